@@ -2,8 +2,12 @@
 #define BAGGAGEMANAGER_H
 
 #include "BaggageRecord.h"
+#include "StorageEngine.h"
+#include "MutationJournal.h"
+#include "DeskReconciler.h"
 #include <QVector>
 #include <QString>
+#include <QHash>
 #include <memory>
 
 /**
@@ -12,7 +16,8 @@
  */
 class BaggageManager {
 public:
-    BaggageManager();
+    // storage - хранилище записей (по умолчанию текущее, см. StorageEngine::current())
+    explicit BaggageManager(StorageEngine& storage = StorageEngine::current());
     ~BaggageManager();
 
     // Функция 1: Создать файл с заданной структурой записи
@@ -28,7 +33,8 @@ public:
     QVector<BaggageRecord> filterPassengersWithSingleItem20_30kg() const;
 
     // Функция 4: Сформировать файл с номером рейса, ФИО и общим весом багажа
-    bool createSummaryFile(const QString& filename);
+    bool createSummaryFile(const QString& filename,
+                           const SummaryExportOptions& options = SummaryExportOptions());
 
     // Функция 6: Добавить запись
     bool addRecord(const BaggageRecord& record);
@@ -49,13 +55,76 @@ public:
     QVector<BaggageRecord> findRecordsByFlightNumber(const QString& flightNumber) const;
     QVector<BaggageRecord> findRecordsByPassengerName(const QString& passengerName) const;
 
+    // Бирки вещей: поиск по индексу в памяти (бирка -> вещь), который строится
+    // из хранилища при первом поиске после загрузки данных. Бирки, которых нет
+    // в индексе (новые вещи, закрытые рейсы), ищутся в хранилище.
+    // 1 - найдена, 0 - нет такой бирки, -1 - ошибка хранилища
+    int resolveBagTag(qint64 tag, BagTagInfo* info);
+    // Перестроить индекс бирок; -1 - ошибка
+    int rebuildBagTagIndex();
+    int bagTagIndexSize() const { return m_bagTags.size(); }
+
+    // Архив рейсов (компактный сжатый формат, см. FlightArchive)
+    bool exportArchive(const QString& filename, const QStringList& flightNumbers = QStringList());
+    int importArchive(const QString& filename);
+
+    // Кеш загружен из снимка и ещё не сверен с БД
+    bool isWarmedFromSnapshot() const { return m_warmedFromSnapshot; }
+
+    // Догнать состояние БД после старта из снимка и обновить снимок: читаются
+    // только записи, изменённые после версии снимка; если в БД были удаления
+    // (число записей не сошлось) или версия снимка неизвестна - все записи
+    bool catchUpWithDatabase();
+
+    // Журнал изменений и автономный режим: добавления, удаления и изменения
+    // вещей пишутся в журнал и сразу применяются к кешу, а в БД их переносит
+    // DeskReconciler в фоновом потоке. Интерфейс не ждёт сети.
+    bool openJournal(const QString& filename = MutationJournal::defaultPath());
+    int pendingMutations() const { return m_journal ? m_journal->pendingCount() : 0; }
+    DeskReconciler* reconciler() const { return m_reconciler.get(); }
+    bool isOnline() const;
+
+    // Состояние БД от DeskReconciler: кеш = БД + ещё не перенесённые изменения.
+    // appliedThrough - последний номер журнала, учтённый в records.
+    void applyServerState(const QVector<BaggageRecord>& records, qint64 dataVersion,
+                          quint64 appliedThrough);
+
 private:
+    // Записей архива в одной пачке addRecordsBatch
+    static constexpr int ARCHIVE_IMPORT_BATCH = 5000;
+
+    StorageEngine& m_storage;
     QVector<BaggageRecord> m_records;
     QString m_currentFilename;
+    bool m_warmedFromSnapshot;
+    qint64 m_dataVersion;           // версия данных БД, на которой основан кеш
+    std::unique_ptr<MutationJournal> m_journal;
+    std::unique_ptr<DeskReconciler> m_reconciler;
+    // Пассажиры и рейсы, изменённые этой стойкой после m_dataVersion
+    // (номер последнего изменения в журнале) - для них конфликт не проверяется
+    QHash<QString, quint64> m_touchedPassengers;
+    QHash<QString, quint64> m_touchedFlights;
+    // Индекс бирок; устаревает при каждой загрузке записей из хранилища
+    QHash<qint64, BagTagInfo> m_bagTags;
+    bool m_bagTagsStale;
 
     // Вспомогательные методы для работы с файлами
     bool saveBinaryFile(const QString& filename);
     bool loadBinaryFile(const QString& filename);
+
+    // Записи из БД с наложенными неперенесёнными изменениями журнала
+    bool refreshFromDatabase();
+    // Наложить на кеш записи, изменённые в БД после m_dataVersion; false - нужно полное чтение
+    bool mergeChangesFromDatabase();
+    void overlayPendingMutations();
+    void markTouched(const MutationJournal::Entry& entry);
+    // Изменение записано в журнал: применить к кешу и разбудить сверку
+    bool acceptJournaled(const MutationJournal::Entry& entry, int* affected = nullptr);
+    // Убрать из индекса бирок вещи удалённых рейсов / изменённого пассажира
+    void forgetBagTags(const MutationJournal::Entry& entry);
+    // Версия для проверки конфликтов; NO_VERSION, если записи уже менялись
+    // этой стойкой после m_dataVersion
+    qint64 baseVersionFor(const QStringList& flightNumbers, const QString& passengerName) const;
 };
 
 #endif // BAGGAGEMANAGER_H
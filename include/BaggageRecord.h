@@ -4,6 +4,7 @@
 #include <QString>
 #include <QVector>
 #include <QDataStream>
+#include <QMetaType>
 
 /**
  * @brief Класс для хранения данных об одной записи багажа пассажира
@@ -12,6 +13,15 @@ class BaggageRecord {
 public:
     static constexpr int MAX_ITEMS = 5; 
 
+    // Коды ошибок валидации (порядок проверки совпадает с isValid())
+    enum ValidationError : quint8 {
+        NoError = 0,
+        InvalidFlightNumber,
+        InvalidPassengerName,
+        InvalidItemCount,
+        InvalidWeight
+    };
+
     BaggageRecord();
     BaggageRecord(const QString& flightNumber, const QString& passengerName,
                   const QVector<double>& itemWeights);
@@ -34,6 +44,11 @@ public:
     static bool isValidFlightNumber(const QString& flightNumber);
     static bool isValidPassengerName(const QString& name);
     bool isValid() const;
+    ValidationError validate() const;
+
+    // Пакетная валидация: код ошибки для каждой записи
+    static QVector<ValidationError> validateBatch(const QVector<BaggageRecord>& records);
+    static QString validationErrorText(ValidationError error);
 
     // Сериализация для сохранения в файл
     friend QDataStream& operator<<(QDataStream& out, const BaggageRecord& record);
@@ -45,4 +60,7 @@ private:
     QVector<double> m_itemWeights; 
 };
 
+// Для передачи записей между потоками через сигналы
+Q_DECLARE_METATYPE(BaggageRecord)
+
 #endif // BAGGAGERECORD_H
@@ -0,0 +1,160 @@
+#ifndef BAGGAGESERVICE_H
+#define BAGGAGESERVICE_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QMultiHash>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QThreadPool>
+#include <QReadWriteLock>
+#include <QMutex>
+#include <QTimer>
+#include <QPointer>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include "BaggageRecord.h"
+
+class WriteBehindQueue;
+class ScanEventIngestor;
+
+class QIODevice;
+class QLocalServer;
+class QTcpServer;
+
+/**
+ * @brief Параметры сервиса
+ */
+struct ServiceOptions {
+    QString socketName = "baggage-service";   // пусто - без локального сокета
+    QString listenAddress = "127.0.0.1";       // не локальный адрес - только с authToken
+    QString authToken;                         // токен запросов по TCP; пусто - без проверки
+    quint16 tcpPort = 0;                       // 0 - без TCP
+    int workerThreads = 0;                     // 0 - по числу ядер
+    int cacheRefreshSeconds = 60;              // 0 - без периодической сверки с БД
+    int maxRequestSize = 1 << 20;              // байт в одной строке запроса
+    bool writeBehind = false;                  // добавления - групповым коммитом
+    int groupDelayMs = 5;                      // ожидание добора группы (writeBehind)
+    QString scanSocketName;                    // сокет событий сканирования; пусто - без приёма
+};
+
+/**
+ * @brief Сервис без GUI: операции с багажом по протоколу JSON поверх
+ * QLocalServer и/или TCP
+ *
+ * Протокол: один JSON-объект на строку в обе стороны.
+ * Запрос:  {"id": 1, "op": "find", "flight_number": "SU1234"}
+ * Ответ:   {"id": 1, "ok": true, "result": ...} или {"id": 1, "ok": false, "error": "..."}
+ *
+ * Операции: ping, add, find, delete, change_items, filter, report, refresh,
+ * last_scan.
+ * Если задан authToken, каждый запрос по TCP должен содержать поле
+ * "token" с этим значением; без токена TCP слушает только локальный адрес.
+ * Локальный сокет доступен только пользователю сервиса и токена не требует.
+ * Запросы выполняются пулом потоков, у каждого потока своё подключение к БД
+ * (см. DatabaseManager). Ответы на запросы одного клиента могут приходить
+ * не по порядку - клиент сопоставляет их по id.
+ *
+ * Чтение (find, filter) обслуживается из общего кеша открытых рейсов под
+ * блокировкой чтения; find, не нашедший записей в кеше, ищет в БД, включая
+ * архив закрытых рейсов. Если у пассажира есть записи в кеше, его записи
+ * в архиве не возвращаются. Изменения выполняются по одному и сразу
+ * обновляют кеш. В режиме writeBehind
+ * добавления не занимают поток пула: они уходят в WriteBehindQueue, и ответ
+ * отправляется после коммита группы.
+ *
+ * Если задан scanSocketName, сервис слушает второй локальный сокет для
+ * событий сканирования бирок: строки "бирка<TAB>место[<TAB>время]" без
+ * ответов, приём - ScanEventIngestor. Последнее место бирки отдаёт
+ * операция last_scan {"tag": n}.
+ */
+class BaggageService : public QObject {
+    Q_OBJECT
+
+public:
+    explicit BaggageService(QObject* parent = nullptr);
+    ~BaggageService();
+
+    bool start(const ServiceOptions& options = ServiceOptions());
+    void stop();
+
+    // Обработка одного запроса (потокобезопасно)
+    QJsonObject handleRequest(const QJsonObject& request);
+
+    QString errorString() const { return m_errorString; }
+    qint64 requestsServed() const { return m_requestsServed.load(); }
+    int cachedRecordCount() const;
+
+private slots:
+    void onNewLocalConnection();
+    void onNewTcpConnection();
+    void onNewScanConnection();
+    void onScanResume();
+    void onRefreshTimer();
+
+private:
+    // Буфер чтения сокета событий: пока приём отложен, сканер упирается в
+    // него и в буфер сокета ОС, а не в память сервиса
+    static constexpr qint64 SCAN_READ_BUFFER = 64 * 1024;
+    // Через сколько снова читать отложенные сокеты событий
+    static constexpr int SCAN_RESUME_MS = 20;
+
+    void attachClient(QIODevice* socket);
+    void readRequests(QIODevice* socket);
+    // Строки событий сканирования - в основном потоке, он единственный пишет в буфер приёма.
+    // Буфер заполнен - чтение сокета откладывается (pauseScans), цикл событий не ждёт
+    void readScans(QIODevice* socket);
+    void pauseScans(QIODevice* socket);
+    // trusted - клиент локального сокета (без проверки токена)
+    void dispatchLine(const QByteArray& line, bool trusted,
+                      const std::function<void(const QJsonObject&)>& reply);
+
+    // Операции протокола (вызываются из потоков пула)
+    QJsonObject opAdd(const QJsonObject& request);
+    void opAddWriteBehind(const QJsonObject& request,
+                          const std::function<void(const QJsonObject&)>& reply);
+    static bool recordFromRequest(const QJsonObject& request, BaggageRecord& record, QString& error);
+    QJsonObject opFind(const QJsonObject& request);
+    QJsonObject opDelete(const QJsonObject& request);
+    QJsonObject opChangeItems(const QJsonObject& request);
+    QJsonObject opFilter();
+    QJsonObject opReport(const QJsonObject& request);
+    QJsonObject opLastScan(const QJsonObject& request);
+
+    // Кеш записей: рейс -> записи, ФИО -> рейсы
+    bool reloadCache();
+    void setCache(const QVector<BaggageRecord>& records);
+    void cacheInsert(const BaggageRecord& record);
+    void cacheRemovePassenger(const QString& passengerName);
+    void cacheRemoveFlight(const QString& flightNumber);
+
+    static QJsonObject recordToJson(const BaggageRecord& record);
+    static QJsonArray recordsToJson(const QVector<BaggageRecord>& records);
+    static bool weightsFromJson(const QJsonValue& value, QVector<double>& weights);
+
+    ServiceOptions m_options;
+    QLocalServer* m_localServer;
+    QTcpServer* m_tcpServer;
+    QLocalServer* m_scanServer;
+    QTimer m_refreshTimer;
+    QThreadPool m_pool;
+    QString m_errorString;
+    std::atomic<qint64> m_requestsServed;
+
+    mutable QReadWriteLock m_cacheLock;
+    QHash<QString, QVector<BaggageRecord>> m_byFlight;
+    QMultiHash<QString, QString> m_flightsByName;
+    int m_cachedCount;
+
+    // Изменения выполняются по одному, чтобы БД и кеш не расходились
+    QMutex m_writeMutex;
+    std::unique_ptr<WriteBehindQueue> m_writeBehind;
+    std::unique_ptr<ScanEventIngestor> m_scans;
+    QTimer m_scanResumeTimer;
+    QVector<QPointer<QIODevice>> m_pausedScans;
+};
+
+#endif // BAGGAGESERVICE_H
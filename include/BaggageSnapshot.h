@@ -0,0 +1,76 @@
+#ifndef BAGGAGESNAPSHOT_H
+#define BAGGAGESNAPSHOT_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include "BaggageRecord.h"
+
+/**
+ * @brief Версионированный бинарный снимок кеша записей о багаже
+ *
+ * Формат файла (little-endian):
+ *   [заголовок 64 байта][индекс смещений][записи фиксированного размера][таблица строк]
+ * Строки (номера рейсов и ФИО) хранятся в UTF-8 один раз в таблице строк,
+ * записи ссылаются на них по смещению. Файл отображается в память (QFile::map):
+ * open() проверяет только заголовок, recordAt() разбирает одну запись через
+ * индекс смещений. readAll() создаёт все записи сразу - так загружается кеш
+ * BaggageManager (таблице главного окна нужны все записи); отображение
+ * избавляет от копии файла в буфере и разбора QDataStream, но не от этого прохода.
+ *
+ * Файлы без сигнатуры читаются как поток QDataStream из BaggageRecord
+ * (совместимость со старым форматом .dat).
+ */
+class BaggageSnapshot {
+public:
+    // 2: в заголовке хранится версия данных БД (DatabaseManager::getDataVersion)
+    static constexpr quint16 FORMAT_VERSION = 2;
+
+    BaggageSnapshot();
+    ~BaggageSnapshot();
+
+    // Запись снимка (атомарно через QSaveFile)
+    static bool write(const QString& filename, const QVector<BaggageRecord>& records,
+                      QString* errorString = nullptr, qint64 dataVersion = -1);
+
+    // Открыть снимок (отображение в память) или файл старого формата
+    bool open(const QString& filename);
+    void close();
+    bool isOpen() const { return m_isOpen; }
+
+    int recordCount() const;
+    BaggageRecord recordAt(int index) const;
+    QVector<BaggageRecord> readAll() const;
+
+    bool isLegacyFormat() const { return m_isLegacy; }
+    qint64 createdAtMsecs() const { return m_createdAtMsecs; }
+    // Версия данных БД, с которой снят снимок; -1 - неизвестна
+    qint64 dataVersion() const { return m_dataVersion; }
+    QString errorString() const { return m_errorString; }
+
+    // Путь к последнему снимку для быстрого старта приложения
+    static QString lastSnapshotPath();
+
+private:
+    bool openMapped();
+    bool openLegacy();
+
+    QFile m_file;
+    const uchar* m_data;
+    qint64 m_size;
+    bool m_isOpen;
+    bool m_isLegacy;
+
+    quint32 m_recordCount;
+    quint64 m_indexOffset;
+    quint64 m_recordsOffset;
+    quint64 m_stringTableOffset;
+    quint64 m_stringTableSize;
+    qint64 m_createdAtMsecs;
+    qint64 m_dataVersion;
+
+    QVector<BaggageRecord> m_legacyRecords;
+    QString m_errorString;
+};
+
+#endif // BAGGAGESNAPSHOT_H
@@ -0,0 +1,36 @@
+#ifndef BENCHFIXTURE_H
+#define BENCHFIXTURE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "BaggageRecord.h"
+
+class StorageEngine;
+
+/**
+ * @brief Тестовые данные для замеров и проверок baggage-bench
+ *
+ * Замеры с БД работают только на рейсах ZZ9000-ZZ9099 и удаляют их после
+ * себя; если на этих рейсах уже есть записи, замер не запускается.
+ */
+class BenchFixture {
+public:
+    static constexpr int FLIGHTS = 100;
+    static constexpr int BATCH_SIZE = 5000;
+
+    // Номера тестовых рейсов
+    static QStringList flightNumbers();
+
+    // Запись номер index: рейс по кругу, ФИО уникальное, две вещи
+    static BaggageRecord record(int index);
+
+    // Записи для проверки архива: общие префиксы ФИО, повторы рейсов,
+    // от 1 до MAX_ITEMS вещей весом от 0,01 до 100 кг
+    static QVector<BaggageRecord> archiveRecords(int count);
+
+    // true, если на тестовых рейсах нет записей; иначе - текст причины в error
+    static bool flightsAreFree(StorageEngine& storage, QString* error);
+};
+
+#endif // BENCHFIXTURE_H
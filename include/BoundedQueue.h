@@ -0,0 +1,69 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QQueue>
+#include <utility>
+
+/**
+ * @brief Потокобезопасная очередь ограниченной ёмкости между стадиями конвейера
+ *
+ * push() блокируется, пока очередь заполнена; pop() - пока она пуста.
+ * После close() новые элементы не принимаются, а pop() отдаёт оставшиеся
+ * элементы и затем возвращает false.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(int capacity) : m_capacity(capacity > 0 ? capacity : 1), m_closed(false) {}
+
+    bool push(T item) {
+        QMutexLocker locker(&m_mutex);
+        while (m_queue.size() >= m_capacity && !m_closed) {
+            m_notFull.wait(&m_mutex);
+        }
+        if (m_closed) {
+            return false;
+        }
+        m_queue.enqueue(std::move(item));
+        m_notEmpty.wakeOne();
+        return true;
+    }
+
+    bool pop(T& item) {
+        QMutexLocker locker(&m_mutex);
+        while (m_queue.isEmpty() && !m_closed) {
+            m_notEmpty.wait(&m_mutex);
+        }
+        if (m_queue.isEmpty()) {
+            return false;
+        }
+        item = m_queue.dequeue();
+        m_notFull.wakeOne();
+        return true;
+    }
+
+    void close() {
+        QMutexLocker locker(&m_mutex);
+        m_closed = true;
+        m_notEmpty.wakeAll();
+        m_notFull.wakeAll();
+    }
+
+    int size() const {
+        QMutexLocker locker(&m_mutex);
+        return m_queue.size();
+    }
+
+private:
+    mutable QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+    QQueue<T> m_queue;
+    int m_capacity;
+    bool m_closed;
+};
+
+#endif // BOUNDEDQUEUE_H
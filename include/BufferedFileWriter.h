@@ -0,0 +1,59 @@
+#ifndef BUFFEREDFILEWRITER_H
+#define BUFFEREDFILEWRITER_H
+
+#include <QFile>
+#include <QString>
+#include <QByteArray>
+#include <memory>
+
+/**
+ * @brief Буферизованная запись UTF-8 в файл с опциональным сжатием gzip
+ *
+ * Данные накапливаются в большом буфере и сбрасываются на диск одним вызовом
+ * write(), без проверки состояния на каждой строке. Ошибка запоминается
+ * и возвращается из close().
+ */
+class BufferedFileWriter {
+public:
+    static constexpr int DEFAULT_BUFFER_SIZE = 1 << 20;  // 1 МиБ
+
+    explicit BufferedFileWriter(int bufferSize = DEFAULT_BUFFER_SIZE);
+    ~BufferedFileWriter();
+
+    // Сжатие gzip доступно при сборке с zlib (BAGGAGE_HAVE_ZLIB)
+    static bool isGzipSupported();
+
+    bool open(const QString& filename, bool gzip = false);
+
+    void write(const char* data, int size);
+    void write(const QByteArray& data) { write(data.constData(), static_cast<int>(data.size())); }
+    void write(const QString& text) { write(text.toUtf8()); }
+    void write(char c);
+
+    // Сбросить буфер и закрыть файл; false - при любой ошибке записи
+    bool close();
+
+    // Прервать запись и удалить частично записанный файл
+    void discard();
+
+    bool hasError() const { return m_hasError; }
+    QString errorString() const { return m_errorString; }
+    qint64 bytesWritten() const { return m_bytesWritten; }
+
+private:
+    struct GzipState;
+
+    bool flushBuffer(bool finish);
+    bool writeToFile(const char* data, qint64 size);
+    void setError(const QString& message);
+
+    QFile m_file;
+    QByteArray m_buffer;
+    int m_bufferSize;
+    std::unique_ptr<GzipState> m_gzip;
+    bool m_hasError;
+    QString m_errorString;
+    qint64 m_bytesWritten;
+};
+
+#endif // BUFFEREDFILEWRITER_H
@@ -0,0 +1,83 @@
+#ifndef BULKIMPORTER_H
+#define BULKIMPORTER_H
+
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+#include <atomic>
+#include <functional>
+#include "BaggageRecord.h"
+
+/**
+ * @brief Статистика импорта (пропускная способность и результат)
+ */
+struct ImportStats {
+    qint64 bytesRead = 0;
+    qint64 totalBytes = 0;
+    qint64 rowsRead = 0;
+    qint64 rowsImported = 0;
+    qint64 rowsRejected = 0;
+    qint64 batchesWritten = 0;
+    qint64 elapsedMs = 0;
+
+    double rowsPerSecond() const {
+        return elapsedMs > 0 ? rowsImported * 1000.0 / elapsedMs : 0.0;
+    }
+};
+
+/**
+ * @brief Параметры импорта манифестов
+ */
+struct ImportOptions {
+    enum Format { AutoDetect, Csv, JsonLines };
+
+    Format format = AutoDetect;
+    int chunkSize = 1 << 20;      // байт на один блок чтения
+    int parserThreads = 0;        // 0 - по числу ядер
+    int batchSize = 5000;         // записей в одной транзакции
+    int queueCapacity = 8;        // блоков в очереди между стадиями
+    QString errorReportPath;      // пусто - <файл>.errors.txt
+    // Вызывается из потока записи после каждой пачки
+    std::function<void(const ImportStats&)> progress;
+};
+
+/**
+ * @brief Конвейер массового импорта манифестов CSV / JSON Lines
+ *
+ * Стадии: чтение файла блоками -> параллельный разбор и валидация
+ * (BaggageRecord::validateBatch) -> пакетная запись в БД в отдельном подключении.
+ * Между стадиями - очереди ограниченной ёмкости, поэтому память
+ * не зависит от размера файла. Отклонённые строки пишутся в файл ошибок.
+ *
+ * CSV: рейс;ФИО;вес1[;вес2...] (разделитель ; , или табуляция, строка
+ * заголовка пропускается). JSON Lines:
+ * {"flight_number": "SU1234", "passenger_name": "...", "weights": [15.5, 22.0]}
+ */
+class BulkImporter {
+public:
+    BulkImporter();
+
+    // Блокирующий запуск; false - ошибка чтения файла или БД (см. errorString())
+    bool run(const QString& filename, const ImportOptions& options = ImportOptions());
+
+    // Прервать импорт (можно вызывать из любого потока)
+    void cancel() { m_cancelled = true; }
+    bool isCancelled() const { return m_cancelled.load(); }
+
+    ImportStats stats() const { return m_stats; }
+    QString errorString() const { return m_errorString; }
+    QString errorReportPath() const { return m_errorReportPath; }
+
+    // Разбор одной строки (используется стадией разбора); проверяются только
+    // структура и веса, остальное - BaggageRecord::validateBatch() по блоку
+    static bool parseCsvLine(const QByteArray& line, BaggageRecord& record, QString& error);
+    static bool parseJsonLine(const QByteArray& line, BaggageRecord& record, QString& error);
+
+private:
+    std::atomic<bool> m_cancelled;
+    ImportStats m_stats;
+    QString m_errorString;
+    QString m_errorReportPath;
+};
+
+#endif // BULKIMPORTER_H
@@ -2,19 +2,53 @@
 #define DATABASEMANAGER_H
 
 #include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QHash>
 #include <QString>
 #include <QVector>
 #include <QDateTime>
+#include <QThreadStorage>
+#include <QMutex>
+#include <atomic>
+#include <functional>
+#include <memory>
 #include "BaggageRecord.h"
+#include "StorageEngine.h"
+
+class QThread;
+
+/**
+ * @brief Где выполнялись чтения (см. DatabaseManager::attachReplica)
+ */
+struct ReadRoutingStats {
+    qint64 primaryReads = 0;
+    qint64 replicaReads = 0;
+    qint64 replicaFallbacks = 0;   // ошибка на реплике - повтор на основном сервере
+    qint64 laggedSkips = 0;        // реплика отстала больше допустимого
+    qint64 staleSkips = 0;         // на реплике ещё нет изменений, записанных этим процессом
+    qint64 replicaLagMs = -1;      // последнее измеренное отставание; -1 - не измерялось
+};
 
 /**
  * @brief Класс для работы с PostgreSQL базой данных
- * Управляет подключением и операциями с таблицей baggage_records
+ * Управляет подключением и операциями с таблицей baggage_records.
+ * Методы можно вызывать из любого потока: в основном потоке используется
+ * основное подключение, в остальных - собственное подключение потока,
+ * открываемое при первом обращении. Последняя ошибка хранится по потокам.
+ *
+ * Помимо StorageEngine даёт средства, которые есть только у PostgreSQL:
+ * серверные курсоры, пакетную вставку через unnest() и отдельные
+ * подключения рабочих потоков (BulkImporter, WriteBehindQueue, сервис).
  */
-class DatabaseManager {
+class DatabaseManager : public StorageEngine {
 public:
     static DatabaseManager& instance();
 
+    // Отдельный экземпляр со своим именованным подключением (сегмент, реплика).
+    // Создаётся в потоке, который будет использовать основное подключение.
+    explicit DatabaseManager(const QString& connectionName);
+    ~DatabaseManager() override;
+
     // Инициализация и подключение
     bool connectToDatabase(const QString& host = "localhost",
                           int port = 5432,
@@ -22,57 +56,204 @@ public:
                           const QString& user = "postgres",
                           const QString& password = "postgres");
 
-    void disconnectFromDatabase();
-    bool isConnected() const;
+    // Подключение по переменным окружения DB_HOST, DB_PORT, DB_NAME, DB_USER, DB_PASSWORD
+    // (DB_CONNECT_TIMEOUT - таймаут подключения в секундах, по умолчанию 3).
+    // DB_REPLICA_HOST, DB_REPLICA_PORT, DB_REPLICA_MAX_LAG_MS - реплика для чтения
+    bool connectFromEnvironment(QString* connectionInfo = nullptr) override;
+
+    // Реплика только для чтения (имя БД и учётные данные - как у основного сервера).
+    // Загрузка всех записей, поиск, отчёты за период и сводка идут на реплику,
+    // если она отстаёт не больше maxLagMs и уже содержит изменения, записанные
+    // этим процессом; иначе, а также при ошибке на реплике - на основной сервер.
+    // false - реплика пока недоступна (подключение повторяется при чтениях).
+    bool attachReplica(const QString& host, int port, int maxLagMs);
+    bool hasReplica() const { return m_replica != nullptr; }
+    ReadRoutingStats readRoutingStats() const;
+
+    void disconnectFromDatabase() override;
+    bool isConnected() const override;
+
+    // Проверить связь с сервером (SELECT 1) и при обрыве переподключиться
+    bool checkConnection() override;
+
+    // Закрыть подключение текущего (не основного) потока перед его завершением
+    void releaseThreadConnection() override;
 
     // Функция 1: Создать таблицу (инициализация БД)
-    bool createTable();
+    bool createTable() override;
 
     // Функция 2: Получить все записи
-    QVector<BaggageRecord> getAllRecords();
+    // dataVersion - версия данных (см. getDataVersion), прочитанная в том же снимке БД
+    QVector<BaggageRecord> getAllRecords(qint64* dataVersion = nullptr) override;
 
     // Функция 3: Фильтр - пассажиры с 1 вещью 20-30 кг
-    QVector<BaggageRecord> filterPassengersWithSingleItem20_30kg();
+    QVector<BaggageRecord> filterPassengersWithSingleItem20_30kg() override;
 
     // Функция 4: Создать файл сводки (номер рейса, ФИО, общий вес)
-    bool createSummaryFile(const QString& filename);
+    bool createSummaryFile(const QString& filename,
+                           const SummaryExportOptions& options = SummaryExportOptions()) override;
 
     // Функция 6: Добавить запись
-    bool addRecord(const BaggageRecord& record);
+    bool addRecord(const BaggageRecord& record) override;
 
     // Функция 7: Удалить записи по номерам рейсов
-    int deleteRecordsByFlightNumbers(const QStringList& flightNumbers);
+    int deleteRecordsByFlightNumbers(const QStringList& flightNumbers) override;
 
     // Функция 8: Изменить количество вещей для указанных ФИО
     bool changeItemCountByName(const QString& passengerName,
-                               const QVector<double>& newWeights);
+                               const QVector<double>& newWeights) override;
+
+    // Пакетные функции 7 и 8: одна транзакция, параметры-массивы частями по BATCH_CHUNK_SIZE
+    static constexpr int BATCH_CHUNK_SIZE = 500;
+    int deleteFlightsBatch(const QStringList& flightNumbers, QVector<int>* outcomes = nullptr) override;
+    int changeItemsBatch(const QVector<ItemChange>& changes, QVector<int>* outcomes = nullptr) override;
+
+    // Архив закрытых рейсов: таблицы baggage_archive (вещи - массивом весов)
+    // и closed_flights (итоги). Перенос - одна транзакция, частями по BATCH_CHUNK_SIZE
+    int closeFlights(const QStringList& flightNumbers, QVector<int>* outcomes = nullptr) override;
+    QVector<FlightStats> getClosedFlightStats() override;
+
+    // Бирки вещей: столбец baggage_items.bag_tag (последовательность bag_tag_seq,
+    // уникальный индекс), в архиве - массив bag_tags
+    int resolveBagTag(qint64 tag, BagTagInfo* info) override;
+    bool streamBagTags(const BagTagHandler& handler) override;
+    // Новые бирки этой БД - не меньше first (диапазоны сегментов не пересекаются)
+    bool reserveBagTags(qint64 first);
 
     // Вспомогательные методы
-    void clearAllRecords();
-    int getRecordCount();
-    QString getLastError() const { return m_lastError; }
+    void clearAllRecords() override;
+    int getRecordCount() override;
+
+    // Версия данных: счётчик baggage_version; -1 - ошибка. Записи с
+    // row_version больше версии изменены транзакциями, зафиксированными после её чтения.
+    qint64 getDataVersion(int* recordCount = nullptr) override;
+    // Число записей пассажира / рейсов, изменённых после версии; -1 - ошибка
+    int countPassengerChangesSince(const QString& passengerName, qint64 version) override;
+    int countFlightChangesSince(const QStringList& flightNumbers, qint64 version) override;
+    bool getRecordsChangedSince(qint64 version, QVector<BaggageRecord>* records,
+                                qint64* dataVersion, int* recordCount) override;
 
     // Поиск
-    QVector<BaggageRecord> findRecordsByFlightNumber(const QString& flightNumber);
-    QVector<BaggageRecord> findRecordsByPassengerName(const QString& passengerName);
+    QVector<BaggageRecord> findRecordsByFlightNumber(const QString& flightNumber) override;
+    QVector<BaggageRecord> findRecordsByPassengerName(const QString& passengerName) override;
+    // Только рабочая таблица (без архива), основной сервер - для кеша открытых рейсов
+    QVector<BaggageRecord> findOpenRecordsByPassengerName(const QString& passengerName);
 
     // Отчёты за период (ТЗ п. 1.2.4.1.1)
-    QVector<BaggageRecord> getRecordsByDateRange(const QDateTime& from, const QDateTime& to);
+    QVector<BaggageRecord> getRecordsByDateRange(const QDateTime& from, const QDateTime& to) override;
+    QVector<FlightStats> getFlightStatsByDateRange(const QDateTime& from, const QDateTime& to) override;
+    bool streamRecordsByDateRange(const QDateTime& from, const QDateTime& to,
+                                  const RecordHandler& recordHandler) override;
+
+    // Потоковое чтение всех записей (или только указанных рейсов) с вещами
+    bool streamRecords(const QStringList& flightNumbers, const RecordHandler& recordHandler) override;
+
+    // Потоковое чтение через серверный курсор (память не зависит от объёма выборки).
+    // rowHandler вызывается для каждой строки; вернуть false - прекратить чтение.
+    static constexpr int CURSOR_FETCH_SIZE = 10000;
+    bool streamQuery(const QString& selectSql,
+                     const std::function<bool(const QSqlQuery&)>& rowHandler,
+                     int fetchSize = CURSOR_FETCH_SIZE);
+
+    // Отдельное подключение для рабочего потока (QSqlDatabase нельзя
+    // использовать из разных потоков). Открывается и закрывается в этом потоке.
+    QSqlDatabase openWorkerConnection(const QString& connectionName);
+    static void closeWorkerConnection(const QString& connectionName);
+
+    // Пакетная вставка записей с вещами за одну транзакцию (3 запроса на пачку).
+    // ownTransaction = false - транзакцию начинает и завершает вызывающий.
+    // Метод статический: после фиксации вызывающий сам вызывает noteWrite
+    static bool insertRecordsBatch(QSqlDatabase& db, const QVector<BaggageRecord>& records,
+                                   QString* error = nullptr, bool ownTransaction = true);
+
+    // Подключение текущего потока (основное - в потоке-владельце)
+    QSqlDatabase connection();
+
+    // После фиксации записи в обход методов класса (insertRecordsBatch,
+    // PurgeEngine): запомнить позицию WAL, чтобы чтения с реплики видели
+    // изменения этого процесса
+    void noteWrite(QSqlDatabase db);
+
+    // Литералы массивов PostgreSQL для параметров вида ?::text[] / ?::int[]
+    static QString pgTextArray(const QStringList& values);
+    template <typename Number>
+    static QString pgNumberArray(const QVector<Number>& values);
+
+    // Пакетная вставка через подключение текущего потока
+    bool addRecordsBatch(const QVector<BaggageRecord>& records) override;
 
     // Доступ к базе данных (для LoginDialog и других компонентов)
-    QSqlDatabase& getDatabase() { return m_db; }
+    QSqlDatabase& getDatabase() override { return m_db; }
+
+    QString engineName() const override { return "postgres"; }
+    bool isEmbedded() const override { return false; }
 
 private:
+    // Как часто перепроверять отставание реплики и через сколько
+    // снова пробовать реплику после ошибки на ней
+    static constexpr qint64 REPLICA_CHECK_INTERVAL_MS = 1000;
+    static constexpr qint64 REPLICA_RETRY_MS = 10000;
+
     DatabaseManager();
-    ~DatabaseManager();
     DatabaseManager(const DatabaseManager&) = delete;
     DatabaseManager& operator=(const DatabaseManager&) = delete;
 
     QSqlDatabase m_db;
-    QString m_lastError;
+    QThread* m_ownerThread;
+    QThreadStorage<QString> m_threadConnection;
+    // Подготовленные запросы подключений текущего потока: "подключение\nSQL" -> запрос
+    QThreadStorage<QHash<QString, QSqlQuery>> m_statements;
+
+    // Реплика и состояние маршрутизации чтений (m_replicaMutex)
+    std::unique_ptr<DatabaseManager> m_replica;
+    int m_replicaMaxLagMs;
+    std::atomic<qint64> m_lastWriteLsn;     // позиция WAL после последней записи процесса
+    mutable QMutex m_replicaMutex;
+    qint64 m_replicaReplayLsn;
+    qint64 m_replicaCheckedAt;
+    qint64 m_replicaDownUntil;
+    bool m_replicaProbing;                  // запрос состояния реплики уже выполняется
+    ReadRoutingStats m_readStats;
+
+    // Подключение для чтения: реплика или основной сервер текущего потока
+    struct ReadRoute {
+        QSqlDatabase db;
+        bool replica = false;
+    };
+    ReadRoute readRoute();
+    // Ошибка чтения: если оно шло на реплику, реплика откладывается на
+    // REPLICA_RETRY_MS и возвращается true - чтение нужно повторить
+    bool fallBackToPrimary(const ReadRoute& route, const char* operation);
+    // Позиция воспроизведения WAL и отставание реплики; вызывается без
+    // m_replicaMutex (сетевой запрос), false - реплика недоступна
+    bool probeReplica(qint64* replayLsn, qint64* lagMs);
+    bool streamQuery(QSqlDatabase db, const QString& selectSql,
+                     const std::function<bool(const QSqlQuery&)>& rowHandler, int fetchSize);
+
+    // Запрос, подготовленный на подключении один раз и переиспользуемый
+    // (значения привязываются по номеру: bindValue(0, ...)). После чтения
+    // строк вызывать finish(), чтобы кеш не держал выборку в памяти.
+    QSqlQuery preparedQuery(const QSqlDatabase& db, const QString& sql);
+    // Перед закрытием подключения в текущем потоке
+    void dropPreparedQueries(const QString& connectionName);
 
     // Вспомогательные методы
-    QVector<double> getItemWeights(int recordId);
+    QString sqlLiteral(const QVariant& value) const;
+    static BaggageRecord recordFromAggregateRow(const QSqlQuery& row);
+    static QString connectOptions();
 };
 
+template <typename Number>
+QString DatabaseManager::pgNumberArray(const QVector<Number>& values) {
+    QString result = "{";
+    for (int i = 0; i < values.size(); ++i) {
+        if (i > 0) {
+            result += ',';
+        }
+        result += QString::number(values[i]);
+    }
+    result += '}';
+    return result;
+}
+
 #endif // DATABASEMANAGER_H
@@ -7,7 +7,6 @@
 #include <QTextEdit>
 #include <QLabel>
 #include <QDateTime>
-#include "BaggageRecord.h"
 
 class DateRangeReportDialog : public QDialog {
     Q_OBJECT
@@ -29,14 +28,15 @@ private:
     QTextEdit* m_reportTextEdit;
     QLabel* m_statusLabel;
 
-    // Данные отчёта
-    QString m_currentReport;
+    // Параметры сформированного отчёта (текст целиком в памяти не хранится)
+    QDateTime m_reportFrom;
+    QDateTime m_reportTo;
+
+    // В окне предпросмотра показываются только первые строки отчёта
+    static constexpr int PREVIEW_LINES = 1000;
 
     // Методы
     void setupUI();
-    QString generateReportText(const QVector<BaggageRecord>& records,
-                              const QDateTime& from,
-                              const QDateTime& to);
     void showStatus(const QString& message, bool isError = false);
 };
 
@@ -0,0 +1,75 @@
+#ifndef DESKRECONCILER_H
+#define DESKRECONCILER_H
+
+#include <QObject>
+#include <QThread>
+#include <QVector>
+#include <QString>
+#include <atomic>
+#include "BaggageRecord.h"
+#include "MutationJournal.h"
+#include "JournalReplayer.h"
+
+class QTimer;
+
+/**
+ * @brief Фоновая сверка стойки с PostgreSQL
+ *
+ * Работает в собственном потоке со своим подключением к БД, поэтому
+ * ожидание сети (таймауты подключения, обрывы) не блокирует интерфейс.
+ * Раз в intervalMs, а также по reconcileNow():
+ *   1. проверяет связь с БД (connect_timeout, см. DatabaseManager);
+ *   2. переносит неприменённые записи журнала (JournalReplayer);
+ *   3. если данные в БД изменились, читает их вместе с версией, сохраняет
+ *      снимок для следующего старта и отправляет сигналом stateReconciled.
+ * Конфликтующие изменения и изменения, отклонённые БД (ограничения,
+ * неизвестный пассажир), дописываются в файл <журнал>.conflicts (одна
+ * JSON-строка на изменение, поле reason - "conflict" или "rejected") и
+ * сообщаются сигналами: стойка уже показала их как выполненные.
+ */
+class DeskReconciler : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int DEFAULT_INTERVAL_MS = 5000;
+
+    explicit DeskReconciler(MutationJournal* journal, QObject* parent = nullptr);
+    ~DeskReconciler() override;
+
+    void start(int intervalMs = DEFAULT_INTERVAL_MS);
+    void stop();
+
+    bool isOnline() const { return m_online.load(); }
+    QString conflictLogPath() const;
+
+public slots:
+    // Запланировать сверку немедленно (можно вызывать из любого потока)
+    void reconcileNow();
+
+signals:
+    void connectivityChanged(bool online);
+    // appliedThrough - последний номер журнала, уже перенесённый в БД к моменту чтения
+    void stateReconciled(const QVector<BaggageRecord>& records, qint64 dataVersion,
+                         quint64 appliedThrough);
+    void conflictsDetected(int count, const QString& logPath);
+    // Изменения стойки, которые БД отклонила; firstError - текст первой ошибки
+    void changesRejected(int count, const QString& firstError, const QString& logPath);
+
+private:
+    void reconcile();
+    void setOnline(bool online);
+    bool writeConflictLog(const QVector<JournalReplayer::Skipped>& skipped);
+
+    MutationJournal* m_journal;
+    QThread m_thread;
+    QTimer* m_timer;
+    std::atomic<bool> m_online;
+    std::atomic<bool> m_reconcileQueued;
+
+    // Состояние потока сверки
+    bool m_tablesReady;
+    qint64 m_lastVersion;
+    int m_lastCount;
+};
+
+#endif // DESKRECONCILER_H
@@ -0,0 +1,76 @@
+#ifndef FLIGHTARCHIVE_H
+#define FLIGHTARCHIVE_H
+
+#include <QIODevice>
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <memory>
+#include "BaggageRecord.h"
+
+/**
+ * @brief Компактный архивный формат для выгрузки закрытых рейсов
+ *
+ * Файл: сигнатура "BGAR", версия, затем последовательность блоков
+ * [число записей u32][размер сжатых данных u32][qCompress(данные блока)].
+ * Внутри блока записи упорядочены по (рейс, ФИО) и хранятся по столбцам:
+ *   - словарь номеров рейсов + varint-коды рейсов;
+ *   - ФИО во фронтальном кодировании (общий префикс + суффикс);
+ *   - количество вещей;
+ *   - веса в сотых долях кг, дельта к предыдущему весу, zigzag-varint.
+ */
+class FlightArchiveWriter {
+public:
+    static constexpr int DEFAULT_BLOCK_SIZE = 4096;
+
+    explicit FlightArchiveWriter(int blockSize = DEFAULT_BLOCK_SIZE);
+    ~FlightArchiveWriter();
+
+    bool open(const QString& filename);
+    bool open(QIODevice* device);   // устройство должно быть открыто на запись
+    bool write(const BaggageRecord& record);
+    bool close();
+
+    qint64 recordsWritten() const { return m_recordsWritten; }
+    QString errorString() const { return m_errorString; }
+
+private:
+    bool writeHeader();
+    bool flushBlock();
+
+    std::unique_ptr<QFile> m_ownedFile;
+    QIODevice* m_device;
+    int m_blockSize;
+    QVector<BaggageRecord> m_pending;
+    qint64 m_recordsWritten;
+    QString m_errorString;
+};
+
+class FlightArchiveReader {
+public:
+    FlightArchiveReader();
+    ~FlightArchiveReader();
+
+    bool open(const QString& filename);
+    bool open(QIODevice* device);   // устройство должно быть открыто на чтение
+    void close();
+
+    // Потоковое чтение: false - конец архива или ошибка (см. hasError())
+    bool readNext(BaggageRecord& record);
+    QVector<BaggageRecord> readAll();
+
+    bool hasError() const { return !m_errorString.isEmpty(); }
+    QString errorString() const { return m_errorString; }
+
+private:
+    bool readHeader();
+    bool loadNextBlock();
+
+    std::unique_ptr<QFile> m_ownedFile;
+    QIODevice* m_device;
+    QVector<BaggageRecord> m_block;
+    int m_blockPos;
+    QString m_errorString;
+};
+
+#endif // FLIGHTARCHIVE_H
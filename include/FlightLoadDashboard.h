@@ -0,0 +1,82 @@
+#ifndef FLIGHTLOADDASHBOARD_H
+#define FLIGHTLOADDASHBOARD_H
+
+#include <QDialog>
+#include <QAbstractTableModel>
+#include <QTableView>
+#include <QLabel>
+#include <QHash>
+#include <QVector>
+#include "FlightLoadMonitor.h"
+
+/**
+ * @brief Модель итогов по рейсам: строка на рейс
+ *
+ * Изменения кадра применяются точечно: dataChanged для изменённых строк,
+ * вставка новых рейсов в конец и удаление ушедших - без сброса модели,
+ * поэтому выделение и прокрутка сохраняются. Порядок строк задаёт прокси
+ * сортировки в представлении.
+ */
+class FlightLoadModel : public QAbstractTableModel {
+    Q_OBJECT
+
+public:
+    enum Column { FlightColumn, PassengersColumn, ItemsColumn, WeightColumn, ColumnCount };
+
+    explicit FlightLoadModel(QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    void reset(const QVector<FlightStats>& flights);
+    void apply(const QVector<FlightStats>& changed, const QStringList& removed);
+
+    // Итоги по всем рейсам
+    FlightStats totals() const { return m_totals; }
+
+private:
+    void addToTotals(const FlightStats& flight, int sign);
+
+    QVector<FlightStats> m_rows;
+    QHash<QString, int> m_rowByFlight;
+    FlightStats m_totals;
+};
+
+/**
+ * @brief Окно загрузки вылетающих рейсов в реальном времени
+ *
+ * Пассажиры, вещи и вес по рейсам из FlightLoadMonitor: таблица меняется
+ * кадрами не чаще FlightLoadMonitor::DEFAULT_FRAME_INTERVAL_MS, сколько бы
+ * изменений ни записывали стойки. Немодальное, открывается рядом с главным
+ * окном; только для PostgreSQL.
+ */
+class FlightLoadDashboard : public QDialog {
+    Q_OBJECT
+
+public:
+    explicit FlightLoadDashboard(QWidget* parent = nullptr);
+    ~FlightLoadDashboard();
+
+    bool start();
+    QString errorString() const { return m_monitor->errorString(); }
+
+private slots:
+    void onFlightsChanged(const QVector<FlightStats>& changed, const QStringList& removed);
+    void onResynced(const QVector<FlightStats>& flights);
+    void onConnectionChanged(bool online);
+
+private:
+    void createUI();
+    void updateSummary();
+
+    FlightLoadMonitor* m_monitor;
+    FlightLoadModel* m_model;
+    QTableView* m_tableView;
+    QLabel* m_summaryLabel;
+    QLabel* m_statusLabel;
+    bool m_online;
+};
+
+#endif // FLIGHTLOADDASHBOARD_H
@@ -0,0 +1,109 @@
+#ifndef FLIGHTLOADMONITOR_H
+#define FLIGHTLOADMONITOR_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QVariant>
+#include <QSqlDriver>
+#include "StorageEngine.h"
+
+/**
+ * @brief Статистика монитора загрузки
+ */
+struct FlightLoadMonitorStats {
+    qint64 notifications = 0;   // получено уведомлений
+    qint64 applied = 0;         // применено к итогам
+    qint64 skipped = 0;         // уже учтены в загруженных итогах
+    qint64 malformed = 0;
+    qint64 frames = 0;          // отправлено кадров flightsChanged
+    qint64 flightUpdates = 0;   // рейсов во всех кадрах
+    int resyncs = 0;            // полных загрузок итогов
+};
+
+/**
+ * @brief Итоги по рейсам (пассажиры, вещи, вес), обновляемые уведомлениями PostgreSQL
+ *
+ * При запуске подписывается на канал baggage_load (LISTEN) отдельным
+ * подключением и один раз загружает итоги по рабочей таблице вместе со
+ * снимком транзакций. Дальше итоги меняются только по уведомлениям
+ * триггеров (см. DatabaseManager::createTable): каждое содержит изменение
+ * итогов одного рейса одной командой, запросов к БД на изменение нет.
+ * Уведомления транзакций, уже видимых в снимке загрузки, пропускаются.
+ *
+ * Изменённые рейсы копятся и отправляются сигналом flightsChanged не чаще
+ * одного раза за frameIntervalMs, сколько бы уведомлений ни пришло.
+ * Раз в HEALTH_CHECK_MS проверяется подключение; после обрыва итоги
+ * загружаются заново (сигнал resynced).
+ *
+ * Работает в потоке, где создан (нужен цикл событий), только с PostgreSQL
+ * (DatabaseManager::instance()).
+ */
+class FlightLoadMonitor : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int DEFAULT_FRAME_INTERVAL_MS = 100;
+    static constexpr int HEALTH_CHECK_MS = 5000;
+
+    explicit FlightLoadMonitor(QObject* parent = nullptr);
+    ~FlightLoadMonitor() override;
+
+    bool start(int frameIntervalMs = DEFAULT_FRAME_INTERVAL_MS);
+    void stop();
+    bool isRunning() const { return m_running; }
+
+    // Текущие итоги по рейсам, по номеру рейса (с изменениями ещё не отправленного кадра)
+    QVector<FlightStats> flights() const;
+    FlightLoadMonitorStats stats() const { return m_stats; }
+    QString errorString() const { return m_errorString; }
+
+signals:
+    // Рейсы, итоги которых изменились за кадр; removed - рейсы, где не осталось записей
+    void flightsChanged(const QVector<FlightStats>& changed, const QStringList& removed);
+    // Итоги загружены заново целиком (запуск, восстановление подключения)
+    void resynced(const QVector<FlightStats>& flights);
+    void connectionChanged(bool online);
+
+private slots:
+    void onNotification(const QString& name, QSqlDriver::NotificationSource source,
+                        const QVariant& payload);
+    void onFrame();
+    void onHealthCheck();
+
+private:
+    // Вес хранится в сотых долях кг - суммы изменений не накапливают ошибку
+    struct Totals {
+        qint64 passengers = 0;
+        qint64 items = 0;
+        qint64 weightCents = 0;
+    };
+
+    bool resync();
+    bool isInSnapshot(qint64 txid) const;
+    static FlightStats toStats(const QString& flightNumber, const Totals& totals);
+    void setError(const QString& error);
+
+    QString m_connectionName;
+    bool m_running;
+    bool m_online;
+    QTimer m_frameTimer;
+    QTimer m_healthTimer;
+
+    QHash<QString, Totals> m_totals;
+    QSet<QString> m_dirty;
+
+    // Снимок загрузки итогов: txid < xmin или (< xmax и не в xip) - уже учтены
+    qint64 m_snapshotXmin;
+    qint64 m_snapshotXmax;
+    QSet<qint64> m_snapshotXip;
+
+    FlightLoadMonitorStats m_stats;
+    QString m_errorString;
+};
+
+#endif // FLIGHTLOADMONITOR_H
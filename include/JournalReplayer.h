@@ -0,0 +1,50 @@
+#ifndef JOURNALREPLAYER_H
+#define JOURNALREPLAYER_H
+
+#include "MutationJournal.h"
+
+/**
+ * @brief Перенос записей журнала изменений в БД (StorageEngine::current())
+ *
+ * Записи применяются строго по порядку. Подряд идущие добавления пишутся
+ * пачками через StorageEngine::addRecordsBatch(). Если связи с БД нет,
+ * перенос останавливается, и оставшиеся записи ждут следующей попытки;
+ * изменения, отклонённые самой БД (ограничения, неизвестный пассажир),
+ * пропускаются и вместе с текстом ошибки возвращаются вызывающему.
+ *
+ * Конфликты: если запись, которую удаляет или меняет стойка, изменена в БД
+ * после версии данных, которую видела стойка (Entry::baseVersion), изменение
+ * не применяется - приоритет у БД, а запись журнала возвращается вызывающему
+ * для разбора.
+ */
+class JournalReplayer {
+public:
+    enum Result {
+        Applied,     // изменение выполнено
+        Rejected,    // БД доступна, но отклонила изменение
+        Deferred,    // нет связи с БД - повторить позже
+        Conflict     // данные в БД изменены позже baseVersion
+    };
+
+    // Изменение журнала, не применённое к БД
+    struct Skipped {
+        MutationJournal::Entry entry;
+        Result result = Rejected;   // Rejected или Conflict
+        QString error;              // ошибка БД (Rejected)
+    };
+
+    static constexpr int BATCH_SIZE = 5000;
+
+    // Выполнить одно изменение в БД (основное подключение текущего потока)
+    static Result apply(const MutationJournal::Entry& entry, int* affected = nullptr);
+
+    // Перенести все неприменённые записи; возвращает число обработанных
+    // (включая пропущенные - они же дописываются в skipped)
+    static int drain(MutationJournal& journal, QVector<Skipped>* skipped = nullptr);
+
+private:
+    // Conflict / Applied (конфликта нет) / Deferred (нет связи)
+    static Result checkConflict(const MutationJournal::Entry& entry);
+};
+
+#endif // JOURNALREPLAYER_H
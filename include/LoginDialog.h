@@ -53,6 +53,16 @@ private:
     QString getUserRole(const QString& username);
     QString hashPassword(const QString& password);
 
+    // Вход без связи с БД: солёный хеш пароля (PBKDF2) сохраняется при успешном
+    // входе с сервером и проверяется локально в автономном режиме. Роль не
+    // сохраняется - автономный вход всегда с правами обычного пользователя
+    static constexpr int OFFLINE_HASH_ITERATIONS = 100000;
+    static constexpr int OFFLINE_HASH_LENGTH = 32;
+    static constexpr int OFFLINE_SALT_LENGTH = 16;
+    static QByteArray offlinePasswordHash(const QString& password, const QByteArray& salt);
+    void cacheCredentials(const QString& username, const QString& password);
+    bool authenticateOffline(const QString& username, const QString& password);
+
     // Валидация
     bool validateInput(const QString& username, const QString& password);
 
@@ -8,8 +8,12 @@
 #include <QStatusBar>
 #include <QPushButton>
 #include <QLabel>
+#include <QPointer>
 #include <memory>
 #include "BaggageManager.h"
+#include "RefreshScheduler.h"
+
+class FlightLoadDashboard;
 
 /**
  * @brief Главное окно приложения для управления багажом пассажиров
@@ -42,14 +46,26 @@ private slots:
     void onDeleteByFlight();       // Функция 7
     void onChangeItemCount();      // Функция 8
     void onGenerateDateReport();
+    void onExportArchive();
+    void onImportArchive();
+    void onImportManifest();
+    void onShowFlightLoad();
 
     void onAbout();
 
+    void onRefreshDue(int parts);
+
 private:
+    // Сколько показывать сообщение о конфликтах синхронизации
+    static constexpr int CONFLICT_MESSAGE_TIMEOUT_MS = 15000;
+
     void createMenus();
     void createToolBar();
     void createCentralWidget();
+    // Перерисовка по кадрам RefreshScheduler; слоты только запрашивают её
+    void requestRefresh(RefreshScheduler::Part part);
     void updateTable();
+    void setCellText(int row, int column, const QString& text);
     void updateStatusBar();
     void setupPermissions();  
 
@@ -72,6 +88,11 @@ private:
     std::unique_ptr<BaggageManager> m_manager;
     QString m_currentFilename;
 
+    RefreshScheduler* m_refresh;
+
+    // Окно загрузки рейсов (одно, удаляется при закрытии)
+    QPointer<FlightLoadDashboard> m_loadDashboard;
+
     bool m_isGuestMode;
     QString m_userRole;  
     QString m_username;  
@@ -0,0 +1,61 @@
+#ifndef MAPPEDTEXTFILE_H
+#define MAPPEDTEXTFILE_H
+
+#include <QObject>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <atomic>
+
+class QThread;
+
+/**
+ * @brief Текстовый файл UTF-8, отображённый в память, с индексом начала строк
+ *
+ * Индекс строк строится в фоновом потоке; по мере продвижения
+ * отправляется сигнал linesIndexed(). Строки декодируются по запросу,
+ * поэтому файл любого размера не загружается в память целиком.
+ */
+class MappedTextFile : public QObject {
+    Q_OBJECT
+
+public:
+    explicit MappedTextFile(QObject* parent = nullptr);
+    ~MappedTextFile();
+
+    bool open(const QString& filename);
+    void close();
+    QString errorString() const { return m_errorString; }
+
+    qint64 fileSize() const { return m_size; }
+    int lineCount() const;
+    bool isIndexComplete() const { return m_indexComplete.load(); }
+
+    QString line(int index) const;
+
+    // Поиск подстроки начиная со строки fromLine; -1 - не найдено
+    int findNext(const QString& text, int fromLine) const;
+
+signals:
+    void linesIndexed(int lineCount);
+    void indexingFinished(int lineCount);
+
+private:
+    void buildIndex();
+    void stopIndexing();
+
+    QFile m_file;
+    const uchar* m_data;
+    qint64 m_size;
+
+    mutable QMutex m_mutex;
+    QVector<qint64> m_lineStarts;
+
+    QThread* m_indexThread;
+    std::atomic<bool> m_stopRequested;
+    std::atomic<bool> m_indexComplete;
+    QString m_errorString;
+};
+
+#endif // MAPPEDTEXTFILE_H
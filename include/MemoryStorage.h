@@ -0,0 +1,117 @@
+#ifndef MEMORYSTORAGE_H
+#define MEMORYSTORAGE_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QReadWriteLock>
+#include "StorageEngine.h"
+
+/**
+ * @brief Хранилище в памяти процесса (для замеров и отладки без PostgreSQL)
+ *
+ * Семантика совпадает с DatabaseManager: каждая операция атомарна (пачка
+ * добавляется целиком или не добавляется вовсе), удаление записи удаляет
+ * её вещи, отчёты за период берут записи с created_at в [from, to]
+ * включительно в порядке создания, версия данных - наибольший updated_at
+ * (мкс) среди оставшихся записей.
+ *
+ * Данные хранятся по столбцам: номер рейса - код в словаре рейсов, веса
+ * всех записей - в одном массиве (запись ссылается на свой отрезок).
+ * Удалённые записи и заменённые веса помечаются и вычищаются сжатием,
+ * когда их становится больше половины. Записи добавляются в порядке
+ * времени, поэтому период ищется двоичным поиском по created_at.
+ *
+ * Индексы по рейсу и ФИО - хеш-таблицы номеров строк.
+ * Доступ из нескольких потоков защищён QReadWriteLock; обработчики
+ * потокового чтения вызываются вне блокировки.
+ */
+class MemoryStorage : public StorageEngine {
+public:
+    static MemoryStorage& instance();
+
+    bool connectFromEnvironment(QString* connectionInfo = nullptr) override;
+    void disconnectFromDatabase() override;
+    bool isConnected() const override;
+    bool checkConnection() override;
+    void releaseThreadConnection() override {}
+
+    QString engineName() const override { return "memory"; }
+    bool isEmbedded() const override { return true; }
+
+    // Функция 1: таблиц нет - только отметка о готовности
+    bool createTable() override;
+
+    // Функция 2: Получить все записи
+    QVector<BaggageRecord> getAllRecords(qint64* dataVersion = nullptr) override;
+
+    // Функции 6-8
+    bool addRecord(const BaggageRecord& record) override;
+    bool addRecordsBatch(const QVector<BaggageRecord>& records) override;
+    int deleteRecordsByFlightNumbers(const QStringList& flightNumbers) override;
+    bool changeItemCountByName(const QString& passengerName,
+                               const QVector<double>& newWeights) override;
+
+    void clearAllRecords() override;
+    int getRecordCount() override;
+
+    // Поиск
+    QVector<BaggageRecord> findRecordsByFlightNumber(const QString& flightNumber) override;
+    QVector<BaggageRecord> findRecordsByPassengerName(const QString& passengerName) override;
+
+    // Отчёты за период
+    QVector<FlightStats> getFlightStatsByDateRange(const QDateTime& from, const QDateTime& to) override;
+    bool streamRecordsByDateRange(const QDateTime& from, const QDateTime& to,
+                                  const RecordHandler& recordHandler) override;
+    bool streamRecords(const QStringList& flightNumbers, const RecordHandler& recordHandler) override;
+
+    // Версия данных и проверка конфликтов
+    qint64 getDataVersion(int* recordCount = nullptr) override;
+    int countPassengerChangesSince(const QString& passengerName, qint64 version) override;
+    int countFlightChangesSince(const QStringList& flightNumbers, qint64 version) override;
+
+    // Подключения к БД нет: возвращается неоткрытое подключение
+    QSqlDatabase& getDatabase() override { return m_db; }
+
+private:
+    MemoryStorage();
+
+    // Столбцы записей (индекс - номер строки)
+    QVector<qint64> m_ids;
+    QVector<int> m_flightCodes;         // код в m_flightNames
+    QVector<QString> m_passengerNames;
+    QVector<qint64> m_createdAt;        // мкс с начала эпохи, не убывает
+    QVector<qint64> m_updatedAt;
+    QVector<int> m_itemOffsets;         // начало вещей записи в m_weights
+    QVector<quint8> m_itemCounts;
+    QVector<bool> m_deleted;
+
+    QVector<double> m_weights;          // веса всех записей подряд
+    int m_deadWeights;                  // веса удалённых и изменённых записей
+
+    QVector<QString> m_flightNames;
+    QHash<QString, int> m_flightCodeByName;
+    QHash<int, QVector<int>> m_rowsByFlight;
+    QHash<QString, QVector<int>> m_rowsByPassenger;
+
+    int m_liveCount;
+    qint64 m_nextId;
+    qint64 m_lastVersion;
+    bool m_connected;
+    QSqlDatabase m_db;
+    mutable QReadWriteLock m_lock;
+
+    // Вызываются под блокировкой записи
+    qint64 nextVersion();
+    int flightCode(const QString& flightNumber);
+    void appendRow(const BaggageRecord& record, qint64 version);
+    void compactIfNeeded();
+
+    // Вызываются под блокировкой чтения
+    BaggageRecord recordAt(int row) const;
+    QVector<int> rowsInRange(const QDateTime& from, const QDateTime& to) const;
+    QVector<int> rowsOfFlights(const QStringList& flightNumbers) const;
+};
+
+#endif // MEMORYSTORAGE_H
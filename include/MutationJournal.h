@@ -0,0 +1,113 @@
+#ifndef MUTATIONJOURNAL_H
+#define MUTATIONJOURNAL_H
+
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QRecursiveMutex>
+#include "BaggageRecord.h"
+
+/**
+ * @brief Локальный журнал изменений (только дозапись)
+ *
+ * Каждое добавление, удаление по рейсам и изменение вещей записывается
+ * в журнал до обращения к БД. Пока БД недоступна, записи журнала остаются
+ * неприменёнными и затем переносятся в PostgreSQL (см. DeskReconciler,
+ * baggage-cli journal-replay).
+ *
+ * Формат файла (little-endian):
+ *   [заголовок 16 байт: "BGJL", версия u16, резерв u16, базовый номер u64]
+ *   [запись: длина u32][crc32 u32][данные QDataStream]...
+ * Применение записей отмечается записью-маркером Applied, поэтому файл
+ * только дописывается. Недописанный хвост (сбой питания) отбрасывается
+ * при открытии. fsync изменений выполняется пачками: раз в syncEveryEntries
+ * записей или syncIntervalMs, а также явным sync(); маркер Applied
+ * сбрасывается на диск сразу.
+ *
+ * Удаление и изменение вещей хранят версию данных БД, которую видела стойка
+ * (baseVersion): при переносе запись, изменённая в БД позже, считается
+ * конфликтом (см. JournalReplayer). Методы объекта потокобезопасны.
+ */
+class MutationJournal {
+public:
+    static constexpr quint16 FORMAT_VERSION = 1;
+    static constexpr qint64 NO_VERSION = -1;    // не проверять конфликты
+
+    enum EntryType : quint8 {
+        AddRecord = 1,
+        DeleteFlights = 2,
+        ChangeItems = 3,
+        Applied = 4       // все записи с номером <= sequence применены к БД
+    };
+
+    struct Entry {
+        EntryType type = AddRecord;
+        quint64 sequence = 0;
+        qint64 timestampMsecs = 0;
+        BaggageRecord record;           // AddRecord
+        QStringList flightNumbers;      // DeleteFlights
+        QString passengerName;          // ChangeItems
+        QVector<double> weights;        // ChangeItems
+        qint64 baseVersion = NO_VERSION; // DeleteFlights, ChangeItems (необязательное поле в конце)
+    };
+
+    MutationJournal();
+    ~MutationJournal();
+
+    bool open(const QString& filename);
+    void close();
+    bool isOpen() const;
+
+    // Дозапись; возвращает запись с присвоенным номером (sequence == 0 - ошибка записи)
+    Entry appendAdd(const BaggageRecord& record);
+    Entry appendDelete(const QStringList& flightNumbers, qint64 baseVersion = NO_VERSION);
+    Entry appendChangeItems(const QString& passengerName, const QVector<double>& weights,
+                            qint64 baseVersion = NO_VERSION);
+
+    // Отметить записи до sequence включительно как применённые (с fsync)
+    bool markApplied(quint64 sequence);
+    bool sync();
+
+    QVector<Entry> pendingEntries() const;
+    int pendingCount() const;
+    quint64 lastSequence() const;
+
+    void setSyncPolicy(int everyEntries, int intervalMs);
+    QString errorString() const;
+    QString fileName() const;
+
+    // Чтение всех записей файла (для просмотра и восстановления состояния)
+    static bool readEntries(const QString& filename, QVector<Entry>& entries,
+                            QString* errorString = nullptr);
+
+    // Применить записи к набору записей в памяти (без маркеров Applied)
+    static void applyToRecords(const Entry& entry, QVector<BaggageRecord>& records);
+
+    static QString entryTypeName(EntryType type);
+    static QString defaultPath();
+
+private:
+    Entry append(Entry entry);
+    bool writeEntry(const Entry& entry);
+    bool writeHeader(quint64 baseSequence);
+    bool compact();
+
+    static bool scan(QFile& file, QVector<Entry>& entries, qint64& validEnd,
+                     quint64& baseSequence, QString* errorString);
+    static QByteArray encodePayload(const Entry& entry);
+    static bool decodePayload(const QByteArray& payload, Entry& entry);
+
+    mutable QRecursiveMutex m_mutex;
+    QFile m_file;
+    QVector<Entry> m_pending;
+    quint64 m_lastSequence;
+    int m_unsyncedEntries;
+    int m_syncEveryEntries;
+    int m_syncIntervalMs;
+    QElapsedTimer m_sinceSync;
+    QString m_errorString;
+};
+
+#endif // MUTATIONJOURNAL_H
@@ -0,0 +1,92 @@
+#ifndef PURGEENGINE_H
+#define PURGEENGINE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QDateTime>
+#include <QVariant>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <atomic>
+#include <functional>
+
+class DatabaseManager;
+class StorageEngine;
+
+/**
+ * @brief Статистика очистки
+ */
+struct PurgeStats {
+    qint64 recordsMatched = 0;    // подходящих записей на момент запуска
+    qint64 recordsDeleted = 0;
+    qint64 chunksCommitted = 0;
+    qint64 elapsedMs = 0;
+
+    double recordsPerSecond() const {
+        return elapsedMs > 0 ? recordsDeleted * 1000.0 / elapsedMs : 0.0;
+    }
+};
+
+/**
+ * @brief Параметры очистки
+ */
+struct PurgeOptions {
+    int chunkSize = 1000;    // записей в одной транзакции
+    int pauseMs = 50;        // пауза между порциями, чтобы не мешать стойкам
+    // Вызывается после каждой порции из потока очистки
+    std::function<void(const PurgeStats&)> progress;
+};
+
+/**
+ * @brief Удаление больших объёмов записей короткими транзакциями
+ *
+ * Записи удаляются порциями по возрастанию id: каждая порция - не больше
+ * chunkSize записей с id после последней отобранной, один DELETE (вещи -
+ * каскадом) в своей транзакции. Очистка заканчивается на порции, в которой
+ * не отобрано ни одной записи. Блокировки держатся недолго, WAL растёт
+ * равномерно, между порциями - пауза pauseMs.
+ *
+ * Отмена проверяется между порциями: удалённые порции остаются удалёнными,
+ * начатая - завершается. Повторный запуск продолжает с того, что осталось.
+ *
+ * Очищаются и рабочая таблица, и архив закрытых рейсов (baggage_archive).
+ * Работает с PostgreSQL (DatabaseManager или каждый сегмент ShardedStorage).
+ */
+class PurgeEngine {
+public:
+    explicit PurgeEngine(DatabaseManager& db);
+
+    // Блокирующий запуск; false - ошибка БД или отмена (см. errorString())
+    bool purgeFlights(const QStringList& flightNumbers, const PurgeOptions& options = PurgeOptions());
+    // Политика хранения: записи, созданные раньше cutoff
+    bool purgeOlderThan(const QDateTime& cutoff, const PurgeOptions& options = PurgeOptions());
+
+    // Срок хранения из BAGGAGE_RETENTION_DAYS; 0 - не задан
+    static int retentionDaysFromEnvironment();
+    // Базы PostgreSQL за хранилищем (сегменты - по отдельности); пусто - встроенное хранилище
+    static QVector<DatabaseManager*> databasesOf(StorageEngine& engine);
+
+    // Прервать очистку (можно вызывать из любого потока и из обработчика
+    // сигнала). Отмена действует и на ещё не начатый запуск: после cancel()
+    // очистка этим объектом не выполняется
+    void cancel() { m_cancelled = true; }
+    bool isCancelled() const { return m_cancelled.load(); }
+
+    PurgeStats stats() const { return m_stats; }
+    QString errorString() const { return m_errorString; }
+
+private:
+    // Рабочая таблица, затем архив закрытых рейсов
+    bool run(const QString& condition, const QVariant& value, const PurgeOptions& options);
+    // condition - условие отбора с одним параметром ?
+    bool purgeTable(QSqlDatabase& db, const QString& table, const QString& condition,
+                    const QVariant& value, const PurgeOptions& options, QElapsedTimer& timer);
+
+    DatabaseManager& m_db;
+    std::atomic<bool> m_cancelled;
+    PurgeStats m_stats;
+    QString m_errorString;
+};
+
+#endif // PURGEENGINE_H
@@ -0,0 +1,70 @@
+#ifndef REFRESHSCHEDULER_H
+#define REFRESHSCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QPointer>
+#include <QWidget>
+
+/**
+ * @brief Статистика планировщика перерисовки
+ */
+struct RefreshStats {
+    qint64 requests = 0;   // запросов обновления
+    qint64 merged = 0;     // слиты с уже запланированным кадром
+    qint64 frames = 0;     // применённых кадров
+    qint64 dropped = 0;    // запросов и кадров, отложенных до показа окна
+};
+
+/**
+ * @brief Слияние запросов перерисовки в кадры
+ *
+ * Мутации, импорт и сверка с БД только отмечают, что устарело (таблица
+ * и/или строка состояния). Первый запрос запускает таймер кадра, следующие
+ * до его срабатывания сливаются с ним; по таймеру сигнал refreshDue
+ * получает объединение частей - одна перерисовка на кадр. Таймер не
+ * перезапускается новыми запросами, поэтому при непрерывном потоке
+ * изменений окно обновляется раз в frameIntervalMs, а не откладывается
+ * до паузы.
+ *
+ * Пока окно скрыто или свёрнуто, кадры пропускаются: части копятся
+ * и применяются одним кадром при показе окна.
+ */
+class RefreshScheduler : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int DEFAULT_FRAME_INTERVAL_MS = 100;
+
+    // Части окна; Table включает и строку состояния
+    enum Part { Status = 0x1, Table = 0x2 | Status };
+
+    explicit RefreshScheduler(QWidget* window, int frameIntervalMs = DEFAULT_FRAME_INTERVAL_MS,
+                              QObject* parent = nullptr);
+
+    void request(Part part);
+    // Применить накопленное сразу, не дожидаясь кадра
+    void flush();
+
+    RefreshStats stats() const { return m_stats; }
+
+signals:
+    // parts - объединение Part всех запросов кадра
+    void refreshDue(int parts);
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
+private slots:
+    void onFrame();
+
+private:
+    bool isWindowShown() const;
+
+    QPointer<QWidget> m_window;
+    QTimer m_frameTimer;
+    int m_pending;
+    RefreshStats m_stats;
+};
+
+#endif // REFRESHSCHEDULER_H
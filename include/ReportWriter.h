@@ -0,0 +1,78 @@
+#ifndef REPORTWRITER_H
+#define REPORTWRITER_H
+
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+#include "BufferedFileWriter.h"
+
+/**
+ * @brief Приёмник строк отчёта
+ * writeLine() возвращает false, если приёмнику больше не нужны строки.
+ */
+class ReportSink {
+public:
+    virtual ~ReportSink() = default;
+    virtual bool writeLine(const QString& line) = 0;
+};
+
+/**
+ * @brief Предпросмотр: хранит только первые maxLines строк отчёта
+ */
+class PreviewReportSink : public ReportSink {
+public:
+    explicit PreviewReportSink(int maxLines);
+
+    bool writeLine(const QString& line) override;
+
+    QString text() const { return m_lines.join('\n'); }
+    bool isTruncated() const { return m_truncated; }
+    int maxLines() const { return m_maxLines; }
+
+private:
+    QStringList m_lines;
+    int m_maxLines;
+    bool m_truncated;
+};
+
+/**
+ * @brief Запись отчёта в файл через буферизованный UTF-8 writer
+ */
+class FileReportSink : public ReportSink {
+public:
+    FileReportSink();
+
+    bool open(const QString& filename, bool gzip = false);
+    bool writeLine(const QString& line) override;
+    bool close();
+    void discard();
+
+    QString errorString() const { return m_writer.errorString(); }
+
+private:
+    BufferedFileWriter m_writer;
+};
+
+/**
+ * @brief Формирование отчёта за период
+ * Сводка по рейсам считается агрегатным запросом, детальный список
+ * читается серверным курсором и сразу передаётся в приёмник.
+ */
+class DateRangeReportWriter {
+public:
+    DateRangeReportWriter(const QDateTime& from, const QDateTime& to);
+
+    // false - ошибка БД (см. errorString())
+    bool write(ReportSink& sink);
+
+    int recordCount() const { return m_recordCount; }
+    QString errorString() const { return m_errorString; }
+
+private:
+    QDateTime m_from;
+    QDateTime m_to;
+    int m_recordCount;
+    QString m_errorString;
+};
+
+#endif // REPORTWRITER_H
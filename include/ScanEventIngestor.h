@@ -0,0 +1,144 @@
+#ifndef SCANEVENTINGESTOR_H
+#define SCANEVENTINGESTOR_H
+
+#include <QString>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QReadWriteLock>
+#include <QMutex>
+#include <atomic>
+#include <memory>
+#include "SpscRingBuffer.h"
+
+class QThread;
+class QIODevice;
+class QSqlDatabase;
+
+/**
+ * @brief Событие сканирования бирки (сортировка, погрузка, выдача)
+ */
+struct ScanEvent {
+    qint64 tag = 0;
+    QString location;
+    qint64 scannedAtMs = 0;     // мс с начала эпохи (UTC)
+};
+
+/**
+ * @brief Параметры приёма событий
+ */
+struct ScanIngestOptions {
+    int ringCapacity = 1 << 16;     // событий между приёмом и записью
+    int maxBatchSize = 5000;        // событий в одной вставке
+    int maxDelayMs = 50;            // сколько ждать добора пачки после первого события
+    int maxTrackedTags = 1000000;   // бирок в памяти lastScan (давно не сканированные вытесняются)
+};
+
+/**
+ * @brief Статистика приёма
+ */
+struct ScanIngestStats {
+    qint64 accepted = 0;        // принято в буфер
+    qint64 rejected = 0;        // строки, которые не удалось разобрать
+    qint64 stalls = 0;          // буфер был заполнен - приём ждал записи
+    qint64 written = 0;
+    qint64 failed = 0;          // события, не записанные к остановке (БД недоступна)
+    qint64 batches = 0;
+    qint64 retries = 0;         // повторы записи пачки после ошибки
+};
+
+/**
+ * @brief Приём событий сканирования бирок с пакетной записью в БД
+ *
+ * События поступают в submit() из одного потока приёма (чтение сокета или
+ * файла) и через кольцевой буфер без блокировок (SpscRingBuffer) попадают
+ * в поток записи. Поток записи собирает пачку (до maxBatchSize событий или
+ * maxDelayMs после первого) и вставляет её одним запросом с параметрами-
+ * массивами в таблицу baggage_events, разделённую на секции по суткам
+ * (UTC) - секция создаётся при первом событии этих суток.
+ *
+ * Пачка хранится, пока не записана: при ошибке поток записи
+ * переподключается и повторяет вставку с нарастающей паузой (до
+ * RETRY_MAX_DELAY_MS). Буфер тем временем заполняется, и приём ждёт
+ * освобождения места (submit() или hasRoom()): события не теряются, а
+ * отставание записи видно по stalls и retries. Только при stop() пачка,
+ * не записанная за STOP_RETRY_ATTEMPTS попыток, считается потерянной (failed).
+ *
+ * Последнее место каждой бирки хранится в памяти (lastScan) и обновляется
+ * после записи пачки в БД. Бирок не больше maxTrackedTags: при заполнении
+ * вытесняются бирки, не сканированные с прошлого заполнения.
+ *
+ * Формат строки: "бирка<TAB>место[<TAB>время]", время - мс с начала эпохи
+ * или ISO 8601; без времени - момент приёма.
+ */
+class ScanEventIngestor {
+public:
+    static constexpr int RETRY_DELAY_MS = 200;
+    static constexpr int RETRY_MAX_DELAY_MS = 10000;
+    static constexpr int STOP_RETRY_ATTEMPTS = 3;
+
+    explicit ScanEventIngestor(const ScanIngestOptions& options = ScanIngestOptions());
+    ~ScanEventIngestor();
+
+    // Создать таблицу baggage_events (секционированную по scanned_at)
+    static bool createTable(QSqlDatabase& db, QString* error = nullptr);
+
+    bool start();
+    // Записать всё из буфера и остановить поток записи
+    void stop();
+    bool isRunning() const { return m_thread != nullptr; }
+
+    // Только из одного потока приёма. submit() ждёт места в буфере; приём,
+    // который ждать не может (цикл событий сервиса), сначала спрашивает
+    // hasRoom(): false - буфер заполнен (учитывается в stalls), чтение
+    // откладывается и повторяется позже
+    bool hasRoom();
+    bool submit(const ScanEvent& event);
+    bool submitLine(const QByteArray& line);
+    // Все строки устройства; follow - ждать новых строк (хвост файла), пока не вызван stop()
+    qint64 ingestDevice(QIODevice* device, bool follow = false);
+
+    static bool parseLine(const QByteArray& line, ScanEvent* event);
+
+    // Последнее записанное в БД сканирование бирки
+    bool lastScan(qint64 tag, ScanEvent* event) const;
+    int trackedTags() const;
+
+    ScanIngestStats stats() const;
+    QString errorString() const;
+
+private:
+    void run();
+    // Записать пачку, переподключаясь и повторяя при ошибках; false - остановка без записи
+    bool writeWithRetry(QSqlDatabase& db, const QVector<ScanEvent>& batch);
+    bool writeBatch(QSqlDatabase& db, const QVector<ScanEvent>& batch);
+    void rememberLatest(const QVector<ScanEvent>& batch);
+    bool ensurePartitions(QSqlDatabase& db, const QVector<ScanEvent>& batch);
+    void setError(const QString& error);
+
+    ScanIngestOptions m_options;
+    SpscRingBuffer<ScanEvent> m_ring;
+    QThread* m_thread;
+    std::atomic<bool> m_stopping;
+
+    // Счётчики приёма - поток приёма, записи - поток записи
+    std::atomic<qint64> m_accepted;
+    std::atomic<qint64> m_rejected;
+    std::atomic<qint64> m_stalls;
+    std::atomic<qint64> m_written;
+    std::atomic<qint64> m_failed;
+    std::atomic<qint64> m_batches;
+    std::atomic<qint64> m_retries;
+
+    // Два поколения: при заполнении текущего оно становится прежним,
+    // а бирки прежнего, не сканированные с тех пор, вытесняются
+    mutable QReadWriteLock m_latestLock;
+    QHash<qint64, ScanEvent> m_latest;
+    QHash<qint64, ScanEvent> m_previousLatest;
+    QSet<qint64> m_partitionDays;   // сутки (от начала эпохи), секции которых уже есть
+
+    mutable QMutex m_errorMutex;
+    QString m_errorString;
+};
+
+#endif // SCANEVENTINGESTOR_H
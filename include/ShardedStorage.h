@@ -0,0 +1,130 @@
+#ifndef SHARDEDSTORAGE_H
+#define SHARDEDSTORAGE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QThreadPool>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "StorageEngine.h"
+
+class DatabaseManager;
+
+/**
+ * @brief Записи, распределённые по рейсам между несколькими серверами PostgreSQL
+ *
+ * Рейс целиком хранится на одном сегменте: номер сегмента - FNV-1a от
+ * UTF-8 номера рейса по модулю числа сегментов (shardFor). Функция не должна
+ * меняться - от неё зависит, где лежат уже записанные данные; при изменении
+ * числа сегментов записи переносятся командой baggage-cli shard-rebalance.
+ *
+ * Операции с рейсом (добавление, удаление по рейсам, поиск по рейсу) идут
+ * на один сегмент. Чтения по всем данным (все записи, поиск по ФИО, отчёты
+ * за период, сводка) выполняются на всех сегментах параллельно и
+ * объединяются; потоковое чтение сливает потоки сегментов по номеру рейса.
+ *
+ * Пачка, затрагивающая несколько сегментов, вставляется в открытые
+ * транзакции всех сегментов и фиксируется только после успешной вставки
+ * везде. Сбой между фиксациями сегментов не откатывается - это
+ * записывается в лог. Удаление рейсов разных сегментов выполняется
+ * отдельными транзакциями сегментов.
+ *
+ * Бирки вещей сегмента i назначаются из диапазона от i * BAG_TAG_RANGE,
+ * поэтому номера не пересекаются между сегментами. При переносе рейса
+ * командой shard-rebalance его вещи получают новые бирки.
+ *
+ * Сегменты задаются переменной DB_SHARDS="host:port,host:port,..." (имя БД,
+ * пользователь и пароль - общие DB_NAME, DB_USER, DB_PASSWORD). Таблица
+ * users и учётные записи - на сегменте 0.
+ */
+class ShardedStorage : public StorageEngine {
+public:
+    static ShardedStorage& instance();
+
+    // Номер сегмента для рейса
+    static int shardFor(const QString& flightNumber, int shardCount);
+
+    bool connectFromEnvironment(QString* connectionInfo = nullptr) override;
+    void disconnectFromDatabase() override;
+    bool isConnected() const override;
+    bool checkConnection() override;
+    void releaseThreadConnection() override;
+
+    QString engineName() const override { return "sharded"; }
+    bool isEmbedded() const override { return false; }
+
+    int shardCount() const { return static_cast<int>(m_shards.size()); }
+    DatabaseManager& shard(int index) { return *m_shards[index]; }
+
+    bool createTable() override;
+    QVector<BaggageRecord> getAllRecords(qint64* dataVersion = nullptr) override;
+
+    bool addRecord(const BaggageRecord& record) override;
+    bool addRecordsBatch(const QVector<BaggageRecord>& records) override;
+    int deleteRecordsByFlightNumbers(const QStringList& flightNumbers) override;
+    bool changeItemCountByName(const QString& passengerName,
+                               const QVector<double>& newWeights) override;
+    int deleteFlightsBatch(const QStringList& flightNumbers, QVector<int>* outcomes = nullptr) override;
+    int changeItemsBatch(const QVector<ItemChange>& changes, QVector<int>* outcomes = nullptr) override;
+    int closeFlights(const QStringList& flightNumbers, QVector<int>* outcomes = nullptr) override;
+    QVector<FlightStats> getClosedFlightStats() override;
+
+    // Перенести записи рейса с сегмента sourceShard на сегмент shardFor (shard-rebalance).
+    // Число перенесённых записей; -1 - ошибка, записи остались на источнике
+    int moveFlight(int sourceShard, const QString& flightNumber);
+
+    // Бирки сегмента i - от i * BAG_TAG_RANGE: сегмент бирки определяется
+    // по её номеру, поиск идёт на один сегмент
+    static constexpr qint64 BAG_TAG_RANGE = 1000000000000LL;
+    int resolveBagTag(qint64 tag, BagTagInfo* info) override;
+    bool streamBagTags(const BagTagHandler& handler) override;
+
+    void clearAllRecords() override;
+    int getRecordCount() override;
+
+    QVector<BaggageRecord> findRecordsByFlightNumber(const QString& flightNumber) override;
+    QVector<BaggageRecord> findRecordsByPassengerName(const QString& passengerName) override;
+
+    QVector<FlightStats> getFlightStatsByDateRange(const QDateTime& from, const QDateTime& to) override;
+    bool streamRecordsByDateRange(const QDateTime& from, const QDateTime& to,
+                                  const RecordHandler& recordHandler) override;
+    bool streamRecords(const QStringList& flightNumbers, const RecordHandler& recordHandler) override;
+
+    qint64 getDataVersion(int* recordCount = nullptr) override;
+    int countPassengerChangesSince(const QString& passengerName, qint64 version) override;
+    int countFlightChangesSince(const QStringList& flightNumbers, qint64 version) override;
+
+    // Сегмент 0 (таблица users)
+    QSqlDatabase& getDatabase() override;
+
+private:
+    // Записей в очереди между сегментом и слиянием потоков
+    static constexpr int STREAM_QUEUE_CAPACITY = 1024;
+
+    ShardedStorage();
+    ~ShardedStorage() override;
+
+    std::vector<std::unique_ptr<DatabaseManager>> m_shards;
+    // Потоки параллельных запросов; не завершаются, чтобы их подключения
+    // к сегментам переиспользовались
+    QThreadPool m_pool;
+
+    DatabaseManager& shardOf(const QString& flightNumber);
+    QHash<int, QStringList> groupByShard(const QStringList& flightNumbers) const;
+
+    // task(i) для всех сегментов параллельно; сегмент 0 - в текущем потоке
+    void forEachShard(const std::function<void(int)>& task);
+
+    // Потоковое чтение сегментов в отдельных потоках с передачей записей
+    // в текущий поток. byFlight - слияние по номеру рейса, иначе поочерёдно.
+    using ShardStream = std::function<bool(int shard, const RecordHandler&)>;
+    bool streamShards(const ShardStream& stream, bool byFlight, const RecordHandler& recordHandler);
+
+    // Ошибки сегментов -> последняя ошибка текущего потока
+    void setShardErrors(const QVector<QString>& errors);
+};
+
+#endif // SHARDEDSTORAGE_H
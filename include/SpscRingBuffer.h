@@ -0,0 +1,70 @@
+#ifndef SPSCRINGBUFFER_H
+#define SPSCRINGBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Кольцевой буфер без блокировок для одного писателя и одного читателя
+ *
+ * Ёмкость округляется вверх до степени двойки. tryPush() вызывается только
+ * из потока-писателя, tryPop() - только из потока-читателя; оба не ждут и
+ * возвращают false, если буфер заполнен / пуст. Позиции писателя и читателя
+ * лежат в разных строках кеша, чтобы потоки не мешали друг другу.
+ */
+template <typename T>
+class SpscRingBuffer {
+public:
+    explicit SpscRingBuffer(size_t capacity)
+        : m_slots(roundUpToPowerOfTwo(capacity)), m_mask(m_slots.size() - 1), m_head(0), m_tail(0) {}
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    bool tryPush(T item) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) >= m_slots.size()) {
+            return false;
+        }
+        m_slots[tail & m_mask] = std::move(item);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& item) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = std::move(m_slots[head & m_mask]);
+        m_slots[head & m_mask] = T();   // не держать данные до перезаписи слота
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Приблизительно, если буфер одновременно меняется
+    size_t size() const {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+    size_t capacity() const { return m_slots.size(); }
+
+private:
+    static constexpr size_t CACHE_LINE = 64;
+
+    static size_t roundUpToPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    std::vector<T> m_slots;
+    const size_t m_mask;
+    alignas(CACHE_LINE) std::atomic<size_t> m_head;   // следующий слот для чтения
+    alignas(CACHE_LINE) std::atomic<size_t> m_tail;   // следующий слот для записи
+};
+
+#endif // SPSCRINGBUFFER_H
@@ -0,0 +1,109 @@
+#ifndef SQLITESTORAGE_H
+#define SQLITESTORAGE_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QVector>
+#include <QThreadStorage>
+#include "StorageEngine.h"
+
+class QSqlQuery;
+class QThread;
+
+/**
+ * @brief Встроенное хранилище на SQLite (один файл, без сервера)
+ *
+ * Для стоек без связи с PostgreSQL и для разработки. Схема повторяет
+ * baggage_records / baggage_items / users; вещи удаляются каскадно
+ * (PRAGMA foreign_keys=ON), файл открывается в режиме WAL - чтение
+ * из других потоков не блокируется записью.
+ *
+ * Время created_at / updated_at хранится целым числом микросекунд с начала
+ * эпохи UTC, поэтому версия данных (getDataVersion) совпадает по смыслу
+ * с версией DatabaseManager. Каждое изменение получает updated_at больше
+ * текущего максимума таблицы - версия строго растёт.
+ *
+ * Путь к файлу - BAGGAGE_SQLITE_PATH, по умолчанию baggage.sqlite
+ * в каталоге данных приложения.
+ */
+class SqliteStorage : public StorageEngine {
+public:
+    static constexpr int BUSY_TIMEOUT_MS = 5000;
+    // Ограничение SQLite на число параметров запроса - списки рейсов обрабатываются порциями
+    static constexpr int IN_LIST_CHUNK_SIZE = 500;
+
+    static SqliteStorage& instance();
+
+    bool open(const QString& path);
+    bool connectFromEnvironment(QString* connectionInfo = nullptr) override;
+    void disconnectFromDatabase() override;
+    bool isConnected() const override;
+    bool checkConnection() override;
+    void releaseThreadConnection() override;
+
+    QString engineName() const override { return "sqlite"; }
+    bool isEmbedded() const override { return true; }
+    QString path() const { return m_path; }
+
+    // Функция 1: Создать таблицы
+    bool createTable() override;
+
+    // Функция 2: Получить все записи
+    QVector<BaggageRecord> getAllRecords(qint64* dataVersion = nullptr) override;
+
+    // Функции 6-8
+    bool addRecord(const BaggageRecord& record) override;
+    bool addRecordsBatch(const QVector<BaggageRecord>& records) override;
+    int deleteRecordsByFlightNumbers(const QStringList& flightNumbers) override;
+    bool changeItemCountByName(const QString& passengerName,
+                               const QVector<double>& newWeights) override;
+
+    void clearAllRecords() override;
+    int getRecordCount() override;
+
+    // Поиск
+    QVector<BaggageRecord> findRecordsByFlightNumber(const QString& flightNumber) override;
+    QVector<BaggageRecord> findRecordsByPassengerName(const QString& passengerName) override;
+
+    // Отчёты за период
+    QVector<FlightStats> getFlightStatsByDateRange(const QDateTime& from, const QDateTime& to) override;
+    bool streamRecordsByDateRange(const QDateTime& from, const QDateTime& to,
+                                  const RecordHandler& recordHandler) override;
+    bool streamRecords(const QStringList& flightNumbers, const RecordHandler& recordHandler) override;
+
+    // Версия данных и проверка конфликтов
+    qint64 getDataVersion(int* recordCount = nullptr) override;
+    int countPassengerChangesSince(const QString& passengerName, qint64 version) override;
+    int countFlightChangesSince(const QStringList& flightNumbers, qint64 version) override;
+
+    QSqlDatabase& getDatabase() override { return m_db; }
+
+    static QString defaultPath();
+
+private:
+    SqliteStorage();
+    ~SqliteStorage() override;
+
+    QSqlDatabase m_db;
+    QThread* m_ownerThread;
+    QThreadStorage<QString> m_threadConnection;
+    QString m_path;
+
+    // Подключение для текущего потока
+    QSqlDatabase connection();
+    bool openConnection(QSqlDatabase& db);
+
+    // Вставка записи с вещами внутри уже начатой транзакции
+    bool insertRecord(QSqlQuery& recordQuery, QSqlQuery& itemQuery,
+                      const BaggageRecord& record, qint64 version);
+    // updated_at для очередного изменения (внутри транзакции записи)
+    qint64 nextVersion(QSqlDatabase& db);
+    bool failTransaction(QSqlDatabase& db, const QString& message);
+
+    // Выборка (id, рейс, ФИО, номер вещи, вес), упорядоченная по записи,
+    // -> записи с вещами
+    bool streamJoined(QSqlQuery& query, const RecordHandler& recordHandler);
+    QVector<BaggageRecord> collectJoined(QSqlQuery& query);
+};
+
+#endif // SQLITESTORAGE_H
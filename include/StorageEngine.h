@@ -0,0 +1,176 @@
+#ifndef STORAGEENGINE_H
+#define STORAGEENGINE_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QPair>
+#include <QDateTime>
+#include <QThreadStorage>
+#include <functional>
+#include "BaggageRecord.h"
+
+/**
+ * @brief Параметры потоковой выгрузки файла сводки
+ */
+struct SummaryExportOptions {
+    bool gzip = false;
+    // Прогресс (записано строк, всего строк); вернуть false - отменить выгрузку
+    std::function<bool(qint64, qint64)> progress;
+};
+
+/**
+ * @brief Агрегаты по одному рейсу (считаются на стороне сервера)
+ */
+struct FlightStats {
+    QString flightNumber;
+    int passengerCount = 0;
+    int itemCount = 0;
+    double totalWeight = 0.0;
+};
+
+/**
+ * @brief Вещь пассажира, найденная по номеру бирки
+ */
+struct BagTagInfo {
+    qint64 tag = 0;
+    QString flightNumber;
+    QString passengerName;
+    int itemNumber = 0;         // с 1
+    double weight = 0.0;
+    bool archived = false;      // рейс закрыт, запись в архиве
+};
+
+/**
+ * @brief Хранилище записей о багаже
+ *
+ * Общий интерфейс для BaggageManager, журнала изменений и отчётов.
+ * Реализации: DatabaseManager (PostgreSQL), ShardedStorage (рейсы
+ * распределены по нескольким серверам PostgreSQL), SqliteStorage (встроенная
+ * БД в одном файле, без сервера) и MemoryStorage (в памяти процесса, для
+ * замеров). Выбор - переменной окружения BAGGAGE_STORAGE
+ * (postgres | sharded | sqlite | memory), см. selectFromEnvironment().
+ *
+ * Методы можно вызывать из любого потока; последняя ошибка хранится по потокам.
+ * Часть операций (фильтр, сводка, отчёты за период) имеет общую реализацию
+ * поверх потокового чтения - реализация может заменить её запросом к БД.
+ */
+class StorageEngine {
+public:
+    using RecordHandler = std::function<bool(const BaggageRecord&)>;
+    using BagTagHandler = std::function<bool(const BagTagInfo&)>;
+    // ФИО пассажира и новые веса вещей
+    using ItemChange = QPair<QString, QVector<double>>;
+
+    virtual ~StorageEngine() = default;
+
+    // Хранилище, с которым работает приложение (по умолчанию - PostgreSQL)
+    static StorageEngine& current();
+    static void setCurrent(StorageEngine* engine);
+    // Выбрать хранилище по BAGGAGE_STORAGE и сделать его текущим
+    static StorageEngine& selectFromEnvironment();
+
+    virtual QString engineName() const = 0;
+    // Хранилище в локальном файле: связь не пропадает, журнал не нужен
+    virtual bool isEmbedded() const = 0;
+
+    // Подключение
+    virtual bool connectFromEnvironment(QString* connectionInfo = nullptr) = 0;
+    virtual void disconnectFromDatabase() = 0;
+    virtual bool isConnected() const = 0;
+    virtual bool checkConnection() = 0;
+    virtual void releaseThreadConnection() = 0;
+    QString getLastError() const { return m_lastError.localData(); }
+
+    // Функция 1: Создать таблицы
+    virtual bool createTable() = 0;
+
+    // Функция 2: Получить все записи (dataVersion - версия данных из того же снимка)
+    virtual QVector<BaggageRecord> getAllRecords(qint64* dataVersion = nullptr) = 0;
+
+    // Функция 3: Фильтр - пассажиры с 1 вещью 20-30 кг
+    virtual QVector<BaggageRecord> filterPassengersWithSingleItem20_30kg();
+
+    // Функция 4: Создать файл сводки (номер рейса, ФИО, общий вес)
+    virtual bool createSummaryFile(const QString& filename,
+                                   const SummaryExportOptions& options = SummaryExportOptions());
+
+    // Функции 6-8: изменения
+    virtual bool addRecord(const BaggageRecord& record) = 0;
+    virtual bool addRecordsBatch(const QVector<BaggageRecord>& records) = 0;
+    virtual int deleteRecordsByFlightNumbers(const QStringList& flightNumbers) = 0;
+    virtual bool changeItemCountByName(const QString& passengerName,
+                                       const QVector<double>& newWeights) = 0;
+
+    // Пакетные функции 7 и 8 с итогом по каждому ключу. Общая реализация
+    // обрабатывает ключи по одному; PostgreSQL - одной транзакцией запросами
+    // над массивами, частями по несколько сотен ключей.
+    // deleteFlightsBatch: outcomes[i] - удалено записей рейса flightNumbers[i],
+    // -1 - ошибка; возвращает всего удалённых записей.
+    virtual int deleteFlightsBatch(const QStringList& flightNumbers, QVector<int>* outcomes = nullptr);
+    // changeItemsBatch: changeItemCountByName для каждого ФИО (при повторе ФИО
+    // действует последнее изменение); outcomes[i] - 1 изменено, 0 - ФИО не
+    // найдено, -1 - ошибка. Возвращает число изменённых пассажиров, -1 - сбой пакета.
+    virtual int changeItemsBatch(const QVector<ItemChange>& changes, QVector<int>* outcomes = nullptr);
+
+    // Закрытие рейсов: записи и вещи переносятся из рабочих таблиц в архив,
+    // по рейсу сохраняются итоги. Архивные записи по-прежнему находятся
+    // поиском и отчётами за период, но не загружаются getAllRecords.
+    // outcomes[i] - перенесено записей рейса flightNumbers[i]; возвращает
+    // всего перенесённых записей, -1 - ошибка или архив не поддерживается
+    // (общая реализация: архив есть только у PostgreSQL).
+    virtual int closeFlights(const QStringList& flightNumbers, QVector<int>* outcomes = nullptr);
+    // Итоги закрытых рейсов по номеру рейса
+    virtual QVector<FlightStats> getClosedFlightStats();
+
+    // Бирки вещей: номер назначается хранилищем при добавлении вещи и
+    // сохраняется при изменении её веса (общая реализация: бирок нет).
+    // resolveBagTag: 1 - найдена (info заполнен), 0 - нет такой бирки, -1 - ошибка
+    virtual int resolveBagTag(qint64 tag, BagTagInfo* info);
+    // Все бирки открытых рейсов - для индекса в памяти; false - ошибка
+    virtual bool streamBagTags(const BagTagHandler& handler);
+
+    virtual void clearAllRecords() = 0;
+    virtual int getRecordCount() = 0;
+
+    // Поиск
+    virtual QVector<BaggageRecord> findRecordsByFlightNumber(const QString& flightNumber) = 0;
+    virtual QVector<BaggageRecord> findRecordsByPassengerName(const QString& passengerName) = 0;
+
+    // Отчёты за период
+    virtual QVector<BaggageRecord> getRecordsByDateRange(const QDateTime& from, const QDateTime& to);
+    // Ошибка - пустой результат и непустой getLastError()
+    virtual QVector<FlightStats> getFlightStatsByDateRange(const QDateTime& from, const QDateTime& to);
+    virtual bool streamRecordsByDateRange(const QDateTime& from, const QDateTime& to,
+                                          const RecordHandler& recordHandler) = 0;
+
+    // Потоковое чтение всех записей (или только указанных рейсов), по рейсам
+    virtual bool streamRecords(const QStringList& flightNumbers, const RecordHandler& recordHandler) = 0;
+
+    // Версия данных (растёт с каждым зафиксированным изменением) и проверка конфликтов, -1 - ошибка
+    virtual qint64 getDataVersion(int* recordCount = nullptr) = 0;
+    virtual int countPassengerChangesSince(const QString& passengerName, qint64 version) = 0;
+    virtual int countFlightChangesSince(const QStringList& flightNumbers, qint64 version) = 0;
+    // Догоняющее чтение кеша: записи, изменённые после version, вместе со всеми
+    // записями тех же пар (рейс, ФИО); dataVersion и recordCount - версия данных
+    // и число записей из того же снимка БД. false - ошибка или хранилище этого
+    // не умеет (общая реализация), тогда кеш перечитывается getAllRecords.
+    virtual bool getRecordsChangedSince(qint64 version, QVector<BaggageRecord>* records,
+                                        qint64* dataVersion, int* recordCount);
+
+    // Подключение основного потока (LoginDialog и пр.); может быть не открыто
+    virtual QSqlDatabase& getDatabase() = 0;
+
+protected:
+    StorageEngine() = default;
+    StorageEngine(const StorageEngine&) = delete;
+    StorageEngine& operator=(const StorageEngine&) = delete;
+
+    // Проверка изменения вещей; пустая строка - изменение допустимо
+    static QString itemChangeError(const QString& passengerName, const QVector<double>& weights);
+
+    QThreadStorage<QString> m_lastError;
+};
+
+#endif // STORAGEENGINE_H
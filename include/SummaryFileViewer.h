@@ -0,0 +1,63 @@
+#ifndef SUMMARYFILEVIEWER_H
+#define SUMMARYFILEVIEWER_H
+
+#include <QDialog>
+#include <QAbstractListModel>
+#include <QListView>
+#include <QLineEdit>
+#include <QSpinBox>
+#include <QLabel>
+#include "MappedTextFile.h"
+
+/**
+ * @brief Модель строк файла: данные берутся из MappedTextFile по запросу
+ */
+class SummaryFileModel : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+    explicit SummaryFileModel(MappedTextFile* file, QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+private slots:
+    void onLinesIndexed(int lineCount);
+
+private:
+    MappedTextFile* m_file;
+    int m_rowCount;
+};
+
+/**
+ * @brief Просмотр больших файлов сводки
+ * Отображаются только видимые строки; переход к строке и поиск подстроки.
+ */
+class SummaryFileViewer : public QDialog {
+    Q_OBJECT
+
+public:
+    explicit SummaryFileViewer(QWidget* parent = nullptr);
+    ~SummaryFileViewer();
+
+    bool openFile(const QString& filename);
+    QString errorString() const { return m_file->errorString(); }
+
+private slots:
+    void onGoToLine();
+    void onFindNext();
+    void onLinesIndexed(int lineCount);
+    void onIndexingFinished(int lineCount);
+
+private:
+    void createUI();
+
+    MappedTextFile* m_file;
+    SummaryFileModel* m_model;
+    QListView* m_listView;
+    QSpinBox* m_lineSpinBox;
+    QLineEdit* m_searchEdit;
+    QLabel* m_statusLabel;
+};
+
+#endif // SUMMARYFILEVIEWER_H
@@ -0,0 +1,97 @@
+#ifndef WRITEBEHINDQUEUE_H
+#define WRITEBEHINDQUEUE_H
+
+#include <QString>
+#include <QVector>
+#include <QQueue>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QMutex>
+#include <QWaitCondition>
+#include <functional>
+#include "BaggageRecord.h"
+
+class QThread;
+class QSqlDatabase;
+
+/**
+ * @brief Результат отложенной записи одной записи
+ */
+struct WriteResult {
+    bool ok = false;
+    QString error;
+};
+
+/**
+ * @brief Параметры группового коммита
+ */
+struct WriteBehindOptions {
+    int maxBatchSize = 256;      // записей в одной транзакции
+    int maxDelayMs = 5;          // сколько ждать добора группы после первой записи
+    int maxPending = 10000;      // ёмкость очереди; enqueue() ждёт, если она заполнена
+    // Удерживается на время транзакции группы и onCommitted (согласование с кешем)
+    QMutex* commitLock = nullptr;
+    // Вызывается из потока записи после успешного коммита
+    std::function<void(const QVector<BaggageRecord>&)> onCommitted;
+};
+
+/**
+ * @brief Статистика очереди
+ */
+struct WriteBehindStats {
+    qint64 recordsWritten = 0;
+    qint64 recordsFailed = 0;
+    qint64 groupsCommitted = 0;
+};
+
+/**
+ * @brief Очередь отложенной записи с групповым коммитом
+ *
+ * Добавления копятся в очереди, отдельный поток забирает их группами
+ * (по размеру или по истечении maxDelayMs) и пишет каждую группу одной
+ * транзакцией через DatabaseManager::insertRecordsBatch(). Если группа
+ * не записалась, записи повторяются по одной, чтобы ошибка досталась
+ * только виновной записи.
+ */
+class WriteBehindQueue {
+public:
+    using Callback = std::function<void(const WriteResult&)>;
+
+    explicit WriteBehindQueue(const WriteBehindOptions& options = WriteBehindOptions());
+    ~WriteBehindQueue();
+
+    bool start();
+    // Дописать всё из очереди и остановить поток записи
+    void stop();
+    bool isRunning() const { return m_thread != nullptr; }
+
+    // Результат - через QFuture или через callback (вызывается из потока записи)
+    QFuture<WriteResult> enqueue(const BaggageRecord& record);
+    void enqueue(const BaggageRecord& record, const Callback& callback);
+
+    WriteBehindStats stats() const;
+
+private:
+    struct PendingWrite {
+        BaggageRecord record;
+        QFutureInterface<WriteResult> promise;
+        Callback callback;
+    };
+
+    bool push(PendingWrite&& write);
+    void run();
+    void commitGroup(QSqlDatabase& db, QVector<PendingWrite>& group);
+    static void resolve(PendingWrite& write, const WriteResult& result);
+
+    WriteBehindOptions m_options;
+    QThread* m_thread;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+    QQueue<PendingWrite> m_pending;
+    bool m_stopping;
+    WriteBehindStats m_stats;
+};
+
+#endif // WRITEBEHINDQUEUE_H
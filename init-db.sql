@@ -5,23 +5,70 @@ CREATE TABLE IF NOT EXISTS baggage_records (
     passenger_name VARCHAR(255) NOT NULL,
     created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
     updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
-    created_by INTEGER 
+    created_by INTEGER,
+    row_version BIGINT NOT NULL DEFAULT 0
 );
 
+-- Версия данных для обнаружения конфликтов (одна строка)
+CREATE TABLE IF NOT EXISTS baggage_version (
+    id INTEGER PRIMARY KEY CHECK (id = 1),
+    version BIGINT NOT NULL
+);
+INSERT INTO baggage_version (id, version) VALUES (1, 0) ON CONFLICT (id) DO NOTHING;
+
+-- Номера бирок вещей
+CREATE SEQUENCE IF NOT EXISTS bag_tag_seq;
+
 -- Создание таблицы для отдельных вещей 
 CREATE TABLE IF NOT EXISTS baggage_items (
     id SERIAL PRIMARY KEY,
     baggage_record_id INTEGER NOT NULL REFERENCES baggage_records(id) ON DELETE CASCADE,
     item_number INTEGER NOT NULL CHECK (item_number >= 1 AND item_number <= 5),
     weight NUMERIC(5,2) NOT NULL CHECK (weight > 0 AND weight <= 100),
+    bag_tag BIGINT NOT NULL DEFAULT nextval('bag_tag_seq'),
     UNIQUE(baggage_record_id, item_number)
 );
 
+-- Архив закрытых рейсов (baggage-cli close-flight): записи с весами
+-- массивом и итоги по рейсу
+CREATE TABLE IF NOT EXISTS baggage_archive (
+    id INTEGER PRIMARY KEY,
+    flight_number VARCHAR(50) NOT NULL,
+    passenger_name VARCHAR(255) NOT NULL,
+    created_at TIMESTAMP,
+    updated_at TIMESTAMP,
+    weights NUMERIC(5,2)[] NOT NULL,
+    bag_tags BIGINT[]
+);
+
+CREATE TABLE IF NOT EXISTS closed_flights (
+    flight_number VARCHAR(50) PRIMARY KEY,
+    closed_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+    passenger_count INTEGER NOT NULL,
+    item_count INTEGER NOT NULL,
+    total_weight NUMERIC(12,2) NOT NULL
+);
+
+-- События сканирования бирок (baggage-cli scan-ingest, сервис --scan-socket);
+-- секции по суткам UTC создаются при приёме
+CREATE TABLE IF NOT EXISTS baggage_events (
+    bag_tag BIGINT NOT NULL,
+    location VARCHAR(100) NOT NULL,
+    scanned_at TIMESTAMPTZ NOT NULL
+) PARTITION BY RANGE (scanned_at);
+
 -- Создание индексов для ускорения поиска
 CREATE INDEX IF NOT EXISTS idx_flight_number ON baggage_records(flight_number);
 CREATE INDEX IF NOT EXISTS idx_passenger_name ON baggage_records(passenger_name);
 CREATE INDEX IF NOT EXISTS idx_created_at ON baggage_records(created_at);
 CREATE INDEX IF NOT EXISTS idx_baggage_items_record ON baggage_items(baggage_record_id);
+CREATE INDEX IF NOT EXISTS idx_row_version ON baggage_records(row_version);
+CREATE INDEX IF NOT EXISTS idx_archive_flight_number ON baggage_archive(flight_number);
+CREATE INDEX IF NOT EXISTS idx_archive_passenger_name ON baggage_archive(passenger_name);
+CREATE INDEX IF NOT EXISTS idx_archive_created_at ON baggage_archive(created_at);
+CREATE UNIQUE INDEX IF NOT EXISTS idx_baggage_items_bag_tag ON baggage_items(bag_tag);
+CREATE INDEX IF NOT EXISTS idx_archive_bag_tags ON baggage_archive USING gin(bag_tags);
+CREATE INDEX IF NOT EXISTS idx_baggage_events_tag ON baggage_events(bag_tag, scanned_at);
 
 -- Комментарии к таблице и полям
 COMMENT ON TABLE baggage_records IS 'Записи о багаже пассажиров';
@@ -30,6 +77,7 @@ COMMENT ON COLUMN baggage_records.flight_number IS 'Номер рейса';
 COMMENT ON COLUMN baggage_records.passenger_name IS 'Ф.И.О. пассажира';
 COMMENT ON COLUMN baggage_records.created_at IS 'Дата и время создания записи';
 COMMENT ON COLUMN baggage_records.updated_at IS 'Дата и время последнего обновления';
+COMMENT ON COLUMN baggage_records.row_version IS 'Версия последнего изменения (baggage_version)';
 COMMENT ON COLUMN baggage_records.created_by IS 'ID пользователя, создавшего запись';
 
 COMMENT ON TABLE baggage_items IS 'Отдельные вещи багажа (нормализованная структура)';
@@ -37,6 +85,7 @@ COMMENT ON COLUMN baggage_items.id IS 'Уникальный идентифика
 COMMENT ON COLUMN baggage_items.baggage_record_id IS 'Ссылка на запись багажа';
 COMMENT ON COLUMN baggage_items.item_number IS 'Номер вещи (1-5)';
 COMMENT ON COLUMN baggage_items.weight IS 'Вес вещи в кг (0.01-100.00)';
+COMMENT ON COLUMN baggage_items.bag_tag IS 'Номер бирки (назначается при добавлении вещи)';
 
 -- Тригер для автоматического обновления updated_at
 CREATE OR REPLACE FUNCTION update_updated_at_column()
@@ -52,6 +101,207 @@ CREATE TRIGGER update_baggage_records_updated_at
     FOR EACH ROW
     EXECUTE FUNCTION update_updated_at_column();
 
+-- Версия изменения: один раз на транзакцию при первой записи; строка
+-- счётчика заблокирована до фиксации, поэтому версии растут в порядке
+-- фиксации (в отличие от CURRENT_TIMESTAMP - времени начала транзакции)
+CREATE OR REPLACE FUNCTION baggage_tx_version()
+RETURNS BIGINT
+LANGUAGE plpgsql AS $$
+DECLARE
+    v_version TEXT := current_setting('baggage.tx_version', true);
+BEGIN
+    IF v_version IS NULL OR v_version = '' THEN
+        UPDATE baggage_version
+        SET version = GREATEST(version + 1, (extract(epoch FROM clock_timestamp()) * 1000000)::bigint)
+        WHERE id = 1
+        RETURNING version::text INTO v_version;
+        PERFORM set_config('baggage.tx_version', v_version, true);
+    END IF;
+    RETURN v_version::bigint;
+END;
+$$;
+
+CREATE OR REPLACE FUNCTION baggage_set_row_version()
+RETURNS trigger
+LANGUAGE plpgsql AS $$
+BEGIN
+    NEW.row_version := baggage_tx_version();
+    RETURN NEW;
+END;
+$$;
+
+CREATE TRIGGER baggage_row_version
+    BEFORE INSERT OR UPDATE ON baggage_records
+    FOR EACH ROW
+    EXECUTE FUNCTION baggage_set_row_version();
+
+-- Изменения записи за один вызов: запись и все её вещи одной командой.
+-- Возвращают id записи и её created_at / updated_at (то же создаёт
+-- DatabaseManager::createTable, если функций нет)
+CREATE OR REPLACE FUNCTION add_baggage(p_flight_number VARCHAR, p_passenger_name VARCHAR,
+                                       p_weights NUMERIC[])
+RETURNS TABLE (record_id INTEGER, created_at TIMESTAMP, updated_at TIMESTAMP)
+LANGUAGE sql AS $$
+    WITH rec AS (
+        INSERT INTO baggage_records (flight_number, passenger_name)
+        VALUES (p_flight_number, p_passenger_name)
+        RETURNING id, created_at, updated_at
+    ), items AS (
+        INSERT INTO baggage_items (baggage_record_id, item_number, weight)
+        SELECT rec.id, w.item_number, w.weight
+        FROM rec, unnest(p_weights) WITH ORDINALITY AS w(weight, item_number)
+    )
+    SELECT id, created_at, updated_at FROM rec
+$$;
+
+-- Замена вещей первой записи пассажира; неизвестное ФИО - пустой результат
+CREATE OR REPLACE FUNCTION replace_items(p_passenger_name VARCHAR, p_weights NUMERIC[])
+RETURNS TABLE (record_id INTEGER, created_at TIMESTAMP, updated_at TIMESTAMP)
+LANGUAGE plpgsql AS $$
+DECLARE
+    v_id INTEGER;
+BEGIN
+    SELECT br.id INTO v_id FROM baggage_records br
+    WHERE br.passenger_name = p_passenger_name
+    ORDER BY br.id LIMIT 1
+    FOR UPDATE;
+    IF NOT FOUND THEN
+        RETURN;
+    END IF;
+
+    -- Вещи с прежним номером сохраняют бирку
+    DELETE FROM baggage_items
+    WHERE baggage_record_id = v_id AND item_number > cardinality(p_weights);
+    INSERT INTO baggage_items (baggage_record_id, item_number, weight)
+    SELECT v_id, w.item_number, w.weight
+    FROM unnest(p_weights) WITH ORDINALITY AS w(weight, item_number)
+    ON CONFLICT (baggage_record_id, item_number) DO UPDATE SET weight = EXCLUDED.weight;
+
+    RETURN QUERY
+        UPDATE baggage_records br SET updated_at = CURRENT_TIMESTAMP
+        WHERE br.id = v_id
+        RETURNING br.id, br.created_at, br.updated_at;
+END;
+$$;
+
+-- Загрузка рейсов онлайн: изменения итогов по рейсам в канал baggage_load,
+-- одно уведомление на рейс за команду "txid<TAB>метка<TAB>рейс<TAB>пассажиры<TAB>вещи<TAB>вес"
+CREATE UNLOGGED TABLE IF NOT EXISTS baggage_load_pending (
+    txid BIGINT NOT NULL,
+    record_id INTEGER NOT NULL,
+    item_count BIGINT NOT NULL,
+    total_weight NUMERIC(12,2) NOT NULL
+);
+CREATE INDEX IF NOT EXISTS idx_load_pending ON baggage_load_pending(txid, record_id);
+
+CREATE OR REPLACE FUNCTION baggage_load_notify(p_flight_number VARCHAR, p_passengers BIGINT,
+                                               p_items BIGINT, p_weight NUMERIC)
+RETURNS void
+LANGUAGE sql AS $$
+    SELECT pg_notify('baggage_load', concat_ws(E'\t', txid_current(),
+                     (extract(epoch FROM clock_timestamp()) * 1000000)::bigint,
+                     p_flight_number, p_passengers, p_items, p_weight))
+$$;
+
+-- Вещи записей, удалённых каскадом, ждут триггера baggage_records в baggage_load_pending
+CREATE OR REPLACE FUNCTION baggage_load_items_changed()
+RETURNS trigger
+LANGUAGE plpgsql AS $$
+BEGIN
+    IF TG_OP = 'INSERT' THEN
+        PERFORM baggage_load_notify(br.flight_number, 0, count(*), sum(n.weight))
+        FROM new_items n JOIN baggage_records br ON br.id = n.baggage_record_id
+        GROUP BY br.flight_number;
+    ELSIF TG_OP = 'UPDATE' THEN
+        PERFORM baggage_load_notify(br.flight_number, 0, 0, sum(n.weight - o.weight))
+        FROM new_items n
+        JOIN old_items o ON o.id = n.id
+        JOIN baggage_records br ON br.id = n.baggage_record_id
+        WHERE n.weight <> o.weight
+        GROUP BY br.flight_number;
+    ELSE
+        PERFORM baggage_load_notify(br.flight_number, 0, -count(*), -sum(o.weight))
+        FROM old_items o JOIN baggage_records br ON br.id = o.baggage_record_id
+        GROUP BY br.flight_number;
+        INSERT INTO baggage_load_pending (txid, record_id, item_count, total_weight)
+        SELECT txid_current(), o.baggage_record_id, count(*), sum(o.weight)
+        FROM old_items o
+        WHERE NOT EXISTS (SELECT 1 FROM baggage_records br WHERE br.id = o.baggage_record_id)
+        GROUP BY o.baggage_record_id;
+    END IF;
+    RETURN NULL;
+END;
+$$;
+
+CREATE OR REPLACE FUNCTION baggage_load_records_changed()
+RETURNS trigger
+LANGUAGE plpgsql AS $$
+BEGIN
+    IF TG_OP = 'INSERT' THEN
+        PERFORM baggage_load_notify(n.flight_number, count(*), 0, 0)
+        FROM new_records n
+        GROUP BY n.flight_number;
+    ELSIF TG_OP = 'UPDATE' THEN
+        -- Запись перенесена на другой рейс вместе с вещами
+        PERFORM baggage_load_notify(m.flight_number, sum(m.sign)::bigint,
+                                    sum(m.sign * m.items)::bigint, sum(m.sign * m.weight))
+        FROM (
+            SELECT CASE WHEN s.sign > 0 THEN r.new_flight ELSE r.old_flight END AS flight_number,
+                   s.sign, r.items, r.weight
+            FROM (
+                SELECT n.flight_number AS new_flight, o.flight_number AS old_flight,
+                       count(bi.id) AS items, COALESCE(sum(bi.weight), 0) AS weight
+                FROM new_records n
+                JOIN old_records o ON o.id = n.id AND o.flight_number <> n.flight_number
+                LEFT JOIN baggage_items bi ON bi.baggage_record_id = n.id
+                GROUP BY n.id, n.flight_number, o.flight_number
+            ) r
+            CROSS JOIN (VALUES (1), (-1)) AS s(sign)
+        ) m
+        GROUP BY m.flight_number;
+    ELSE
+        PERFORM baggage_load_notify(o.flight_number, -count(*),
+                                    -COALESCE(sum(p.item_count), 0)::bigint,
+                                    -COALESCE(sum(p.total_weight), 0))
+        FROM old_records o
+        LEFT JOIN baggage_load_pending p ON p.txid = txid_current() AND p.record_id = o.id
+        GROUP BY o.flight_number;
+        DELETE FROM baggage_load_pending p
+        USING old_records o
+        WHERE p.txid = txid_current() AND p.record_id = o.id;
+    END IF;
+    RETURN NULL;
+END;
+$$;
+
+CREATE TRIGGER baggage_load_items_insert AFTER INSERT ON baggage_items
+    REFERENCING NEW TABLE AS new_items
+    FOR EACH STATEMENT EXECUTE FUNCTION baggage_load_items_changed();
+CREATE TRIGGER baggage_load_items_update AFTER UPDATE ON baggage_items
+    REFERENCING OLD TABLE AS old_items NEW TABLE AS new_items
+    FOR EACH STATEMENT EXECUTE FUNCTION baggage_load_items_changed();
+CREATE TRIGGER baggage_load_items_delete AFTER DELETE ON baggage_items
+    REFERENCING OLD TABLE AS old_items
+    FOR EACH STATEMENT EXECUTE FUNCTION baggage_load_items_changed();
+CREATE TRIGGER baggage_load_records_insert AFTER INSERT ON baggage_records
+    REFERENCING NEW TABLE AS new_records
+    FOR EACH STATEMENT EXECUTE FUNCTION baggage_load_records_changed();
+CREATE TRIGGER baggage_load_records_update AFTER UPDATE ON baggage_records
+    REFERENCING OLD TABLE AS old_records NEW TABLE AS new_records
+    FOR EACH STATEMENT EXECUTE FUNCTION baggage_load_records_changed();
+CREATE TRIGGER baggage_load_records_delete AFTER DELETE ON baggage_records
+    REFERENCING OLD TABLE AS old_records
+    FOR EACH STATEMENT EXECUTE FUNCTION baggage_load_records_changed();
+
+-- Ревизия функций (DatabaseManager::createTable пересоздаёт функции другой ревизии)
+COMMENT ON FUNCTION baggage_tx_version() IS 'baggage_system 2';
+COMMENT ON FUNCTION baggage_set_row_version() IS 'baggage_system 2';
+COMMENT ON FUNCTION add_baggage(varchar, varchar, numeric[]) IS 'baggage_system 2';
+COMMENT ON FUNCTION replace_items(varchar, numeric[]) IS 'baggage_system 2';
+COMMENT ON FUNCTION baggage_load_notify(varchar, bigint, bigint, numeric) IS 'baggage_system 2';
+COMMENT ON FUNCTION baggage_load_items_changed() IS 'baggage_system 2';
+COMMENT ON FUNCTION baggage_load_records_changed() IS 'baggage_system 2';
+
 CREATE TABLE IF NOT EXISTS users (
     id SERIAL PRIMARY KEY,
     username VARCHAR(100) UNIQUE NOT NULL,
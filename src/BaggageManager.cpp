@@ -1,16 +1,36 @@
 #include "BaggageManager.h"
-#include "DatabaseManager.h"
+#include "BaggageSnapshot.h"
+#include "FlightArchive.h"
+#include "JournalReplayer.h"
 #include <QFile>
+#include <QFileInfo>
 #include <QDataStream>
 #include <QTextStream>
 #include <QDebug>
+#include <iterator>
 
-BaggageManager::BaggageManager() {
-    m_records = DatabaseManager::instance().getAllRecords();
-    qDebug() << "BaggageManager инициализирован. Записей в кеше:" << m_records.size();
+BaggageManager::BaggageManager(StorageEngine& storage)
+    : m_storage(storage), m_warmedFromSnapshot(false), m_dataVersion(-1), m_bagTagsStale(true) {
+    // Быстрый старт: сначала кеш из последнего снимка, сверка с БД - в catchUpWithDatabase()
+    // (или в DeskReconciler). Без связи с БД снимок - единственный источник данных.
+    if (loadBinaryFile(BaggageSnapshot::lastSnapshotPath())) {
+        m_warmedFromSnapshot = true;
+    } else if (m_storage.isConnected()) {
+        m_records = m_storage.getAllRecords(&m_dataVersion);
+    }
+    qDebug() << "BaggageManager инициализирован. Записей в кеше:" << m_records.size()
+             << (m_warmedFromSnapshot ? "(из снимка)" : "(из БД)");
 }
 
 BaggageManager::~BaggageManager() {
+    m_reconciler.reset();
+
+    // Сохраняем кеш для быстрого старта в следующий раз. С журналом снимок
+    // пишет DeskReconciler: кеш содержит неперенесённые изменения, а они
+    // при старте накладываются из журнала.
+    if (!m_warmedFromSnapshot && !m_journal) {
+        saveBinaryFile(BaggageSnapshot::lastSnapshotPath());
+    }
 }
 
 // Функция 1: Создать/инициализировать БД
@@ -22,34 +42,395 @@ bool BaggageManager::createFile(const QString& filename) {
     m_records.clear();
 
     // Очищаем таблицу в БД
-    DatabaseManager::instance().clearAllRecords();
+    m_storage.clearAllRecords();
 
     return true;
 }
 
-// Функция 2: Загрузить содержимое из БД
+// Функция 2: Загрузить содержимое из снимка .dat или из БД
 bool BaggageManager::loadFromFile(const QString& filename) {
-    Q_UNUSED(filename);
-    m_records = DatabaseManager::instance().getAllRecords();
+    if (!filename.isEmpty() && QFileInfo::exists(filename)) {
+        if (!loadBinaryFile(filename)) {
+            return false;
+        }
+        m_currentFilename = filename;
+        m_warmedFromSnapshot = true;
+        return true;
+    }
+
+    if (!refreshFromDatabase()) {
+        return false;
+    }
     m_currentFilename = "PostgreSQL Database";
+    m_warmedFromSnapshot = false;
     return true;
 }
 
-// Сохранить данные (для PostgreSQL это не требуется - данные сохраняются автоматически)
+// Сохранить снимок текущего кеша (сами данные PostgreSQL сохраняет при каждой операции)
 bool BaggageManager::saveToFile(const QString& filename) {
-    Q_UNUSED(filename);
-    // PostgreSQL сохраняет данные автоматически при каждой операции
+    return saveBinaryFile(filename);
+}
+
+// Выгрузить рейсы в архив (пустой список - все рейсы)
+bool BaggageManager::exportArchive(const QString& filename, const QStringList& flightNumbers) {
+    FlightArchiveWriter writer;
+    if (!writer.open(filename)) {
+        qWarning() << writer.errorString();
+        return false;
+    }
+
+    // Записи читаются курсором и сразу пишутся в архив
+    bool ok = m_storage.streamRecords(flightNumbers,
+        [&writer](const BaggageRecord& record) {
+            return writer.write(record);
+        });
+
+    if (!writer.close() || !ok) {
+        qWarning() << writer.errorString();
+        return false;
+    }
     return true;
 }
 
+// Загрузить записи из архива обратно в БД
+int BaggageManager::importArchive(const QString& filename) {
+    FlightArchiveReader reader;
+    if (!reader.open(filename)) {
+        qWarning() << reader.errorString();
+        return -1;
+    }
+
+    // Пачками через addRecordsBatch; если пачка не прошла (например, в ней
+    // недопустимая запись), её записи добавляются по одной
+    int imported = 0;
+    QVector<BaggageRecord> batch;
+    batch.reserve(ARCHIVE_IMPORT_BATCH);
+    auto flush = [this, &batch, &imported]() {
+        if (m_storage.addRecordsBatch(batch)) {
+            imported += batch.size();
+        } else {
+            qWarning() << "Пачка архива не записана, повтор по одной записи:" << m_storage.getLastError();
+            for (const BaggageRecord& single : batch) {
+                if (m_storage.addRecord(single)) {
+                    ++imported;
+                }
+            }
+        }
+        batch.clear();
+    };
+
+    BaggageRecord record;
+    while (reader.readNext(record)) {
+        batch.append(record);
+        if (batch.size() >= ARCHIVE_IMPORT_BATCH) {
+            flush();
+        }
+    }
+    if (!batch.isEmpty()) {
+        flush();
+    }
+
+    if (reader.hasError()) {
+        qWarning() << reader.errorString();
+    }
+
+    if (imported > 0) {
+        refreshFromDatabase();
+    }
+    return reader.hasError() && imported == 0 ? -1 : imported;
+}
+
+// Догнать состояние БД после быстрого старта из снимка
+bool BaggageManager::catchUpWithDatabase() {
+    // С журналом сверку выполняет фоновый поток
+    if (m_reconciler) {
+        m_reconciler->reconcileNow();
+        return false;
+    }
+    if (!m_storage.isConnected()) {
+        return false;
+    }
+    if (!mergeChangesFromDatabase() && !refreshFromDatabase()) {
+        return false;
+    }
+
+    m_warmedFromSnapshot = false;
+    saveBinaryFile(BaggageSnapshot::lastSnapshotPath());
+    return true;
+}
+
+bool BaggageManager::openJournal(const QString& filename) {
+    std::unique_ptr<MutationJournal> journal(new MutationJournal());
+    if (!journal->open(filename)) {
+        qWarning() << journal->errorString();
+        return false;
+    }
+    m_reconciler.reset();
+    m_journal = std::move(journal);
+
+    // Неперенесённые изменения прошлого сеанса - поверх снимка
+    overlayPendingMutations();
+    for (const MutationJournal::Entry& entry : m_journal->pendingEntries()) {
+        markTouched(entry);
+    }
+
+    m_reconciler.reset(new DeskReconciler(m_journal.get()));
+    m_reconciler->start();
+    return true;
+}
+
+bool BaggageManager::isOnline() const {
+    return m_reconciler ? m_reconciler->isOnline() : m_storage.isConnected();
+}
+
+void BaggageManager::applyServerState(const QVector<BaggageRecord>& records, qint64 dataVersion,
+                                      quint64 appliedThrough) {
+    m_records = records;
+    m_dataVersion = dataVersion;
+    m_warmedFromSnapshot = false;
+    m_bagTagsStale = true;
+    overlayPendingMutations();
+
+    // Перенесённые изменения уже учтены в dataVersion
+    auto forget = [appliedThrough](QHash<QString, quint64>& touched) {
+        for (auto it = touched.begin(); it != touched.end();) {
+            it = it.value() <= appliedThrough ? touched.erase(it) : std::next(it);
+        }
+    };
+    forget(m_touchedPassengers);
+    forget(m_touchedFlights);
+}
+
+bool BaggageManager::refreshFromDatabase() {
+    // Без связи остаётся кеш: пустой результат не должен стирать данные стойки
+    if (m_reconciler && !m_reconciler->isOnline()) {
+        return false;
+    }
+
+    qint64 version = -1;
+    QVector<BaggageRecord> records = m_storage.getAllRecords(&version);
+    if (version < 0) {
+        return false;
+    }
+    m_records = records;
+    m_dataVersion = version;
+    m_bagTagsStale = true;
+    overlayPendingMutations();
+    return true;
+}
+
+bool BaggageManager::mergeChangesFromDatabase() {
+    // Кеш с неперенесёнными изменениями не соответствует ни одной версии БД
+    if (m_dataVersion < 0 || pendingMutations() > 0) {
+        return false;
+    }
+
+    QVector<BaggageRecord> changed;
+    qint64 version = -1;
+    int count = 0;
+    if (!m_storage.getRecordsChangedSince(m_dataVersion, &changed, &version, &count)) {
+        return false;
+    }
+
+    // Записи одной пары (рейс, ФИО) заменяются группой на месте первой из них,
+    // новые пары дописываются в конец - в порядке id, как у getAllRecords
+    auto key = [](const BaggageRecord& record) {
+        return record.getFlightNumber() + QLatin1Char('\n') + record.getPassengerName();
+    };
+    QHash<QString, QVector<BaggageRecord>> groups;
+    for (const BaggageRecord& record : changed) {
+        groups[key(record)].append(record);
+    }
+
+    QVector<BaggageRecord> merged;
+    merged.reserve(count);
+    for (const BaggageRecord& record : m_records) {
+        auto it = groups.find(key(record));
+        if (it == groups.end()) {
+            merged.append(record);
+        } else if (!it.value().isEmpty()) {
+            merged += it.value();
+            it.value().clear();
+        }
+    }
+    for (const BaggageRecord& record : changed) {
+        QVector<BaggageRecord>& group = groups[key(record)];
+        if (!group.isEmpty()) {
+            merged += group;
+            group.clear();
+        }
+    }
+
+    // Удалённые в БД записи не попадают в изменения - их выдаёт только число записей
+    if (merged.size() != count) {
+        qDebug() << "Число записей не сошлось после догоняющего чтения:" << merged.size()
+                 << "в БД" << count << "- полная загрузка";
+        return false;
+    }
+
+    m_records = merged;
+    m_dataVersion = version;
+    if (!changed.isEmpty()) {
+        m_bagTagsStale = true;
+    }
+    qDebug() << "Кеш догнал БД, изменённых записей:" << changed.size();
+    return true;
+}
+
+void BaggageManager::overlayPendingMutations() {
+    if (!m_journal) {
+        return;
+    }
+    for (const MutationJournal::Entry& entry : m_journal->pendingEntries()) {
+        MutationJournal::applyToRecords(entry, m_records);
+    }
+}
+
+void BaggageManager::markTouched(const MutationJournal::Entry& entry) {
+    switch (entry.type) {
+    case MutationJournal::AddRecord:
+        m_touchedPassengers.insert(entry.record.getPassengerName(), entry.sequence);
+        m_touchedFlights.insert(entry.record.getFlightNumber(), entry.sequence);
+        break;
+    case MutationJournal::ChangeItems:
+        m_touchedPassengers.insert(entry.passengerName, entry.sequence);
+        for (const BaggageRecord& record : m_records) {
+            if (record.getPassengerName() == entry.passengerName) {
+                m_touchedFlights.insert(record.getFlightNumber(), entry.sequence);
+            }
+        }
+        break;
+    case MutationJournal::DeleteFlights:
+    case MutationJournal::Applied:
+        break;
+    }
+}
+
+qint64 BaggageManager::baseVersionFor(const QStringList& flightNumbers,
+                                      const QString& passengerName) const {
+    if (m_dataVersion < 0 || m_touchedPassengers.contains(passengerName)) {
+        return MutationJournal::NO_VERSION;
+    }
+    for (const QString& flightNumber : flightNumbers) {
+        if (m_touchedFlights.contains(flightNumber)) {
+            return MutationJournal::NO_VERSION;
+        }
+    }
+    return m_dataVersion;
+}
+
+// Изменение уже в журнале: сразу видно в кеше, в БД его перенесёт DeskReconciler
+bool BaggageManager::acceptJournaled(const MutationJournal::Entry& entry, int* affected) {
+    if (entry.sequence == 0) {
+        qWarning() << "Не удалось записать изменение в журнал:" << m_journal->errorString();
+        return false;
+    }
+
+    // Пока изменение не перенесено в БД, журнал - его единственная копия
+    m_journal->sync();
+    markTouched(entry);
+
+    forgetBagTags(entry);
+    int before = m_records.size();
+    MutationJournal::applyToRecords(entry, m_records);
+    if (affected) {
+        *affected = before - m_records.size();
+    }
+
+    m_reconciler->reconcileNow();
+    return true;
+}
+
+void BaggageManager::forgetBagTags(const MutationJournal::Entry& entry) {
+    if (entry.type != MutationJournal::DeleteFlights && entry.type != MutationJournal::ChangeItems) {
+        return;
+    }
+    for (auto it = m_bagTags.begin(); it != m_bagTags.end();) {
+        const bool affected = entry.type == MutationJournal::DeleteFlights
+                                  ? entry.flightNumbers.contains(it->flightNumber)
+                                  : it->passengerName == entry.passengerName;
+        it = affected ? m_bagTags.erase(it) : std::next(it);
+    }
+}
+
+// При ошибке остаётся прежний индекс; следующая попытка - после новой загрузки записей
+int BaggageManager::rebuildBagTagIndex() {
+    m_bagTagsStale = false;
+    QHash<qint64, BagTagInfo> index;
+    index.reserve(m_bagTags.size());
+    const bool ok = m_storage.streamBagTags([&index](const BagTagInfo& info) {
+        index.insert(info.tag, info);
+        return true;
+    });
+    if (!ok) {
+        return -1;
+    }
+
+    // Неперенесённые удаления и изменения стойки - поверх состояния БД
+    m_bagTags.swap(index);
+    if (m_journal) {
+        for (const MutationJournal::Entry& entry : m_journal->pendingEntries()) {
+            forgetBagTags(entry);
+        }
+    }
+    return m_bagTags.size();
+}
+
+// Поиск по бирке: индекс в памяти, промах - запрос к хранилищу
+int BaggageManager::resolveBagTag(qint64 tag, BagTagInfo* info) {
+    if (m_bagTagsStale && isOnline()) {
+        rebuildBagTagIndex();
+    }
+
+    const auto it = m_bagTags.constFind(tag);
+    if (it != m_bagTags.constEnd()) {
+        if (info) {
+            *info = it.value();
+        }
+        return 1;
+    }
+
+    if (!isOnline()) {
+        return 0;
+    }
+    BagTagInfo found;
+    const int result = m_storage.resolveBagTag(tag, &found);
+    if (result == 1) {
+        // Архивные не кешируются: индекс - только открытые рейсы
+        if (!found.archived) {
+            m_bagTags.insert(tag, found);
+        }
+        if (info) {
+            *info = found;
+        }
+    }
+    return result;
+}
+
 // Функция 3: Получить список пассажиров с 1 вещью весом 20-30 кг
+// С журналом поиск и фильтр работают по кешу: он включает неперенесённые
+// изменения и доступен без связи с БД
 QVector<BaggageRecord> BaggageManager::filterPassengersWithSingleItem20_30kg() const {
-    return DatabaseManager::instance().filterPassengersWithSingleItem20_30kg();
+    if (!m_reconciler) {
+        return m_storage.filterPassengersWithSingleItem20_30kg();
+    }
+
+    QVector<BaggageRecord> result;
+    for (const BaggageRecord& record : m_records) {
+        if (record.getItemCount() == 1) {
+            double weight = record.getItemWeights()[0];
+            if (weight >= 20.0 && weight <= 30.0) {
+                result.append(record);
+            }
+        }
+    }
+    return result;
 }
 
 // Функция 4: Сформировать файл с номером рейса, ФИО и общим весом багажа
-bool BaggageManager::createSummaryFile(const QString& filename) {
-    return DatabaseManager::instance().createSummaryFile(filename);
+bool BaggageManager::createSummaryFile(const QString& filename,
+                                       const SummaryExportOptions& options) {
+    return m_storage.createSummaryFile(filename, options);
 }
 
 // Функция 6: Добавить запись
@@ -59,19 +440,30 @@ bool BaggageManager::addRecord(const BaggageRecord& record) {
         return false;
     }
 
-    bool success = DatabaseManager::instance().addRecord(record);
+    if (m_journal) {
+        return acceptJournaled(m_journal->appendAdd(record));
+    }
+
+    bool success = m_storage.addRecord(record);
     if (success) {
         // Обновляем кеш
-        m_records = DatabaseManager::instance().getAllRecords();
+        refreshFromDatabase();
     }
     return success;
 }
 
 // Функция 7: Удалить записи по заданным номерам рейсов
 int BaggageManager::deleteRecordsByFlightNumbers(const QStringList& flightNumbers) {
-    int deletedCount = DatabaseManager::instance().deleteRecordsByFlightNumbers(flightNumbers);
+    if (m_journal) {
+        int affected = 0;
+        MutationJournal::Entry entry =
+            m_journal->appendDelete(flightNumbers, baseVersionFor(flightNumbers, QString()));
+        return acceptJournaled(entry, &affected) ? affected : 0;
+    }
+
+    int deletedCount = m_storage.deleteRecordsByFlightNumbers(flightNumbers);
     if (deletedCount > 0) {
-        m_records = DatabaseManager::instance().getAllRecords();
+        refreshFromDatabase();
     }
     return deletedCount;
 }
@@ -79,37 +471,100 @@ int BaggageManager::deleteRecordsByFlightNumbers(const QStringList& flightNumber
 // Функция 8: Изменить количество вещей для указанных ФИО
 bool BaggageManager::changeItemCountByName(const QString& passengerName,
                                            const QVector<double>& newWeights) {
-    bool success = DatabaseManager::instance().changeItemCountByName(passengerName, newWeights);
+    if (m_journal) {
+        // Проверки, которые иначе выполнила бы БД: ответ нужен сразу
+        BaggageRecord probe;
+        if (!probe.setItemWeights(newWeights)) {
+            qWarning() << "Неверное количество или вес вещей";
+            return false;
+        }
+        bool known = false;
+        for (const BaggageRecord& record : m_records) {
+            if (record.getPassengerName() == passengerName) {
+                known = true;
+                break;
+            }
+        }
+        if (!known) {
+            return false;
+        }
+
+        MutationJournal::Entry entry = m_journal->appendChangeItems(
+            passengerName, newWeights, baseVersionFor(QStringList(), passengerName));
+        return acceptJournaled(entry);
+    }
+
+    bool success = m_storage.changeItemCountByName(passengerName, newWeights);
     if (success) {
         // Обновляем кеш
-        m_records = DatabaseManager::instance().getAllRecords();
+        refreshFromDatabase();
     }
     return success;
 }
 
 // Очистить все записи
 void BaggageManager::clearRecords() {
-    DatabaseManager::instance().clearAllRecords();
+    m_storage.clearAllRecords();
     m_records.clear();
 }
 
 // Найти записи по номеру рейса
 QVector<BaggageRecord> BaggageManager::findRecordsByFlightNumber(const QString& flightNumber) const {
-    return DatabaseManager::instance().findRecordsByFlightNumber(flightNumber);
+    if (!m_reconciler) {
+        return m_storage.findRecordsByFlightNumber(flightNumber);
+    }
+
+    QVector<BaggageRecord> result;
+    for (const BaggageRecord& record : m_records) {
+        if (record.getFlightNumber() == flightNumber) {
+            result.append(record);
+        }
+    }
+    return result;
 }
 
 // Найти записи по ФИО пассажира
 QVector<BaggageRecord> BaggageManager::findRecordsByPassengerName(const QString& passengerName) const {
-    return DatabaseManager::instance().findRecordsByPassengerName(passengerName);
+    if (!m_reconciler) {
+        return m_storage.findRecordsByPassengerName(passengerName);
+    }
+
+    QVector<BaggageRecord> result;
+    for (const BaggageRecord& record : m_records) {
+        if (record.getPassengerName() == passengerName) {
+            result.append(record);
+        }
+    }
+    return result;
 }
 
 bool BaggageManager::saveBinaryFile(const QString& filename) {
-    Q_UNUSED(filename);
-    // Данные сохраняются в PostgreSQL автоматически
+    // Кеш с неперенесёнными изменениями уже не соответствует версии БД
+    const qint64 version = pendingMutations() > 0 ? -1 : m_dataVersion;
+    QString error;
+    if (!BaggageSnapshot::write(filename, m_records, &error, version)) {
+        qWarning() << error;
+        return false;
+    }
     return true;
 }
 
 bool BaggageManager::loadBinaryFile(const QString& filename) {
-    Q_UNUSED(filename);
-    return loadFromFile(filename);
+    if (!QFileInfo::exists(filename)) {
+        return false;
+    }
+
+    BaggageSnapshot snapshot;
+    if (!snapshot.open(filename)) {
+        qWarning() << snapshot.errorString();
+        return false;
+    }
+
+    // Кешу нужны все записи: они создаются из отображения за один проход,
+    // а изменения после версии снимка дочитывает catchUpWithDatabase()
+    m_records = snapshot.readAll();
+    m_dataVersion = snapshot.dataVersion();
+    qDebug() << "Загружен снимок" << filename << "записей:" << m_records.size()
+             << (snapshot.isLegacyFormat() ? "(старый формат QDataStream)" : "");
+    return true;
 }
@@ -1,5 +1,4 @@
 #include "BaggageRecord.h"
-#include <QRegularExpression>
 
 BaggageRecord::BaggageRecord()
     : m_flightNumber(""), m_passengerName("") {
@@ -44,69 +43,145 @@ bool BaggageRecord::isValidWeight(double weight) {
     return weight > 0.0 && weight <= 100.0; // Максимальный вес одной вещи 100 кг
 }
 
-bool BaggageRecord::isValidFlightNumber(const QString& flightNumber) {
-    QString trimmed = flightNumber.trimmed();
-
-    // Проверка: не пустое, длина 4-10 символов
-    if (trimmed.isEmpty() || trimmed.length() < 4 || trimmed.length() > 10) {
+// Валидаторы написаны как однопроходные сканеры: без QRegularExpression
+// и без копии строки в trimmed(), так как вызываются на каждой вставке и импорте.
+namespace {
+
+// Символы, запрещённые в номере рейса и ФИО (обратная косая черта, кавычки, скобки и т.п.)
+inline bool isDangerousChar(char16_t c) {
+    switch (c) {
+    case u'<': case u'>': case u'{': case u'}': case u'[': case u']':
+    case u'$': case u';': case u'\'': case u'"': case u'`': case u'\\':
+        return true;
+    default:
         return false;
     }
+}
 
-    // Проверка: не содержит опасные символы
-    if (trimmed.contains(QRegularExpression("[<>{}\\[\\]$;'\"`\\\\]"))) {
-        return false;
-    }
+inline bool isAsciiUpper(char16_t c) { return c >= u'A' && c <= u'Z'; }
+inline bool isAsciiDigit(char16_t c) { return c >= u'0' && c <= u'9'; }
 
-    // Проверка формата: 2 буквы + цифры (например SU1234, BA456)
-    QRegularExpression regex("^[A-Z]{2}\\d{3,4}$");
-    return regex.match(trimmed).hasMatch();
+// Буква из набора [А-Яа-яA-Za-z]
+inline bool isNameLetter(char16_t c) {
+    return (c >= u'A' && c <= u'Z') || (c >= u'a' && c <= u'z') ||
+           (c >= u'\u0410' && c <= u'\u044F');
 }
 
-bool BaggageRecord::isValidPassengerName(const QString& name) {
-    QString trimmed = name.trimmed();
+// Границы строки без пробельных символов по краям (аналог trimmed() без копии)
+inline void trimmedBounds(const QString& value, int& begin, int& end) {
+    begin = 0;
+    end = static_cast<int>(value.size());
+    while (begin < end && value.at(begin).isSpace()) {
+        ++begin;
+    }
+    while (end > begin && value.at(end - 1).isSpace()) {
+        --end;
+    }
+}
 
-    // Проверка: длина от 3 до 255 символов
-    if (trimmed.length() < 3 || trimmed.length() > 255) {
+} // namespace
+
+bool BaggageRecord::isValidFlightNumber(const QString& flightNumber) {
+    int begin = 0;
+    int end = 0;
+    trimmedBounds(flightNumber, begin, end);
+    const int length = end - begin;
+
+    // Формат: 2 буквы + 3-4 цифры (например SU1234, BA456), т.е. 5-6 символов.
+    // Опасные символы под этот формат не подходят автоматически.
+    if (length < 5 || length > 6) {
         return false;
     }
 
-    // Проверка: не содержит опасные символы
-    if (trimmed.contains(QRegularExpression("[<>{}\\[\\]$;'\"`\\\\]"))) {
+    const QChar* data = flightNumber.constData() + begin;
+    if (!isAsciiUpper(data[0].unicode()) || !isAsciiUpper(data[1].unicode())) {
         return false;
     }
+    for (int i = 2; i < length; ++i) {
+        if (!isAsciiDigit(data[i].unicode())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BaggageRecord::isValidPassengerName(const QString& name) {
+    int begin = 0;
+    int end = 0;
+    trimmedBounds(name, begin, end);
+    const int length = end - begin;
 
-    // Проверка: содержит хотя бы одну букву
-    if (!trimmed.contains(QRegularExpression("[А-Яа-яA-Za-z]"))) {
+    // Проверка: длина от 3 до 255 символов
+    if (length < 3 || length > 255) {
         return false;
     }
 
-    return true;
+    // Один проход: нет опасных символов и есть хотя бы одна буква
+    const QChar* data = name.constData() + begin;
+    bool hasLetter = false;
+    for (int i = 0; i < length; ++i) {
+        const char16_t c = data[i].unicode();
+        if (isDangerousChar(c)) {
+            return false;
+        }
+        hasLetter = hasLetter || isNameLetter(c);
+    }
+
+    return hasLetter;
 }
 
 bool BaggageRecord::isValid() const {
+    return validate() == NoError;
+}
+
+BaggageRecord::ValidationError BaggageRecord::validate() const {
     // Валидация номера рейса
     if (!isValidFlightNumber(m_flightNumber)) {
-        return false;
+        return InvalidFlightNumber;
     }
 
     // Валидация ФИО пассажира
     if (!isValidPassengerName(m_passengerName)) {
-        return false;
+        return InvalidPassengerName;
     }
 
     // Валидация количества вещей
     if (!isValidItemCount(m_itemWeights.size())) {
-        return false;
+        return InvalidItemCount;
     }
 
     // Валидация веса каждой вещи
     for (double weight : m_itemWeights) {
         if (!isValidWeight(weight)) {
-            return false;
+            return InvalidWeight;
         }
     }
 
-    return true;
+    return NoError;
+}
+
+QVector<BaggageRecord::ValidationError> BaggageRecord::validateBatch(const QVector<BaggageRecord>& records) {
+    QVector<ValidationError> errors(records.size(), NoError);
+    for (int i = 0; i < records.size(); ++i) {
+        errors[i] = records[i].validate();
+    }
+    return errors;
+}
+
+QString BaggageRecord::validationErrorText(ValidationError error) {
+    switch (error) {
+    case NoError:
+        return QString();
+    case InvalidFlightNumber:
+        return "Неверный номер рейса";
+    case InvalidPassengerName:
+        return "Неверное ФИО пассажира";
+    case InvalidItemCount:
+        return "Неверное количество вещей (должно быть от 1 до 5)";
+    case InvalidWeight:
+        return "Неверный вес вещи (должен быть от 0 до 100 кг)";
+    }
+    return QString();
 }
 
 // Сериализация для сохранения в бинарный файл
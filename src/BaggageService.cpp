@@ -0,0 +1,775 @@
+#include "BaggageService.h"
+#include "DatabaseManager.h"
+#include "BaggageSnapshot.h"
+#include "WriteBehindQueue.h"
+#include "ScanEventIngestor.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QPointer>
+#include <QSemaphore>
+#include <QThread>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QDebug>
+
+BaggageService::BaggageService(QObject* parent)
+    : QObject(parent),
+      m_localServer(nullptr),
+      m_tcpServer(nullptr),
+      m_scanServer(nullptr),
+      m_requestsServed(0),
+      m_cachedCount(0) {
+    connect(&m_refreshTimer, &QTimer::timeout, this, &BaggageService::onRefreshTimer);
+    m_scanResumeTimer.setSingleShot(true);
+    m_scanResumeTimer.setInterval(SCAN_RESUME_MS);
+    connect(&m_scanResumeTimer, &QTimer::timeout, this, &BaggageService::onScanResume);
+}
+
+BaggageService::~BaggageService() {
+    stop();
+}
+
+bool BaggageService::start(const ServiceOptions& options) {
+    m_options = options;
+
+    // Пул потоков живёт всё время работы сервиса: каждый поток держит своё подключение к БД
+    m_pool.setMaxThreadCount(options.workerThreads > 0 ? options.workerThreads
+                                                       : QThread::idealThreadCount());
+    m_pool.setExpiryTimeout(-1);
+
+    // Тёплый старт из последнего снимка, сверка с БД - в фоне
+    QString snapshotPath = BaggageSnapshot::lastSnapshotPath();
+    BaggageSnapshot snapshot;
+    if (QFileInfo::exists(snapshotPath) && snapshot.open(snapshotPath)) {
+        setCache(snapshot.readAll());
+        m_pool.start([this]() { reloadCache(); });
+    } else if (!reloadCache()) {
+        m_errorString = "Не удалось загрузить записи из БД: " + DatabaseManager::instance().getLastError();
+        return false;
+    }
+
+    if (!options.socketName.isEmpty()) {
+        m_localServer = new QLocalServer(this);
+        m_localServer->setSocketOptions(QLocalServer::UserAccessOption);
+        QLocalServer::removeServer(options.socketName);   // сокет от прошлого запуска
+        if (!m_localServer->listen(options.socketName)) {
+            m_errorString = "Не удалось открыть локальный сокет " + options.socketName + ": "
+                            + m_localServer->errorString();
+            return false;
+        }
+        connect(m_localServer, &QLocalServer::newConnection,
+                this, &BaggageService::onNewLocalConnection);
+        qDebug() << "Сервис слушает локальный сокет" << m_localServer->fullServerName();
+    }
+
+    if (options.tcpPort != 0) {
+        // Изменения и удаление без проверки доступа - только с этой машины
+        if (!QHostAddress(options.listenAddress).isLoopback() && options.authToken.isEmpty()) {
+            m_errorString = QString("Адрес %1 доступен по сети: задайте BAGGAGE_SERVICE_TOKEN "
+                                    "или слушайте 127.0.0.1").arg(options.listenAddress);
+            return false;
+        }
+        m_tcpServer = new QTcpServer(this);
+        if (!m_tcpServer->listen(QHostAddress(options.listenAddress), options.tcpPort)) {
+            m_errorString = QString("Не удалось открыть порт %1:%2: %3")
+                                .arg(options.listenAddress)
+                                .arg(options.tcpPort)
+                                .arg(m_tcpServer->errorString());
+            return false;
+        }
+        connect(m_tcpServer, &QTcpServer::newConnection,
+                this, &BaggageService::onNewTcpConnection);
+        qDebug() << "Сервис слушает TCP" << options.listenAddress << options.tcpPort;
+    }
+
+    if (!m_localServer && !m_tcpServer) {
+        m_errorString = "Не задан ни локальный сокет, ни TCP-порт";
+        return false;
+    }
+
+    // Групповой коммит: группа пишется под m_writeMutex и сразу попадает в кеш
+    if (options.writeBehind) {
+        WriteBehindOptions writeOptions;
+        writeOptions.maxDelayMs = options.groupDelayMs;
+        writeOptions.commitLock = &m_writeMutex;
+        writeOptions.onCommitted = [this](const QVector<BaggageRecord>& records) {
+            for (const BaggageRecord& record : records) {
+                cacheInsert(record);
+            }
+        };
+        m_writeBehind.reset(new WriteBehindQueue(writeOptions));
+        m_writeBehind->start();
+    }
+
+    if (!options.scanSocketName.isEmpty()) {
+        QSqlDatabase db = DatabaseManager::instance().connection();
+        if (!ScanEventIngestor::createTable(db, &m_errorString)) {
+            return false;
+        }
+        m_scanServer = new QLocalServer(this);
+        m_scanServer->setSocketOptions(QLocalServer::UserAccessOption);
+        QLocalServer::removeServer(options.scanSocketName);
+        if (!m_scanServer->listen(options.scanSocketName)) {
+            m_errorString = "Не удалось открыть сокет событий " + options.scanSocketName + ": "
+                            + m_scanServer->errorString();
+            return false;
+        }
+        connect(m_scanServer, &QLocalServer::newConnection,
+                this, &BaggageService::onNewScanConnection);
+        m_scans.reset(new ScanEventIngestor());
+        m_scans->start();
+        qDebug() << "Приём событий сканирования:" << m_scanServer->fullServerName();
+    }
+
+    if (options.cacheRefreshSeconds > 0) {
+        m_refreshTimer.start(options.cacheRefreshSeconds * 1000);
+    }
+
+    qDebug() << "Сервис запущен. Потоков:" << m_pool.maxThreadCount()
+             << "Записей в кеше:" << cachedRecordCount()
+             << (m_writeBehind ? "(групповой коммит)" : "");
+    return true;
+}
+
+void BaggageService::stop() {
+    m_refreshTimer.stop();
+    m_scanResumeTimer.stop();
+    m_pausedScans.clear();
+    if (m_localServer) {
+        m_localServer->close();
+    }
+    if (m_tcpServer) {
+        m_tcpServer->close();
+    }
+    if (m_scanServer) {
+        m_scanServer->close();
+    }
+    if (m_scans) {
+        m_scans->stop();
+    }
+    m_pool.waitForDone();
+    if (m_writeBehind) {
+        m_writeBehind->stop();
+    }
+
+    // Закрываем подключения потоков пула: задачи занимают все потоки сразу,
+    // поэтому каждая выполняется в своём потоке
+    int threads = m_pool.maxThreadCount();
+    QSemaphore started;
+    QSemaphore finish;
+    for (int i = 0; i < threads; ++i) {
+        m_pool.start([&started, &finish]() {
+            DatabaseManager::instance().releaseThreadConnection();
+            started.release();
+            finish.acquire();
+        });
+    }
+    started.acquire(threads);
+    finish.release(threads);
+    m_pool.waitForDone();
+}
+
+int BaggageService::cachedRecordCount() const {
+    QReadLocker locker(&m_cacheLock);
+    return m_cachedCount;
+}
+
+void BaggageService::onNewLocalConnection() {
+    while (QLocalSocket* socket = m_localServer->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        attachClient(socket);
+    }
+}
+
+void BaggageService::onNewTcpConnection() {
+    while (QTcpSocket* socket = m_tcpServer->nextPendingConnection()) {
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        attachClient(socket);
+    }
+}
+
+void BaggageService::onNewScanConnection() {
+    while (QLocalSocket* socket = m_scanServer->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        socket->setReadBufferSize(SCAN_READ_BUFFER);
+        connect(socket, &QIODevice::readyRead, this, [this, socket]() { readScans(socket); });
+    }
+}
+
+void BaggageService::attachClient(QIODevice* socket) {
+    connect(socket, &QIODevice::readyRead, this, [this, socket]() { readRequests(socket); });
+}
+
+// Чтение строк запросов в основном потоке, выполнение - в пуле
+void BaggageService::readRequests(QIODevice* socket) {
+    const bool trusted = qobject_cast<QTcpSocket*>(socket) == nullptr;
+    while (socket->canReadLine()) {
+        QByteArray line = socket->readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+
+        QPointer<QIODevice> client(socket);
+        m_pool.start([this, client, line, trusted]() {
+            dispatchLine(line, trusted, [this, client](const QJsonObject& reply) {
+                QByteArray data = QJsonDocument(reply).toJson(QJsonDocument::Compact) + '\n';
+                // Писать в сокет можно только из его потока
+                QMetaObject::invokeMethod(this, [client, data]() {
+                    if (client) {
+                        client->write(data);
+                    }
+                }, Qt::QueuedConnection);
+            });
+        });
+    }
+
+    if (socket->bytesAvailable() > m_options.maxRequestSize) {
+        qWarning() << "Слишком длинный запрос, соединение закрыто";
+        socket->write("{\"ok\":false,\"error\":\"Слишком длинный запрос\"}\n");
+        socket->close();
+    }
+}
+
+// Ответов нет: неразобранные строки учитываются в статистике приёма
+void BaggageService::readScans(QIODevice* socket) {
+    if (!m_scans) {
+        return;
+    }
+    while (socket->canReadLine()) {
+        // Поток записи отстаёт (например, БД недоступна): строки остаются
+        // в сокете, цикл событий продолжает обслуживать запросы
+        if (!m_scans->hasRoom()) {
+            pauseScans(socket);
+            return;
+        }
+        const QByteArray line = socket->readLine().trimmed();
+        if (!line.isEmpty()) {
+            m_scans->submitLine(line);
+        }
+    }
+
+    // Буфер чтения заполнен строкой без перевода строки - дальше читать нечего
+    if (socket->bytesAvailable() >= SCAN_READ_BUFFER) {
+        qWarning() << "Слишком длинная строка события сканирования, соединение закрыто";
+        socket->close();
+    }
+}
+
+void BaggageService::pauseScans(QIODevice* socket) {
+    if (!m_pausedScans.contains(socket)) {
+        m_pausedScans.append(socket);
+    }
+    if (!m_scanResumeTimer.isActive()) {
+        m_scanResumeTimer.start();
+    }
+}
+
+// Новых readyRead для уже прочитанных в сокет данных не будет - дочитываем сами
+void BaggageService::onScanResume() {
+    const QVector<QPointer<QIODevice>> paused = m_pausedScans;
+    m_pausedScans.clear();
+    for (const QPointer<QIODevice>& socket : paused) {
+        if (socket) {
+            readScans(socket);
+        }
+    }
+
+    if (socket->bytesAvailable() > m_options.maxRequestSize) {
+        qWarning() << "Слишком длинная строка события, соединение закрыто";
+        socket->close();
+    }
+}
+
+// reply вызывается ровно один раз: сразу или из потока записи после коммита
+void BaggageService::dispatchLine(const QByteArray& line, bool trusted,
+                                  const std::function<void(const QJsonObject&)>& reply) {
+    ++m_requestsServed;
+
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(line, &parseError);
+    if (parseError.error != QJsonParseError::NoError || !document.isObject()) {
+        QJsonObject error;
+        error["ok"] = false;
+        error["error"] = "Некорректный JSON: " + parseError.errorString();
+        reply(error);
+        return;
+    }
+
+    const QJsonObject request = document.object();
+    if (!trusted && !m_options.authToken.isEmpty()
+        && request.value("token").toString() != m_options.authToken) {
+        QJsonObject error;
+        error["ok"] = false;
+        error["error"] = "Неверный или отсутствующий token";
+        if (request.contains("id")) {
+            error["id"] = request.value("id");
+        }
+        reply(error);
+        return;
+    }
+    if (m_writeBehind && request.value("op").toString() == "add") {
+        opAddWriteBehind(request, reply);
+        return;
+    }
+    reply(handleRequest(request));
+}
+
+QJsonObject BaggageService::handleRequest(const QJsonObject& request) {
+    QString op = request.value("op").toString();
+    QJsonObject reply;
+
+    if (op == "ping") {
+        QJsonObject result;
+        result["records"] = cachedRecordCount();
+        result["requests"] = static_cast<double>(m_requestsServed.load());
+        if (m_scans) {
+            const ScanIngestStats scanStats = m_scans->stats();
+            QJsonObject scans;
+            scans["accepted"] = static_cast<double>(scanStats.accepted);
+            scans["rejected"] = static_cast<double>(scanStats.rejected);
+            scans["stalls"] = static_cast<double>(scanStats.stalls);
+            scans["written"] = static_cast<double>(scanStats.written);
+            scans["failed"] = static_cast<double>(scanStats.failed);
+            scans["retries"] = static_cast<double>(scanStats.retries);
+            scans["tracked_tags"] = m_scans->trackedTags();
+            result["scans"] = scans;
+        }
+        reply["ok"] = true;
+        reply["result"] = result;
+    } else if (op == "add") {
+        reply = opAdd(request);
+    } else if (op == "find") {
+        reply = opFind(request);
+    } else if (op == "delete") {
+        reply = opDelete(request);
+    } else if (op == "change_items") {
+        reply = opChangeItems(request);
+    } else if (op == "filter") {
+        reply = opFilter();
+    } else if (op == "report") {
+        reply = opReport(request);
+    } else if (op == "last_scan") {
+        reply = opLastScan(request);
+    } else if (op == "refresh") {
+        bool ok = reloadCache();
+        reply["ok"] = ok;
+        if (!ok) {
+            reply["error"] = DatabaseManager::instance().getLastError();
+        }
+    } else {
+        reply["ok"] = false;
+        reply["error"] = "Неизвестная операция: " + op;
+    }
+
+    if (request.contains("id")) {
+        reply["id"] = request.value("id");
+    }
+    return reply;
+}
+
+// ==================== Операции ====================
+
+bool BaggageService::recordFromRequest(const QJsonObject& request, BaggageRecord& record,
+                                       QString& error) {
+    QVector<double> weights;
+    if (!weightsFromJson(request.value("weights"), weights)) {
+        error = "Поле weights должно быть массивом чисел";
+        return false;
+    }
+
+    record = BaggageRecord(request.value("flight_number").toString().trimmed(),
+                           request.value("passenger_name").toString().trimmed(),
+                           weights);
+    BaggageRecord::ValidationError validation = record.validate();
+    if (validation != BaggageRecord::NoError) {
+        error = BaggageRecord::validationErrorText(validation);
+        return false;
+    }
+    return true;
+}
+
+QJsonObject BaggageService::opAdd(const QJsonObject& request) {
+    QJsonObject reply;
+    BaggageRecord record;
+    QString error;
+    if (!recordFromRequest(request, record, error)) {
+        reply["ok"] = false;
+        reply["error"] = error;
+        return reply;
+    }
+
+    QMutexLocker writeLocker(&m_writeMutex);
+    if (!DatabaseManager::instance().addRecord(record)) {
+        reply["ok"] = false;
+        reply["error"] = DatabaseManager::instance().getLastError();
+        return reply;
+    }
+    cacheInsert(record);
+
+    reply["ok"] = true;
+    reply["result"] = recordToJson(record);
+    return reply;
+}
+
+// Добавление через групповой коммит: поток пула освобождается сразу
+void BaggageService::opAddWriteBehind(const QJsonObject& request,
+                                      const std::function<void(const QJsonObject&)>& reply) {
+    QJsonObject response;
+    if (request.contains("id")) {
+        response["id"] = request.value("id");
+    }
+
+    BaggageRecord record;
+    QString error;
+    if (!recordFromRequest(request, record, error)) {
+        response["ok"] = false;
+        response["error"] = error;
+        reply(response);
+        return;
+    }
+
+    m_writeBehind->enqueue(record, [response, record, reply](const WriteResult& result) mutable {
+        response["ok"] = result.ok;
+        if (result.ok) {
+            response["result"] = recordToJson(record);
+        } else {
+            response["error"] = result.error;
+        }
+        reply(response);
+    });
+}
+
+// Открытые рейсы - из кеша; нет в кеше - поиск в БД, включая архив закрытых рейсов
+QJsonObject BaggageService::opFind(const QJsonObject& request) {
+    QJsonObject reply;
+    QVector<BaggageRecord> records;
+    DatabaseManager& db = DatabaseManager::instance();
+
+    if (request.contains("flight_number")) {
+        QString flightNumber = request.value("flight_number").toString().trimmed();
+        {
+            QReadLocker locker(&m_cacheLock);
+            records = m_byFlight.value(flightNumber);
+        }
+        if (records.isEmpty()) {
+            records = db.findRecordsByFlightNumber(flightNumber);
+        }
+    } else if (request.contains("passenger_name")) {
+        QString passengerName = request.value("passenger_name").toString().trimmed();
+        {
+            QReadLocker locker(&m_cacheLock);
+            const QList<QString> flights = m_flightsByName.values(passengerName);
+            for (const QString& flightNumber : flights) {
+                for (const BaggageRecord& record : m_byFlight.value(flightNumber)) {
+                    if (record.getPassengerName() == passengerName) {
+                        records.append(record);
+                    }
+                }
+            }
+        }
+        if (records.isEmpty()) {
+            records = db.findRecordsByPassengerName(passengerName);
+        }
+    } else {
+        reply["ok"] = false;
+        reply["error"] = "Укажите flight_number или passenger_name";
+        return reply;
+    }
+
+    if (records.isEmpty() && !db.getLastError().isEmpty()) {
+        reply["ok"] = false;
+        reply["error"] = db.getLastError();
+        return reply;
+    }
+
+    reply["ok"] = true;
+    reply["result"] = recordsToJson(records);
+    return reply;
+}
+
+QJsonObject BaggageService::opDelete(const QJsonObject& request) {
+    QJsonObject reply;
+    QStringList flightNumbers;
+    for (const QJsonValue& value : request.value("flight_numbers").toArray()) {
+        QString flightNumber = value.toString().trimmed();
+        if (!flightNumber.isEmpty()) {
+            flightNumbers.append(flightNumber);
+        }
+    }
+    if (flightNumbers.isEmpty()) {
+        reply["ok"] = false;
+        reply["error"] = "Список flight_numbers пуст";
+        return reply;
+    }
+
+    QMutexLocker writeLocker(&m_writeMutex);
+    QVector<int> outcomes;
+    int deleted = DatabaseManager::instance().deleteFlightsBatch(flightNumbers, &outcomes);
+    // Рейсы удаляются одной транзакцией: -1 у рейса - не удалено ничего
+    if (outcomes.contains(-1)) {
+        reply["ok"] = false;
+        reply["error"] = DatabaseManager::instance().getLastError();
+        return reply;
+    }
+    if (deleted > 0) {
+        for (const QString& flightNumber : flightNumbers) {
+            cacheRemoveFlight(flightNumber);
+        }
+    }
+
+    QJsonObject result;
+    result["deleted"] = deleted;
+    reply["ok"] = true;
+    reply["result"] = result;
+    return reply;
+}
+
+QJsonObject BaggageService::opChangeItems(const QJsonObject& request) {
+    QJsonObject reply;
+    QString passengerName = request.value("passenger_name").toString().trimmed();
+    QVector<double> weights;
+    if (!weightsFromJson(request.value("weights"), weights)) {
+        reply["ok"] = false;
+        reply["error"] = "Поле weights должно быть массивом чисел";
+        return reply;
+    }
+
+    QMutexLocker writeLocker(&m_writeMutex);
+    if (!DatabaseManager::instance().changeItemCountByName(passengerName, weights)) {
+        reply["ok"] = false;
+        reply["error"] = DatabaseManager::instance().getLastError();
+        return reply;
+    }
+
+    // Какая из записей с этим ФИО изменена, решает БД - перечитываем их.
+    // В кеше только открытые рейсы, поэтому архив не читается
+    QVector<BaggageRecord> records = DatabaseManager::instance().findOpenRecordsByPassengerName(passengerName);
+    cacheRemovePassenger(passengerName);
+    for (const BaggageRecord& record : records) {
+        cacheInsert(record);
+    }
+
+    reply["ok"] = true;
+    reply["result"] = recordsToJson(records);
+    return reply;
+}
+
+// Функция 3 по кешу: пассажиры с 1 вещью весом 20-30 кг
+QJsonObject BaggageService::opFilter() {
+    QVector<BaggageRecord> result;
+    {
+        QReadLocker locker(&m_cacheLock);
+        for (auto it = m_byFlight.cbegin(); it != m_byFlight.cend(); ++it) {
+            for (const BaggageRecord& record : it.value()) {
+                if (record.getItemCount() == 1) {
+                    double weight = record.getItemWeights()[0];
+                    if (weight >= 20.0 && weight <= 30.0) {
+                        result.append(record);
+                    }
+                }
+            }
+        }
+    }
+
+    QJsonObject reply;
+    reply["ok"] = true;
+    reply["result"] = recordsToJson(result);
+    return reply;
+}
+
+QJsonObject BaggageService::opReport(const QJsonObject& request) {
+    QJsonObject reply;
+    QDateTime from = QDateTime::fromString(request.value("from").toString(), Qt::ISODate);
+    QDateTime to = QDateTime::fromString(request.value("to").toString(), Qt::ISODate);
+    if (!from.isValid() || !to.isValid() || from > to) {
+        reply["ok"] = false;
+        reply["error"] = "Укажите корректный период from/to (ISO 8601)";
+        return reply;
+    }
+
+    DatabaseManager& db = DatabaseManager::instance();
+    QVector<FlightStats> stats = db.getFlightStatsByDateRange(from, to);
+    if (stats.isEmpty() && !db.getLastError().isEmpty()) {
+        reply["ok"] = false;
+        reply["error"] = db.getLastError();
+        return reply;
+    }
+
+    QJsonArray flights;
+    int totalPassengers = 0;
+    double totalWeight = 0.0;
+    for (const FlightStats& flight : stats) {
+        QJsonObject item;
+        item["flight_number"] = flight.flightNumber;
+        item["passengers"] = flight.passengerCount;
+        item["items"] = flight.itemCount;
+        item["total_weight"] = flight.totalWeight;
+        flights.append(item);
+        totalPassengers += flight.passengerCount;
+        totalWeight += flight.totalWeight;
+    }
+
+    QJsonObject result;
+    result["flights"] = flights;
+    result["total_passengers"] = totalPassengers;
+    result["total_weight"] = totalWeight;
+    reply["ok"] = true;
+    reply["result"] = result;
+    return reply;
+}
+
+QJsonObject BaggageService::opLastScan(const QJsonObject& request) {
+    QJsonObject reply;
+    if (!m_scans) {
+        reply["ok"] = false;
+        reply["error"] = "Приём событий сканирования не включён";
+        return reply;
+    }
+    const qint64 tag = static_cast<qint64>(request.value("tag").toDouble());
+    ScanEvent event;
+    if (tag <= 0 || !m_scans->lastScan(tag, &event)) {
+        reply["ok"] = false;
+        reply["error"] = QString("Нет сканирований бирки %1").arg(tag);
+        return reply;
+    }
+
+    QJsonObject result;
+    result["tag"] = static_cast<double>(event.tag);
+    result["location"] = event.location;
+    result["scanned_at"] = QDateTime::fromMSecsSinceEpoch(event.scannedAtMs, Qt::UTC)
+                               .toString(Qt::ISODateWithMs);
+    reply["ok"] = true;
+    reply["result"] = result;
+    return reply;
+}
+
+// ==================== Кеш ====================
+
+void BaggageService::onRefreshTimer() {
+    m_pool.start([this]() { reloadCache(); });
+}
+
+// Полная сверка с БД (в том числе с изменениями, сделанными мимо сервиса)
+bool BaggageService::reloadCache() {
+    QVector<BaggageRecord> records;
+    {
+        QMutexLocker writeLocker(&m_writeMutex);
+        if (!DatabaseManager::instance().isConnected()) {
+            return false;
+        }
+        records = DatabaseManager::instance().getAllRecords();
+        setCache(records);
+    }
+
+    QString error;
+    if (!BaggageSnapshot::write(BaggageSnapshot::lastSnapshotPath(), records, &error)) {
+        qWarning() << error;
+    }
+    return true;
+}
+
+void BaggageService::setCache(const QVector<BaggageRecord>& records) {
+    QHash<QString, QVector<BaggageRecord>> byFlight;
+    QMultiHash<QString, QString> flightsByName;
+    for (const BaggageRecord& record : records) {
+        QVector<BaggageRecord>& flight = byFlight[record.getFlightNumber()];
+        flight.append(record);
+        if (!flightsByName.contains(record.getPassengerName(), record.getFlightNumber())) {
+            flightsByName.insert(record.getPassengerName(), record.getFlightNumber());
+        }
+    }
+
+    QWriteLocker locker(&m_cacheLock);
+    m_byFlight.swap(byFlight);
+    m_flightsByName.swap(flightsByName);
+    m_cachedCount = records.size();
+}
+
+void BaggageService::cacheInsert(const BaggageRecord& record) {
+    QWriteLocker locker(&m_cacheLock);
+    m_byFlight[record.getFlightNumber()].append(record);
+    if (!m_flightsByName.contains(record.getPassengerName(), record.getFlightNumber())) {
+        m_flightsByName.insert(record.getPassengerName(), record.getFlightNumber());
+    }
+    ++m_cachedCount;
+}
+
+void BaggageService::cacheRemovePassenger(const QString& passengerName) {
+    QWriteLocker locker(&m_cacheLock);
+    const QList<QString> flights = m_flightsByName.values(passengerName);
+    for (const QString& flightNumber : flights) {
+        auto it = m_byFlight.find(flightNumber);
+        if (it == m_byFlight.end()) {
+            continue;
+        }
+        QVector<BaggageRecord>& records = it.value();
+        for (int i = records.size() - 1; i >= 0; --i) {
+            if (records[i].getPassengerName() == passengerName) {
+                records.remove(i);
+                --m_cachedCount;
+            }
+        }
+        if (records.isEmpty()) {
+            m_byFlight.erase(it);
+        }
+    }
+    m_flightsByName.remove(passengerName);
+}
+
+void BaggageService::cacheRemoveFlight(const QString& flightNumber) {
+    QWriteLocker locker(&m_cacheLock);
+    auto it = m_byFlight.find(flightNumber);
+    if (it == m_byFlight.end()) {
+        return;
+    }
+    for (const BaggageRecord& record : it.value()) {
+        m_flightsByName.remove(record.getPassengerName(), flightNumber);
+    }
+    m_cachedCount -= it.value().size();
+    m_byFlight.erase(it);
+}
+
+// ==================== JSON ====================
+
+QJsonObject BaggageService::recordToJson(const BaggageRecord& record) {
+    QJsonArray weights;
+    for (double weight : record.getItemWeights()) {
+        weights.append(weight);
+    }
+
+    QJsonObject object;
+    object["flight_number"] = record.getFlightNumber();
+    object["passenger_name"] = record.getPassengerName();
+    object["weights"] = weights;
+    object["total_weight"] = record.getTotalWeight();
+    return object;
+}
+
+QJsonArray BaggageService::recordsToJson(const QVector<BaggageRecord>& records) {
+    QJsonArray array;
+    for (const BaggageRecord& record : records) {
+        array.append(recordToJson(record));
+    }
+    return array;
+}
+
+bool BaggageService::weightsFromJson(const QJsonValue& value, QVector<double>& weights) {
+    if (!value.isArray()) {
+        return false;
+    }
+    const QJsonArray array = value.toArray();
+    weights.clear();
+    weights.reserve(array.size());
+    for (const QJsonValue& item : array) {
+        if (!item.isDouble()) {
+            return false;
+        }
+        weights.append(item.toDouble());
+    }
+    return true;
+}
@@ -0,0 +1,323 @@
+#include "BaggageSnapshot.h"
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QStandardPaths>
+#include <QDir>
+#include <QHash>
+#include <QtEndian>
+#include <QDebug>
+
+namespace {
+
+const char SNAPSHOT_MAGIC[4] = {'B', 'G', 'S', 'N'};
+
+constexpr int HEADER_SIZE = 64;
+constexpr int RECORD_HEADER_SIZE = 24;
+constexpr int INDEX_ENTRY_SIZE = 4;
+
+// Смещения полей заголовка файла
+constexpr int H_VERSION = 4;
+constexpr int H_HEADER_SIZE = 6;
+constexpr int H_RECORD_COUNT = 8;
+constexpr int H_RECORD_HEADER_SIZE = 12;
+constexpr int H_INDEX_OFFSET = 16;
+constexpr int H_RECORDS_OFFSET = 24;
+constexpr int H_STRINGS_OFFSET = 32;
+constexpr int H_STRINGS_SIZE = 40;
+constexpr int H_CREATED_AT = 48;
+constexpr int H_DATA_VERSION = 56;     // с версии 2
+
+// Смещения полей заголовка записи
+constexpr int R_FLIGHT_OFFSET = 0;
+constexpr int R_NAME_OFFSET = 4;
+constexpr int R_FLIGHT_LENGTH = 8;
+constexpr int R_NAME_LENGTH = 10;
+constexpr int R_WEIGHTS = 12;
+constexpr int R_ITEM_COUNT = 22;
+
+template <typename T>
+void putLE(QByteArray& buffer, int offset, T value) {
+    qToLittleEndian<T>(value, buffer.data() + offset);
+}
+
+template <typename T>
+T getLE(const uchar* data, quint64 offset) {
+    return qFromLittleEndian<T>(data + offset);
+}
+
+} // namespace
+
+BaggageSnapshot::BaggageSnapshot()
+    : m_data(nullptr), m_size(0), m_isOpen(false), m_isLegacy(false),
+      m_recordCount(0), m_indexOffset(0), m_recordsOffset(0),
+      m_stringTableOffset(0), m_stringTableSize(0), m_createdAtMsecs(0), m_dataVersion(-1) {
+}
+
+BaggageSnapshot::~BaggageSnapshot() {
+    close();
+}
+
+bool BaggageSnapshot::write(const QString& filename, const QVector<BaggageRecord>& records,
+                            QString* errorString, qint64 dataVersion) {
+    const quint32 count = static_cast<quint32>(records.size());
+
+    // Таблица строк: одинаковые строки (номера рейсов) хранятся один раз
+    QByteArray strings;
+    QHash<QByteArray, quint32> interned;
+    auto intern = [&strings, &interned](const QString& value, quint16& length) -> quint32 {
+        QByteArray utf8 = value.toUtf8();
+        if (utf8.size() > 0xFFFF) {
+            utf8.truncate(0xFFFF);
+        }
+        length = static_cast<quint16>(utf8.size());
+
+        auto it = interned.constFind(utf8);
+        if (it != interned.constEnd()) {
+            return it.value();
+        }
+        quint32 offset = static_cast<quint32>(strings.size());
+        strings.append(utf8);
+        interned.insert(utf8, offset);
+        return offset;
+    };
+
+    const quint64 indexOffset = HEADER_SIZE;
+    const quint64 recordsOffset = indexOffset + quint64(count) * INDEX_ENTRY_SIZE;
+    const quint64 stringsOffset = recordsOffset + quint64(count) * RECORD_HEADER_SIZE;
+
+    QByteArray body(static_cast<int>(stringsOffset), '\0');
+
+    for (quint32 i = 0; i < count; ++i) {
+        const BaggageRecord& record = records[i];
+        const quint32 relOffset = i * RECORD_HEADER_SIZE;
+        putLE<quint32>(body, static_cast<int>(indexOffset + i * INDEX_ENTRY_SIZE), relOffset);
+
+        const int base = static_cast<int>(recordsOffset + relOffset);
+        quint16 flightLength = 0;
+        quint16 nameLength = 0;
+        quint32 flightOffset = intern(record.getFlightNumber(), flightLength);
+        quint32 nameOffset = intern(record.getPassengerName(), nameLength);
+
+        putLE<quint32>(body, base + R_FLIGHT_OFFSET, flightOffset);
+        putLE<quint32>(body, base + R_NAME_OFFSET, nameOffset);
+        putLE<quint16>(body, base + R_FLIGHT_LENGTH, flightLength);
+        putLE<quint16>(body, base + R_NAME_LENGTH, nameLength);
+
+        // Веса хранятся в сотых долях кг (NUMERIC(5,2) в БД)
+        const QVector<double> weights = record.getItemWeights();
+        const int itemCount = qMin(weights.size(), BaggageRecord::MAX_ITEMS);
+        for (int w = 0; w < itemCount; ++w) {
+            putLE<quint16>(body, base + R_WEIGHTS + w * 2,
+                           static_cast<quint16>(qRound(weights[w] * 100.0)));
+        }
+        body[base + R_ITEM_COUNT] = static_cast<char>(itemCount);
+    }
+
+    // Заголовок
+    memcpy(body.data(), SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    putLE<quint16>(body, H_VERSION, FORMAT_VERSION);
+    putLE<quint16>(body, H_HEADER_SIZE, HEADER_SIZE);
+    putLE<quint32>(body, H_RECORD_COUNT, count);
+    putLE<quint32>(body, H_RECORD_HEADER_SIZE, RECORD_HEADER_SIZE);
+    putLE<quint64>(body, H_INDEX_OFFSET, indexOffset);
+    putLE<quint64>(body, H_RECORDS_OFFSET, recordsOffset);
+    putLE<quint64>(body, H_STRINGS_OFFSET, stringsOffset);
+    putLE<quint64>(body, H_STRINGS_SIZE, static_cast<quint64>(strings.size()));
+    putLE<qint64>(body, H_CREATED_AT, QDateTime::currentMSecsSinceEpoch());
+    putLE<qint64>(body, H_DATA_VERSION, dataVersion);
+
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorString) {
+            *errorString = "Не удалось создать файл снимка: " + file.errorString();
+        }
+        return false;
+    }
+
+    if (file.write(body) != body.size() || file.write(strings) != strings.size()) {
+        if (errorString) {
+            *errorString = "Ошибка записи файла снимка: " + file.errorString();
+        }
+        file.cancelWriting();
+        return false;
+    }
+
+    if (!file.commit()) {
+        if (errorString) {
+            *errorString = "Ошибка сохранения файла снимка: " + file.errorString();
+        }
+        return false;
+    }
+
+    qDebug() << "Снимок сохранён:" << filename << "записей:" << count;
+    return true;
+}
+
+bool BaggageSnapshot::open(const QString& filename) {
+    close();
+    m_errorString.clear();
+
+    m_file.setFileName(filename);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_errorString = "Не удалось открыть файл снимка: " + m_file.errorString();
+        return false;
+    }
+
+    QByteArray magic = m_file.peek(sizeof(SNAPSHOT_MAGIC));
+    bool ok = (magic == QByteArray(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)))
+                  ? openMapped()
+                  : openLegacy();
+
+    if (!ok) {
+        close();
+        return false;
+    }
+
+    m_isOpen = true;
+    return true;
+}
+
+bool BaggageSnapshot::openMapped() {
+    m_size = m_file.size();
+    if (m_size < HEADER_SIZE) {
+        m_errorString = "Файл снимка повреждён: слишком короткий заголовок";
+        return false;
+    }
+
+    m_data = m_file.map(0, m_size);
+    if (!m_data) {
+        m_errorString = "Не удалось отобразить файл снимка в память: " + m_file.errorString();
+        return false;
+    }
+
+    quint16 version = getLE<quint16>(m_data, H_VERSION);
+    if (version == 0 || version > FORMAT_VERSION) {
+        m_errorString = QString("Неподдерживаемая версия снимка: %1").arg(version);
+        return false;
+    }
+
+    if (getLE<quint32>(m_data, H_RECORD_HEADER_SIZE) != RECORD_HEADER_SIZE) {
+        m_errorString = "Файл снимка повреждён: неверный размер заголовка записи";
+        return false;
+    }
+
+    m_recordCount = getLE<quint32>(m_data, H_RECORD_COUNT);
+    m_indexOffset = getLE<quint64>(m_data, H_INDEX_OFFSET);
+    m_recordsOffset = getLE<quint64>(m_data, H_RECORDS_OFFSET);
+    m_stringTableOffset = getLE<quint64>(m_data, H_STRINGS_OFFSET);
+    m_stringTableSize = getLE<quint64>(m_data, H_STRINGS_SIZE);
+    m_createdAtMsecs = getLE<qint64>(m_data, H_CREATED_AT);
+    m_dataVersion = version >= 2 ? getLE<qint64>(m_data, H_DATA_VERSION) : -1;
+
+    const quint64 size = static_cast<quint64>(m_size);
+    if (m_indexOffset + quint64(m_recordCount) * INDEX_ENTRY_SIZE > m_recordsOffset ||
+        m_recordsOffset + quint64(m_recordCount) * RECORD_HEADER_SIZE > m_stringTableOffset ||
+        m_stringTableOffset + m_stringTableSize > size) {
+        m_errorString = "Файл снимка повреждён: неверные смещения секций";
+        return false;
+    }
+
+    m_isLegacy = false;
+    return true;
+}
+
+bool BaggageSnapshot::openLegacy() {
+    // Старый формат: последовательность BaggageRecord в QDataStream
+    QDataStream in(&m_file);
+    in.setVersion(QDataStream::Qt_5_15);
+
+    m_legacyRecords.clear();
+    while (!in.atEnd()) {
+        BaggageRecord record;
+        in >> record;
+        if (in.status() != QDataStream::Ok) {
+            m_errorString = "Ошибка чтения файла старого формата";
+            m_legacyRecords.clear();
+            return false;
+        }
+        m_legacyRecords.append(record);
+    }
+
+    m_recordCount = static_cast<quint32>(m_legacyRecords.size());
+    m_isLegacy = true;
+    return true;
+}
+
+void BaggageSnapshot::close() {
+    if (m_data) {
+        m_file.unmap(const_cast<uchar*>(m_data));
+        m_data = nullptr;
+    }
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+    m_legacyRecords.clear();
+    m_size = 0;
+    m_recordCount = 0;
+    m_dataVersion = -1;
+    m_isOpen = false;
+    m_isLegacy = false;
+}
+
+int BaggageSnapshot::recordCount() const {
+    return static_cast<int>(m_recordCount);
+}
+
+BaggageRecord BaggageSnapshot::recordAt(int index) const {
+    if (!m_isOpen || index < 0 || index >= recordCount()) {
+        return BaggageRecord();
+    }
+
+    if (m_isLegacy) {
+        return m_legacyRecords[index];
+    }
+
+    quint32 relOffset = getLE<quint32>(m_data, m_indexOffset + quint64(index) * INDEX_ENTRY_SIZE);
+    quint64 base = m_recordsOffset + relOffset;
+    if (base + RECORD_HEADER_SIZE > m_stringTableOffset) {
+        return BaggageRecord();
+    }
+
+    quint32 flightOffset = getLE<quint32>(m_data, base + R_FLIGHT_OFFSET);
+    quint32 nameOffset = getLE<quint32>(m_data, base + R_NAME_OFFSET);
+    quint16 flightLength = getLE<quint16>(m_data, base + R_FLIGHT_LENGTH);
+    quint16 nameLength = getLE<quint16>(m_data, base + R_NAME_LENGTH);
+    int itemCount = qMin<int>(m_data[base + R_ITEM_COUNT], BaggageRecord::MAX_ITEMS);
+
+    if (quint64(flightOffset) + flightLength > m_stringTableSize ||
+        quint64(nameOffset) + nameLength > m_stringTableSize) {
+        return BaggageRecord();
+    }
+
+    const char* strings = reinterpret_cast<const char*>(m_data + m_stringTableOffset);
+    QString flightNumber = QString::fromUtf8(strings + flightOffset, flightLength);
+    QString passengerName = QString::fromUtf8(strings + nameOffset, nameLength);
+
+    QVector<double> weights;
+    weights.reserve(itemCount);
+    for (int w = 0; w < itemCount; ++w) {
+        weights.append(getLE<quint16>(m_data, base + R_WEIGHTS + w * 2) / 100.0);
+    }
+
+    return BaggageRecord(flightNumber, passengerName, weights);
+}
+
+QVector<BaggageRecord> BaggageSnapshot::readAll() const {
+    if (m_isLegacy) {
+        return m_legacyRecords;
+    }
+
+    QVector<BaggageRecord> records;
+    records.reserve(recordCount());
+    for (int i = 0; i < recordCount(); ++i) {
+        records.append(recordAt(i));
+    }
+    return records;
+}
+
+QString BaggageSnapshot::lastSnapshotPath() {
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    QDir().mkpath(dir);
+    return dir + "/last_snapshot.dat";
+}
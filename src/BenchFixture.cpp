@@ -0,0 +1,50 @@
+#include "BenchFixture.h"
+#include "StorageEngine.h"
+
+QStringList BenchFixture::flightNumbers() {
+    QStringList flights;
+    for (int i = 0; i < FLIGHTS; ++i) {
+        flights.append(QString("ZZ%1").arg(9000 + i));
+    }
+    return flights;
+}
+
+BaggageRecord BenchFixture::record(int index) {
+    return BaggageRecord(QString("ZZ%1").arg(9000 + index % FLIGHTS),
+                         QString("Тестовый Пассажир %1").arg(index),
+                         {10.0 + index % 20, 5.5});
+}
+
+QVector<BaggageRecord> BenchFixture::archiveRecords(int count) {
+    QVector<BaggageRecord> records;
+    records.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        QVector<double> weights;
+        for (int k = 0; k <= i % BaggageRecord::MAX_ITEMS; ++k) {
+            weights.append((1 + (i * 37 + k * 13) % 10000) / 100.0);
+        }
+        records.append(BaggageRecord(QString("ZZ%1").arg(9000 + i * 7 % FLIGHTS),
+                                     QString("Пассажир %1 %2").arg(i % 3 == 0 ? "Иванов" : "Петрова").arg(i),
+                                     weights));
+    }
+    return records;
+}
+
+bool BenchFixture::flightsAreFree(StorageEngine& storage, QString* error) {
+    const QStringList flights = flightNumbers();
+    bool occupied = false;
+    const bool ok = storage.streamRecords(flights, [&occupied](const BaggageRecord&) {
+        occupied = true;
+        return false;
+    });
+    if (occupied) {
+        *error = QString("В БД уже есть записи рейсов %1-%2, замер отменён")
+                     .arg(flights.first(), flights.last());
+        return false;
+    }
+    if (!ok) {
+        *error = "Ошибка чтения тестовых рейсов: " + storage.getLastError();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,184 @@
+#include "BufferedFileWriter.h"
+#include <QDebug>
+
+#ifdef BAGGAGE_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+struct BufferedFileWriter::GzipState {
+#ifdef BAGGAGE_HAVE_ZLIB
+    z_stream stream;
+    QByteArray output;
+#endif
+};
+
+BufferedFileWriter::BufferedFileWriter(int bufferSize)
+    : m_bufferSize(qMax(4096, bufferSize)), m_hasError(false), m_bytesWritten(0) {
+}
+
+BufferedFileWriter::~BufferedFileWriter() {
+    if (m_file.isOpen()) {
+        close();
+    }
+}
+
+bool BufferedFileWriter::isGzipSupported() {
+#ifdef BAGGAGE_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool BufferedFileWriter::open(const QString& filename, bool gzip) {
+    m_hasError = false;
+    m_errorString.clear();
+    m_bytesWritten = 0;
+    m_buffer.clear();
+    m_buffer.reserve(m_bufferSize);
+
+    if (gzip && !isGzipSupported()) {
+        setError("Сжатие gzip недоступно в этой сборке");
+        return false;
+    }
+
+    m_file.setFileName(filename);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        setError("Не удалось создать файл: " + m_file.errorString());
+        return false;
+    }
+
+#ifdef BAGGAGE_HAVE_ZLIB
+    if (gzip) {
+        m_gzip = std::make_unique<GzipState>();
+        memset(&m_gzip->stream, 0, sizeof(m_gzip->stream));
+        // windowBits 15 + 16 - формат gzip вместо zlib
+        if (deflateInit2(&m_gzip->stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                         15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            m_gzip.reset();
+            m_file.close();
+            setError("Ошибка инициализации сжатия gzip");
+            return false;
+        }
+        m_gzip->output.resize(m_bufferSize);
+    }
+#endif
+
+    return true;
+}
+
+void BufferedFileWriter::write(const char* data, int size) {
+    if (m_hasError) {
+        return;
+    }
+
+    m_buffer.append(data, size);
+    if (m_buffer.size() >= m_bufferSize) {
+        flushBuffer(false);
+    }
+}
+
+void BufferedFileWriter::write(char c) {
+    if (m_hasError) {
+        return;
+    }
+
+    m_buffer.append(c);
+    if (m_buffer.size() >= m_bufferSize) {
+        flushBuffer(false);
+    }
+}
+
+bool BufferedFileWriter::flushBuffer(bool finish) {
+#ifdef BAGGAGE_HAVE_ZLIB
+    if (m_gzip) {
+        z_stream& stream = m_gzip->stream;
+        stream.next_in = reinterpret_cast<Bytef*>(m_buffer.data());
+        stream.avail_in = static_cast<uInt>(m_buffer.size());
+
+        int result = Z_OK;
+        do {
+            stream.next_out = reinterpret_cast<Bytef*>(m_gzip->output.data());
+            stream.avail_out = static_cast<uInt>(m_gzip->output.size());
+
+            result = deflate(&stream, finish ? Z_FINISH : Z_NO_FLUSH);
+            if (result == Z_STREAM_ERROR) {
+                setError("Ошибка сжатия gzip");
+                return false;
+            }
+
+            qint64 produced = m_gzip->output.size() - stream.avail_out;
+            if (produced > 0 && !writeToFile(m_gzip->output.constData(), produced)) {
+                return false;
+            }
+        } while (stream.avail_out == 0 || (finish && result != Z_STREAM_END));
+
+        m_buffer.clear();
+        return true;
+    }
+#else
+    Q_UNUSED(finish);
+#endif
+
+    bool ok = m_buffer.isEmpty() || writeToFile(m_buffer.constData(), m_buffer.size());
+    m_buffer.clear();
+    return ok;
+}
+
+bool BufferedFileWriter::writeToFile(const char* data, qint64 size) {
+    if (m_file.write(data, size) != size) {
+        setError("Ошибка записи в файл: " + m_file.errorString());
+        return false;
+    }
+    m_bytesWritten += size;
+    return true;
+}
+
+bool BufferedFileWriter::close() {
+    if (!m_file.isOpen()) {
+        return !m_hasError;
+    }
+
+    if (!m_hasError) {
+        flushBuffer(true);
+    }
+
+#ifdef BAGGAGE_HAVE_ZLIB
+    if (m_gzip) {
+        deflateEnd(&m_gzip->stream);
+        m_gzip.reset();
+    }
+#endif
+
+    m_file.close();
+    if (!m_hasError && m_file.error() != QFileDevice::NoError) {
+        setError("Ошибка при закрытии файла: " + m_file.errorString());
+    }
+
+    m_buffer.clear();
+    m_buffer.squeeze();
+    return !m_hasError;
+}
+
+void BufferedFileWriter::discard() {
+#ifdef BAGGAGE_HAVE_ZLIB
+    if (m_gzip) {
+        deflateEnd(&m_gzip->stream);
+        m_gzip.reset();
+    }
+#endif
+
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+    m_file.remove();
+    m_buffer.clear();
+}
+
+void BufferedFileWriter::setError(const QString& message) {
+    if (!m_hasError) {
+        m_hasError = true;
+        m_errorString = message;
+        qWarning() << message;
+    }
+}
@@ -0,0 +1,409 @@
+#include "BulkImporter.h"
+#include "BoundedQueue.h"
+#include "BufferedFileWriter.h"
+#include "DatabaseManager.h"
+#include <QFile>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QSqlDatabase>
+#include <QDebug>
+#include <memory>
+
+namespace {
+
+struct Chunk {
+    qint64 firstLine = 0;
+    QByteArray data;
+};
+
+struct ImportError {
+    qint64 line = 0;
+    QString reason;
+    QByteArray raw;
+};
+
+struct ParsedBatch {
+    QVector<BaggageRecord> records;
+    QVector<ImportError> errors;
+    qint64 rowsRead = 0;
+    qint64 bytes = 0;
+};
+
+// Структурная проверка вещей; остальная валидация - BaggageRecord::validateBatch()
+bool buildRecord(const QString& flightNumber, const QString& passengerName,
+                 const QVector<double>& weights, BaggageRecord& record, QString& error) {
+    if (!BaggageRecord::isValidItemCount(weights.size())) {
+        error = BaggageRecord::validationErrorText(BaggageRecord::InvalidItemCount);
+        return false;
+    }
+    for (double weight : weights) {
+        if (!BaggageRecord::isValidWeight(weight)) {
+            error = BaggageRecord::validationErrorText(BaggageRecord::InvalidWeight);
+            return false;
+        }
+    }
+
+    record = BaggageRecord(flightNumber, passengerName, weights);
+    return true;
+}
+
+char detectDelimiter(const QByteArray& line) {
+    if (line.contains(';')) {
+        return ';';
+    }
+    if (line.contains('\t')) {
+        return '\t';
+    }
+    return ',';
+}
+
+// Разбиение строки CSV с поддержкой полей в кавычках ("" внутри кавычек - кавычка)
+QList<QByteArray> splitCsv(const QByteArray& line, char delimiter) {
+    QList<QByteArray> fields;
+    QByteArray current;
+    bool inQuotes = false;
+
+    for (int i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (inQuotes) {
+            if (c == '"') {
+                if (i + 1 < line.size() && line[i + 1] == '"') {
+                    current.append('"');
+                    ++i;
+                } else {
+                    inQuotes = false;
+                }
+            } else {
+                current.append(c);
+            }
+        } else if (c == '"') {
+            inQuotes = true;
+        } else if (c == delimiter) {
+            fields.append(current);
+            current.clear();
+        } else {
+            current.append(c);
+        }
+    }
+    fields.append(current);
+    return fields;
+}
+
+} // namespace
+
+BulkImporter::BulkImporter() : m_cancelled(false) {
+}
+
+bool BulkImporter::parseCsvLine(const QByteArray& line, BaggageRecord& record, QString& error) {
+    error.clear();
+    const char delimiter = detectDelimiter(line);
+    const QList<QByteArray> fields = splitCsv(line, delimiter);
+
+    // Строка заголовка пропускается без ошибки
+    const QByteArray first = fields.first().trimmed().toLower();
+    if (first == "flight_number" || first == "flight") {
+        return false;
+    }
+
+    if (fields.size() < 3) {
+        error = "Недостаточно полей (ожидается: рейс, ФИО, веса вещей)";
+        return false;
+    }
+
+    QVector<double> weights;
+    for (int i = 2; i < fields.size(); ++i) {
+        QByteArray value = fields[i].trimmed();
+        if (value.isEmpty()) {
+            continue;
+        }
+        if (delimiter != ',') {
+            value.replace(',', '.');   // десятичная запятая
+        }
+        bool ok = false;
+        double weight = value.toDouble(&ok);
+        if (!ok) {
+            error = "Вес вещи не является числом: " + QString::fromUtf8(value);
+            return false;
+        }
+        weights.append(weight);
+    }
+
+    return buildRecord(QString::fromUtf8(fields[0].trimmed()),
+                       QString::fromUtf8(fields[1].trimmed()),
+                       weights, record, error);
+}
+
+bool BulkImporter::parseJsonLine(const QByteArray& line, BaggageRecord& record, QString& error) {
+    error.clear();
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(line, &parseError);
+    if (parseError.error != QJsonParseError::NoError || !document.isObject()) {
+        error = "Ошибка разбора JSON: " + parseError.errorString();
+        return false;
+    }
+
+    const QJsonObject object = document.object();
+    const QJsonValue flightValue = object.value("flight_number");
+    const QJsonValue nameValue = object.value("passenger_name");
+    const QJsonValue weightsValue = object.value("weights");
+
+    if (!flightValue.isString() || !nameValue.isString() || !weightsValue.isArray()) {
+        error = "Ожидаются поля flight_number, passenger_name и weights";
+        return false;
+    }
+
+    QVector<double> weights;
+    for (const QJsonValue& value : weightsValue.toArray()) {
+        if (!value.isDouble()) {
+            error = "Вес вещи не является числом";
+            return false;
+        }
+        weights.append(value.toDouble());
+    }
+
+    return buildRecord(flightValue.toString().trimmed(), nameValue.toString().trimmed(),
+                       weights, record, error);
+}
+
+bool BulkImporter::run(const QString& filename, const ImportOptions& options) {
+    m_cancelled = false;
+    m_stats = ImportStats();
+    m_errorString.clear();
+    m_errorReportPath.clear();
+
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_errorString = "Не удалось открыть файл импорта: " + file.errorString();
+        qWarning() << m_errorString;
+        return false;
+    }
+    m_stats.totalBytes = file.size();
+
+    ImportOptions::Format format = options.format;
+    if (format == ImportOptions::AutoDetect) {
+        format = (filename.endsWith(".jsonl", Qt::CaseInsensitive) ||
+                  filename.endsWith(".ndjson", Qt::CaseInsensitive))
+                     ? ImportOptions::JsonLines
+                     : ImportOptions::Csv;
+    }
+
+    const int parserCount = options.parserThreads > 0 ? options.parserThreads
+                                                      : qMax(1, QThread::idealThreadCount());
+    const int batchSize = qMax(1, options.batchSize);
+    const QString errorReportPath = options.errorReportPath.isEmpty()
+                                        ? filename + ".errors.txt"
+                                        : options.errorReportPath;
+
+    BoundedQueue<Chunk> chunkQueue(options.queueCapacity);
+    BoundedQueue<ParsedBatch> batchQueue(options.queueCapacity);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Стадия 2: параллельный разбор и валидация
+    auto parseChunk = [format](const Chunk& chunk) {
+        ParsedBatch batch;
+        batch.bytes = chunk.data.size();
+
+        QVector<BaggageRecord> candidates;
+        QVector<qint64> candidateLines;
+        QVector<QByteArray> candidateRaw;
+
+        qint64 lineNumber = chunk.firstLine;
+        int start = 0;
+        while (start < chunk.data.size()) {
+            int end = chunk.data.indexOf('\n', start);
+            if (end < 0) {
+                end = chunk.data.size();
+            }
+            QByteArray line = chunk.data.mid(start, end - start).trimmed();
+            start = end + 1;
+
+            if (!line.isEmpty()) {
+                BaggageRecord record;
+                QString error;
+                bool ok = (format == ImportOptions::JsonLines)
+                              ? parseJsonLine(line, record, error)
+                              : parseCsvLine(line, record, error);
+                if (ok) {
+                    candidates.append(record);
+                    candidateLines.append(lineNumber);
+                    candidateRaw.append(line);
+                    ++batch.rowsRead;
+                } else if (!error.isEmpty()) {
+                    batch.errors.append({lineNumber, error, line});
+                    ++batch.rowsRead;
+                }
+            }
+            ++lineNumber;
+        }
+
+        // Валидация всего блока одним вызовом
+        const QVector<BaggageRecord::ValidationError> codes = BaggageRecord::validateBatch(candidates);
+        batch.records.reserve(candidates.size());
+        for (int i = 0; i < candidates.size(); ++i) {
+            if (codes[i] == BaggageRecord::NoError) {
+                batch.records.append(candidates[i]);
+            } else {
+                batch.errors.append({candidateLines[i], BaggageRecord::validationErrorText(codes[i]),
+                                     candidateRaw[i]});
+            }
+        }
+        return batch;
+    };
+
+    QVector<QThread*> parsers;
+    for (int i = 0; i < parserCount; ++i) {
+        parsers.append(QThread::create([&chunkQueue, &batchQueue, &parseChunk]() {
+            Chunk chunk;
+            while (chunkQueue.pop(chunk)) {
+                if (!batchQueue.push(parseChunk(chunk))) {
+                    break;
+                }
+            }
+        }));
+        parsers.last()->start();
+    }
+
+    // Стадия 3: пакетная запись в БД в отдельном подключении
+    QString writerError;
+    QThread* writer = QThread::create([&]() {
+        const QString connectionName =
+            QString("baggage_import_%1").arg(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+        {
+            QSqlDatabase db = DatabaseManager::instance().openWorkerConnection(connectionName);
+            if (!db.isOpen()) {
+                writerError = "Не удалось открыть подключение к БД для импорта";
+                m_cancelled = true;
+                chunkQueue.close();
+                batchQueue.close();
+            }
+
+            std::unique_ptr<BufferedFileWriter> errorReport;
+            QVector<BaggageRecord> pending;
+
+            auto flush = [&](int count) {
+                QVector<BaggageRecord> batch = pending.mid(0, count);
+                pending.remove(0, count);
+
+                QString error;
+                if (!DatabaseManager::insertRecordsBatch(db, batch, &error)) {
+                    writerError = error;
+                    m_cancelled = true;
+                    chunkQueue.close();
+                    batchQueue.close();
+                    return false;
+                }
+                DatabaseManager::instance().noteWrite(db);
+                m_stats.rowsImported += batch.size();
+                ++m_stats.batchesWritten;
+                m_stats.elapsedMs = timer.elapsed();
+                if (options.progress) {
+                    options.progress(m_stats);
+                }
+                return true;
+            };
+
+            ParsedBatch parsed;
+            while (writerError.isEmpty() && batchQueue.pop(parsed)) {
+                if (m_cancelled) {
+                    // Разблокируем чтение и разбор, если они ждут места в очередях
+                    chunkQueue.close();
+                    batchQueue.close();
+                    break;
+                }
+
+                m_stats.rowsRead += parsed.rowsRead;
+                m_stats.bytesRead += parsed.bytes;
+                m_stats.rowsRejected += parsed.errors.size();
+
+                if (!parsed.errors.isEmpty()) {
+                    if (!errorReport) {
+                        errorReport = std::make_unique<BufferedFileWriter>();
+                        if (errorReport->open(errorReportPath)) {
+                            m_errorReportPath = errorReportPath;
+                            errorReport->write(QString("Строка\tПричина\tИсходные данные\n"));
+                        }
+                    }
+                    for (const ImportError& error : parsed.errors) {
+                        errorReport->write(QString("%1\t%2\t").arg(error.line).arg(error.reason));
+                        errorReport->write(error.raw);
+                        errorReport->write('\n');
+                    }
+                }
+
+                pending += parsed.records;
+                while (pending.size() >= batchSize && flush(batchSize)) {
+                }
+            }
+
+            if (writerError.isEmpty() && !m_cancelled && !pending.isEmpty()) {
+                flush(pending.size());
+            }
+
+            if (errorReport) {
+                errorReport->close();
+            }
+        }
+        DatabaseManager::closeWorkerConnection(connectionName);
+    });
+    writer->start();
+
+    // Стадия 1: чтение файла блоками по границам строк
+    QByteArray carry;
+    qint64 nextLine = 1;
+    while (!m_cancelled) {
+        QByteArray block = file.read(options.chunkSize);
+        if (block.isEmpty()) {
+            break;
+        }
+
+        QByteArray data = carry + block;
+        int lastNewline = data.lastIndexOf('\n');
+        if (lastNewline < 0) {
+            carry = data;
+            continue;
+        }
+        carry = data.mid(lastNewline + 1);
+        data.truncate(lastNewline + 1);
+
+        Chunk chunk;
+        chunk.firstLine = nextLine;
+        nextLine += data.count('\n');
+        chunk.data = data;
+        if (!chunkQueue.push(chunk)) {
+            break;
+        }
+    }
+    if (!m_cancelled && !carry.isEmpty()) {
+        chunkQueue.push(Chunk{nextLine, carry});
+    }
+    chunkQueue.close();
+
+    for (QThread* parser : parsers) {
+        parser->wait();
+        delete parser;
+    }
+    batchQueue.close();
+    writer->wait();
+    delete writer;
+
+    m_stats.elapsedMs = timer.elapsed();
+
+    if (!writerError.isEmpty()) {
+        m_errorString = writerError;
+        qWarning() << "Импорт прерван:" << m_errorString;
+        return false;
+    }
+
+    qDebug() << "Импорт завершён:" << filename
+             << "строк:" << m_stats.rowsRead
+             << "импортировано:" << m_stats.rowsImported
+             << "отклонено:" << m_stats.rowsRejected
+             << "за" << m_stats.elapsedMs << "мс"
+             << QString("(%1 записей/с)").arg(m_stats.rowsPerSecond(), 0, 'f', 0);
+    return !m_cancelled;
+}
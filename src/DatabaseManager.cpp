@@ -3,20 +3,479 @@
 #include <QSqlError>
 #include <QDebug>
 #include <QFile>
-#include <QTextStream>
 #include <QVariant>
+#include <QSqlDriver>
+#include <QSqlField>
+#include <QSqlRecord>
+#include <QThread>
+#include <QMutexLocker>
+#include <QDateTime>
+#include "BufferedFileWriter.h"
+
+namespace {
+
+// Версия данных - счётчик baggage_version (см. TX_VERSION_FUNCTION_SQL),
+// версия строки - row_version; по ним обнаруживаются конфликты
+const char DATA_VERSION_SQL[] = "COALESCE((SELECT version FROM baggage_version WHERE id = 1), 0)";
+
+// Запросы, выполняемые на каждой операции, - готовятся один раз на подключение
+const char ADD_BAGGAGE_SQL[] =
+    "SELECT record_id, created_at, updated_at FROM add_baggage(?, ?, ?::numeric[])";
+const char REPLACE_ITEMS_SQL[] =
+    "SELECT record_id, created_at, updated_at FROM replace_items(?, ?::numeric[])";
+// Пакетные изменения: значения - параметры-массивы (одна подготовка на любое число ключей)
+const char DELETE_FLIGHTS_SQL[] = R"(
+    WITH deleted AS (
+        DELETE FROM baggage_records WHERE flight_number = ANY(?::text[])
+        RETURNING flight_number
+    )
+    SELECT flight_number, COUNT(*) FROM deleted GROUP BY flight_number
+)";
+const char MARK_FIRST_RECORDS_SQL[] = R"(
+    UPDATE baggage_records br SET updated_at = CURRENT_TIMESTAMP
+    FROM (
+        SELECT DISTINCT ON (c.ord) r.id, c.ord
+        FROM unnest(?::text[]) WITH ORDINALITY AS c(passenger_name, ord)
+        JOIN baggage_records r ON r.passenger_name = c.passenger_name
+        ORDER BY c.ord, r.id
+    ) AS target
+    WHERE br.id = target.id
+    RETURNING br.id, target.ord
+)";
+// Вещи с прежним номером меняют вес и сохраняют бирку, лишние удаляются
+const char TRIM_ITEMS_SQL[] =
+    "DELETE FROM baggage_items bi USING unnest(?::int[], ?::int[]) AS c(record_id, item_count) "
+    "WHERE bi.baggage_record_id = c.record_id AND bi.item_number > c.item_count";
+const char UPSERT_ITEMS_SQL[] =
+    "INSERT INTO baggage_items (baggage_record_id, item_number, weight) "
+    "SELECT * FROM unnest(?::int[], ?::int[], ?::numeric[]) "
+    "ON CONFLICT (baggage_record_id, item_number) DO UPDATE SET weight = EXCLUDED.weight";
+
+// Бирка: сначала рабочие таблицы (уникальный индекс), затем архив (GIN по
+// массиву бирок). Вторая часть UNION ALL не выполняется, если нашлась первая.
+const char RESOLVE_BAG_TAG_SQL[] = R"(
+    SELECT br.flight_number, br.passenger_name, bi.item_number, bi.weight, false AS archived
+    FROM baggage_items bi
+    JOIN baggage_records br ON br.id = bi.baggage_record_id
+    WHERE bi.bag_tag = ?
+    UNION ALL
+    SELECT ba.flight_number, ba.passenger_name, t.ord::int, ba.weights[t.ord], true
+    FROM baggage_archive ba, unnest(ba.bag_tags) WITH ORDINALITY AS t(tag, ord)
+    WHERE ba.bag_tags @> ARRAY[?::bigint] AND t.tag = ?
+    LIMIT 1
+)";
+
+// Закрытие рейсов одной командой: записи удаляются из рабочей таблицы (вещи -
+// каскадом), в архив попадают с весами массивом, итоги рейса прибавляются
+// к closed_flights. Вещи читаются из снимка до удаления - каскад выполняется
+// после всей команды.
+const char CLOSE_FLIGHTS_SQL[] = R"(
+    WITH moved AS (
+        DELETE FROM baggage_records WHERE flight_number = ANY(?::text[])
+        RETURNING id, flight_number, passenger_name, created_at, updated_at
+    ), archived AS (
+        INSERT INTO baggage_archive (id, flight_number, passenger_name, created_at, updated_at,
+                                     weights, bag_tags)
+        SELECT m.id, m.flight_number, m.passenger_name, m.created_at, m.updated_at,
+               ARRAY(SELECT bi.weight FROM baggage_items bi
+                     WHERE bi.baggage_record_id = m.id ORDER BY bi.item_number),
+               ARRAY(SELECT bi.bag_tag FROM baggage_items bi
+                     WHERE bi.baggage_record_id = m.id ORDER BY bi.item_number)
+        FROM moved m
+        RETURNING flight_number, weights
+    ), totals AS (
+        SELECT a.flight_number, COUNT(*) AS passenger_count,
+               SUM(cardinality(a.weights)) AS item_count,
+               SUM((SELECT COALESCE(SUM(w), 0) FROM unnest(a.weights) AS w)) AS total_weight
+        FROM archived a
+        GROUP BY a.flight_number
+    ), closed AS (
+        INSERT INTO closed_flights (flight_number, passenger_count, item_count, total_weight)
+        SELECT flight_number, passenger_count, item_count, total_weight FROM totals
+        ON CONFLICT (flight_number) DO UPDATE SET
+            closed_at = CURRENT_TIMESTAMP,
+            passenger_count = closed_flights.passenger_count + EXCLUDED.passenger_count,
+            item_count = closed_flights.item_count + EXCLUDED.item_count,
+            total_weight = closed_flights.total_weight + EXCLUDED.total_weight
+    )
+    SELECT flight_number, passenger_count FROM totals
+)";
+
+// Записи рабочей таблицы и архива одной выборкой: (рейс, ФИО, "вес1,вес2,...",
+// id, created_at) - первые три столбца читает recordFromAggregateRow.
+// condition ссылается только на flight_number, passenger_name, created_at и
+// подставляется в обе части, поэтому его параметры привязываются дважды.
+QString recordsWithArchiveSql(const QString& condition, const QString& orderBy) {
+    return QString(R"(
+        SELECT br.flight_number, br.passenger_name,
+               string_agg(bi.weight::text, ',' ORDER BY bi.item_number) AS weights,
+               br.id, br.created_at
+        FROM baggage_records br
+        LEFT JOIN baggage_items bi ON bi.baggage_record_id = br.id
+        WHERE %1
+        GROUP BY br.id
+        UNION ALL
+        SELECT flight_number, passenger_name, array_to_string(weights, ','), id, created_at
+        FROM baggage_archive
+        WHERE %1
+        ORDER BY %2
+    )").arg(condition, orderBy);
+}
+
+// Записи пассажира только из рабочей таблицы, столбцы - как в recordsWithArchiveSql
+const char OPEN_RECORDS_BY_NAME_SQL[] = R"(
+    SELECT br.flight_number, br.passenger_name,
+           string_agg(bi.weight::text, ',' ORDER BY bi.item_number) AS weights,
+           br.id, br.created_at
+    FROM baggage_records br
+    LEFT JOIN baggage_items bi ON bi.baggage_record_id = br.id
+    WHERE br.passenger_name = ?
+    GROUP BY br.id
+    ORDER BY br.id
+)";
+
+const char ALL_RECORDS_SQL[] = R"(
+    SELECT br.id, br.flight_number, br.passenger_name,
+           bi.item_number, bi.weight
+    FROM baggage_records br
+    LEFT JOIN baggage_items bi ON bi.baggage_record_id = br.id
+    ORDER BY br.id, bi.item_number
+)";
+
+// Записи, изменённые после версии, и все записи тех же пар (рейс, ФИО):
+// кеш заменяет их группой, поэтому повторы ФИО на рейсе не теряются
+const char CHANGED_RECORDS_SQL[] = R"(
+    SELECT br.id, br.flight_number, br.passenger_name,
+           bi.item_number, bi.weight
+    FROM baggage_records br
+    LEFT JOIN baggage_items bi ON bi.baggage_record_id = br.id
+    WHERE (br.flight_number, br.passenger_name) IN (
+        SELECT flight_number, passenger_name FROM baggage_records WHERE row_version > ?)
+    ORDER BY br.id, bi.item_number
+)";
+
+// Ревизия серверных функций (комментарий функции в БД): функции старой
+// ревизии пересоздаются в createTable
+const char FUNCTIONS_REVISION[] = "baggage_system 2";
+
+// Изменения записи за один вызов на сервере: запись и все её вещи -
+// одна команда и один обмен с сервером при любом числе вещей.
+// Возвращают id записи и её created_at / updated_at; replace_items для
+// неизвестного ФИО ничего не возвращает. То же объявлено в init-db.sql.
+const char ADD_BAGGAGE_FUNCTION_SQL[] = R"(
+    CREATE OR REPLACE FUNCTION add_baggage(p_flight_number VARCHAR, p_passenger_name VARCHAR,
+                                           p_weights NUMERIC[])
+    RETURNS TABLE (record_id INTEGER, created_at TIMESTAMP, updated_at TIMESTAMP)
+    LANGUAGE sql AS $$
+        WITH rec AS (
+            INSERT INTO baggage_records (flight_number, passenger_name)
+            VALUES (p_flight_number, p_passenger_name)
+            RETURNING id, created_at, updated_at
+        ), items AS (
+            INSERT INTO baggage_items (baggage_record_id, item_number, weight)
+            SELECT rec.id, w.item_number, w.weight
+            FROM rec, unnest(p_weights) WITH ORDINALITY AS w(weight, item_number)
+        )
+        SELECT id, created_at, updated_at FROM rec
+    $$
+)";
+
+const char REPLACE_ITEMS_FUNCTION_SQL[] = R"(
+    CREATE OR REPLACE FUNCTION replace_items(p_passenger_name VARCHAR, p_weights NUMERIC[])
+    RETURNS TABLE (record_id INTEGER, created_at TIMESTAMP, updated_at TIMESTAMP)
+    LANGUAGE plpgsql AS $$
+    DECLARE
+        v_id INTEGER;
+    BEGIN
+        SELECT br.id INTO v_id FROM baggage_records br
+        WHERE br.passenger_name = p_passenger_name
+        ORDER BY br.id LIMIT 1
+        FOR UPDATE;
+        IF NOT FOUND THEN
+            RETURN;
+        END IF;
+
+        -- Вещи с прежним номером сохраняют бирку
+        DELETE FROM baggage_items
+        WHERE baggage_record_id = v_id AND item_number > cardinality(p_weights);
+        INSERT INTO baggage_items (baggage_record_id, item_number, weight)
+        SELECT v_id, w.item_number, w.weight
+        FROM unnest(p_weights) WITH ORDINALITY AS w(weight, item_number)
+        ON CONFLICT (baggage_record_id, item_number) DO UPDATE SET weight = EXCLUDED.weight;
+
+        RETURN QUERY
+            UPDATE baggage_records br SET updated_at = CURRENT_TIMESTAMP
+            WHERE br.id = v_id
+            RETURNING br.id, br.created_at, br.updated_at;
+    END;
+    $$
+)";
+
+// Версия изменения: счётчик увеличивается один раз на транзакцию при первой
+// записи, строка счётчика заблокирована до её фиксации. Поэтому версии
+// растут в порядке фиксации: в любом снимке счётчик - последняя
+// зафиксированная версия, а всё, что зафиксируют позже, получит большую.
+// CURRENT_TIMESTAMP (время начала транзакции) этого не даёт: транзакция,
+// начатая раньше чтения, но зафиксированная после, получила бы меньшее
+// время. Не меньше текущего времени в мкс - версии продолжают прежние
+// (updated_at в мкс) в журналах и снимках стоек.
+const char TX_VERSION_FUNCTION_SQL[] = R"(
+    CREATE OR REPLACE FUNCTION baggage_tx_version()
+    RETURNS BIGINT
+    LANGUAGE plpgsql AS $$
+    DECLARE
+        v_version TEXT := current_setting('baggage.tx_version', true);
+    BEGIN
+        IF v_version IS NULL OR v_version = '' THEN
+            UPDATE baggage_version
+            SET version = GREATEST(version + 1, (extract(epoch FROM clock_timestamp()) * 1000000)::bigint)
+            WHERE id = 1
+            RETURNING version::text INTO v_version;
+            PERFORM set_config('baggage.tx_version', v_version, true);
+        END IF;
+        RETURN v_version::bigint;
+    END;
+    $$
+)";
+
+const char ROW_VERSION_FUNCTION_SQL[] = R"(
+    CREATE OR REPLACE FUNCTION baggage_set_row_version()
+    RETURNS trigger
+    LANGUAGE plpgsql AS $$
+    BEGIN
+        NEW.row_version := baggage_tx_version();
+        RETURN NEW;
+    END;
+    $$
+)";
+
+// Загрузка рейсов (FlightLoadMonitor): триггеры уровня команды отправляют в
+// канал baggage_load изменения итогов по рейсам - одно уведомление на рейс
+// за команду: "txid<TAB>метка<TAB>рейс<TAB>пассажиры<TAB>вещи<TAB>вес".
+// Метка (clock_timestamp, мкс) делает одинаковые изменения одной транзакции
+// разными уведомлениями - PostgreSQL объединяет одинаковые.
+const char LOAD_NOTIFY_FUNCTION_SQL[] = R"(
+    CREATE OR REPLACE FUNCTION baggage_load_notify(p_flight_number VARCHAR, p_passengers BIGINT,
+                                                   p_items BIGINT, p_weight NUMERIC)
+    RETURNS void
+    LANGUAGE sql AS $$
+        SELECT pg_notify('baggage_load', concat_ws(E'\t', txid_current(),
+                         (extract(epoch FROM clock_timestamp()) * 1000000)::bigint,
+                         p_flight_number, p_passengers, p_items, p_weight))
+    $$
+)";
+
+// Вещи удалённых записей (каскад) уже не связать с рейсом: их итоги
+// откладываются в baggage_load_pending до триггера baggage_records той же команды
+const char LOAD_ITEMS_FUNCTION_SQL[] = R"(
+    CREATE OR REPLACE FUNCTION baggage_load_items_changed()
+    RETURNS trigger
+    LANGUAGE plpgsql AS $$
+    BEGIN
+        IF TG_OP = 'INSERT' THEN
+            PERFORM baggage_load_notify(br.flight_number, 0, count(*), sum(n.weight))
+            FROM new_items n JOIN baggage_records br ON br.id = n.baggage_record_id
+            GROUP BY br.flight_number;
+        ELSIF TG_OP = 'UPDATE' THEN
+            PERFORM baggage_load_notify(br.flight_number, 0, 0, sum(n.weight - o.weight))
+            FROM new_items n
+            JOIN old_items o ON o.id = n.id
+            JOIN baggage_records br ON br.id = n.baggage_record_id
+            WHERE n.weight <> o.weight
+            GROUP BY br.flight_number;
+        ELSE
+            PERFORM baggage_load_notify(br.flight_number, 0, -count(*), -sum(o.weight))
+            FROM old_items o JOIN baggage_records br ON br.id = o.baggage_record_id
+            GROUP BY br.flight_number;
+            INSERT INTO baggage_load_pending (txid, record_id, item_count, total_weight)
+            SELECT txid_current(), o.baggage_record_id, count(*), sum(o.weight)
+            FROM old_items o
+            WHERE NOT EXISTS (SELECT 1 FROM baggage_records br WHERE br.id = o.baggage_record_id)
+            GROUP BY o.baggage_record_id;
+        END IF;
+        RETURN NULL;
+    END;
+    $$
+)";
+
+const char LOAD_RECORDS_FUNCTION_SQL[] = R"(
+    CREATE OR REPLACE FUNCTION baggage_load_records_changed()
+    RETURNS trigger
+    LANGUAGE plpgsql AS $$
+    BEGIN
+        IF TG_OP = 'INSERT' THEN
+            PERFORM baggage_load_notify(n.flight_number, count(*), 0, 0)
+            FROM new_records n
+            GROUP BY n.flight_number;
+        ELSIF TG_OP = 'UPDATE' THEN
+            -- Запись перенесена на другой рейс вместе с вещами
+            PERFORM baggage_load_notify(m.flight_number, sum(m.sign)::bigint,
+                                        sum(m.sign * m.items)::bigint, sum(m.sign * m.weight))
+            FROM (
+                SELECT CASE WHEN s.sign > 0 THEN r.new_flight ELSE r.old_flight END AS flight_number,
+                       s.sign, r.items, r.weight
+                FROM (
+                    SELECT n.flight_number AS new_flight, o.flight_number AS old_flight,
+                           count(bi.id) AS items, COALESCE(sum(bi.weight), 0) AS weight
+                    FROM new_records n
+                    JOIN old_records o ON o.id = n.id AND o.flight_number <> n.flight_number
+                    LEFT JOIN baggage_items bi ON bi.baggage_record_id = n.id
+                    GROUP BY n.id, n.flight_number, o.flight_number
+                ) r
+                CROSS JOIN (VALUES (1), (-1)) AS s(sign)
+            ) m
+            GROUP BY m.flight_number;
+        ELSE
+            PERFORM baggage_load_notify(o.flight_number, -count(*),
+                                        -COALESCE(sum(p.item_count), 0)::bigint,
+                                        -COALESCE(sum(p.total_weight), 0))
+            FROM old_records o
+            LEFT JOIN baggage_load_pending p ON p.txid = txid_current() AND p.record_id = o.id
+            GROUP BY o.flight_number;
+            DELETE FROM baggage_load_pending p
+            USING old_records o
+            WHERE p.txid = txid_current() AND p.record_id = o.id;
+        END IF;
+        RETURN NULL;
+    END;
+    $$
+)";
+
+// Версия строки и загрузка рейсов; триггеры загрузки - уровня команды
+// с таблицами переходов (PostgreSQL 10+)
+const char* const TRIGGERS[][2] = {
+    {"baggage_row_version",
+     "CREATE TRIGGER baggage_row_version BEFORE INSERT OR UPDATE ON baggage_records "
+     "FOR EACH ROW EXECUTE FUNCTION baggage_set_row_version()"},
+    {"baggage_load_items_insert",
+     "CREATE TRIGGER baggage_load_items_insert AFTER INSERT ON baggage_items "
+     "REFERENCING NEW TABLE AS new_items FOR EACH STATEMENT EXECUTE FUNCTION baggage_load_items_changed()"},
+    {"baggage_load_items_update",
+     "CREATE TRIGGER baggage_load_items_update AFTER UPDATE ON baggage_items "
+     "REFERENCING OLD TABLE AS old_items NEW TABLE AS new_items "
+     "FOR EACH STATEMENT EXECUTE FUNCTION baggage_load_items_changed()"},
+    {"baggage_load_items_delete",
+     "CREATE TRIGGER baggage_load_items_delete AFTER DELETE ON baggage_items "
+     "REFERENCING OLD TABLE AS old_items FOR EACH STATEMENT EXECUTE FUNCTION baggage_load_items_changed()"},
+    {"baggage_load_records_insert",
+     "CREATE TRIGGER baggage_load_records_insert AFTER INSERT ON baggage_records "
+     "REFERENCING NEW TABLE AS new_records FOR EACH STATEMENT EXECUTE FUNCTION baggage_load_records_changed()"},
+    {"baggage_load_records_update",
+     "CREATE TRIGGER baggage_load_records_update AFTER UPDATE ON baggage_records "
+     "REFERENCING OLD TABLE AS old_records NEW TABLE AS new_records "
+     "FOR EACH STATEMENT EXECUTE FUNCTION baggage_load_records_changed()"},
+    {"baggage_load_records_delete",
+     "CREATE TRIGGER baggage_load_records_delete AFTER DELETE ON baggage_records "
+     "REFERENCING OLD TABLE AS old_records FOR EACH STATEMENT EXECUTE FUNCTION baggage_load_records_changed()"},
+};
+
+/**
+ * @brief Номера столбцов выборки записей
+ *
+ * Определяются один раз по описанию выборки, а не поиском по имени
+ * в каждой строке; столбца нет в выборке - номер -1.
+ */
+struct RecordColumns {
+    explicit RecordColumns(const QSqlQuery& query) {
+        const QSqlRecord columns = query.record();
+        id = columns.indexOf("id");
+        flightNumber = columns.indexOf("flight_number");
+        passengerName = columns.indexOf("passenger_name");
+        weight = columns.indexOf("weight");
+    }
+
+    int id;
+    int flightNumber;
+    int passengerName;
+    int weight;
+};
+
+// Строки "запись + вещь" (ALL_RECORDS_SQL и подобные, по порядку id) в записи
+QVector<BaggageRecord> groupItemRows(QSqlQuery& query) {
+    QVector<BaggageRecord> records;
+    const RecordColumns columns(query);
+    int lastRecordId = -1;
+    QString currentFlightNumber;
+    QString currentPassengerName;
+    QVector<double> currentWeights;
+
+    while (query.next()) {
+        int recordId = query.value(columns.id).toInt();
+        
+        // Если началась новая запись
+        if (recordId != lastRecordId && lastRecordId != -1) {
+            // Сохраняем предыдущую запись
+            records.append(BaggageRecord(currentFlightNumber, currentPassengerName, currentWeights));
+            currentWeights.clear();
+        }
+        
+        // Читаем данные текущей записи
+        if (recordId != lastRecordId) {
+            currentFlightNumber = query.value(columns.flightNumber).toString();
+            currentPassengerName = query.value(columns.passengerName).toString();
+            lastRecordId = recordId;
+        }
+        
+        // Добавляем вес вещи (если есть)
+        const QVariant weight = query.value(columns.weight);
+        if (!weight.isNull()) {
+            currentWeights.append(weight.toDouble());
+        }
+    }
+    query.finish();
+
+    // Не забываем добавить последнюю запись
+    if (lastRecordId != -1) {
+        records.append(BaggageRecord(currentFlightNumber, currentPassengerName, currentWeights));
+    }
+    return records;
+}
+
+// Позиция WAL в байтах - сравнима между основным сервером и его репликой
+const char WRITE_LSN_SQL[] = "SELECT pg_wal_lsn_diff(pg_current_wal_lsn(), '0/0')::bigint";
+
+// Позиция применённого WAL и отставание реплики (мс). Если всё полученное
+// уже применено, реплика не отстаёт, даже когда записей давно не было.
+const char REPLICA_STATE_SQL[] = R"(
+    SELECT pg_wal_lsn_diff(CASE WHEN pg_is_in_recovery() THEN pg_last_wal_replay_lsn()
+                                ELSE pg_current_wal_lsn() END, '0/0')::bigint,
+           CASE WHEN NOT pg_is_in_recovery()
+                     OR pg_last_wal_receive_lsn() = pg_last_wal_replay_lsn() THEN 0
+                ELSE COALESCE(EXTRACT(EPOCH FROM now() - pg_last_xact_replay_timestamp()) * 1000, 0)
+           END::bigint
+)";
+
+} // namespace
 
 DatabaseManager& DatabaseManager::instance() {
     static DatabaseManager instance;
     return instance;
 }
 
-DatabaseManager::DatabaseManager() {
-    m_db = QSqlDatabase::addDatabase("QPSQL");
+DatabaseManager::DatabaseManager() : DatabaseManager(QSqlDatabase::defaultConnection) {
+}
+
+DatabaseManager::DatabaseManager(const QString& connectionName)
+    : m_ownerThread(QThread::currentThread()),
+      m_replicaMaxLagMs(0),
+      m_lastWriteLsn(0),
+      m_replicaReplayLsn(-1),
+      m_replicaCheckedAt(0),
+      m_replicaDownUntil(0),
+      m_replicaProbing(false) {
+    m_db = QSqlDatabase::addDatabase("QPSQL", connectionName);
 }
 
 DatabaseManager::~DatabaseManager() {
+    m_replica.reset();
     disconnectFromDatabase();
+
+    // Именованные подключения (сегменты, реплики) удаляются вместе с объектом
+    const QString name = m_db.connectionName();
+    if (name != QLatin1String(QSqlDatabase::defaultConnection)) {
+        m_db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(name);
+    }
 }
 
 bool DatabaseManager::connectToDatabase(const QString& host, int port,
@@ -28,10 +487,12 @@ bool DatabaseManager::connectToDatabase(const QString& host, int port,
     m_db.setDatabaseName(dbName);
     m_db.setUserName(user);
     m_db.setPassword(password);
+    // Клоны для рабочих потоков наследуют параметры подключения
+    m_db.setConnectOptions(connectOptions());
 
     if (!m_db.open()) {
-        m_lastError = "Ошибка подключения к БД: " + m_db.lastError().text();
-        qWarning() << m_lastError;
+        m_lastError.localData() = "Ошибка подключения к БД: " + m_db.lastError().text();
+        qWarning() << m_lastError.localData();
         return false;
     }
 
@@ -39,7 +500,190 @@ bool DatabaseManager::connectToDatabase(const QString& host, int port,
     return true;
 }
 
+bool DatabaseManager::connectFromEnvironment(QString* connectionInfo) {
+    QString dbHost = qEnvironmentVariable("DB_HOST", "postgres");
+    int dbPort = qEnvironmentVariable("DB_PORT", "5432").toInt();
+    QString dbName = qEnvironmentVariable("DB_NAME", "baggage_db");
+    QString dbUser = qEnvironmentVariable("DB_USER", "postgres");
+    QString dbPassword = qEnvironmentVariable("DB_PASSWORD", "postgres");
+
+    if (connectionInfo) {
+        *connectionInfo = "Host: " + dbHost + ":" + QString::number(dbPort) + "\n" +
+                          "Database: " + dbName + "\n" +
+                          "User: " + dbUser;
+    }
+
+    if (!connectToDatabase(dbHost, dbPort, dbName, dbUser, dbPassword)) {
+        return false;
+    }
+
+    // Реплика не обязательна: без неё все чтения идут на основной сервер
+    const QString replicaHost = qEnvironmentVariable("DB_REPLICA_HOST");
+    if (!replicaHost.isEmpty()) {
+        int replicaPort = qEnvironmentVariable("DB_REPLICA_PORT", QString::number(dbPort)).toInt();
+        int maxLagMs = qEnvironmentVariable("DB_REPLICA_MAX_LAG_MS", "5000").toInt();
+        attachReplica(replicaHost, replicaPort, maxLagMs);
+        if (connectionInfo) {
+            *connectionInfo += "\nReplica: " + replicaHost + ":" + QString::number(replicaPort);
+        }
+    }
+    return true;
+}
+
+bool DatabaseManager::attachReplica(const QString& host, int port, int maxLagMs) {
+    m_replica.reset(new DatabaseManager(m_db.connectionName() + "_replica"));
+    m_replicaMaxLagMs = qMax(0, maxLagMs);
+    {
+        QMutexLocker locker(&m_replicaMutex);
+        m_replicaReplayLsn = -1;
+        m_replicaCheckedAt = 0;
+        m_replicaDownUntil = 0;
+    }
+
+    if (!m_replica->connectToDatabase(host, port, m_db.databaseName(),
+                                      m_db.userName(), m_db.password())) {
+        qWarning() << "Реплика недоступна, чтения идут на основной сервер:" << m_replica->getLastError();
+        QMutexLocker locker(&m_replicaMutex);
+        m_replicaDownUntil = QDateTime::currentMSecsSinceEpoch() + REPLICA_RETRY_MS;
+        return false;
+    }
+    qDebug() << "Реплика для чтения:" << host << port << "допустимое отставание, мс:" << m_replicaMaxLagMs;
+    return true;
+}
+
+ReadRoutingStats DatabaseManager::readRoutingStats() const {
+    QMutexLocker locker(&m_replicaMutex);
+    return m_readStats;
+}
+
+DatabaseManager::ReadRoute DatabaseManager::readRoute() {
+    ReadRoute route;
+    if (!m_replica) {
+        QMutexLocker locker(&m_replicaMutex);
+        ++m_readStats.primaryReads;
+        route.db = connection();
+        return route;
+    }
+
+    // Состояние перепроверяется раз в интервал, а также пока на реплике
+    // нет последней записи процесса (чтобы не ждать интервал после неё).
+    // Запрос к реплике идёт без блокировки и только в одном потоке;
+    // остальные чтения тем временем решают по прежнему состоянию.
+    bool probe = false;
+    {
+        QMutexLocker locker(&m_replicaMutex);
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        if (now >= m_replicaDownUntil && !m_replicaProbing
+            && (now - m_replicaCheckedAt >= REPLICA_CHECK_INTERVAL_MS
+                || m_replicaReplayLsn < m_lastWriteLsn.load())) {
+            m_replicaProbing = true;
+            probe = true;
+        }
+    }
+    if (probe) {
+        qint64 replayLsn = -1;
+        qint64 lagMs = 0;
+        const bool ok = probeReplica(&replayLsn, &lagMs);
+        QMutexLocker locker(&m_replicaMutex);
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        if (ok) {
+            m_replicaReplayLsn = replayLsn;
+            m_readStats.replicaLagMs = lagMs;
+            m_replicaCheckedAt = now;
+        } else {
+            m_replicaDownUntil = now + REPLICA_RETRY_MS;
+        }
+        m_replicaProbing = false;
+    }
+
+    {
+        QMutexLocker locker(&m_replicaMutex);
+        // После ошибки реплика отложена до m_replicaDownUntil
+        if (QDateTime::currentMSecsSinceEpoch() >= m_replicaDownUntil) {
+            if (m_readStats.replicaLagMs > m_replicaMaxLagMs) {
+                ++m_readStats.laggedSkips;
+            } else if (m_replicaReplayLsn < m_lastWriteLsn.load()) {
+                ++m_readStats.staleSkips;
+            } else {
+                route.replica = true;
+            }
+        }
+        if (route.replica) {
+            ++m_readStats.replicaReads;
+        } else {
+            ++m_readStats.primaryReads;
+        }
+    }
+
+    route.db = route.replica ? m_replica->connection() : connection();
+    return route;
+}
+
+bool DatabaseManager::probeReplica(qint64* replayLsn, qint64* lagMs) {
+    QSqlDatabase db = m_replica->connection();
+    if (!db.isOpen() && !db.open()) {
+        qWarning() << "Реплика недоступна, чтения идут на основной сервер:" << db.lastError().text();
+        return false;
+    }
+    QSqlQuery query(db);
+    if (!query.exec(REPLICA_STATE_SQL) || !query.next()) {
+        qWarning() << "Реплика недоступна, чтения идут на основной сервер:" << query.lastError().text();
+        // Следующая проверка переоткроет подключение
+        query.finish();
+        dropPreparedQueries(db.connectionName());
+        db.close();
+        return false;
+    }
+    *replayLsn = query.value(0).toLongLong();
+    *lagMs = query.value(1).toLongLong();
+    return true;
+}
+
+bool DatabaseManager::fallBackToPrimary(const ReadRoute& route, const char* operation) {
+    if (!route.replica) {
+        return false;
+    }
+    QMutexLocker locker(&m_replicaMutex);
+    m_replicaDownUntil = QDateTime::currentMSecsSinceEpoch() + REPLICA_RETRY_MS;
+    ++m_readStats.replicaFallbacks;
+    qWarning() << "Ошибка чтения" << operation << "на реплике, повтор на основном сервере";
+    return true;
+}
+
+void DatabaseManager::noteWrite(QSqlDatabase db) {
+    if (!m_replica) {
+        return;
+    }
+    QSqlQuery query(db);
+    if (!query.exec(WRITE_LSN_SQL) || !query.next()) {
+        // Позиция неизвестна - реплика не используется, пока не догонит наверняка
+        qWarning() << "Не удалось прочитать позицию WAL:" << query.lastError().text();
+        QMutexLocker locker(&m_replicaMutex);
+        m_replicaDownUntil = QDateTime::currentMSecsSinceEpoch() + REPLICA_RETRY_MS;
+        return;
+    }
+    const qint64 lsn = query.value(0).toLongLong();
+    qint64 previous = m_lastWriteLsn.load();
+    while (previous < lsn && !m_lastWriteLsn.compare_exchange_weak(previous, lsn)) {
+    }
+}
+
+// Короткий таймаут подключения и keepalive: при обрыве сети стойка
+// узнаёт об этом за секунды, а не за минуты ожидания TCP
+QString DatabaseManager::connectOptions() {
+    int timeout = qEnvironmentVariable("DB_CONNECT_TIMEOUT", "3").toInt();
+    return QString("connect_timeout=%1;keepalives=1;keepalives_idle=10;"
+                   "keepalives_interval=3;keepalives_count=3")
+        .arg(qMax(1, timeout));
+}
+
 void DatabaseManager::disconnectFromDatabase() {
+    if (m_statements.hasLocalData()) {
+        m_statements.localData().clear();
+    }
+    if (m_replica) {
+        m_replica->disconnectFromDatabase();
+    }
     if (m_db.isOpen()) {
         m_db.close();
         qDebug() << "Отключение от БД";
@@ -50,9 +694,102 @@ bool DatabaseManager::isConnected() const {
     return m_db.isOpen();
 }
 
+bool DatabaseManager::checkConnection() {
+    QSqlDatabase db = connection();
+    if (db.isOpen()) {
+        QSqlQuery ping(db);
+        if (ping.exec("SELECT 1")) {
+            return true;
+        }
+        dropPreparedQueries(db.connectionName());
+        db.close();
+    }
+
+    if (!db.open()) {
+        m_lastError.localData() = "Нет связи с БД: " + db.lastError().text();
+        return false;
+    }
+    qDebug() << "Связь с БД восстановлена";
+    return true;
+}
+
+// Основной поток работает через m_db, остальные - через клон подключения
+QSqlDatabase DatabaseManager::connection() {
+    if (QThread::currentThread() == m_ownerThread) {
+        return m_db;
+    }
+
+    if (m_threadConnection.hasLocalData() && !m_threadConnection.localData().isEmpty()) {
+        QSqlDatabase db = QSqlDatabase::database(m_threadConnection.localData(), false);
+        if (!db.isOpen() && !db.open()) {
+            m_lastError.localData() = "Ошибка подключения потока к БД: " + db.lastError().text();
+        }
+        return db;
+    }
+
+    const QString prefix = m_db.connectionName() == QLatin1String(QSqlDatabase::defaultConnection)
+                               ? QString("baggage") : m_db.connectionName();
+    QString name = QString("%1_thread_%2")
+                       .arg(prefix)
+                       .arg(reinterpret_cast<quintptr>(QThread::currentThreadId()), 0, 16);
+    QSqlDatabase db = openWorkerConnection(name);
+    if (!db.isOpen()) {
+        m_lastError.localData() = "Ошибка подключения потока к БД: " + db.lastError().text();
+    }
+    m_threadConnection.setLocalData(name);
+    return db;
+}
+
+void DatabaseManager::releaseThreadConnection() {
+    // Подготовленные запросы держат подключения потока
+    if (m_statements.hasLocalData()) {
+        m_statements.localData().clear();
+    }
+    if (m_replica) {
+        m_replica->releaseThreadConnection();
+    }
+    if (QThread::currentThread() == m_ownerThread || !m_threadConnection.hasLocalData()
+        || m_threadConnection.localData().isEmpty()) {
+        return;
+    }
+    closeWorkerConnection(m_threadConnection.localData());
+    m_threadConnection.setLocalData(QString());
+}
+
+QSqlQuery DatabaseManager::preparedQuery(const QSqlDatabase& db, const QString& sql) {
+    QHash<QString, QSqlQuery>& statements = m_statements.localData();
+    const QString key = db.connectionName() + '\n' + sql;
+    auto it = statements.constFind(key);
+    if (it != statements.constEnd()) {
+        return it.value();
+    }
+
+    QSqlQuery query(db);
+    // Неудачная подготовка не кешируется: exec() вернёт её ошибку
+    if (query.prepare(sql)) {
+        statements.insert(key, query);
+    }
+    return query;
+}
+
+void DatabaseManager::dropPreparedQueries(const QString& connectionName) {
+    if (!m_statements.hasLocalData()) {
+        return;
+    }
+    const QString prefix = connectionName + '\n';
+    QHash<QString, QSqlQuery>& statements = m_statements.localData();
+    for (auto it = statements.begin(); it != statements.end();) {
+        if (it.key().startsWith(prefix)) {
+            it = statements.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 // Функция 1: Создать таблицу с заданной структурой
 bool DatabaseManager::createTable() {
-    QSqlQuery query(m_db);
+    QSqlQuery query(connection());
 
     // Создаем таблицу багажа пассажиров
     QString createRecordsSQL = R"(
@@ -67,8 +804,8 @@ bool DatabaseManager::createTable() {
     )";
 
     if (!query.exec(createRecordsSQL)) {
-        m_lastError = "Ошибка создания таблицы baggage_records: " + query.lastError().text();
-        qWarning() << m_lastError;
+        m_lastError.localData() = "Ошибка создания таблицы baggage_records: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
         return false;
     }
 
@@ -84,97 +821,193 @@ bool DatabaseManager::createTable() {
     )";
 
     if (!query.exec(createItemsSQL)) {
-        m_lastError = "Ошибка создания таблицы baggage_items: " + query.lastError().text();
-        qWarning() << m_lastError;
+        m_lastError.localData() = "Ошибка создания таблицы baggage_items: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
         return false;
     }
 
-    // Создаем индексы для ускорения поиска
-    query.exec("CREATE INDEX IF NOT EXISTS idx_flight_number ON baggage_records(flight_number)");
-    query.exec("CREATE INDEX IF NOT EXISTS idx_passenger_name ON baggage_records(passenger_name)");
-    query.exec("CREATE INDEX IF NOT EXISTS idx_baggage_items_record ON baggage_items(baggage_record_id)");
-
-    qDebug() << "Таблицы baggage_records и baggage_items созданы успешно";
-    return true;
-}
+    // Версии изменений для обнаружения конфликтов (строки до появления
+    // столбца - версии 0, то есть старше любой версии стойки)
+    if (!query.exec("CREATE TABLE IF NOT EXISTS baggage_version ("
+                    "id INTEGER PRIMARY KEY CHECK (id = 1), version BIGINT NOT NULL)")
+        || !query.exec("INSERT INTO baggage_version (id, version) VALUES (1, 0) ON CONFLICT (id) DO NOTHING")
+        || !query.exec("ALTER TABLE baggage_records ADD COLUMN IF NOT EXISTS "
+                       "row_version BIGINT NOT NULL DEFAULT 0")) {
+        m_lastError.localData() = "Ошибка создания версий данных: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        return false;
+    }
 
-// Функция 2: Получить все записи
-QVector<BaggageRecord> DatabaseManager::getAllRecords() {
-    QVector<BaggageRecord> records;
-    QSqlQuery query(m_db);
+    // Бирки вещей: номер из последовательности при вставке вещи (существующим
+    // вещам назначается при добавлении столбца)
+    if (!query.exec("CREATE SEQUENCE IF NOT EXISTS bag_tag_seq")
+        || !query.exec("ALTER TABLE baggage_items ADD COLUMN IF NOT EXISTS "
+                       "bag_tag BIGINT NOT NULL DEFAULT nextval('bag_tag_seq')")
+        || !query.exec("CREATE UNIQUE INDEX IF NOT EXISTS idx_baggage_items_bag_tag ON baggage_items(bag_tag)")) {
+        m_lastError.localData() = "Ошибка создания бирок вещей: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        return false;
+    }
 
-    // Используем JOIN для получения всех данных за 1 запрос вместо N+1
-    QString sql = R"(
-        SELECT br.id, br.flight_number, br.passenger_name, 
-               bi.item_number, bi.weight
-        FROM baggage_records br
-        LEFT JOIN baggage_items bi ON bi.baggage_record_id = br.id
-        ORDER BY br.id, bi.item_number
+    // Архив закрытых рейсов: запись с весами массивом (без строк вещей)
+    // и итоги по рейсу
+    QString createArchiveSQL = R"(
+        CREATE TABLE IF NOT EXISTS baggage_archive (
+            id INTEGER PRIMARY KEY,
+            flight_number VARCHAR(50) NOT NULL,
+            passenger_name VARCHAR(255) NOT NULL,
+            created_at TIMESTAMP,
+            updated_at TIMESTAMP,
+            weights NUMERIC(5,2)[] NOT NULL,
+            bag_tags BIGINT[]
+        )
+    )";
+    QString createClosedFlightsSQL = R"(
+        CREATE TABLE IF NOT EXISTS closed_flights (
+            flight_number VARCHAR(50) PRIMARY KEY,
+            closed_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+            passenger_count INTEGER NOT NULL,
+            item_count INTEGER NOT NULL,
+            total_weight NUMERIC(12,2) NOT NULL
+        )
     )";
 
-    if (!query.exec(sql)) {
-        m_lastError = "Ошибка получения записей: " + query.lastError().text();
-        qWarning() << m_lastError;
-        return records;
+    if (!query.exec(createArchiveSQL) || !query.exec(createClosedFlightsSQL)
+        || !query.exec("ALTER TABLE baggage_archive ADD COLUMN IF NOT EXISTS bag_tags BIGINT[]")) {
+        m_lastError.localData() = "Ошибка создания таблиц архива: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        return false;
     }
 
-    // Группируем результаты по записям
-    int lastRecordId = -1;
-    QString currentFlightNumber;
-    QString currentPassengerName;
-    QVector<double> currentWeights;
+    // Создаем индексы для ускорения поиска
+    query.exec("CREATE INDEX IF NOT EXISTS idx_flight_number ON baggage_records(flight_number)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_passenger_name ON baggage_records(passenger_name)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_baggage_items_record ON baggage_items(baggage_record_id)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_row_version ON baggage_records(row_version)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_archive_flight_number ON baggage_archive(flight_number)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_archive_passenger_name ON baggage_archive(passenger_name)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_archive_created_at ON baggage_archive(created_at)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_archive_bag_tags ON baggage_archive USING gin(bag_tags)");
+
+    // Итоги вещей записей, удалённых каскадом, до триггера baggage_records
+    // (строки живут до конца команды, поэтому журнал WAL не нужен)
+    if (!query.exec(R"(
+            CREATE UNLOGGED TABLE IF NOT EXISTS baggage_load_pending (
+                txid BIGINT NOT NULL,
+                record_id INTEGER NOT NULL,
+                item_count BIGINT NOT NULL,
+                total_weight NUMERIC(12,2) NOT NULL
+            )
+        )")
+        || !query.exec("CREATE INDEX IF NOT EXISTS idx_load_pending ON baggage_load_pending(txid, record_id)")) {
+        m_lastError.localData() = "Ошибка создания таблицы baggage_load_pending: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        return false;
+    }
 
-    while (query.next()) {
-        int recordId = query.value("id").toInt();
-        
-        // Если началась новая запись
-        if (recordId != lastRecordId && lastRecordId != -1) {
-            // Сохраняем предыдущую запись
-            records.append(BaggageRecord(currentFlightNumber, currentPassengerName, currentWeights));
-            currentWeights.clear();
+    // Функции изменения записей. Создаются, только если их нет или они старой
+    // ревизии: одновременный CREATE OR REPLACE с нескольких стоек завершается ошибкой
+    const QVector<QPair<QString, const char*>> functions = {
+        {"baggage_tx_version()", TX_VERSION_FUNCTION_SQL},
+        {"baggage_set_row_version()", ROW_VERSION_FUNCTION_SQL},
+        {"add_baggage(varchar,varchar,numeric[])", ADD_BAGGAGE_FUNCTION_SQL},
+        {"replace_items(varchar,numeric[])", REPLACE_ITEMS_FUNCTION_SQL},
+        {"baggage_load_notify(varchar,bigint,bigint,numeric)", LOAD_NOTIFY_FUNCTION_SQL},
+        {"baggage_load_items_changed()", LOAD_ITEMS_FUNCTION_SQL},
+        {"baggage_load_records_changed()", LOAD_RECORDS_FUNCTION_SQL},
+    };
+    for (const auto& function : functions) {
+        query.prepare("SELECT COALESCE(obj_description(to_regprocedure(?), 'pg_proc'), '') = ?");
+        query.addBindValue(function.first);
+        query.addBindValue(QString(FUNCTIONS_REVISION));
+        if (!query.exec() || !query.next()) {
+            m_lastError.localData() = "Ошибка проверки функции " + function.first + ": " + query.lastError().text();
+            qWarning() << m_lastError.localData();
+            return false;
         }
-        
-        // Читаем данные текущей записи
-        if (recordId != lastRecordId) {
-            currentFlightNumber = query.value("flight_number").toString();
-            currentPassengerName = query.value("passenger_name").toString();
-            lastRecordId = recordId;
+        if (query.value(0).toBool()) {
+            continue;
         }
-        
-        // Добавляем вес вещи (если есть)
-        if (!query.value("weight").isNull()) {
-            double weight = query.value("weight").toDouble();
-            currentWeights.append(weight);
+        if (!query.exec(function.second)
+            || !query.exec(QString("COMMENT ON FUNCTION %1 IS '%2'").arg(function.first, FUNCTIONS_REVISION))) {
+            m_lastError.localData() = "Ошибка создания функции " + function.first + ": " + query.lastError().text();
+            qWarning() << m_lastError.localData();
+            return false;
         }
     }
 
-    // Не забываем добавить последнюю запись
-    if (lastRecordId != -1) {
-        records.append(BaggageRecord(currentFlightNumber, currentPassengerName, currentWeights));
+    // Триггеры ссылаются на функции по имени и переживают их пересоздание
+    for (const auto& trigger : TRIGGERS) {
+        query.prepare("SELECT 1 FROM pg_trigger WHERE tgname = ?");
+        query.addBindValue(QString(trigger[0]));
+        if (!query.exec()) {
+            m_lastError.localData() = QString("Ошибка проверки триггера %1: %2")
+                                          .arg(trigger[0], query.lastError().text());
+            qWarning() << m_lastError.localData();
+            return false;
+        }
+        if (!query.next() && !query.exec(trigger[1])) {
+            m_lastError.localData() = QString("Ошибка создания триггера %1: %2")
+                                          .arg(trigger[0], query.lastError().text());
+            qWarning() << m_lastError.localData();
+            return false;
+        }
     }
 
-    qDebug() << "Загружено записей из БД:" << records.size();
-    return records;
+    qDebug() << "Таблицы baggage_records, baggage_items и архива созданы успешно";
+    return true;
 }
 
-// Вспомогательный метод для получения весов вещей
-QVector<double> DatabaseManager::getItemWeights(int recordId) {
-    QVector<double> weights;
-    QSqlQuery query(m_db);
+// Функция 2: Получить все записи
+QVector<BaggageRecord> DatabaseManager::getAllRecords(qint64* dataVersion) {
+    QVector<BaggageRecord> records;
+    const ReadRoute route = readRoute();
+    QSqlDatabase db = route.db;
+
+    // Версия и записи читаются из одного снимка БД. Версия с отстающей
+    // реплики меньше версии основного сервера - при сверке это даёт лишние
+    // конфликты, но не пропущенные.
+    const bool consistent = dataVersion && db.transaction();
+    if (consistent) {
+        QSqlQuery versionQuery(db);
+        versionQuery.exec("SET TRANSACTION ISOLATION LEVEL REPEATABLE READ");
+        if (!versionQuery.exec(QString("SELECT %1").arg(DATA_VERSION_SQL))
+            || !versionQuery.next()) {
+            m_lastError.localData() = "Ошибка чтения версии данных: " + versionQuery.lastError().text();
+            qWarning() << m_lastError.localData();
+            db.rollback();
+            if (fallBackToPrimary(route, "getAllRecords")) {
+                return getAllRecords(dataVersion);
+            }
+            return records;
+        }
+        *dataVersion = versionQuery.value(0).toLongLong();
+    }
 
-    query.prepare("SELECT weight FROM baggage_items WHERE baggage_record_id = ? ORDER BY item_number");
-    query.addBindValue(recordId);
+    // Используем JOIN для получения всех данных за 1 запрос вместо N+1
+    QSqlQuery query = preparedQuery(db, ALL_RECORDS_SQL);
 
     if (!query.exec()) {
-        qWarning() << "Ошибка получения весов для записи" << recordId << ":" << query.lastError().text();
-        return weights;
+        m_lastError.localData() = "Ошибка получения записей: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        if (consistent) {
+            db.rollback();
+            *dataVersion = -1;
+        }
+        if (fallBackToPrimary(route, "getAllRecords")) {
+            return getAllRecords(dataVersion);
+        }
+        return records;
     }
 
-    while (query.next()) {
-        weights.append(query.value(0).toDouble());
+    // Группируем результаты по записям
+    records = groupItemRows(query);
+    if (consistent) {
+        db.commit();
     }
 
-    return weights;
+    qDebug() << "Загружено записей из БД:" << records.size();
+    return records;
 }
 
 // Функция 3: Фильтр пассажиров с 1 вещью весом 20-30 кг
@@ -195,324 +1028,694 @@ QVector<BaggageRecord> DatabaseManager::filterPassengersWithSingleItem20_30kg()
 }
 
 // Функция 4: Сформировать файл сводки
-bool DatabaseManager::createSummaryFile(const QString& filename) {
-    QFile file(filename);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        m_lastError = "Не удалось создать файл сводки: " + filename;
-        qWarning() << m_lastError;
+// Строки читаются серверным курсором и пишутся через большой буфер,
+// поэтому память не растёт с числом записей.
+bool DatabaseManager::createSummaryFile(const QString& filename,
+                                        const SummaryExportOptions& options) {
+    BufferedFileWriter writer;
+    if (!writer.open(filename, options.gzip)) {
+        m_lastError.localData() = "Не удалось создать файл сводки: " + writer.errorString();
+        qWarning() << m_lastError.localData();
         return false;
     }
 
-    QTextStream out(&file);
-    out.setEncoding(QStringConverter::Utf8);
-
     // Заголовок
-    out << QString("№ рейса\tФ.И.О. пассажира\tОбщий вес багажа (кг)\n");
-    out << QString("=======================================================\n");
-
-    // Получаем все записи
-    QVector<BaggageRecord> records = getAllRecords();
-
-    // Записываем данные
-    for (const BaggageRecord& record : records) {
-        out << record.getFlightNumber() << "\t"
-            << record.getPassengerName() << "\t"
-            << QString::number(record.getTotalWeight(), 'f', 2) << "\n";
-
-        // Проверка ошибок записи
-        if (out.status() != QTextStream::Ok) {
-            m_lastError = "Ошибка записи в файл сводки: " + filename;
-            qWarning() << m_lastError;
-            file.close();
-            return false;
+    writer.write(QString("№ рейса\tФ.И.О. пассажира\tОбщий вес багажа (кг)\n"));
+    writer.write(QString("=======================================================\n"));
+
+    const qint64 totalRows = options.progress ? getRecordCount() : 0;
+    qint64 rowsWritten = 0;
+    bool cancelled = false;
+
+    // Общий вес считается и форматируется на стороне сервера
+    QString sql = R"(
+        SELECT br.flight_number, br.passenger_name,
+               COALESCE(SUM(bi.weight), 0)::numeric(10,2)::text AS total_weight
+        FROM baggage_records br
+        LEFT JOIN baggage_items bi ON bi.baggage_record_id = br.id
+        GROUP BY br.id
+        ORDER BY br.id
+    )";
+
+    const ReadRoute route = readRoute();
+    bool ok = streamQuery(route.db, sql, [&](const QSqlQuery& row) {
+        writer.write(row.value(0).toString().toUtf8());
+        writer.write('\t');
+        writer.write(row.value(1).toString().toUtf8());
+        writer.write('\t');
+        writer.write(row.value(2).toString().toUtf8());
+        writer.write('\n');
+
+        ++rowsWritten;
+        if (options.progress && rowsWritten % CURSOR_FETCH_SIZE == 0 &&
+            !options.progress(rowsWritten, totalRows)) {
+            cancelled = true;
         }
+        return !cancelled && !writer.hasError();
+    });
+
+    if (cancelled) {
+        writer.discard();
+        m_lastError.localData() = "Создание файла сводки отменено";
+        qDebug() << m_lastError.localData();
+        return false;
     }
 
-    file.close();
+    if (!ok) {
+        writer.discard();
+        // Повтор возможен, пока в файл не попало ни одной строки
+        if (rowsWritten == 0 && fallBackToPrimary(route, "createSummaryFile")) {
+            return createSummaryFile(filename, options);
+        }
+        return false;
+    }
 
-    // Проверка успешности закрытия файла
-    if (file.error() != QFileDevice::NoError) {
-        m_lastError = "Ошибка при закрытии файла: " + file.errorString();
-        qWarning() << m_lastError;
+    if (!writer.close()) {
+        m_lastError.localData() = "Ошибка записи в файл сводки: " + writer.errorString();
+        qWarning() << m_lastError.localData();
         return false;
     }
 
-    qDebug() << "Файл сводки успешно создан:" << filename;
+    if (options.progress) {
+        options.progress(rowsWritten, totalRows);
+    }
+
+    qDebug() << "Файл сводки успешно создан:" << filename << "строк:" << rowsWritten;
     return true;
 }
 
-// Функция 6: Добавить запись
-bool DatabaseManager::addRecord(const BaggageRecord& record) {
-    if (!record.isValid()) {
-        m_lastError = "Попытка добавить невалидную запись";
-        qWarning() << m_lastError;
+// Потоковое чтение выборки через серверный курсор
+bool DatabaseManager::streamQuery(const QString& selectSql,
+                                  const std::function<bool(const QSqlQuery&)>& rowHandler,
+                                  int fetchSize) {
+    return streamQuery(connection(), selectSql, rowHandler, fetchSize);
+}
+
+bool DatabaseManager::streamQuery(QSqlDatabase db, const QString& selectSql,
+                                  const std::function<bool(const QSqlQuery&)>& rowHandler,
+                                  int fetchSize) {
+    if (!db.isOpen()) {
+        m_lastError.localData() = "База данных не подключена";
+        qWarning() << m_lastError.localData();
         return false;
     }
 
-    // Проверка подключения к БД
-    if (!m_db.isOpen()) {
-        m_lastError = "База данных не подключена";
-        qWarning() << m_lastError;
+    // Курсор существует только внутри транзакции
+    if (!db.transaction()) {
+        m_lastError.localData() = "Не удалось начать транзакцию: " + db.lastError().text();
+        qWarning() << m_lastError.localData();
         return false;
     }
 
-    // ТРАНЗАКЦИЯ: начинаем транзакцию
-    if (!m_db.transaction()) {
-        m_lastError = "Не удалось начать транзакцию: " + m_db.lastError().text();
-        qWarning() << m_lastError;
+    QSqlQuery declareQuery(db);
+    if (!declareQuery.exec("DECLARE baggage_stream_cursor NO SCROLL CURSOR FOR " + selectSql)) {
+        m_lastError.localData() = "Ошибка открытия курсора: " + declareQuery.lastError().text();
+        qWarning() << m_lastError.localData();
+        db.rollback();
         return false;
     }
 
-    // Вставляем запись багажа
-    QSqlQuery query(m_db);
-    query.prepare("INSERT INTO baggage_records (flight_number, passenger_name) VALUES (?, ?) RETURNING id");
-    query.addBindValue(record.getFlightNumber());
-    query.addBindValue(record.getPassengerName());
+    QSqlQuery fetchQuery(db);
+    fetchQuery.setForwardOnly(true);
+    const QString fetchSql = QString("FETCH FORWARD %1 FROM baggage_stream_cursor").arg(fetchSize);
+
+    bool ok = true;
+    bool stopped = false;
+    while (!stopped) {
+        if (!fetchQuery.exec(fetchSql)) {
+            m_lastError.localData() = "Ошибка чтения курсора: " + fetchQuery.lastError().text();
+            qWarning() << m_lastError.localData();
+            ok = false;
+            break;
+        }
 
-    if (!query.exec()) {
-        m_lastError = "Ошибка добавления записи: " + query.lastError().text();
-        qWarning() << m_lastError;
-        m_db.rollback();
-        return false;
+        int fetched = 0;
+        while (fetchQuery.next()) {
+            ++fetched;
+            if (!rowHandler(fetchQuery)) {
+                stopped = true;
+                break;
+            }
+        }
+
+        if (fetched < fetchSize) {
+            break;
+        }
     }
 
-    // Получаем ID созданной записи
-    int recordId = -1;
-    if (query.next()) {
-        recordId = query.value(0).toInt();
+    fetchQuery.finish();
+    declareQuery.exec("CLOSE baggage_stream_cursor");
+
+    // Только чтение - транзакцию можно просто завершить
+    if (ok) {
+        db.commit();
     } else {
-        m_lastError = "Не удалось получить ID созданной записи";
-        qWarning() << m_lastError;
-        m_db.rollback();
-        return false;
+        db.rollback();
     }
+    return ok;
+}
 
-    // Вставляем вещи
-    QVector<double> weights = record.getItemWeights();
-    for (int i = 0; i < weights.size(); ++i) {
-        QSqlQuery itemQuery(m_db);
-        itemQuery.prepare("INSERT INTO baggage_items (baggage_record_id, item_number, weight) VALUES (?, ?, ?)");
-        itemQuery.addBindValue(recordId);
-        itemQuery.addBindValue(i + 1);
-        itemQuery.addBindValue(weights[i]);
+// Функция 6: Добавить запись
+bool DatabaseManager::addRecord(const BaggageRecord& record) {
+    if (!record.isValid()) {
+        m_lastError.localData() = "Попытка добавить невалидную запись";
+        qWarning() << m_lastError.localData();
+        return false;
+    }
 
-        if (!itemQuery.exec()) {
-            m_lastError = "Ошибка добавления вещи: " + itemQuery.lastError().text();
-            qWarning() << m_lastError;
-            m_db.rollback();
-            return false;
-        }
+    // Проверка подключения к БД
+    if (!connection().isOpen()) {
+        m_lastError.localData() = "База данных не подключена";
+        qWarning() << m_lastError.localData();
+        return false;
     }
 
-    // Фиксируем транзакцию
-    if (!m_db.commit()) {
-        m_lastError = "Не удалось зафиксировать транзакцию: " + m_db.lastError().text();
-        qWarning() << m_lastError;
-        m_db.rollback();
+    // Запись и вещи - одним вызовом add_baggage(): одна команда в автономной
+    // транзакции, время не зависит от числа вещей
+    QSqlQuery query = preparedQuery(connection(), ADD_BAGGAGE_SQL);
+    query.bindValue(0, record.getFlightNumber());
+    query.bindValue(1, record.getPassengerName());
+    query.bindValue(2, pgNumberArray(record.getItemWeights()));
+
+    if (!query.exec() || !query.next()) {
+        m_lastError.localData() = "Ошибка добавления записи: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
         return false;
     }
+    const int recordId = query.value(0).toInt();
+    query.finish();
 
-    qDebug() << "Запись и вещи успешно добавлены:" << record.getPassengerName();
+    noteWrite(connection());
+    qDebug() << "Запись и вещи успешно добавлены:" << record.getPassengerName() << "id" << recordId;
     return true;
 }
 
 // Функция 7: Удалить записи по номерам рейсов
 int DatabaseManager::deleteRecordsByFlightNumbers(const QStringList& flightNumbers) {
+    return deleteFlightsBatch(flightNumbers);
+}
+
+// Все части - в одной транзакции: рейсы удаляются все или ни один
+int DatabaseManager::deleteFlightsBatch(const QStringList& flightNumbers, QVector<int>* outcomes) {
+    if (outcomes) {
+        outcomes->fill(0, flightNumbers.size());
+    }
     if (flightNumbers.isEmpty()) {
         return 0;
     }
 
-    // Проверка подключения к БД
-    if (!m_db.isOpen()) {
-        m_lastError = "База данных не подключена";
-        qWarning() << m_lastError;
+    QSqlDatabase db = connection();
+    auto fail = [&](const QString& message, bool rollback) {
+        m_lastError.localData() = message;
+        qWarning() << m_lastError.localData();
+        if (rollback) {
+            db.rollback();
+        }
+        if (outcomes) {
+            outcomes->fill(-1);
+        }
         return 0;
+    };
+
+    // Проверка подключения к БД
+    if (!db.isOpen()) {
+        return fail("База данных не подключена", false);
     }
 
     // ТРАНЗАКЦИЯ: Начинаем транзакцию для атомарности операции
-    if (!m_db.transaction()) {
-        m_lastError = "Не удалось начать транзакцию: " + m_db.lastError().text();
-        qWarning() << m_lastError;
+    if (!db.transaction()) {
+        return fail("Не удалось начать транзакцию: " + db.lastError().text(), false);
+    }
+
+    // Один параметр-массив вместо списка IN (?, ?, ...)
+    QSqlQuery query = preparedQuery(db, DELETE_FLIGHTS_SQL);
+    QHash<QString, int> deletedByFlight;
+    int affectedRows = 0;
+    for (int start = 0; start < flightNumbers.size(); start += BATCH_CHUNK_SIZE) {
+        query.bindValue(0, pgTextArray(flightNumbers.mid(start, BATCH_CHUNK_SIZE)));
+        if (!query.exec()) {
+            return fail("Ошибка удаления записей: " + query.lastError().text(), true);
+        }
+        while (query.next()) {
+            const int count = query.value(1).toInt();
+            deletedByFlight[query.value(0).toString()] += count;
+            affectedRows += count;
+        }
+        query.finish();
+    }
+
+    // Фиксируем транзакцию
+    if (!db.commit()) {
+        return fail("Не удалось зафиксировать транзакцию: " + db.lastError().text(), true);
+    }
+
+    if (outcomes) {
+        for (int i = 0; i < flightNumbers.size(); ++i) {
+            (*outcomes)[i] = deletedByFlight.value(flightNumbers[i]);
+        }
+    }
+    noteWrite(db);
+    qDebug() << "Транзакция успешно выполнена. Удалено записей:" << affectedRows;
+    return affectedRows;
+}
+
+// Все части - в одной транзакции: рейсы закрываются все или ни один
+int DatabaseManager::closeFlights(const QStringList& flightNumbers, QVector<int>* outcomes) {
+    if (outcomes) {
+        outcomes->fill(0, flightNumbers.size());
+    }
+    if (flightNumbers.isEmpty()) {
         return 0;
     }
 
-    QSqlQuery query(m_db);
+    QSqlDatabase db = connection();
+    auto fail = [&](const QString& message, bool rollback) {
+        m_lastError.localData() = message;
+        qWarning() << m_lastError.localData();
+        if (rollback) {
+            db.rollback();
+        }
+        if (outcomes) {
+            outcomes->fill(-1);
+        }
+        return -1;
+    };
+
+    if (!db.isOpen()) {
+        return fail("База данных не подключена", false);
+    }
+    if (!db.transaction()) {
+        return fail("Не удалось начать транзакцию: " + db.lastError().text(), false);
+    }
+
+    QSqlQuery query = preparedQuery(db, CLOSE_FLIGHTS_SQL);
+    QHash<QString, int> archivedByFlight;
+    int archived = 0;
+    for (int start = 0; start < flightNumbers.size(); start += BATCH_CHUNK_SIZE) {
+        query.bindValue(0, pgTextArray(flightNumbers.mid(start, BATCH_CHUNK_SIZE)));
+        if (!query.exec()) {
+            return fail("Ошибка переноса рейсов в архив: " + query.lastError().text(), true);
+        }
+        while (query.next()) {
+            const int count = query.value(1).toInt();
+            archivedByFlight[query.value(0).toString()] += count;
+            archived += count;
+        }
+        query.finish();
+    }
+
+    if (!db.commit()) {
+        return fail("Не удалось зафиксировать транзакцию: " + db.lastError().text(), true);
+    }
 
-    // Формируем список placeholders
-    QStringList placeholders;
-    for (int i = 0; i < flightNumbers.size(); ++i) {
-        placeholders.append("?");
+    if (outcomes) {
+        for (int i = 0; i < flightNumbers.size(); ++i) {
+            (*outcomes)[i] = archivedByFlight.value(flightNumbers[i]);
+        }
     }
+    noteWrite(db);
+    qDebug() << "Рейсы закрыты. Перенесено в архив записей:" << archived;
+    return archived;
+}
 
-    QString sql = QString("DELETE FROM baggage_records WHERE flight_number IN (%1)")
-                      .arg(placeholders.join(", "));
+QVector<FlightStats> DatabaseManager::getClosedFlightStats() {
+    QVector<FlightStats> stats;
+    const ReadRoute route = readRoute();
+    QSqlQuery query(route.db);
+    if (!query.exec("SELECT flight_number, passenger_count, item_count, total_weight "
+                    "FROM closed_flights ORDER BY flight_number")) {
+        m_lastError.localData() = "Ошибка чтения итогов закрытых рейсов: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        if (fallBackToPrimary(route, "getClosedFlightStats")) {
+            return getClosedFlightStats();
+        }
+        return stats;
+    }
 
-    query.prepare(sql);
-    for (const QString& flightNumber : flightNumbers) {
-        query.addBindValue(flightNumber);
+    while (query.next()) {
+        FlightStats flight;
+        flight.flightNumber = query.value(0).toString();
+        flight.passengerCount = query.value(1).toInt();
+        flight.itemCount = query.value(2).toInt();
+        flight.totalWeight = query.value(3).toDouble();
+        stats.append(flight);
     }
+    return stats;
+}
+
+int DatabaseManager::resolveBagTag(qint64 tag, BagTagInfo* info) {
+    const ReadRoute route = readRoute();
+    QSqlQuery query = preparedQuery(route.db, RESOLVE_BAG_TAG_SQL);
+    query.bindValue(0, tag);
+    query.bindValue(1, tag);
+    query.bindValue(2, tag);
 
     if (!query.exec()) {
-        m_lastError = "Ошибка удаления записей: " + query.lastError().text();
-        qWarning() << m_lastError;
-        m_db.rollback();  // Откатываем изменения
+        m_lastError.localData() = "Ошибка поиска бирки: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        if (fallBackToPrimary(route, "resolveBagTag")) {
+            return resolveBagTag(tag, info);
+        }
+        return -1;
+    }
+    if (!query.next()) {
+        query.finish();
         return 0;
     }
 
-    int affectedRows = query.numRowsAffected();
+    if (info) {
+        info->tag = tag;
+        info->flightNumber = query.value(0).toString();
+        info->passengerName = query.value(1).toString();
+        info->itemNumber = query.value(2).toInt();
+        info->weight = query.value(3).toDouble();
+        info->archived = query.value(4).toBool();
+    }
+    query.finish();
+    return 1;
+}
 
-    // Фиксируем транзакцию
-    if (!m_db.commit()) {
-        m_lastError = "Не удалось зафиксировать транзакцию: " + m_db.lastError().text();
-        qWarning() << m_lastError;
-        m_db.rollback();
-        return 0;
+bool DatabaseManager::streamBagTags(const BagTagHandler& handler) {
+    const QString sql = R"(
+        SELECT bi.bag_tag, br.flight_number, br.passenger_name, bi.item_number, bi.weight
+        FROM baggage_items bi
+        JOIN baggage_records br ON br.id = bi.baggage_record_id
+    )";
+
+    const ReadRoute route = readRoute();
+    bool delivered = false;
+    bool ok = streamQuery(route.db, sql, [&handler, &delivered](const QSqlQuery& row) {
+        delivered = true;
+        BagTagInfo info;
+        info.tag = row.value(0).toLongLong();
+        info.flightNumber = row.value(1).toString();
+        info.passengerName = row.value(2).toString();
+        info.itemNumber = row.value(3).toInt();
+        info.weight = row.value(4).toDouble();
+        return handler(info);
+    });
+    if (!ok && !delivered && fallBackToPrimary(route, "streamBagTags")) {
+        return streamBagTags(handler);
     }
+    return ok;
+}
 
-    qDebug() << "Транзакция успешно выполнена. Удалено записей:" << affectedRows;
-    return affectedRows;
+bool DatabaseManager::reserveBagTags(qint64 first) {
+    QSqlQuery query(connection());
+    query.prepare("SELECT setval('bag_tag_seq', ?, false) "
+                  "WHERE (SELECT last_value FROM bag_tag_seq) < ?");
+    query.addBindValue(first);
+    query.addBindValue(first);
+    if (!query.exec()) {
+        m_lastError.localData() = "Ошибка настройки диапазона бирок: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        return false;
+    }
+    return true;
 }
 
 // Функция 8: Изменить количество вещей для указанных ФИО
 bool DatabaseManager::changeItemCountByName(const QString& passengerName,
                                            const QVector<double>& newWeights) {
     // Валидация входных данных
-    if (passengerName.trimmed().isEmpty()) {
-        m_lastError = "ФИО пассажира не может быть пустым";
+    const QString invalid = itemChangeError(passengerName, newWeights);
+    if (!invalid.isEmpty()) {
+        m_lastError.localData() = invalid;
         return false;
     }
 
-    if (!BaggageRecord::isValidItemCount(newWeights.size())) {
-        m_lastError = "Неверное количество вещей (должно быть от 1 до 5)";
+    // Проверка подключения к БД
+    if (!connection().isOpen()) {
+        m_lastError.localData() = "База данных не подключена";
+        qWarning() << m_lastError.localData();
         return false;
     }
 
-    for (double weight : newWeights) {
-        if (!BaggageRecord::isValidWeight(weight)) {
-            m_lastError = "Неверный вес вещи (должен быть от 0 до 100 кг)";
-            return false;
-        }
-    }
+    // Поиск записи, замена вещей и отметка времени - одним вызовом replace_items()
+    QSqlQuery query = preparedQuery(connection(), REPLACE_ITEMS_SQL);
+    query.bindValue(0, passengerName);
+    query.bindValue(1, pgNumberArray(newWeights));
 
-    // Проверка подключения к БД
-    if (!m_db.isOpen()) {
-        m_lastError = "База данных не подключена";
-        qWarning() << m_lastError;
+    if (!query.exec()) {
+        m_lastError.localData() = "Ошибка замены вещей: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
         return false;
     }
 
-    // ТРАНЗАКЦИЯ: Начинаем транзакцию
-    if (!m_db.transaction()) {
-        m_lastError = "Не удалось начать транзакцию: " + m_db.lastError().text();
-        qWarning() << m_lastError;
+    if (!query.next()) {
+        m_lastError.localData() = "Пассажир с указанным ФИО не найден";
         return false;
     }
+    query.finish();
 
-    // Получаем ID записи по ФИО
-    QSqlQuery findQuery(m_db);
-    findQuery.prepare("SELECT id FROM baggage_records WHERE passenger_name = ?");
-    findQuery.addBindValue(passengerName);
+    noteWrite(connection());
+    qDebug() << "Транзакция успешно выполнена. Обновлены веса для:" << passengerName;
+    return true;
+}
 
-    if (!findQuery.exec()) {
-        m_lastError = "Ошибка поиска записи: " + findQuery.lastError().text();
-        qWarning() << m_lastError;
-        m_db.rollback();
-        return false;
+// Первая запись каждого ФИО находится и помечается одним UPDATE ... FROM unnest(),
+// вещи заменяются двумя запросами над массивами - три запроса на часть пакета
+int DatabaseManager::changeItemsBatch(const QVector<ItemChange>& changes, QVector<int>* outcomes) {
+    QVector<int> result(changes.size(), 0);
+    QHash<QString, int> lastIndex;
+    for (int i = 0; i < changes.size(); ++i) {
+        lastIndex.insert(changes[i].first, i);
     }
 
-    if (!findQuery.next()) {
-        m_lastError = "Пассажир с указанным ФИО не найден";
-        m_db.rollback();
-        return false;
+    // Последнее изменение ФИО; неверные отбрасываются сразу
+    QVector<int> pending;
+    for (int i = 0; i < changes.size(); ++i) {
+        if (lastIndex.value(changes[i].first) != i) {
+            continue;
+        }
+        if (itemChangeError(changes[i].first, changes[i].second).isEmpty()) {
+            pending.append(i);
+        } else {
+            result[i] = -1;
+        }
     }
 
-    int recordId = findQuery.value(0).toInt();
+    auto finish = [&](int changed) {
+        if (outcomes) {
+            for (int i = 0; i < changes.size(); ++i) {
+                result[i] = result[lastIndex.value(changes[i].first)];
+            }
+            *outcomes = result;
+        }
+        return changed;
+    };
+    if (pending.isEmpty()) {
+        return finish(0);
+    }
 
-    // Удаляем старые вещи
-    QSqlQuery deleteQuery(m_db);
-    deleteQuery.prepare("DELETE FROM baggage_items WHERE baggage_record_id = ?");
-    deleteQuery.addBindValue(recordId);
+    QSqlDatabase db = connection();
+    auto fail = [&](const QString& message, bool rollback) {
+        m_lastError.localData() = message;
+        qWarning() << m_lastError.localData();
+        if (rollback) {
+            db.rollback();
+        }
+        for (int index : pending) {
+            result[index] = -1;
+        }
+        return finish(-1);
+    };
 
-    if (!deleteQuery.exec()) {
-        m_lastError = "Ошибка удаления старых вещей: " + deleteQuery.lastError().text();
-        qWarning() << m_lastError;
-        m_db.rollback();
-        return false;
+    if (!db.isOpen()) {
+        return fail("База данных не подключена", false);
     }
+    if (!db.transaction()) {
+        return fail("Не удалось начать транзакцию: " + db.lastError().text(), false);
+    }
+
+    QSqlQuery updateQuery = preparedQuery(db, MARK_FIRST_RECORDS_SQL);
+    QSqlQuery deleteQuery = preparedQuery(db, TRIM_ITEMS_SQL);
+    QSqlQuery insertQuery = preparedQuery(db, UPSERT_ITEMS_SQL);
+    int changed = 0;
+
+    for (int start = 0; start < pending.size(); start += BATCH_CHUNK_SIZE) {
+        const int end = qMin(start + BATCH_CHUNK_SIZE, pending.size());
+        QStringList names;
+        for (int k = start; k < end; ++k) {
+            names.append(changes[pending[k]].first);
+        }
 
-    // Вставляем новые вещи
-    for (int i = 0; i < newWeights.size(); ++i) {
-        QSqlQuery insertQuery(m_db);
-        insertQuery.prepare("INSERT INTO baggage_items (baggage_record_id, item_number, weight) VALUES (?, ?, ?)");
-        insertQuery.addBindValue(recordId);
-        insertQuery.addBindValue(i + 1);
-        insertQuery.addBindValue(newWeights[i]);
+        updateQuery.bindValue(0, pgTextArray(names));
+        if (!updateQuery.exec()) {
+            return fail("Ошибка поиска записей: " + updateQuery.lastError().text(), true);
+        }
+
+        QVector<qint64> recordIds;
+        QVector<int> itemCounts;
+        QVector<qint64> itemRecordIds;
+        QVector<int> itemNumbers;
+        QVector<double> itemWeights;
+        while (updateQuery.next()) {
+            const qint64 recordId = updateQuery.value(0).toLongLong();
+            // ord - номер ФИО в части, с 1
+            const int index = pending[start + updateQuery.value(1).toInt() - 1];
+            result[index] = 1;
+            recordIds.append(recordId);
+            const QVector<double>& weights = changes[index].second;
+            itemCounts.append(weights.size());
+            for (int w = 0; w < weights.size(); ++w) {
+                itemRecordIds.append(recordId);
+                itemNumbers.append(w + 1);
+                itemWeights.append(weights[w]);
+            }
+        }
+        updateQuery.finish();
+        if (recordIds.isEmpty()) {
+            continue;
+        }
 
+        deleteQuery.bindValue(0, pgNumberArray(recordIds));
+        deleteQuery.bindValue(1, pgNumberArray(itemCounts));
+        if (!deleteQuery.exec()) {
+            return fail("Ошибка удаления старых вещей: " + deleteQuery.lastError().text(), true);
+        }
+        insertQuery.bindValue(0, pgNumberArray(itemRecordIds));
+        insertQuery.bindValue(1, pgNumberArray(itemNumbers));
+        insertQuery.bindValue(2, pgNumberArray(itemWeights));
         if (!insertQuery.exec()) {
-            m_lastError = "Ошибка вставки новой вещи: " + insertQuery.lastError().text();
-            qWarning() << m_lastError;
-            m_db.rollback();
-            return false;
+            return fail("Ошибка вставки новых вещей: " + insertQuery.lastError().text(), true);
         }
+        changed += recordIds.size();
     }
 
-    // Обновляем updated_at
-    QSqlQuery updateQuery(m_db);
-    updateQuery.prepare("UPDATE baggage_records SET updated_at = CURRENT_TIMESTAMP WHERE id = ?");
-    updateQuery.addBindValue(recordId);
-    updateQuery.exec();
-
-    // Фиксируем транзакцию
-    if (!m_db.commit()) {
-        m_lastError = "Не удалось зафиксировать транзакцию: " + m_db.lastError().text();
-        qWarning() << m_lastError;
-        m_db.rollback();
-        return false;
+    if (!db.commit()) {
+        return fail("Не удалось зафиксировать транзакцию: " + db.lastError().text(), true);
     }
 
-    qDebug() << "Транзакция успешно выполнена. Обновлены веса для:" << passengerName;
-    return true;
+    noteWrite(db);
+    qDebug() << "Транзакция успешно выполнена. Обновлены веса пассажиров:" << changed;
+    return finish(changed);
 }
 
 void DatabaseManager::clearAllRecords() {
     // Проверка подключения к БД
-    if (!m_db.isOpen()) {
-        m_lastError = "База данных не подключена";
-        qWarning() << m_lastError;
+    if (!connection().isOpen()) {
+        m_lastError.localData() = "База данных не подключена";
+        qWarning() << m_lastError.localData();
         return;
     }
 
     // ТРАНЗАКЦИЯ: Начинаем транзакцию для безопасного удаления всех записей
-    if (!m_db.transaction()) {
-        m_lastError = "Не удалось начать транзакцию: " + m_db.lastError().text();
-        qWarning() << m_lastError;
+    if (!connection().transaction()) {
+        m_lastError.localData() = "Не удалось начать транзакцию: " + connection().lastError().text();
+        qWarning() << m_lastError.localData();
         return;
     }
 
-    QSqlQuery query(m_db);
+    QSqlQuery query(connection());
     if (!query.exec("DELETE FROM baggage_records")) {
-        m_lastError = "Ошибка очистки таблицы: " + query.lastError().text();
-        qWarning() << m_lastError;
-        m_db.rollback();  // Откатываем изменения
+        m_lastError.localData() = "Ошибка очистки таблицы: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        connection().rollback();  // Откатываем изменения
         return;
     }
 
     // Фиксируем транзакцию
-    if (!m_db.commit()) {
-        m_lastError = "Не удалось зафиксировать транзакцию: " + m_db.lastError().text();
-        qWarning() << m_lastError;
-        m_db.rollback();
+    if (!connection().commit()) {
+        m_lastError.localData() = "Не удалось зафиксировать транзакцию: " + connection().lastError().text();
+        qWarning() << m_lastError.localData();
+        connection().rollback();
         return;
     }
 
+    noteWrite(connection());
     qDebug() << "Транзакция успешно выполнена. Все записи удалены.";
 }
 
+qint64 DatabaseManager::getDataVersion(int* recordCount) {
+    QSqlQuery query(connection());
+    if (!query.exec(QString("SELECT %1, COUNT(*) FROM baggage_records").arg(DATA_VERSION_SQL))
+        || !query.next()) {
+        m_lastError.localData() = "Ошибка чтения версии данных: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        return -1;
+    }
+    if (recordCount) {
+        *recordCount = query.value(1).toInt();
+    }
+    return query.value(0).toLongLong();
+}
+
+int DatabaseManager::countPassengerChangesSince(const QString& passengerName, qint64 version) {
+    QSqlQuery query = preparedQuery(
+        connection(),
+        "SELECT COUNT(*) FROM baggage_records WHERE passenger_name = ? AND row_version > ?");
+    query.bindValue(0, passengerName);
+    query.bindValue(1, version);
+    if (!query.exec() || !query.next()) {
+        m_lastError.localData() = "Ошибка проверки изменений пассажира: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        return -1;
+    }
+    const int count = query.value(0).toInt();
+    query.finish();
+    return count;
+}
+
+int DatabaseManager::countFlightChangesSince(const QStringList& flightNumbers, qint64 version) {
+    QSqlQuery query = preparedQuery(connection(),
+                                    "SELECT COUNT(*) FROM baggage_records "
+                                    "WHERE flight_number = ANY(?::text[]) AND row_version > ?");
+    query.bindValue(0, pgTextArray(flightNumbers));
+    query.bindValue(1, version);
+    if (!query.exec() || !query.next()) {
+        m_lastError.localData() = "Ошибка проверки изменений рейсов: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        return -1;
+    }
+    const int count = query.value(0).toInt();
+    query.finish();
+    return count;
+}
+
+bool DatabaseManager::getRecordsChangedSince(qint64 version, QVector<BaggageRecord>* records,
+                                             qint64* dataVersion, int* recordCount) {
+    // Основной сервер: после догоняющего чтения стойка сверяет версии с ним же
+    QSqlDatabase db = connection();
+    if (!db.transaction()) {
+        m_lastError.localData() = "Не удалось начать транзакцию: " + db.lastError().text();
+        qWarning() << m_lastError.localData();
+        return false;
+    }
+
+    // Версия, число записей и изменения - из одного снимка БД
+    QSqlQuery versionQuery(db);
+    versionQuery.exec("SET TRANSACTION ISOLATION LEVEL REPEATABLE READ");
+    if (!versionQuery.exec(QString("SELECT %1, COUNT(*) FROM baggage_records").arg(DATA_VERSION_SQL))
+        || !versionQuery.next()) {
+        m_lastError.localData() = "Ошибка чтения версии данных: " + versionQuery.lastError().text();
+        qWarning() << m_lastError.localData();
+        db.rollback();
+        return false;
+    }
+    *dataVersion = versionQuery.value(0).toLongLong();
+    *recordCount = versionQuery.value(1).toInt();
+
+    QSqlQuery query = preparedQuery(db, CHANGED_RECORDS_SQL);
+    query.bindValue(0, version);
+    if (!query.exec()) {
+        m_lastError.localData() = "Ошибка чтения изменённых записей: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        db.rollback();
+        return false;
+    }
+    *records = groupItemRows(query);
+    db.commit();
+
+    qDebug() << "Изменённых записей после версии" << version << ":" << records->size();
+    return true;
+}
+
 int DatabaseManager::getRecordCount() {
-    QSqlQuery query(m_db);
+    QSqlQuery query(connection());
     if (!query.exec("SELECT COUNT(*) FROM baggage_records")) {
-        m_lastError = "Ошибка подсчета записей: " + query.lastError().text();
-        qWarning() << m_lastError;
+        m_lastError.localData() = "Ошибка подсчета записей: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
         return 0;
     }
 
@@ -523,81 +1726,346 @@ int DatabaseManager::getRecordCount() {
     return 0;
 }
 
+// Поиск идёт и по рабочей таблице, и по архиву закрытых рейсов
 QVector<BaggageRecord> DatabaseManager::findRecordsByFlightNumber(const QString& flightNumber) {
     QVector<BaggageRecord> records;
-    QSqlQuery query(m_db);
-
-    query.prepare("SELECT id, flight_number, passenger_name FROM baggage_records WHERE flight_number = ?");
-    query.addBindValue(flightNumber);
+    m_lastError.localData().clear();
+    const ReadRoute route = readRoute();
+    QSqlQuery query = preparedQuery(route.db, recordsWithArchiveSql("flight_number = ?", "id"));
+    query.bindValue(0, flightNumber);
+    query.bindValue(1, flightNumber);
 
     if (!query.exec()) {
-        m_lastError = "Ошибка поиска по номеру рейса: " + query.lastError().text();
-        qWarning() << m_lastError;
+        m_lastError.localData() = "Ошибка поиска по номеру рейса: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        if (fallBackToPrimary(route, "findRecordsByFlightNumber")) {
+            return findRecordsByFlightNumber(flightNumber);
+        }
         return records;
     }
 
     while (query.next()) {
-        int recordId = query.value("id").toInt();
-        QString flightNum = query.value("flight_number").toString();
-        QString passengerName = query.value("passenger_name").toString();
-        QVector<double> weights = getItemWeights(recordId);
-
-        records.append(BaggageRecord(flightNum, passengerName, weights));
+        records.append(recordFromAggregateRow(query));
     }
+    query.finish();
 
     return records;
 }
 
 QVector<BaggageRecord> DatabaseManager::findRecordsByPassengerName(const QString& passengerName) {
     QVector<BaggageRecord> records;
-    QSqlQuery query(m_db);
-
-    query.prepare("SELECT id, flight_number, passenger_name FROM baggage_records WHERE passenger_name = ?");
-    query.addBindValue(passengerName);
+    m_lastError.localData().clear();
+    const ReadRoute route = readRoute();
+    QSqlQuery query = preparedQuery(route.db, recordsWithArchiveSql("passenger_name = ?", "id"));
+    query.bindValue(0, passengerName);
+    query.bindValue(1, passengerName);
 
     if (!query.exec()) {
-        m_lastError = "Ошибка поиска по ФИО: " + query.lastError().text();
-        qWarning() << m_lastError;
+        m_lastError.localData() = "Ошибка поиска по ФИО: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        if (fallBackToPrimary(route, "findRecordsByPassengerName")) {
+            return findRecordsByPassengerName(passengerName);
+        }
         return records;
     }
 
     while (query.next()) {
-        int recordId = query.value("id").toInt();
-        QString flightNumber = query.value("flight_number").toString();
-        QString passName = query.value("passenger_name").toString();
-        QVector<double> weights = getItemWeights(recordId);
+        records.append(recordFromAggregateRow(query));
+    }
+    query.finish();
+
+    return records;
+}
+
+// Сразу после изменения: основной сервер, а не реплика
+QVector<BaggageRecord> DatabaseManager::findOpenRecordsByPassengerName(const QString& passengerName) {
+    QVector<BaggageRecord> records;
+    m_lastError.localData().clear();
+    QSqlQuery query = preparedQuery(connection(), OPEN_RECORDS_BY_NAME_SQL);
+    query.bindValue(0, passengerName);
 
-        records.append(BaggageRecord(flightNumber, passName, weights));
+    if (!query.exec()) {
+        m_lastError.localData() = "Ошибка поиска по ФИО: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        return records;
     }
 
+    while (query.next()) {
+        records.append(recordFromAggregateRow(query));
+    }
+    query.finish();
+
     return records;
 }
 
 QVector<BaggageRecord> DatabaseManager::getRecordsByDateRange(const QDateTime& from, const QDateTime& to) {
     QVector<BaggageRecord> records;
-    QSqlQuery query(m_db);
+    const ReadRoute route = readRoute();
+    QSqlQuery query = preparedQuery(route.db,
+                                    recordsWithArchiveSql("created_at BETWEEN ? AND ?", "created_at, id"));
+    query.bindValue(0, from);
+    query.bindValue(1, to);
+    query.bindValue(2, from);
+    query.bindValue(3, to);
+
+    if (!query.exec()) {
+        m_lastError.localData() = "Ошибка получения записей за период: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        if (fallBackToPrimary(route, "getRecordsByDateRange")) {
+            return getRecordsByDateRange(from, to);
+        }
+        return records;
+    }
+
+    while (query.next()) {
+        records.append(recordFromAggregateRow(query));
+    }
+    query.finish();
+
+    return records;
+}
 
-    query.prepare("SELECT id, flight_number, passenger_name "
-                 "FROM baggage_records "
-                 "WHERE created_at BETWEEN ? AND ? "
-                 "ORDER BY created_at");
+QVector<FlightStats> DatabaseManager::getFlightStatsByDateRange(const QDateTime& from, const QDateTime& to) {
+    QVector<FlightStats> stats;
+    m_lastError.localData().clear();
+    const ReadRoute route = readRoute();
+    QSqlQuery query(route.db);
+
+    // Итоги по записям рабочей таблицы и архива, затем по рейсам
+    query.prepare(R"(
+        SELECT flight_number, COUNT(*), SUM(item_count), SUM(total_weight)
+        FROM (
+            SELECT br.flight_number, COUNT(bi.id) AS item_count,
+                   COALESCE(SUM(bi.weight), 0) AS total_weight
+            FROM baggage_records br
+            LEFT JOIN baggage_items bi ON bi.baggage_record_id = br.id
+            WHERE br.created_at BETWEEN ? AND ?
+            GROUP BY br.id
+            UNION ALL
+            SELECT flight_number, cardinality(weights),
+                   (SELECT COALESCE(SUM(w), 0) FROM unnest(weights) AS w)
+            FROM baggage_archive
+            WHERE created_at BETWEEN ? AND ?
+        ) AS records
+        GROUP BY flight_number
+        ORDER BY flight_number
+    )");
+    query.addBindValue(from);
+    query.addBindValue(to);
     query.addBindValue(from);
     query.addBindValue(to);
 
     if (!query.exec()) {
-        m_lastError = "Ошибка получения записей за период: " + query.lastError().text();
-        qWarning() << m_lastError;
-        return records;
+        m_lastError.localData() = "Ошибка получения статистики за период: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        if (fallBackToPrimary(route, "getFlightStatsByDateRange")) {
+            return getFlightStatsByDateRange(from, to);
+        }
+        return stats;
     }
 
     while (query.next()) {
-        int recordId = query.value("id").toInt();
-        QString flightNumber = query.value("flight_number").toString();
-        QString passengerName = query.value("passenger_name").toString();
-        QVector<double> weights = getItemWeights(recordId);
+        FlightStats flight;
+        flight.flightNumber = query.value(0).toString();
+        flight.passengerCount = query.value(1).toInt();
+        flight.itemCount = query.value(2).toInt();
+        flight.totalWeight = query.value(3).toDouble();
+        stats.append(flight);
+    }
 
-        records.append(BaggageRecord(flightNumber, passengerName, weights));
+    return stats;
+}
+
+// Потоковое чтение записей за период (без накопления в памяти)
+bool DatabaseManager::streamRecordsByDateRange(const QDateTime& from, const QDateTime& to,
+                                               const RecordHandler& recordHandler) {
+    // DECLARE CURSOR не поддерживает параметры - значения экранирует драйвер
+    const QString sql = recordsWithArchiveSql(
+        QString("created_at BETWEEN %1 AND %2").arg(sqlLiteral(from), sqlLiteral(to)), "created_at, id");
+
+    const ReadRoute route = readRoute();
+    bool delivered = false;
+    bool ok = streamQuery(route.db, sql, [&recordHandler, &delivered](const QSqlQuery& row) {
+        delivered = true;
+        return recordHandler(recordFromAggregateRow(row));
+    });
+    // Повтор возможен, пока обработчик не получил ни одной записи
+    if (!ok && !delivered && fallBackToPrimary(route, "streamRecordsByDateRange")) {
+        return streamRecordsByDateRange(from, to, recordHandler);
     }
+    return ok;
+}
 
-    return records;
+bool DatabaseManager::streamRecords(const QStringList& flightNumbers,
+                                    const RecordHandler& recordHandler) {
+    QString where;
+    if (!flightNumbers.isEmpty()) {
+        where = QString("WHERE br.flight_number = ANY(%1::text[])").arg(sqlLiteral(pgTextArray(flightNumbers)));
+    }
+
+    QString sql = QString(R"(
+        SELECT br.flight_number, br.passenger_name,
+               string_agg(bi.weight::text, ',' ORDER BY bi.item_number) AS weights
+        FROM baggage_records br
+        LEFT JOIN baggage_items bi ON bi.baggage_record_id = br.id
+        %1
+        GROUP BY br.id
+        ORDER BY br.flight_number, br.id
+    )").arg(where);
+
+    return streamQuery(sql, [&recordHandler](const QSqlQuery& row) {
+        return recordHandler(recordFromAggregateRow(row));
+    });
+}
+
+// Строка вида (рейс, ФИО, "вес1,вес2,...") -> запись
+BaggageRecord DatabaseManager::recordFromAggregateRow(const QSqlQuery& row) {
+    QVector<double> weights;
+    const QStringList parts = row.value(2).toString().split(',', Qt::SkipEmptyParts);
+    weights.reserve(parts.size());
+    for (const QString& part : parts) {
+        weights.append(part.toDouble());
+    }
+    return BaggageRecord(row.value(0).toString(), row.value(1).toString(), weights);
+}
+
+// Экранирование значения средствами драйвера (для запросов без параметров)
+QString DatabaseManager::sqlLiteral(const QVariant& value) const {
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    QSqlField field(QString(), value.metaType());
+#else
+    QSqlField field(QString(), value.type());
+#endif
+    field.setValue(value);
+    return m_db.driver()->formatValue(field);
+}
+
+QSqlDatabase DatabaseManager::openWorkerConnection(const QString& connectionName) {
+    QSqlDatabase db = QSqlDatabase::cloneDatabase(m_db.connectionName(), connectionName);
+    if (!db.open()) {
+        qWarning() << "Ошибка подключения рабочего потока к БД:" << db.lastError().text();
+    }
+    return db;
+}
+
+void DatabaseManager::closeWorkerConnection(const QString& connectionName) {
+    {
+        QSqlDatabase db = QSqlDatabase::database(connectionName, false);
+        if (db.isOpen()) {
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+// Пакетная вставка: id выделяются заранее, затем записи и вещи
+// вставляются через unnest() массивов - по одному запросу на таблицу
+bool DatabaseManager::insertRecordsBatch(QSqlDatabase& db, const QVector<BaggageRecord>& records,
+                                         QString* error, bool ownTransaction) {
+    if (records.isEmpty()) {
+        return true;
+    }
+
+    auto fail = [&db, error, ownTransaction](const QString& message) {
+        if (error) {
+            *error = message;
+        }
+        qWarning() << message;
+        if (ownTransaction) {
+            db.rollback();
+        }
+        return false;
+    };
+
+    if (ownTransaction && !db.transaction()) {
+        if (error) {
+            *error = "Не удалось начать транзакцию: " + db.lastError().text();
+        }
+        return false;
+    }
+
+    QSqlQuery idQuery(db);
+    idQuery.setForwardOnly(true);
+    idQuery.prepare("SELECT nextval('baggage_records_id_seq') FROM generate_series(1, ?)");
+    idQuery.addBindValue(records.size());
+    if (!idQuery.exec()) {
+        return fail("Ошибка выделения id записей: " + idQuery.lastError().text());
+    }
+
+    QVector<qint64> recordIds;
+    recordIds.reserve(records.size());
+    while (idQuery.next()) {
+        recordIds.append(idQuery.value(0).toLongLong());
+    }
+    if (recordIds.size() != records.size()) {
+        return fail("Не удалось выделить id для всех записей");
+    }
+
+    QStringList flightNumbers;
+    QStringList passengerNames;
+    QVector<qint64> itemRecordIds;
+    QVector<int> itemNumbers;
+    QVector<double> itemWeights;
+    for (int i = 0; i < records.size(); ++i) {
+        flightNumbers.append(records[i].getFlightNumber());
+        passengerNames.append(records[i].getPassengerName());
+        const QVector<double> weights = records[i].getItemWeights();
+        for (int w = 0; w < weights.size(); ++w) {
+            itemRecordIds.append(recordIds[i]);
+            itemNumbers.append(w + 1);
+            itemWeights.append(weights[w]);
+        }
+    }
+
+    QSqlQuery recordsQuery(db);
+    recordsQuery.prepare("INSERT INTO baggage_records (id, flight_number, passenger_name) "
+                         "SELECT * FROM unnest(?::int[], ?::text[], ?::text[])");
+    recordsQuery.addBindValue(pgNumberArray(recordIds));
+    recordsQuery.addBindValue(pgTextArray(flightNumbers));
+    recordsQuery.addBindValue(pgTextArray(passengerNames));
+    if (!recordsQuery.exec()) {
+        return fail("Ошибка пакетной вставки записей: " + recordsQuery.lastError().text());
+    }
+
+    QSqlQuery itemsQuery(db);
+    itemsQuery.prepare("INSERT INTO baggage_items (baggage_record_id, item_number, weight) "
+                       "SELECT * FROM unnest(?::int[], ?::int[], ?::numeric[])");
+    itemsQuery.addBindValue(pgNumberArray(itemRecordIds));
+    itemsQuery.addBindValue(pgNumberArray(itemNumbers));
+    itemsQuery.addBindValue(pgNumberArray(itemWeights));
+    if (!itemsQuery.exec()) {
+        return fail("Ошибка пакетной вставки вещей: " + itemsQuery.lastError().text());
+    }
+
+    if (ownTransaction && !db.commit()) {
+        return fail("Не удалось зафиксировать транзакцию: " + db.lastError().text());
+    }
+    return true;
+}
+
+bool DatabaseManager::addRecordsBatch(const QVector<BaggageRecord>& records) {
+    QSqlDatabase db = connection();
+    QString error;
+    if (!insertRecordsBatch(db, records, &error)) {
+        m_lastError.localData() = error;
+        return false;
+    }
+    noteWrite(db);
+    return true;
+}
+
+QString DatabaseManager::pgTextArray(const QStringList& values) {
+    QString result = "{";
+    for (int i = 0; i < values.size(); ++i) {
+        if (i > 0) {
+            result += ',';
+        }
+        QString escaped = values[i];
+        escaped.replace('\\', "\\\\").replace('"', "\\\"");
+        result += '"';
+        result += escaped;
+        result += '"';
+    }
+    result += '}';
+    return result;
 }
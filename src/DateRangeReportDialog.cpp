@@ -1,15 +1,12 @@
 #include "DateRangeReportDialog.h"
-#include "DatabaseManager.h"
+#include "ReportWriter.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QFormLayout>
 #include <QGroupBox>
 #include <QFileDialog>
 #include <QMessageBox>
-#include <QTextStream>
-#include <QFile>
 #include <QDebug>
-#include <QSet>
 
 DateRangeReportDialog::DateRangeReportDialog(QWidget *parent)
     : QDialog(parent) {
@@ -96,11 +93,17 @@ void DateRangeReportDialog::onGenerateReport() {
         return;
     }
 
-    // Получение записей за период из БД
-    DatabaseManager& dbManager = DatabaseManager::instance();
-    QVector<BaggageRecord> records = dbManager.getRecordsByDateRange(fromDate, toDate);
+    // Предпросмотр: в окно попадают только первые PREVIEW_LINES строк
+    DateRangeReportWriter reportWriter(fromDate, toDate);
+    PreviewReportSink preview(PREVIEW_LINES);
 
-    if (records.isEmpty()) {
+    if (!reportWriter.write(preview)) {
+        showStatus("Ошибка формирования отчёта: " + reportWriter.errorString(), true);
+        m_exportButton->setEnabled(false);
+        return;
+    }
+
+    if (reportWriter.recordCount() == 0) {
         showStatus("За указанный период записей не найдено", true);
         m_reportTextEdit->setPlainText("За период с " +
             fromDate.toString("dd.MM.yyyy HH:mm") + " по " +
@@ -110,19 +113,26 @@ void DateRangeReportDialog::onGenerateReport() {
         return;
     }
 
-    // Генерация текста отчёта
-    m_currentReport = generateReportText(records, fromDate, toDate);
-    m_reportTextEdit->setPlainText(m_currentReport);
+    QString previewText = preview.text();
+    if (preview.isTruncated()) {
+        previewText += QString("\n\n... показаны первые %1 строк. "
+                               "Полный отчёт доступен через экспорт в файл.")
+                           .arg(preview.maxLines());
+    }
+    m_reportTextEdit->setPlainText(previewText);
+
+    m_reportFrom = fromDate;
+    m_reportTo = toDate;
 
-    showStatus(QString("Отчёт сформирован: найдено записей - %1").arg(records.size()), false);
+    showStatus(QString("Отчёт сформирован: найдено записей - %1").arg(reportWriter.recordCount()), false);
     m_exportButton->setEnabled(true);
 
     qDebug() << "Отчёт сформирован за период:" << fromDate << "-" << toDate
-             << "Записей:" << records.size();
+             << "Записей:" << reportWriter.recordCount();
 }
 
 void DateRangeReportDialog::onExportToFile() {
-    if (m_currentReport.isEmpty()) {
+    if (!m_reportFrom.isValid() || !m_reportTo.isValid()) {
         QMessageBox::warning(this, "Ошибка", "Нет данных для экспорта. Сформируйте отчёт.");
         return;
     }
@@ -138,115 +148,29 @@ void DateRangeReportDialog::onExportToFile() {
         return;
     }
 
-    QFile file(fileName);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QMessageBox::critical(this, "Ошибка", "Не удалось создать файл:\n" + file.errorString());
+    FileReportSink fileSink;
+    if (!fileSink.open(fileName)) {
+        QMessageBox::critical(this, "Ошибка", "Не удалось создать файл:\n" + fileSink.errorString());
         return;
     }
 
-    QTextStream out(&file);
-    out.setEncoding(QStringConverter::Utf8);
-    out << m_currentReport;
-    file.close();
-
-    QMessageBox::information(this, "Успех",
-        "Отчёт успешно экспортирован в файл:\n" + fileName);
-    qDebug() << "Отчёт экспортирован в файл:" << fileName;
-}
-
-QString DateRangeReportDialog::generateReportText(const QVector<BaggageRecord>& records,
-                                                  const QDateTime& from,
-                                                  const QDateTime& to) {
-    QString report;
-    QTextStream stream(&report);
-
-    // Заголовок отчёта
-    stream << "========================================\n";
-    stream << "   ОТЧЁТ ЗА ПЕРИОД ВРЕМЕНИ\n";
-    stream << "========================================\n\n";
-
-    stream << "Период: с " << from.toString("dd.MM.yyyy HH:mm")
-           << " по " << to.toString("dd.MM.yyyy HH:mm") << "\n";
-    stream << "Дата формирования: " << QDateTime::currentDateTime().toString("dd.MM.yyyy HH:mm:ss") << "\n\n";
-
-    if (records.isEmpty()) {
-        stream << "----------------------------------------\n";
-        stream << "ЗА УКАЗАННЫЙ ПЕРИОД ЗАПИСЕЙ НЕ НАЙДЕНО\n";
-        stream << "----------------------------------------\n";
-        return report;
-    }
-
-    // Общая статистика
-    stream << "----------------------------------------\n";
-    stream << "ОБЩАЯ СТАТИСТИКА:\n";
-    stream << "----------------------------------------\n";
-    stream << "Количество записей: " << records.size() << "\n";
-
-    // Подсчёт общего веса и количества вещей
-    double totalWeight = 0.0;
-    int totalItems = 0;
-    QSet<QString> uniqueFlights;
-
-    for (const auto& record : records) {
-        totalWeight += record.getTotalWeight();
-        totalItems += record.getItemWeights().size();
-        uniqueFlights.insert(record.getFlightNumber());
+    // Полный отчёт пишется в файл потоком прямо из курсора БД
+    DateRangeReportWriter reportWriter(m_reportFrom, m_reportTo);
+    if (!reportWriter.write(fileSink)) {
+        fileSink.discard();
+        QMessageBox::critical(this, "Ошибка",
+            "Ошибка формирования отчёта:\n" + reportWriter.errorString());
+        return;
     }
 
-    stream << "Общий вес багажа: " << QString::number(totalWeight, 'f', 2) << " кг\n";
-    stream << "Общее количество вещей: " << totalItems << "\n";
-    stream << "Количество уникальных рейсов: " << uniqueFlights.size() << "\n\n";
-
-    // Список уникальных рейсов
-    stream << "----------------------------------------\n";
-    stream << "СПИСОК РЕЙСОВ:\n";
-    stream << "----------------------------------------\n";
-    QStringList flightList = uniqueFlights.values();
-    flightList.sort();
-    for (const QString& flight : flightList) {
-        // Подсчитываем количество записей для каждого рейса
-        int count = 0;
-        double flightWeight = 0.0;
-        for (const auto& record : records) {
-            if (record.getFlightNumber() == flight) {
-                count++;
-                flightWeight += record.getTotalWeight();
-            }
-        }
-        stream << QString("  %1 - пассажиров: %2, вес: %3 кг\n")
-                  .arg(flight, -10)
-                  .arg(count, 3)
-                  .arg(flightWeight, 0, 'f', 2);
-    }
-    stream << "\n";
-
-    // Детальный список записей
-    stream << "----------------------------------------\n";
-    stream << "ДЕТАЛЬНЫЙ СПИСОК ЗАПИСЕЙ:\n";
-    stream << "----------------------------------------\n";
-    stream << QString("%1 | %2 | %3 | %4 | %5\n")
-              .arg("№", -5)
-              .arg("Рейс", -10)
-              .arg("Пассажир", -30)
-              .arg("Вещей", -7)
-              .arg("Общий вес", -12);
-    stream << QString("-").repeated(80) << "\n";
-
-    for (int i = 0; i < records.size(); ++i) {
-        const auto& record = records[i];
-        stream << QString("%1 | %2 | %3 | %4 | %5 кг\n")
-                  .arg(i + 1, -5)
-                  .arg(record.getFlightNumber(), -10)
-                  .arg(record.getPassengerName(), -30)
-                  .arg(record.getItemWeights().size(), -7)
-                  .arg(record.getTotalWeight(), -10, 'f', 2);
+    if (!fileSink.close()) {
+        QMessageBox::critical(this, "Ошибка", "Ошибка записи файла:\n" + fileSink.errorString());
+        return;
     }
 
-    stream << "\n========================================\n";
-    stream << "   КОНЕЦ ОТЧЁТА\n";
-    stream << "========================================\n";
-
-    return report;
+    QMessageBox::information(this, "Успех",
+        "Отчёт успешно экспортирован в файл:\n" + fileName);
+    qDebug() << "Отчёт экспортирован в файл:" << fileName;
 }
 
 void DateRangeReportDialog::showStatus(const QString& message, bool isError) {
@@ -0,0 +1,188 @@
+#include "DeskReconciler.h"
+#include "StorageEngine.h"
+#include "JournalReplayer.h"
+#include "BaggageSnapshot.h"
+#include <QTimer>
+#include <QFile>
+#include <QDateTime>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QDebug>
+
+DeskReconciler::DeskReconciler(MutationJournal* journal, QObject* parent)
+    : QObject(parent), m_journal(journal), m_timer(nullptr), m_online(false),
+      m_reconcileQueued(false), m_tablesReady(false), m_lastVersion(-1), m_lastCount(-1) {
+    qRegisterMetaType<QVector<BaggageRecord>>("QVector<BaggageRecord>");
+    m_thread.setObjectName("DeskReconciler");
+}
+
+DeskReconciler::~DeskReconciler() {
+    stop();
+}
+
+void DeskReconciler::start(int intervalMs) {
+    if (m_thread.isRunning()) {
+        return;
+    }
+
+    // Таймер живёт в потоке сверки: его слоты выполняются там же
+    m_timer = new QTimer();
+    m_timer->setInterval(qMax(100, intervalMs));
+    m_timer->moveToThread(&m_thread);
+    connect(m_timer, &QTimer::timeout, m_timer, [this]() { reconcile(); });
+    connect(&m_thread, &QThread::started, m_timer, [this]() {
+        m_timer->start();
+        reconcile();
+    });
+    connect(&m_thread, &QThread::finished, m_timer, &QObject::deleteLater);
+    m_thread.start();
+}
+
+void DeskReconciler::stop() {
+    if (!m_thread.isRunning()) {
+        return;
+    }
+
+    QMetaObject::invokeMethod(m_timer, [this]() {
+        m_timer->stop();
+        StorageEngine::current().releaseThreadConnection();
+    }, Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+    m_timer = nullptr;
+}
+
+void DeskReconciler::reconcileNow() {
+    if (!m_timer || m_reconcileQueued.exchange(true)) {
+        return;
+    }
+    QMetaObject::invokeMethod(m_timer, [this]() { reconcile(); }, Qt::QueuedConnection);
+}
+
+QString DeskReconciler::conflictLogPath() const {
+    return m_journal->fileName() + ".conflicts";
+}
+
+void DeskReconciler::reconcile() {
+    m_reconcileQueued = false;
+    StorageEngine& db = StorageEngine::current();
+
+    if (!db.checkConnection()) {
+        setOnline(false);
+        return;
+    }
+    const bool cameOnline = !m_online.load();
+
+    // При старте без связи таблицы создаются при первом подключении
+    if (!m_tablesReady) {
+        m_tablesReady = db.createTable();
+    }
+
+    int drained = 0;
+    if (m_journal->pendingCount() > 0) {
+        QVector<JournalReplayer::Skipped> skipped;
+        drained = JournalReplayer::drain(*m_journal, &skipped);
+        if (!skipped.isEmpty()) {
+            writeConflictLog(skipped);
+            int conflicts = 0;
+            QString firstError;
+            for (const JournalReplayer::Skipped& item : skipped) {
+                if (item.result == JournalReplayer::Conflict) {
+                    ++conflicts;
+                } else if (firstError.isEmpty()) {
+                    firstError = item.error;
+                }
+            }
+            if (conflicts > 0) {
+                emit conflictsDetected(conflicts, conflictLogPath());
+            }
+            if (conflicts < skipped.size()) {
+                emit changesRejected(skipped.size() - conflicts, firstError, conflictLogPath());
+            }
+        }
+    }
+
+    int count = 0;
+    qint64 version = db.getDataVersion(&count);
+    if (version < 0) {
+        setOnline(false);
+        return;
+    }
+    setOnline(true);
+
+    // Данные не менялись - читать все записи незачем
+    if (drained == 0 && !cameOnline && version == m_lastVersion && count == m_lastCount) {
+        return;
+    }
+
+    // Журнал переносится только этим потоком: всё до первой неприменённой записи уже в БД
+    const quint64 lastSequence = m_journal->lastSequence();
+    const QVector<MutationJournal::Entry> pending = m_journal->pendingEntries();
+    const quint64 appliedThrough = pending.isEmpty() ? lastSequence : pending.first().sequence - 1;
+
+    qint64 dataVersion = -1;
+    QVector<BaggageRecord> records = db.getAllRecords(&dataVersion);
+    if (dataVersion < 0) {
+        return;   // повтор на следующем такте
+    }
+    m_lastVersion = dataVersion;
+    m_lastCount = records.size();
+
+    // Снимок - только состояние БД: изменения журнала накладываются при старте
+    QString error;
+    if (!BaggageSnapshot::write(BaggageSnapshot::lastSnapshotPath(), records, &error, dataVersion)) {
+        qWarning() << error;
+    }
+    emit stateReconciled(records, dataVersion, appliedThrough);
+}
+
+void DeskReconciler::setOnline(bool online) {
+    if (m_online.exchange(online) != online) {
+        qDebug() << (online ? "Связь с БД есть, стойка работает с сервером"
+                            : "Нет связи с БД, стойка работает автономно");
+        emit connectivityChanged(online);
+    }
+}
+
+bool DeskReconciler::writeConflictLog(const QVector<JournalReplayer::Skipped>& skipped) {
+    QFile file(conflictLogPath());
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Не удалось записать журнал конфликтов:" << file.errorString();
+        return false;
+    }
+
+    for (const JournalReplayer::Skipped& item : skipped) {
+        const MutationJournal::Entry& entry = item.entry;
+        QJsonObject object;
+        object["reason"] = item.result == JournalReplayer::Conflict ? "conflict" : "rejected";
+        if (!item.error.isEmpty()) {
+            object["error"] = item.error;
+        }
+        object["sequence"] = QString::number(entry.sequence);
+        object["timestamp"] = QDateTime::fromMSecsSinceEpoch(entry.timestampMsecs).toString(Qt::ISODateWithMs);
+        object["detected_at"] = QDateTime::currentDateTime().toString(Qt::ISODateWithMs);
+        object["type"] = MutationJournal::entryTypeName(entry.type);
+        object["base_version"] = QString::number(entry.baseVersion);
+        QJsonArray weights;
+        if (entry.type == MutationJournal::AddRecord) {
+            object["flight_number"] = entry.record.getFlightNumber();
+            object["passenger_name"] = entry.record.getPassengerName();
+            for (double weight : entry.record.getItemWeights()) {
+                weights.append(weight);
+            }
+            object["weights"] = weights;
+        } else if (entry.type == MutationJournal::DeleteFlights) {
+            object["flight_numbers"] = QJsonArray::fromStringList(entry.flightNumbers);
+        } else if (entry.type == MutationJournal::ChangeItems) {
+            object["passenger_name"] = entry.passengerName;
+            for (double weight : entry.weights) {
+                weights.append(weight);
+            }
+            object["weights"] = weights;
+        }
+        file.write(QJsonDocument(object).toJson(QJsonDocument::Compact));
+        file.write("\n");
+    }
+    return true;
+}
@@ -0,0 +1,432 @@
+#include "FlightArchive.h"
+#include <QHash>
+#include <QStringList>
+#include <QtEndian>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+const char ARCHIVE_MAGIC[4] = {'B', 'G', 'A', 'R'};
+constexpr quint16 ARCHIVE_VERSION = 1;
+constexpr int FILE_HEADER_SIZE = 8;
+constexpr int BLOCK_HEADER_SIZE = 8;
+constexpr int COMPRESSION_LEVEL = 9;
+
+void putVarint(QByteArray& out, quint64 value) {
+    while (value >= 0x80) {
+        out.append(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(static_cast<char>(value));
+}
+
+quint64 zigzagEncode(qint64 value) {
+    return (static_cast<quint64>(value) << 1) ^ static_cast<quint64>(value >> 63);
+}
+
+qint64 zigzagDecode(quint64 value) {
+    return static_cast<qint64>(value >> 1) ^ -static_cast<qint64>(value & 1);
+}
+
+// Последовательное чтение столбцов блока с проверкой границ
+class BlockDecoder {
+public:
+    explicit BlockDecoder(const QByteArray& data) : m_data(data), m_pos(0), m_ok(true) {}
+
+    quint64 varint() {
+        quint64 value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (m_pos >= m_data.size()) {
+                break;
+            }
+            uchar byte = static_cast<uchar>(m_data[m_pos++]);
+            value |= quint64(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        m_ok = false;
+        return 0;
+    }
+
+    QByteArray bytes(quint64 length) {
+        if (length > quint64(m_data.size() - m_pos)) {
+            m_ok = false;
+            return QByteArray();
+        }
+        QByteArray result = m_data.mid(m_pos, static_cast<int>(length));
+        m_pos += static_cast<int>(length);
+        return result;
+    }
+
+    quint8 byte() {
+        if (m_pos >= m_data.size()) {
+            m_ok = false;
+            return 0;
+        }
+        return static_cast<quint8>(m_data[m_pos++]);
+    }
+
+    bool ok() const { return m_ok; }
+
+private:
+    const QByteArray& m_data;
+    int m_pos;
+    bool m_ok;
+};
+
+QByteArray encodeBlock(const QVector<BaggageRecord>& records) {
+    QByteArray out;
+
+    // Столбец 1: словарь рейсов и коды
+    QHash<QString, quint32> dictionary;
+    QStringList flights;
+    for (const BaggageRecord& record : records) {
+        const QString flight = record.getFlightNumber();
+        if (!dictionary.contains(flight)) {
+            dictionary.insert(flight, static_cast<quint32>(flights.size()));
+            flights.append(flight);
+        }
+    }
+
+    putVarint(out, static_cast<quint64>(flights.size()));
+    for (const QString& flight : flights) {
+        QByteArray utf8 = flight.toUtf8();
+        putVarint(out, static_cast<quint64>(utf8.size()));
+        out.append(utf8);
+    }
+    for (const BaggageRecord& record : records) {
+        putVarint(out, dictionary.value(record.getFlightNumber()));
+    }
+
+    // Столбец 2: ФИО, фронтальное кодирование относительно предыдущего
+    QByteArray previous;
+    for (const BaggageRecord& record : records) {
+        QByteArray name = record.getPassengerName().toUtf8();
+        int shared = 0;
+        const int limit = qMin(name.size(), previous.size());
+        while (shared < limit && name[shared] == previous[shared]) {
+            ++shared;
+        }
+        putVarint(out, static_cast<quint64>(shared));
+        putVarint(out, static_cast<quint64>(name.size() - shared));
+        out.append(name.constData() + shared, name.size() - shared);
+        previous = name;
+    }
+
+    // Столбец 3: количество вещей
+    for (const BaggageRecord& record : records) {
+        out.append(static_cast<char>(record.getItemCount()));
+    }
+
+    // Столбец 4: веса в сотых долях кг, дельта-кодирование
+    qint64 previousWeight = 0;
+    for (const BaggageRecord& record : records) {
+        for (double weight : record.getItemWeights()) {
+            qint64 centi = qRound64(weight * 100.0);
+            putVarint(out, zigzagEncode(centi - previousWeight));
+            previousWeight = centi;
+        }
+    }
+
+    return out;
+}
+
+// Наименьший размер записи в блоке: код рейса, два varint ФИО,
+// количество вещей и хотя бы один вес - по байту на каждый
+constexpr int MIN_ENCODED_RECORD_SIZE = 5;
+
+bool decodeBlock(const QByteArray& data, quint32 count, QVector<BaggageRecord>& records) {
+    // count берётся из заголовка блока: до выделения памяти сверяем его с размером данных
+    if (count > quint32(data.size() / MIN_ENCODED_RECORD_SIZE)) {
+        return false;
+    }
+    BlockDecoder decoder(data);
+
+    quint64 dictionarySize = decoder.varint();
+    if (!decoder.ok() || dictionarySize > count) {
+        return false;
+    }
+    QStringList flights;
+    for (quint64 i = 0; i < dictionarySize && decoder.ok(); ++i) {
+        flights.append(QString::fromUtf8(decoder.bytes(decoder.varint())));
+    }
+
+    QVector<quint32> flightCodes(static_cast<int>(count));
+    for (quint32 i = 0; i < count && decoder.ok(); ++i) {
+        quint64 code = decoder.varint();
+        if (code >= dictionarySize) {
+            return false;
+        }
+        flightCodes[i] = static_cast<quint32>(code);
+    }
+
+    QVector<QString> names(static_cast<int>(count));
+    QByteArray previous;
+    for (quint32 i = 0; i < count && decoder.ok(); ++i) {
+        quint64 shared = decoder.varint();
+        quint64 suffixLength = decoder.varint();
+        if (shared > quint64(previous.size())) {
+            return false;
+        }
+        QByteArray name = previous.left(static_cast<int>(shared)) + decoder.bytes(suffixLength);
+        names[i] = QString::fromUtf8(name);
+        previous = name;
+    }
+
+    QVector<quint8> itemCounts(static_cast<int>(count));
+    for (quint32 i = 0; i < count && decoder.ok(); ++i) {
+        itemCounts[i] = decoder.byte();
+        if (itemCounts[i] > BaggageRecord::MAX_ITEMS) {
+            return false;
+        }
+    }
+
+    records.clear();
+    records.reserve(static_cast<int>(count));
+    qint64 previousWeight = 0;
+    for (quint32 i = 0; i < count && decoder.ok(); ++i) {
+        QVector<double> weights;
+        weights.reserve(itemCounts[i]);
+        for (int w = 0; w < itemCounts[i]; ++w) {
+            previousWeight += zigzagDecode(decoder.varint());
+            weights.append(previousWeight / 100.0);
+        }
+        BaggageRecord record;
+        record.setFlightNumber(flights[flightCodes[i]]);
+        record.setPassengerName(names[i]);
+        if (!record.setItemWeights(weights)) {
+            return false;   // ноль вещей или вес вне допустимого диапазона
+        }
+        records.append(record);
+    }
+
+    return decoder.ok();
+}
+
+} // namespace
+
+// ==================== FlightArchiveWriter ====================
+
+FlightArchiveWriter::FlightArchiveWriter(int blockSize)
+    : m_device(nullptr), m_blockSize(qMax(1, blockSize)), m_recordsWritten(0) {
+}
+
+FlightArchiveWriter::~FlightArchiveWriter() {
+    if (m_device) {
+        close();
+    }
+}
+
+bool FlightArchiveWriter::open(const QString& filename) {
+    m_ownedFile = std::make_unique<QFile>(filename);
+    if (!m_ownedFile->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        m_errorString = "Не удалось создать файл архива: " + m_ownedFile->errorString();
+        m_ownedFile.reset();
+        return false;
+    }
+    return open(m_ownedFile.get());
+}
+
+bool FlightArchiveWriter::open(QIODevice* device) {
+    m_device = device;
+    m_pending.clear();
+    m_recordsWritten = 0;
+    m_errorString.clear();
+    return writeHeader();
+}
+
+bool FlightArchiveWriter::writeHeader() {
+    char header[FILE_HEADER_SIZE] = {};
+    memcpy(header, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+    qToLittleEndian<quint16>(ARCHIVE_VERSION, header + 4);
+
+    if (m_device->write(header, FILE_HEADER_SIZE) != FILE_HEADER_SIZE) {
+        m_errorString = "Ошибка записи заголовка архива: " + m_device->errorString();
+        return false;
+    }
+    return true;
+}
+
+bool FlightArchiveWriter::write(const BaggageRecord& record) {
+    if (!m_device) {
+        m_errorString = "Архив не открыт";
+        return false;
+    }
+
+    m_pending.append(record);
+    if (m_pending.size() >= m_blockSize) {
+        return flushBlock();
+    }
+    return true;
+}
+
+bool FlightArchiveWriter::flushBlock() {
+    if (m_pending.isEmpty()) {
+        return true;
+    }
+
+    // Сортировка по (рейс, ФИО) улучшает словарь и фронтальное кодирование
+    std::sort(m_pending.begin(), m_pending.end(),
+              [](const BaggageRecord& a, const BaggageRecord& b) {
+                  int cmp = QString::compare(a.getFlightNumber(), b.getFlightNumber());
+                  if (cmp != 0) {
+                      return cmp < 0;
+                  }
+                  return QString::compare(a.getPassengerName(), b.getPassengerName()) < 0;
+              });
+
+    QByteArray compressed = qCompress(encodeBlock(m_pending), COMPRESSION_LEVEL);
+
+    char blockHeader[BLOCK_HEADER_SIZE];
+    qToLittleEndian<quint32>(static_cast<quint32>(m_pending.size()), blockHeader);
+    qToLittleEndian<quint32>(static_cast<quint32>(compressed.size()), blockHeader + 4);
+
+    if (m_device->write(blockHeader, BLOCK_HEADER_SIZE) != BLOCK_HEADER_SIZE ||
+        m_device->write(compressed) != compressed.size()) {
+        m_errorString = "Ошибка записи блока архива: " + m_device->errorString();
+        return false;
+    }
+
+    m_recordsWritten += m_pending.size();
+    m_pending.clear();
+    return true;
+}
+
+bool FlightArchiveWriter::close() {
+    if (!m_device) {
+        return true;
+    }
+
+    bool ok = flushBlock();
+    if (m_ownedFile) {
+        m_ownedFile->close();
+        if (m_ownedFile->error() != QFileDevice::NoError) {
+            m_errorString = "Ошибка при закрытии файла архива: " + m_ownedFile->errorString();
+            ok = false;
+        }
+        m_ownedFile.reset();
+    }
+    m_device = nullptr;
+
+    qDebug() << "Архив записан, записей:" << m_recordsWritten;
+    return ok;
+}
+
+// ==================== FlightArchiveReader ====================
+
+FlightArchiveReader::FlightArchiveReader() : m_device(nullptr), m_blockPos(0) {
+}
+
+FlightArchiveReader::~FlightArchiveReader() {
+    close();
+}
+
+bool FlightArchiveReader::open(const QString& filename) {
+    m_ownedFile = std::make_unique<QFile>(filename);
+    if (!m_ownedFile->open(QIODevice::ReadOnly)) {
+        m_errorString = "Не удалось открыть файл архива: " + m_ownedFile->errorString();
+        m_ownedFile.reset();
+        return false;
+    }
+    return open(m_ownedFile.get());
+}
+
+bool FlightArchiveReader::open(QIODevice* device) {
+    m_device = device;
+    m_block.clear();
+    m_blockPos = 0;
+    m_errorString.clear();
+    return readHeader();
+}
+
+void FlightArchiveReader::close() {
+    if (m_ownedFile) {
+        m_ownedFile->close();
+        m_ownedFile.reset();
+    }
+    m_device = nullptr;
+    m_block.clear();
+    m_blockPos = 0;
+}
+
+bool FlightArchiveReader::readHeader() {
+    QByteArray header = m_device->read(FILE_HEADER_SIZE);
+    if (header.size() != FILE_HEADER_SIZE ||
+        !header.startsWith(QByteArray(ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)))) {
+        m_errorString = "Файл не является архивом рейсов";
+        return false;
+    }
+
+    quint16 version = qFromLittleEndian<quint16>(header.constData() + 4);
+    if (version == 0 || version > ARCHIVE_VERSION) {
+        m_errorString = QString("Неподдерживаемая версия архива: %1").arg(version);
+        return false;
+    }
+    return true;
+}
+
+bool FlightArchiveReader::loadNextBlock() {
+    QByteArray blockHeader = m_device->read(BLOCK_HEADER_SIZE);
+    if (blockHeader.isEmpty()) {
+        return false;   // конец архива
+    }
+    if (blockHeader.size() != BLOCK_HEADER_SIZE) {
+        m_errorString = "Архив повреждён: неполный заголовок блока";
+        return false;
+    }
+
+    quint32 count = qFromLittleEndian<quint32>(blockHeader.constData());
+    quint32 compressedSize = qFromLittleEndian<quint32>(blockHeader.constData() + 4);
+
+    // Размер из заголовка не должен превышать остаток файла: read() выделяет память заранее
+    if (!m_device->isSequential() && compressedSize > m_device->bytesAvailable()) {
+        m_errorString = "Архив повреждён: неполный блок данных";
+        return false;
+    }
+
+    QByteArray compressed = m_device->read(compressedSize);
+    if (compressed.size() != static_cast<int>(compressedSize)) {
+        m_errorString = "Архив повреждён: неполный блок данных";
+        return false;
+    }
+
+    QByteArray data = qUncompress(compressed);
+    if (data.isEmpty() && count > 0) {
+        m_errorString = "Архив повреждён: ошибка распаковки блока";
+        return false;
+    }
+
+    if (!decodeBlock(data, count, m_block)) {
+        m_errorString = "Архив повреждён: ошибка декодирования блока";
+        return false;
+    }
+
+    m_blockPos = 0;
+    return true;
+}
+
+bool FlightArchiveReader::readNext(BaggageRecord& record) {
+    if (!m_device || hasError()) {
+        return false;
+    }
+
+    while (m_blockPos >= m_block.size()) {
+        if (!loadNextBlock()) {
+            return false;
+        }
+    }
+
+    record = m_block[m_blockPos++];
+    return true;
+}
+
+QVector<BaggageRecord> FlightArchiveReader::readAll() {
+    QVector<BaggageRecord> records;
+    BaggageRecord record;
+    while (readNext(record)) {
+        records.append(record);
+    }
+    return records;
+}
@@ -0,0 +1,217 @@
+#include "FlightLoadDashboard.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QPushButton>
+#include <QHeaderView>
+#include <QSortFilterProxyModel>
+#include <QFont>
+#include <QDebug>
+
+// ==================== FlightLoadModel ====================
+
+FlightLoadModel::FlightLoadModel(QObject* parent)
+    : QAbstractTableModel(parent) {
+}
+
+int FlightLoadModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+int FlightLoadModel::columnCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant FlightLoadModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() >= m_rows.size()) {
+        return QVariant();
+    }
+    const FlightStats& flight = m_rows[index.row()];
+
+    // Qt::UserRole - значения для сортировки (числа, а не текст)
+    if (role == Qt::DisplayRole || role == Qt::UserRole) {
+        switch (index.column()) {
+        case FlightColumn:
+            return flight.flightNumber;
+        case PassengersColumn:
+            return flight.passengerCount;
+        case ItemsColumn:
+            return flight.itemCount;
+        case WeightColumn:
+            return role == Qt::UserRole ? QVariant(flight.totalWeight)
+                                        : QVariant(QString::number(flight.totalWeight, 'f', 2));
+        }
+    } else if (role == Qt::TextAlignmentRole && index.column() != FlightColumn) {
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    }
+    return QVariant();
+}
+
+QVariant FlightLoadModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+    switch (section) {
+    case FlightColumn:
+        return "№ РЕЙСА";
+    case PassengersColumn:
+        return "ПАССАЖИРОВ";
+    case ItemsColumn:
+        return "ВЕЩЕЙ";
+    case WeightColumn:
+        return "ВЕС (КГ)";
+    }
+    return QVariant();
+}
+
+void FlightLoadModel::reset(const QVector<FlightStats>& flights) {
+    beginResetModel();
+    m_rows = flights;
+    m_rowByFlight.clear();
+    m_totals = FlightStats();
+    for (int row = 0; row < m_rows.size(); ++row) {
+        m_rowByFlight.insert(m_rows[row].flightNumber, row);
+        addToTotals(m_rows[row], 1);
+    }
+    endResetModel();
+}
+
+void FlightLoadModel::apply(const QVector<FlightStats>& changed, const QStringList& removed) {
+    // Удалённый рейс заменяется последней строкой, удаляется одна последняя
+    for (const QString& flightNumber : removed) {
+        const auto it = m_rowByFlight.constFind(flightNumber);
+        if (it == m_rowByFlight.constEnd()) {
+            continue;
+        }
+        const int row = it.value();
+        const int last = m_rows.size() - 1;
+        addToTotals(m_rows[row], -1);
+        m_rowByFlight.remove(flightNumber);
+        if (row != last) {
+            m_rows[row] = m_rows[last];
+            m_rowByFlight.insert(m_rows[row].flightNumber, row);
+            emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
+        }
+        beginRemoveRows(QModelIndex(), last, last);
+        m_rows.removeLast();
+        endRemoveRows();
+    }
+
+    QVector<FlightStats> added;
+    for (const FlightStats& flight : changed) {
+        const auto it = m_rowByFlight.constFind(flight.flightNumber);
+        if (it == m_rowByFlight.constEnd()) {
+            added.append(flight);
+            continue;
+        }
+        const int row = it.value();
+        addToTotals(m_rows[row], -1);
+        m_rows[row] = flight;
+        addToTotals(flight, 1);
+        emit dataChanged(index(row, PassengersColumn), index(row, WeightColumn));
+    }
+
+    if (!added.isEmpty()) {
+        beginInsertRows(QModelIndex(), m_rows.size(), m_rows.size() + added.size() - 1);
+        for (const FlightStats& flight : added) {
+            m_rowByFlight.insert(flight.flightNumber, m_rows.size());
+            m_rows.append(flight);
+            addToTotals(flight, 1);
+        }
+        endInsertRows();
+    }
+}
+
+void FlightLoadModel::addToTotals(const FlightStats& flight, int sign) {
+    m_totals.passengerCount += sign * flight.passengerCount;
+    m_totals.itemCount += sign * flight.itemCount;
+    m_totals.totalWeight += sign * flight.totalWeight;
+}
+
+// ==================== FlightLoadDashboard ====================
+
+FlightLoadDashboard::FlightLoadDashboard(QWidget* parent)
+    : QDialog(parent),
+      m_monitor(new FlightLoadMonitor(this)),
+      m_model(new FlightLoadModel(this)),
+      m_online(true) {
+    setWindowTitle("Загрузка рейсов");
+    resize(520, 600);
+    createUI();
+
+    connect(m_monitor, &FlightLoadMonitor::flightsChanged, this, &FlightLoadDashboard::onFlightsChanged);
+    connect(m_monitor, &FlightLoadMonitor::resynced, this, &FlightLoadDashboard::onResynced);
+    connect(m_monitor, &FlightLoadMonitor::connectionChanged, this, &FlightLoadDashboard::onConnectionChanged);
+}
+
+FlightLoadDashboard::~FlightLoadDashboard() {
+    m_monitor->stop();
+}
+
+void FlightLoadDashboard::createUI() {
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
+
+    m_summaryLabel = new QLabel(this);
+    QFont summaryFont = m_summaryLabel->font();
+    summaryFont.setBold(true);
+    m_summaryLabel->setFont(summaryFont);
+    mainLayout->addWidget(m_summaryLabel);
+
+    // Сортировка в прокси: модель не переставляет строки при изменениях
+    QSortFilterProxyModel* proxy = new QSortFilterProxyModel(this);
+    proxy->setSourceModel(m_model);
+    proxy->setSortRole(Qt::UserRole);
+    proxy->setDynamicSortFilter(true);
+
+    m_tableView = new QTableView(this);
+    m_tableView->setModel(proxy);
+    m_tableView->setSortingEnabled(true);
+    m_tableView->sortByColumn(FlightLoadModel::FlightColumn, Qt::AscendingOrder);
+    m_tableView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_tableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_tableView->setAlternatingRowColors(true);
+    m_tableView->verticalHeader()->setVisible(false);
+    m_tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    mainLayout->addWidget(m_tableView);
+
+    m_statusLabel = new QLabel(this);
+    mainLayout->addWidget(m_statusLabel);
+
+    QPushButton* closeButton = new QPushButton("Закрыть", this);
+    mainLayout->addWidget(closeButton);
+    connect(closeButton, &QPushButton::clicked, this, &QDialog::accept);
+}
+
+bool FlightLoadDashboard::start() {
+    return m_monitor->start();
+}
+
+void FlightLoadDashboard::onFlightsChanged(const QVector<FlightStats>& changed, const QStringList& removed) {
+    m_model->apply(changed, removed);
+    updateSummary();
+}
+
+void FlightLoadDashboard::onResynced(const QVector<FlightStats>& flights) {
+    m_model->reset(flights);
+    updateSummary();
+}
+
+void FlightLoadDashboard::onConnectionChanged(bool online) {
+    m_online = online;
+    updateSummary();
+}
+
+void FlightLoadDashboard::updateSummary() {
+    const FlightStats totals = m_model->totals();
+    m_summaryLabel->setText(QString("Рейсов: %1 | Пассажиров: %2 | Вещей: %3 | Вес: %4 кг")
+                                .arg(m_model->rowCount())
+                                .arg(totals.passengerCount)
+                                .arg(totals.itemCount)
+                                .arg(totals.totalWeight, 0, 'f', 2));
+
+    const FlightLoadMonitorStats stats = m_monitor->stats();
+    m_statusLabel->setText(QString("%1 | Уведомлений: %2 | Кадров: %3 | Рейсов в кадрах: %4")
+                               .arg(m_online ? "Онлайн" : "Нет связи с БД, переподключение...")
+                               .arg(stats.notifications)
+                               .arg(stats.frames)
+                               .arg(stats.flightUpdates));
+}
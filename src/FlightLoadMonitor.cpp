@@ -0,0 +1,262 @@
+#include "FlightLoadMonitor.h"
+#include "DatabaseManager.h"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <algorithm>
+#include <utility>
+#include <QDebug>
+
+namespace {
+
+const char LOAD_CHANNEL[] = "baggage_load";
+constexpr int LOAD_PAYLOAD_FIELDS = 6;
+
+// Итоги рабочей таблицы (закрытые рейсы уже в архиве - не вылетающие)
+const char FLIGHT_TOTALS_SQL[] = R"(
+    SELECT br.flight_number, count(DISTINCT br.id), count(bi.id), COALESCE(sum(bi.weight), 0)::text
+    FROM baggage_records br
+    LEFT JOIN baggage_items bi ON bi.baggage_record_id = br.id
+    GROUP BY br.flight_number
+)";
+
+// "12.50" -> 1250; вес в БД - NUMERIC(5,2), суммы - с двумя знаками
+qint64 weightToCents(const QString& text, bool* ok) {
+    return qRound64(text.toDouble(ok) * 100.0);
+}
+
+} // namespace
+
+FlightLoadMonitor::FlightLoadMonitor(QObject* parent)
+    : QObject(parent),
+      m_running(false),
+      m_online(false),
+      m_snapshotXmin(0),
+      m_snapshotXmax(0) {
+    m_frameTimer.setSingleShot(true);
+    connect(&m_frameTimer, &QTimer::timeout, this, &FlightLoadMonitor::onFrame);
+    connect(&m_healthTimer, &QTimer::timeout, this, &FlightLoadMonitor::onHealthCheck);
+}
+
+FlightLoadMonitor::~FlightLoadMonitor() {
+    stop();
+}
+
+bool FlightLoadMonitor::start(int frameIntervalMs) {
+    if (m_running) {
+        return true;
+    }
+    m_frameTimer.setInterval(qMax(1, frameIntervalMs));
+    m_connectionName = QString("baggage_load_monitor_%1").arg(reinterpret_cast<quintptr>(this), 0, 16);
+
+    QSqlDatabase db = DatabaseManager::instance().openWorkerConnection(m_connectionName);
+    if (!db.isOpen()) {
+        setError("Монитор загрузки: нет подключения к БД: " + db.lastError().text());
+        db = QSqlDatabase();
+        DatabaseManager::closeWorkerConnection(m_connectionName);
+        return false;
+    }
+    // Драйвер один на всё время работы, в том числе после переподключения
+    connect(db.driver(),
+            QOverload<const QString&, QSqlDriver::NotificationSource, const QVariant&>::of(
+                &QSqlDriver::notification),
+            this, &FlightLoadMonitor::onNotification);
+
+    m_running = true;
+    if (!resync()) {
+        stop();
+        return false;
+    }
+    m_online = true;
+    m_healthTimer.start(HEALTH_CHECK_MS);
+    return true;
+}
+
+void FlightLoadMonitor::stop() {
+    if (!m_running) {
+        return;
+    }
+    m_running = false;
+    m_frameTimer.stop();
+    m_healthTimer.stop();
+    {
+        QSqlDatabase db = QSqlDatabase::database(m_connectionName, false);
+        if (db.isOpen()) {
+            db.driver()->unsubscribeFromNotification(LOAD_CHANNEL);
+        }
+    }
+    DatabaseManager::closeWorkerConnection(m_connectionName);
+    m_totals.clear();
+    m_dirty.clear();
+}
+
+QVector<FlightStats> FlightLoadMonitor::flights() const {
+    QVector<FlightStats> result;
+    result.reserve(m_totals.size());
+    for (auto it = m_totals.cbegin(); it != m_totals.cend(); ++it) {
+        result.append(toStats(it.key(), it.value()));
+    }
+    std::sort(result.begin(), result.end(), [](const FlightStats& a, const FlightStats& b) {
+        return a.flightNumber < b.flightNumber;
+    });
+    return result;
+}
+
+// Подписка, затем итоги и снимок одной транзакцией: изменения, зафиксированные
+// между подпиской и снимком, придут уведомлениями и будут пропущены по снимку
+bool FlightLoadMonitor::resync() {
+    QSqlDatabase db = QSqlDatabase::database(m_connectionName, false);
+    if (!db.driver()->subscribedToNotifications().contains(LOAD_CHANNEL)
+        && !db.driver()->subscribeToNotification(LOAD_CHANNEL)) {
+        setError("Монитор загрузки: не удалось подписаться на " + QString(LOAD_CHANNEL) + ": "
+                 + db.driver()->lastError().text());
+        return false;
+    }
+
+    if (!db.transaction()) {
+        setError("Монитор загрузки: " + db.lastError().text());
+        return false;
+    }
+    QSqlQuery query(db);
+    if (!query.exec("SET TRANSACTION ISOLATION LEVEL REPEATABLE READ")
+        || !query.exec("SELECT txid_current_snapshot()::text") || !query.next()) {
+        setError("Ошибка чтения снимка транзакций: " + query.lastError().text());
+        db.rollback();
+        return false;
+    }
+
+    // Снимок "xmin:xmax:xip1,xip2,..."
+    const QStringList snapshot = query.value(0).toString().split(':');
+    m_snapshotXmin = snapshot.value(0).toLongLong();
+    m_snapshotXmax = snapshot.value(1).toLongLong();
+    m_snapshotXip.clear();
+    for (const QString& txid : snapshot.value(2).split(',', Qt::SkipEmptyParts)) {
+        m_snapshotXip.insert(txid.toLongLong());
+    }
+
+    QHash<QString, Totals> totals;
+    query.setForwardOnly(true);
+    if (!query.exec(FLIGHT_TOTALS_SQL)) {
+        setError("Ошибка загрузки итогов по рейсам: " + query.lastError().text());
+        db.rollback();
+        return false;
+    }
+    while (query.next()) {
+        Totals& flight = totals[query.value(0).toString()];
+        flight.passengers = query.value(1).toLongLong();
+        flight.items = query.value(2).toLongLong();
+        flight.weightCents = weightToCents(query.value(3).toString(), nullptr);
+    }
+    db.commit();
+
+    m_totals.swap(totals);
+    m_dirty.clear();
+    m_frameTimer.stop();
+    ++m_stats.resyncs;
+    emit resynced(flights());
+    return true;
+}
+
+bool FlightLoadMonitor::isInSnapshot(qint64 txid) const {
+    return txid < m_snapshotXmin || (txid < m_snapshotXmax && !m_snapshotXip.contains(txid));
+}
+
+void FlightLoadMonitor::onNotification(const QString& name, QSqlDriver::NotificationSource,
+                                       const QVariant& payload) {
+    if (name != QLatin1String(LOAD_CHANNEL)) {
+        return;
+    }
+    ++m_stats.notifications;
+
+    // txid, метка, рейс, пассажиры, вещи, вес
+    const QStringList fields = payload.toString().split('\t');
+    bool ok = fields.size() == LOAD_PAYLOAD_FIELDS;
+    bool parsed = false;
+    const qint64 txid = fields.value(0).toLongLong(&parsed);
+    ok = ok && parsed;
+    const qint64 passengers = fields.value(3).toLongLong(&parsed);
+    ok = ok && parsed;
+    const qint64 items = fields.value(4).toLongLong(&parsed);
+    ok = ok && parsed;
+    const qint64 weightCents = weightToCents(fields.value(5), &parsed);
+    ok = ok && parsed;
+    if (!ok || fields.value(2).isEmpty()) {
+        ++m_stats.malformed;
+        qWarning() << "Монитор загрузки: неверное уведомление" << payload.toString();
+        return;
+    }
+    if (isInSnapshot(txid)) {
+        ++m_stats.skipped;
+        return;
+    }
+
+    const QString flightNumber = fields.value(2);
+    Totals& flight = m_totals[flightNumber];
+    flight.passengers += passengers;
+    flight.items += items;
+    flight.weightCents += weightCents;
+    if (flight.passengers <= 0 && flight.items <= 0) {
+        m_totals.remove(flightNumber);
+    }
+    ++m_stats.applied;
+
+    m_dirty.insert(flightNumber);
+    if (!m_frameTimer.isActive()) {
+        m_frameTimer.start();
+    }
+}
+
+void FlightLoadMonitor::onFrame() {
+    if (m_dirty.isEmpty()) {
+        return;
+    }
+    QVector<FlightStats> changed;
+    QStringList removed;
+    for (const QString& flightNumber : std::as_const(m_dirty)) {
+        const auto it = m_totals.constFind(flightNumber);
+        if (it == m_totals.constEnd()) {
+            removed.append(flightNumber);
+        } else {
+            changed.append(toStats(flightNumber, it.value()));
+        }
+    }
+    m_stats.flightUpdates += m_dirty.size();
+    ++m_stats.frames;
+    m_dirty.clear();
+    emit flightsChanged(changed, removed);
+}
+
+// Уведомления не приходят по оборванному подключению - проверяем его сами
+void FlightLoadMonitor::onHealthCheck() {
+    QSqlDatabase db = QSqlDatabase::database(m_connectionName, false);
+    {
+        QSqlQuery query(db);
+        if (db.isOpen() && query.exec("SELECT 1")) {
+            return;
+        }
+    }
+
+    if (m_online) {
+        m_online = false;
+        emit connectionChanged(false);
+    }
+    db.close();
+    if (db.open() && resync()) {
+        m_online = true;
+        emit connectionChanged(true);
+    }
+}
+
+FlightStats FlightLoadMonitor::toStats(const QString& flightNumber, const Totals& totals) {
+    FlightStats stats;
+    stats.flightNumber = flightNumber;
+    stats.passengerCount = static_cast<int>(totals.passengers);
+    stats.itemCount = static_cast<int>(totals.items);
+    stats.totalWeight = totals.weightCents / 100.0;
+    return stats;
+}
+
+void FlightLoadMonitor::setError(const QString& error) {
+    m_errorString = error;
+    qWarning() << error;
+}
@@ -0,0 +1,151 @@
+#include "JournalReplayer.h"
+#include "StorageEngine.h"
+#include <QDebug>
+
+JournalReplayer::Result JournalReplayer::checkConflict(const MutationJournal::Entry& entry) {
+    if (entry.baseVersion == MutationJournal::NO_VERSION) {
+        return Applied;
+    }
+
+    int changed = 0;
+    if (entry.type == MutationJournal::DeleteFlights) {
+        changed = StorageEngine::current().countFlightChangesSince(entry.flightNumbers, entry.baseVersion);
+    } else if (entry.type == MutationJournal::ChangeItems) {
+        changed = StorageEngine::current().countPassengerChangesSince(entry.passengerName, entry.baseVersion);
+    }
+    if (changed < 0) {
+        return Deferred;
+    }
+    return changed > 0 ? Conflict : Applied;
+}
+
+JournalReplayer::Result JournalReplayer::apply(const MutationJournal::Entry& entry, int* affected) {
+    StorageEngine& db = StorageEngine::current();
+    if (affected) {
+        *affected = 0;
+    }
+
+    Result check = checkConflict(entry);
+    if (check == Conflict) {
+        return Conflict;
+    }
+    if (check == Deferred) {
+        return db.checkConnection() ? Rejected : Deferred;
+    }
+
+    bool ok = false;
+    int count = 0;
+
+    switch (entry.type) {
+    case MutationJournal::AddRecord:
+        ok = db.addRecord(entry.record);
+        count = ok ? 1 : 0;
+        break;
+    case MutationJournal::DeleteFlights:
+        // 0 удалённых - и ошибка, и отсутствие рейсов; различаем проверкой связи
+        count = db.deleteRecordsByFlightNumbers(entry.flightNumbers);
+        ok = count > 0 || db.checkConnection();
+        break;
+    case MutationJournal::ChangeItems:
+        ok = db.changeItemCountByName(entry.passengerName, entry.weights);
+        count = ok ? 1 : 0;
+        break;
+    case MutationJournal::Applied:
+        return Applied;
+    }
+
+    if (affected) {
+        *affected = count;
+    }
+    if (ok) {
+        return Applied;
+    }
+    return db.checkConnection() ? Rejected : Deferred;
+}
+
+int JournalReplayer::drain(MutationJournal& journal, QVector<Skipped>* skipped) {
+    if (journal.pendingCount() == 0 || !StorageEngine::current().checkConnection()) {
+        return 0;
+    }
+
+    const QVector<MutationJournal::Entry> pending = journal.pendingEntries();
+    int processed = 0;
+    int i = 0;
+
+    auto skip = [&](const MutationJournal::Entry& entry, Result result) {
+        Skipped item;
+        item.entry = entry;
+        item.result = result;
+        if (result == Conflict) {
+            qWarning() << "Конфликт: запись изменена в БД позже, изменение из журнала не применено: #"
+                       << entry.sequence << MutationJournal::entryTypeName(entry.type);
+        } else {
+            item.error = StorageEngine::current().getLastError();
+            qWarning() << "Изменение из журнала отклонено БД, пропущено: #" << entry.sequence
+                       << MutationJournal::entryTypeName(entry.type) << item.error;
+        }
+        if (skipped) {
+            skipped->append(item);
+        }
+    };
+
+    while (i < pending.size()) {
+        if (pending[i].type != MutationJournal::AddRecord) {
+            Result result = apply(pending[i]);
+            if (result == Deferred) {
+                break;
+            }
+            if (result != Applied) {
+                skip(pending[i], result);
+            }
+            journal.markApplied(pending[i].sequence);
+            ++processed;
+            ++i;
+            continue;
+        }
+
+        // Подряд идущие добавления - одной транзакцией
+        int end = i;
+        QVector<BaggageRecord> batch;
+        while (end < pending.size() && pending[end].type == MutationJournal::AddRecord
+               && batch.size() < BATCH_SIZE) {
+            batch.append(pending[end].record);
+            ++end;
+        }
+
+        if (StorageEngine::current().addRecordsBatch(batch)) {
+            journal.markApplied(pending[end - 1].sequence);
+            processed += end - i;
+            i = end;
+            continue;
+        }
+        if (!StorageEngine::current().checkConnection()) {
+            break;
+        }
+
+        // Пачка отклонена - повторяем по одной, чтобы пропустить только ошибочные
+        bool deferred = false;
+        for (; i < end; ++i) {
+            Result result = apply(pending[i]);
+            if (result == Deferred) {
+                deferred = true;
+                break;
+            }
+            if (result != Applied) {
+                skip(pending[i], result);
+            }
+            journal.markApplied(pending[i].sequence);
+            ++processed;
+        }
+        if (deferred) {
+            break;
+        }
+    }
+
+    journal.sync();
+    if (processed > 0) {
+        qDebug() << "Из журнала перенесено изменений:" << processed
+                 << "осталось:" << journal.pendingCount();
+    }
+    return processed;
+}
@@ -1,12 +1,15 @@
 #include "LoginDialog.h"
-#include "DatabaseManager.h"
+#include "StorageEngine.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QFormLayout>
 #include <QMessageBox>
 #include <QCryptographicHash>
+#include <QPasswordDigestor>
+#include <QRandomGenerator>
 #include <QSqlQuery>
 #include <QSqlError>
+#include <QSettings>
 #include <QDebug>
 
 LoginDialog::LoginDialog(QWidget *parent)
@@ -95,6 +98,9 @@ void LoginDialog::onLoginClicked() {
     if (authenticateUser(username, password)) {
         m_username = username;
         m_userRole = getUserRole(username);  // Получаем роль пользователя
+        if (StorageEngine::current().isConnected()) {
+            cacheCredentials(username, password);
+        }
         m_loginResult = LoggedIn;
         m_failedAttempts = 0;  // Сброс счетчика при успешном входе
         showStatus("Вход выполнен успешно!", false);
@@ -145,11 +151,11 @@ void LoginDialog::onGuestClicked() {
 }
 
 bool LoginDialog::authenticateUser(const QString& username, const QString& password) {
-    QSqlDatabase& db = DatabaseManager::instance().getDatabase();
+    QSqlDatabase& db = StorageEngine::current().getDatabase();
 
     if (!db.isOpen()) {
-        qWarning() << "База данных не подключена";
-        return false;
+        qWarning() << "База данных не подключена, проверка по сохранённым учётным данным";
+        return authenticateOffline(username, password);
     }
 
     QString hashedPassword = hashPassword(password);
@@ -179,11 +185,11 @@ bool LoginDialog::authenticateUser(const QString& username, const QString& passw
 }
 
 QString LoginDialog::getUserRole(const QString& username) {
-    QSqlDatabase& db = DatabaseManager::instance().getDatabase();
+    QSqlDatabase& db = StorageEngine::current().getDatabase();
 
     if (!db.isOpen()) {
-        qWarning() << "База данных не подключена при получении роли";
-        return "user";  // По умолчанию обычный пользователь
+        // Автономный режим: локальным настройкам нельзя доверять права - только обычный пользователь
+        return "user";
     }
 
     QSqlQuery query(db);
@@ -208,7 +214,7 @@ QString LoginDialog::getUserRole(const QString& username) {
 }
 
 bool LoginDialog::registerUser(const QString& username, const QString& password) {
-    QSqlDatabase& db = DatabaseManager::instance().getDatabase();
+    QSqlDatabase& db = StorageEngine::current().getDatabase();
 
     if (!db.isOpen()) {
         qWarning() << "База данных не подключена";
@@ -259,6 +265,44 @@ QString LoginDialog::hashPassword(const QString& password) {
     return QString(hash.toHex());
 }
 
+// Соль на пользователя и PBKDF2: перебор паролей по файлу настроек дорог
+QByteArray LoginDialog::offlinePasswordHash(const QString& password, const QByteArray& salt) {
+    return QPasswordDigestor::deriveKeyPbkdf2(QCryptographicHash::Sha256, password.toUtf8(), salt,
+                                              OFFLINE_HASH_ITERATIONS, OFFLINE_HASH_LENGTH);
+}
+
+void LoginDialog::cacheCredentials(const QString& username, const QString& password) {
+    QByteArray salt(OFFLINE_SALT_LENGTH, Qt::Uninitialized);
+    QRandomGenerator::system()->fillRange(reinterpret_cast<quint32*>(salt.data()),
+                                          OFFLINE_SALT_LENGTH / int(sizeof(quint32)));
+
+    QSettings settings;
+    settings.beginGroup("offline_credentials/" + username);
+    settings.remove("");  // прежние записи, в том числе роль и несолёный хеш старых версий
+    settings.setValue("salt", salt.toHex());
+    settings.setValue("password_hash", offlinePasswordHash(password, salt).toHex());
+    settings.endGroup();
+}
+
+bool LoginDialog::authenticateOffline(const QString& username, const QString& password) {
+    QSettings settings;
+    settings.beginGroup("offline_credentials/" + username);
+    const QByteArray salt = QByteArray::fromHex(settings.value("salt").toByteArray());
+    const QByteArray storedHash = QByteArray::fromHex(settings.value("password_hash").toByteArray());
+    settings.endGroup();
+    if (salt.size() != OFFLINE_SALT_LENGTH || storedHash.size() != OFFLINE_HASH_LENGTH) {
+        return false;
+    }
+
+    // Сравнение без раннего выхода - время не зависит от совпавшего префикса
+    const QByteArray hash = offlinePasswordHash(password, salt);
+    char diff = 0;
+    for (int i = 0; i < OFFLINE_HASH_LENGTH; ++i) {
+        diff |= hash[i] ^ storedHash[i];
+    }
+    return diff == 0;
+}
+
 bool LoginDialog::validateInput(const QString& username, const QString& password) {
     if (username.length() < 3) {
         showStatus("Логин должен содержать минимум 3 символа!", true);
@@ -4,6 +4,10 @@
 #include "FilterDialog.h"
 #include "DeleteByFlightDialog.h"
 #include "ChangeItemsDialog.h"
+#include "BufferedFileWriter.h"
+#include "SummaryFileViewer.h"
+#include "BulkImporter.h"
+#include "FlightLoadDashboard.h"
 #include <QMenuBar>
 #include <QToolBar>
 #include <QVBoxLayout>
@@ -14,10 +18,17 @@
 #include <QGroupBox>
 #include <QDesktopServices>
 #include <QUrl>
-#include <QTextEdit>
+#include <QFile>
 #include <QFont>
 #include <QDialog>
 #include <QPushButton>
+#include <QTimer>
+#include <QInputDialog>
+#include <QProgressDialog>
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QThread>
+#include <QHash>
 
 MainWindow::MainWindow(QWidget* parent)
     : QMainWindow(parent), m_manager(std::make_unique<BaggageManager>()), m_isGuestMode(false), m_userRole("user") {
@@ -29,10 +40,51 @@ MainWindow::MainWindow(QWidget* parent)
     createToolBar();
     createCentralWidget();
 
-    // КРИТИЧНО: Загружаем данные из БД при старте!
-    updateTable();
-
-    updateStatusBar();
+    m_refresh = new RefreshScheduler(this, RefreshScheduler::DEFAULT_FRAME_INTERVAL_MS, this);
+    connect(m_refresh, &RefreshScheduler::refreshDue, this, &MainWindow::onRefreshDue);
+
+    // КРИТИЧНО: Загружаем данные при старте (из последнего снимка или из БД)
+    requestRefresh(RefreshScheduler::Table);
+    m_refresh->flush();
+
+    // Журнал изменений и фоновая сверка: при обрыве связи с БД стойка
+    // продолжает принимать багаж, а интерфейс не ждёт сети.
+    // Встроенной БД (SQLite) журнал не нужен - она всегда доступна.
+    if (!StorageEngine::current().isEmbedded() && m_manager->openJournal()) {
+        DeskReconciler* reconciler = m_manager->reconciler();
+        connect(reconciler, &DeskReconciler::stateReconciled, this,
+                [this](const QVector<BaggageRecord>& records, qint64 dataVersion, quint64 appliedThrough) {
+            m_manager->applyServerState(records, dataVersion, appliedThrough);
+            requestRefresh(RefreshScheduler::Table);
+        });
+        connect(reconciler, &DeskReconciler::connectivityChanged, this, [this](bool online) {
+            if (online) {
+                // Основное подключение (отчёты, сводка) - снова к серверу
+                StorageEngine::current().checkConnection();
+            }
+            requestRefresh(RefreshScheduler::Status);
+        });
+        connect(reconciler, &DeskReconciler::conflictsDetected, this,
+                [this](int count, const QString& logPath) {
+            m_statusBar->showMessage(
+                QString("Конфликтов при синхронизации: %1 (приоритет у БД), см. %2").arg(count).arg(logPath),
+                CONFLICT_MESSAGE_TIMEOUT_MS);
+        });
+        // Оператор уже видел изменение выполненным - отказ БД показываем явно
+        connect(reconciler, &DeskReconciler::changesRejected, this,
+                [this](int count, const QString& firstError, const QString& logPath) {
+            QMessageBox::warning(this, "Изменения не сохранены",
+                QString("База данных отклонила изменений: %1. Они убраны из таблицы.\n"
+                        "Ошибка: %2\nПодробности: %3").arg(count).arg(firstError, logPath));
+        });
+    } else if (m_manager->isWarmedFromSnapshot()) {
+        // После показа окна догоняем состояние БД, если старт был из снимка
+        QTimer::singleShot(0, this, [this]() {
+            if (m_manager->catchUpWithDatabase()) {
+                requestRefresh(RefreshScheduler::Table);
+            }
+        });
+    }
 }
 
 MainWindow::~MainWindow() {
@@ -77,7 +129,7 @@ void MainWindow::setupPermissions() {
                 // Гость - блокируем всё кроме просмотра
                 if (text.contains("Новый файл") || text.contains("Сохранить") ||
                     text.contains("Добавить") || text.contains("Удалить") || 
-                    text.contains("Изменить")) {
+                    text.contains("Изменить") || text.contains("Импорт")) {
                     action->setEnabled(false);
                 }
             } else if (isUser) {
@@ -148,6 +200,14 @@ void MainWindow::createMenus() {
 
     fileMenu->addSeparator();
 
+    QAction* exportArchiveAction = fileMenu->addAction("Экспорт архива рейсов...");
+    connect(exportArchiveAction, &QAction::triggered, this, &MainWindow::onExportArchive);
+
+    QAction* importArchiveAction = fileMenu->addAction("Импорт архива рейсов...");
+    connect(importArchiveAction, &QAction::triggered, this, &MainWindow::onImportArchive);
+
+    fileMenu->addSeparator();
+
     QAction* exitAction = fileMenu->addAction("Выход");
     connect(exitAction, &QAction::triggered, this, &MainWindow::onExit);
 
@@ -166,6 +226,16 @@ void MainWindow::createMenus() {
     QAction* changeAction = operationsMenu->addAction("Изменить количество вещей");
     connect(changeAction, &QAction::triggered, this, &MainWindow::onChangeItemCount);
 
+    operationsMenu->addSeparator();
+
+    QAction* importManifestAction = operationsMenu->addAction("Импорт манифеста (CSV/JSONL)...");
+    connect(importManifestAction, &QAction::triggered, this, &MainWindow::onImportManifest);
+
+    operationsMenu->addSeparator();
+
+    QAction* flightLoadAction = operationsMenu->addAction("Загрузка рейсов (онлайн)");
+    connect(flightLoadAction, &QAction::triggered, this, &MainWindow::onShowFlightLoad);
+
     // Меню "Помощь"
     QMenu* helpMenu = menuBar()->addMenu("Помощь");
 
@@ -271,6 +341,21 @@ setCentralWidget(centralWidget);
 
 }
 
+void MainWindow::requestRefresh(RefreshScheduler::Part part) {
+    m_refresh->request(part);
+}
+
+void MainWindow::onRefreshDue(int parts) {
+    if ((parts & RefreshScheduler::Table) == RefreshScheduler::Table) {
+        updateTable();
+    } else {
+        updateStatusBar();
+    }
+}
+
+// Таблица сверяется с записями по ключу (рейс, ФИО): строки удалённых записей
+// убираются, строки новых вставляются на своё место, у остальных меняется текст
+// только отличающихся ячеек. Выделение и прокрутка при этом сохраняются.
 void MainWindow::updateTable() {
     if (!m_tableWidget) {
         qWarning() << "Table widget is null!";
@@ -282,17 +367,44 @@ void MainWindow::updateTable() {
         return;
     }
 
-    m_tableWidget->setRowCount(0);
-
     const QVector<BaggageRecord>& records = m_manager->getRecords();
-
+    auto recordKey = [](const BaggageRecord& record) {
+        return record.getFlightNumber() + QLatin1Char('\n') + record.getPassengerName();
+    };
+    auto rowKey = [this](int row) {
+        const QTableWidgetItem* flight = m_tableWidget->item(row, 0);
+        const QTableWidgetItem* name = m_tableWidget->item(row, 1);
+        return flight && name ? flight->text() + QLatin1Char('\n') + name->text() : QString();
+    };
+
+    // 1. Удаляем строки, ключей которых среди записей нет (с учётом повторов)
+    QHash<QString, int> wanted;
+    wanted.reserve(records.size());
     for (const BaggageRecord& record : records) {
-        int row = m_tableWidget->rowCount();
-        m_tableWidget->insertRow(row);
+        ++wanted[recordKey(record)];
+    }
+    QVector<int> removed;
+    for (int row = 0; row < m_tableWidget->rowCount(); ++row) {
+        auto it = wanted.find(rowKey(row));
+        if (it == wanted.end() || it.value() == 0) {
+            removed.append(row);
+        } else {
+            --it.value();
+        }
+    }
+    for (int i = removed.size() - 1; i >= 0; --i) {
+        m_tableWidget->removeRow(removed[i]);
+    }
 
-        m_tableWidget->setItem(row, 0, new QTableWidgetItem(record.getFlightNumber()));
-        m_tableWidget->setItem(row, 1, new QTableWidgetItem(record.getPassengerName()));
-        m_tableWidget->setItem(row, 2, new QTableWidgetItem(QString::number(record.getItemCount())));
+    // 2. Идём по записям: совпавшая строка обновляется, иначе вставляется новая
+    for (int row = 0; row < records.size(); ++row) {
+        const BaggageRecord& record = records[row];
+        if (row >= m_tableWidget->rowCount() || rowKey(row) != recordKey(record)) {
+            m_tableWidget->insertRow(row);
+            setCellText(row, 0, record.getFlightNumber());
+            setCellText(row, 1, record.getPassengerName());
+        }
+        setCellText(row, 2, QString::number(record.getItemCount()));
 
         // Форматируем веса вещей
         QString weightsStr;
@@ -300,15 +412,28 @@ void MainWindow::updateTable() {
             if (!weightsStr.isEmpty()) weightsStr += ", ";
             weightsStr += QString::number(weight, 'f', 2);
         }
-        m_tableWidget->setItem(row, 3, new QTableWidgetItem(weightsStr));
+        setCellText(row, 3, weightsStr);
 
-        m_tableWidget->setItem(row, 4, new QTableWidgetItem(
-            QString::number(record.getTotalWeight(), 'f', 2)));
+        setCellText(row, 4, QString::number(record.getTotalWeight(), 'f', 2));
+    }
+
+    // 3. Строки, оставшиеся ниже, - записи, сменившие позицию (уже вставлены выше)
+    while (m_tableWidget->rowCount() > records.size()) {
+        m_tableWidget->removeRow(m_tableWidget->rowCount() - 1);
     }
 
     updateStatusBar();
 }
 
+void MainWindow::setCellText(int row, int column, const QString& text) {
+    QTableWidgetItem* item = m_tableWidget->item(row, column);
+    if (!item) {
+        m_tableWidget->setItem(row, column, new QTableWidgetItem(text));
+    } else if (item->text() != text) {
+        item->setText(text);
+    }
+}
+
 void MainWindow::updateStatusBar() {
     if (!m_statusLabel) {
         qWarning() << "Status label is null!";
@@ -322,10 +447,26 @@ void MainWindow::updateStatusBar() {
 
     int count = m_manager->getRecordCount();
     QString status = QString("Записей: %1").arg(count);
+    if (!m_manager->isOnline()) {
+        status += " | Автономный режим";
+    }
+    if (m_manager->isWarmedFromSnapshot()) {
+        status += " | Из снимка";
+    }
+    if (m_manager->pendingMutations() > 0) {
+        status += QString(" | Ожидают отправки в БД: %1").arg(m_manager->pendingMutations());
+    }
     if (!m_currentFilename.isEmpty()) {
         status += QString(" | Файл: %1").arg(m_currentFilename);
     }
     m_statusLabel->setText(status);
+
+    const RefreshStats stats = m_refresh->stats();
+    m_statusLabel->setToolTip(QString("Обновлений экрана: запрошено %1, слито %2, кадров %3, отложено %4")
+                                  .arg(stats.requests)
+                                  .arg(stats.merged)
+                                  .arg(stats.frames)
+                                  .arg(stats.dropped));
 }
 
 // Функция 1: Создать файл
@@ -341,7 +482,7 @@ void MainWindow::onCreateFile() {
 
     if (m_manager->createFile(filename)) {
         m_currentFilename = filename;
-        updateTable();
+        requestRefresh(RefreshScheduler::Table);
         QMessageBox::information(this, "Успех", "Файл успешно создан!");
     } else {
         QMessageBox::critical(this, "Ошибка", "Не удалось создать файл!");
@@ -350,7 +491,8 @@ void MainWindow::onCreateFile() {
 
 // Функция 2: Показать содержимое файла
 void MainWindow::onShowRecords() {
-    updateTable();
+    requestRefresh(RefreshScheduler::Table);
+    m_refresh->flush();
     QMessageBox::information(this, "Содержимое файла",
         QString("Всего записей в базе: %1").arg(m_manager->getRecordCount()));
 }
@@ -371,18 +513,42 @@ void MainWindow::onCreateSummaryFile() {
         return;
     }
 
+    QString filter = "Текстовые файлы (*.txt);;Все файлы (*)";
+    if (BufferedFileWriter::isGzipSupported()) {
+        filter = "Текстовые файлы (*.txt);;Сжатые файлы gzip (*.txt.gz);;Все файлы (*)";
+    }
+
     QString filename = QFileDialog::getSaveFileName(this,
         "Сохранить файл сводки",
         "baggage_summary.txt",
-        "Текстовые файлы (*.txt);;Все файлы (*)");
+        filter);
 
     if (filename.isEmpty()) {
         return;
     }
 
-    if (m_manager->createSummaryFile(filename)) {
+    QProgressDialog progressDialog("Создание файла сводки...", "Отмена", 0, 100, this);
+    progressDialog.setWindowModality(Qt::WindowModal);
+    progressDialog.setMinimumDuration(500);
+
+    SummaryExportOptions options;
+    options.gzip = filename.endsWith(".gz", Qt::CaseInsensitive);
+    options.progress = [&progressDialog](qint64 written, qint64 total) {
+        if (total > 0) {
+            progressDialog.setValue(static_cast<int>(qMin<qint64>(100, written * 100 / total)));
+        }
+        QCoreApplication::processEvents();
+        return !progressDialog.wasCanceled();
+    };
+
+    bool success = m_manager->createSummaryFile(filename, options);
+    progressDialog.reset();
+
+    if (success) {
         QMessageBox::information(this, "Успех",
             QString("Файл сводки успешно создан:\n%1").arg(filename));
+    } else if (progressDialog.wasCanceled()) {
+        QMessageBox::information(this, "Отмена", "Создание файла сводки отменено.");
     } else {
         QMessageBox::critical(this, "Ошибка", "Не удалось создать файл сводки!");
     }
@@ -407,39 +573,21 @@ void MainWindow::onShowSummaryFile() {
         return;
     }
 
-    // Читаем содержимое файла
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QMessageBox::critical(this, "Ошибка",
-            QString("Не удалось открыть файл для чтения:\n%1").arg(filename));
+    if (filename.endsWith(".gz", Qt::CaseInsensitive)) {
+        QMessageBox::warning(this, "Предупреждение",
+            "Сжатый файл сводки нужно распаковать перед просмотром.");
         return;
     }
 
-    QTextStream in(&file);
-    in.setEncoding(QStringConverter::Utf8);
-    QString content = in.readAll();
-    file.close();
-
-    // Создаем диалоговое окно для отображения содержимого
-    QDialog* dialog = new QDialog(this);
-    dialog->setWindowTitle("Просмотр файла сводки");
-    dialog->resize(700, 500);
-
-    QVBoxLayout* layout = new QVBoxLayout(dialog);
-
-    // Текстовое поле для отображения содержимого
-    QTextEdit* textEdit = new QTextEdit(dialog);
-    textEdit->setReadOnly(true);
-    textEdit->setPlainText(content);
-    textEdit->setFont(QFont("Monospace", 10));
-    layout->addWidget(textEdit);
-
-    // Кнопка "Закрыть"
-    QPushButton* closeButton = new QPushButton("Закрыть", dialog);
-    connect(closeButton, &QPushButton::clicked, dialog, &QDialog::accept);
-    layout->addWidget(closeButton);
+    // Файл отображается в память, индекс строк строится в фоне
+    SummaryFileViewer viewer(this);
+    if (!viewer.openFile(filename)) {
+        QMessageBox::critical(this, "Ошибка",
+            QString("Не удалось открыть файл для чтения:\n%1\n%2").arg(filename, viewer.errorString()));
+        return;
+    }
 
-    dialog->exec();
-    delete dialog;
+    viewer.exec();
 
     qDebug() << "Файл сводки успешно отображен:" << filename;
 }
@@ -452,7 +600,7 @@ void MainWindow::onAddRecord() {
         BaggageRecord record = dialog.getRecord();
 
         if (m_manager->addRecord(record)) {
-            updateTable();
+            requestRefresh(RefreshScheduler::Table);
             QMessageBox::information(this, "Успех", "Запись успешно добавлена!");
         } else {
             QMessageBox::critical(this, "Ошибка", "Не удалось добавить запись!");
@@ -473,7 +621,7 @@ void MainWindow::onDeleteByFlight() {
         QStringList flightNumbers = dialog.getFlightNumbers();
         int deletedCount = m_manager->deleteRecordsByFlightNumbers(flightNumbers);
 
-        updateTable();
+        requestRefresh(RefreshScheduler::Table);
         QMessageBox::information(this, "Результат",
             QString("Удалено записей: %1").arg(deletedCount));
     }
@@ -493,7 +641,7 @@ void MainWindow::onChangeItemCount() {
         QVector<double> newWeights = dialog.getItemWeights();
 
         if (m_manager->changeItemCountByName(passengerName, newWeights)) {
-            updateTable();
+            requestRefresh(RefreshScheduler::Table);
             QMessageBox::information(this, "Успех",
                 QString("Количество вещей изменено для:\n%1").arg(passengerName));
         } else {
@@ -519,7 +667,7 @@ void MainWindow::onOpenFile() {
 
     if (m_manager->loadFromFile(filename)) {
         m_currentFilename = filename;
-        updateTable();
+        requestRefresh(RefreshScheduler::Table);
         QMessageBox::information(this, "Успех", "Файл успешно загружен!");
     } else {
         QMessageBox::critical(this, "Ошибка", "Не удалось открыть файл!");
@@ -551,7 +699,7 @@ void MainWindow::onSaveAsFile() {
 
     if (m_manager->saveToFile(filename)) {
         m_currentFilename = filename;
-        updateStatusBar();
+        requestRefresh(RefreshScheduler::Status);
         QMessageBox::information(this, "Успех", "Файл успешно сохранен!");
     } else {
         QMessageBox::critical(this, "Ошибка", "Не удалось сохранить файл!");
@@ -566,6 +714,165 @@ void MainWindow::onGenerateDateReport() {
     dialog.exec();
 }
 
+void MainWindow::onExportArchive() {
+    bool ok = false;
+    QString text = QInputDialog::getMultiLineText(this,
+        "Экспорт архива рейсов",
+        "Номера рейсов (каждый с новой строки, пусто - все рейсы):",
+        "", &ok);
+
+    if (!ok) {
+        return;
+    }
+
+    QStringList flightNumbers;
+    for (const QString& line : text.split('\n', Qt::SkipEmptyParts)) {
+        QString trimmed = line.trimmed();
+        if (!trimmed.isEmpty()) {
+            flightNumbers.append(trimmed);
+        }
+    }
+
+    QString filename = QFileDialog::getSaveFileName(this,
+        "Сохранить архив рейсов",
+        "flights_archive.bga",
+        "Архивы рейсов (*.bga);;Все файлы (*)");
+
+    if (filename.isEmpty()) {
+        return;
+    }
+
+    if (m_manager->exportArchive(filename, flightNumbers)) {
+        QMessageBox::information(this, "Успех",
+            QString("Архив рейсов успешно создан:\n%1").arg(filename));
+    } else {
+        QMessageBox::critical(this, "Ошибка", "Не удалось создать архив рейсов!");
+    }
+}
+
+void MainWindow::onImportArchive() {
+    QString filename = QFileDialog::getOpenFileName(this,
+        "Открыть архив рейсов",
+        "",
+        "Архивы рейсов (*.bga);;Все файлы (*)");
+
+    if (filename.isEmpty()) {
+        return;
+    }
+
+    int imported = m_manager->importArchive(filename);
+    if (imported < 0) {
+        QMessageBox::critical(this, "Ошибка", "Не удалось прочитать архив рейсов!");
+        return;
+    }
+
+    requestRefresh(RefreshScheduler::Table);
+    QMessageBox::information(this, "Результат",
+        QString("Загружено записей из архива: %1").arg(imported));
+}
+
+void MainWindow::onImportManifest() {
+    QString filename = QFileDialog::getOpenFileName(this,
+        "Импорт манифеста",
+        "",
+        "Манифесты (*.csv *.txt *.jsonl *.ndjson);;Все файлы (*)");
+
+    if (filename.isEmpty()) {
+        return;
+    }
+
+    // Конвейер импорта пишет пачками через unnest() - только PostgreSQL
+    if (StorageEngine::current().isEmbedded()) {
+        QMessageBox::warning(this, "Импорт манифеста",
+            "Импорт манифеста доступен только при работе с PostgreSQL");
+        return;
+    }
+
+    QProgressDialog progressDialog("Импорт манифеста...", "Отмена", 0, 100, this);
+    progressDialog.setWindowModality(Qt::WindowModal);
+    progressDialog.setMinimumDuration(0);
+
+    // Конвейер работает в фоновом потоке, прогресс передаётся в GUI через очередь событий
+    BulkImporter importer;
+    ImportOptions options;
+    options.progress = [&progressDialog](const ImportStats& stats) {
+        const int percent = stats.totalBytes > 0
+            ? static_cast<int>(stats.bytesRead * 100 / stats.totalBytes) : 0;
+        const QString label = QString("Импортировано записей: %1 (%2 записей/с)")
+                                  .arg(stats.rowsImported)
+                                  .arg(stats.rowsPerSecond(), 0, 'f', 0);
+        QMetaObject::invokeMethod(&progressDialog, [&progressDialog, percent, label]() {
+            progressDialog.setValue(qMin(percent, 99));
+            progressDialog.setLabelText(label);
+        }, Qt::QueuedConnection);
+    };
+    connect(&progressDialog, &QProgressDialog::canceled, this, [&importer]() { importer.cancel(); });
+
+    bool success = false;
+    QThread* worker = QThread::create([&importer, &filename, &options, &success]() {
+        success = importer.run(filename, options);
+    });
+
+    QEventLoop loop;
+    connect(worker, &QThread::finished, &loop, &QEventLoop::quit);
+    worker->start();
+    loop.exec();
+    delete worker;
+    progressDialog.reset();
+
+    m_manager->catchUpWithDatabase();
+    requestRefresh(RefreshScheduler::Table);
+
+    const ImportStats stats = importer.stats();
+    QString summary = QString("Прочитано строк: %1\n"
+                              "Импортировано записей: %2\n"
+                              "Отклонено строк: %3\n"
+                              "Время: %4 с (%5 записей/с)")
+                          .arg(stats.rowsRead)
+                          .arg(stats.rowsImported)
+                          .arg(stats.rowsRejected)
+                          .arg(stats.elapsedMs / 1000.0, 0, 'f', 1)
+                          .arg(stats.rowsPerSecond(), 0, 'f', 0);
+    if (!importer.errorReportPath().isEmpty()) {
+        summary += "\n\nОтчёт об ошибках:\n" + importer.errorReportPath();
+    }
+
+    if (success) {
+        QMessageBox::information(this, "Импорт завершён", summary);
+    } else if (importer.isCancelled() && importer.errorString().isEmpty()) {
+        QMessageBox::warning(this, "Импорт отменён", summary);
+    } else {
+        QMessageBox::critical(this, "Ошибка импорта",
+            importer.errorString() + "\n\n" + summary);
+    }
+}
+
+// Загрузка рейсов в отдельном окне справа от главного; повторный вызов - поднять окно
+void MainWindow::onShowFlightLoad() {
+    if (m_loadDashboard) {
+        m_loadDashboard->raise();
+        m_loadDashboard->activateWindow();
+        return;
+    }
+    if (StorageEngine::current().engineName() != "postgres") {
+        QMessageBox::information(this, "Загрузка рейсов",
+                                 "Загрузка рейсов онлайн доступна только с PostgreSQL.");
+        return;
+    }
+
+    FlightLoadDashboard* dashboard = new FlightLoadDashboard(this);
+    dashboard->setAttribute(Qt::WA_DeleteOnClose);
+    if (!dashboard->start()) {
+        QMessageBox::warning(this, "Загрузка рейсов",
+                             "Не удалось подписаться на изменения:\n" + dashboard->errorString());
+        delete dashboard;
+        return;
+    }
+    dashboard->move(frameGeometry().topRight());
+    dashboard->show();
+    m_loadDashboard = dashboard;
+}
+
 void MainWindow::onAbout() {
     QMessageBox::about(this, "О программе",
         "Система управления багажом пассажиров\n\n"
@@ -0,0 +1,168 @@
+#include "MappedTextFile.h"
+#include <QThread>
+#include <QMutexLocker>
+#include <QByteArrayMatcher>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+// Сколько строк индексировать перед публикацией очередной порции
+constexpr int INDEX_PUBLISH_BATCH = 65536;
+}
+
+MappedTextFile::MappedTextFile(QObject* parent)
+    : QObject(parent), m_data(nullptr), m_size(0), m_indexThread(nullptr),
+      m_stopRequested(false), m_indexComplete(false) {
+}
+
+MappedTextFile::~MappedTextFile() {
+    close();
+}
+
+bool MappedTextFile::open(const QString& filename) {
+    close();
+
+    m_file.setFileName(filename);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_errorString = "Не удалось открыть файл для чтения: " + m_file.errorString();
+        return false;
+    }
+
+    m_size = m_file.size();
+    if (m_size > 0) {
+        m_data = m_file.map(0, m_size);
+        if (!m_data) {
+            m_errorString = "Не удалось отобразить файл в память: " + m_file.errorString();
+            m_file.close();
+            return false;
+        }
+    }
+
+    m_stopRequested = false;
+    m_indexComplete = false;
+    m_indexThread = QThread::create([this]() { buildIndex(); });
+    m_indexThread->start(QThread::LowPriority);
+    return true;
+}
+
+void MappedTextFile::close() {
+    stopIndexing();
+
+    if (m_data) {
+        m_file.unmap(const_cast<uchar*>(m_data));
+        m_data = nullptr;
+    }
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_lineStarts.clear();
+    m_size = 0;
+}
+
+void MappedTextFile::stopIndexing() {
+    if (m_indexThread) {
+        m_stopRequested = true;
+        m_indexThread->wait();
+        delete m_indexThread;
+        m_indexThread = nullptr;
+    }
+}
+
+void MappedTextFile::buildIndex() {
+    const char* data = reinterpret_cast<const char*>(m_data);
+    QVector<qint64> batch;
+    batch.reserve(INDEX_PUBLISH_BATCH);
+
+    auto publish = [this, &batch]() {
+        int count = 0;
+        {
+            QMutexLocker locker(&m_mutex);
+            m_lineStarts += batch;
+            count = m_lineStarts.size();
+        }
+        batch.clear();
+        emit linesIndexed(count);
+    };
+
+    qint64 position = 0;
+    while (position < m_size && !m_stopRequested) {
+        batch.append(position);
+
+        const void* newline = memchr(data + position, '\n', static_cast<size_t>(m_size - position));
+        if (!newline) {
+            break;
+        }
+        position = static_cast<const char*>(newline) - data + 1;
+
+        if (batch.size() >= INDEX_PUBLISH_BATCH) {
+            publish();
+        }
+    }
+
+    if (!batch.isEmpty()) {
+        publish();
+    }
+
+    if (!m_stopRequested) {
+        m_indexComplete = true;
+        emit indexingFinished(lineCount());
+    }
+}
+
+int MappedTextFile::lineCount() const {
+    QMutexLocker locker(&m_mutex);
+    return m_lineStarts.size();
+}
+
+QString MappedTextFile::line(int index) const {
+    qint64 start = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (index < 0 || index >= m_lineStarts.size()) {
+            return QString();
+        }
+        start = m_lineStarts[index];
+    }
+
+    const char* begin = reinterpret_cast<const char*>(m_data) + start;
+    const void* newline = memchr(begin, '\n', static_cast<size_t>(m_size - start));
+    qint64 length = newline ? static_cast<const char*>(newline) - begin : m_size - start;
+
+    if (length > 0 && begin[length - 1] == '\r') {
+        --length;
+    }
+    return QString::fromUtf8(begin, static_cast<int>(length));
+}
+
+int MappedTextFile::findNext(const QString& text, int fromLine) const {
+    if (text.isEmpty() || !m_data) {
+        return -1;
+    }
+
+    qint64 searchFrom = 0;
+    qint64 searchTo = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (fromLine < 0 || fromLine >= m_lineStarts.size()) {
+            return -1;
+        }
+        searchFrom = m_lineStarts[fromLine];
+        // Пока индекс строится, ищем только в проиндексированной части
+        searchTo = isIndexComplete() ? m_size : m_lineStarts.last();
+    }
+
+    QByteArrayMatcher matcher(text.toUtf8());
+    qsizetype found = matcher.indexIn(reinterpret_cast<const char*>(m_data),
+                                      static_cast<qsizetype>(searchTo), searchFrom);
+    if (found < 0) {
+        return -1;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    auto it = std::upper_bound(m_lineStarts.constBegin(), m_lineStarts.constEnd(),
+                               static_cast<qint64>(found));
+    return static_cast<int>(it - m_lineStarts.constBegin()) - 1;
+}
@@ -0,0 +1,482 @@
+#include "MemoryStorage.h"
+#include <QDateTime>
+#include <QMap>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+// Сжатие не запускается ради мелочи
+constexpr int COMPACT_MIN_DEAD = 1024;
+
+// Ограничения таблиц PostgreSQL (init-db.sql)
+constexpr int FLIGHT_NUMBER_MAX_LENGTH = 50;
+constexpr int PASSENGER_NAME_MAX_LENGTH = 255;
+
+qint64 toMicros(const QDateTime& value) {
+    return value.toMSecsSinceEpoch() * 1000;
+}
+
+// weight NUMERIC(5,2): PostgreSQL округляет вес до сотых
+double roundWeight(double weight) {
+    return qRound64(weight * 100.0) / 100.0;
+}
+
+// Пустая строка - запись проходит ограничения таблиц
+QString constraintError(const BaggageRecord& record) {
+    if (record.getFlightNumber().isEmpty() || record.getFlightNumber().size() > FLIGHT_NUMBER_MAX_LENGTH) {
+        return "недопустимый номер рейса";
+    }
+    if (record.getPassengerName().isEmpty() || record.getPassengerName().size() > PASSENGER_NAME_MAX_LENGTH) {
+        return "недопустимое ФИО";
+    }
+    if (record.getItemCount() > BaggageRecord::MAX_ITEMS) {
+        return "слишком много вещей";
+    }
+    for (double weight : record.getItemWeights()) {
+        if (!BaggageRecord::isValidWeight(weight)) {
+            return "недопустимый вес вещи";
+        }
+    }
+    return QString();
+}
+
+} // namespace
+
+MemoryStorage& MemoryStorage::instance() {
+    static MemoryStorage instance;
+    return instance;
+}
+
+MemoryStorage::MemoryStorage()
+    : m_deadWeights(0), m_liveCount(0), m_nextId(1), m_lastVersion(0), m_connected(false) {
+}
+
+bool MemoryStorage::connectFromEnvironment(QString* connectionInfo) {
+    if (connectionInfo) {
+        *connectionInfo = "Память процесса (данные не сохраняются)";
+    }
+    QWriteLocker locker(&m_lock);
+    m_connected = true;
+    return true;
+}
+
+void MemoryStorage::disconnectFromDatabase() {
+    QWriteLocker locker(&m_lock);
+    m_connected = false;
+}
+
+bool MemoryStorage::isConnected() const {
+    QReadLocker locker(&m_lock);
+    return m_connected;
+}
+
+bool MemoryStorage::checkConnection() {
+    if (isConnected()) {
+        return true;
+    }
+    m_lastError.localData() = "Хранилище в памяти не подключено";
+    return false;
+}
+
+bool MemoryStorage::createTable() {
+    return true;
+}
+
+qint64 MemoryStorage::nextVersion() {
+    m_lastVersion = qMax(QDateTime::currentMSecsSinceEpoch() * 1000, m_lastVersion + 1);
+    return m_lastVersion;
+}
+
+int MemoryStorage::flightCode(const QString& flightNumber) {
+    auto it = m_flightCodeByName.constFind(flightNumber);
+    if (it != m_flightCodeByName.constEnd()) {
+        return it.value();
+    }
+    const int code = m_flightNames.size();
+    m_flightNames.append(flightNumber);
+    m_flightCodeByName.insert(flightNumber, code);
+    return code;
+}
+
+void MemoryStorage::appendRow(const BaggageRecord& record, qint64 version) {
+    const int row = m_ids.size();
+    const int code = flightCode(record.getFlightNumber());
+    const QVector<double> weights = record.getItemWeights();
+
+    m_ids.append(m_nextId++);
+    m_flightCodes.append(code);
+    m_passengerNames.append(record.getPassengerName());
+    m_createdAt.append(version);
+    m_updatedAt.append(version);
+    m_itemOffsets.append(m_weights.size());
+    m_itemCounts.append(static_cast<quint8>(weights.size()));
+    m_deleted.append(false);
+    for (double weight : weights) {
+        m_weights.append(roundWeight(weight));
+    }
+
+    m_rowsByFlight[code].append(row);
+    m_rowsByPassenger[record.getPassengerName()].append(row);
+    ++m_liveCount;
+}
+
+// Перестроить столбцы без удалённых строк и заменённых весов
+void MemoryStorage::compactIfNeeded() {
+    const int deadRows = m_ids.size() - m_liveCount;
+    const bool manyRows = deadRows >= COMPACT_MIN_DEAD && deadRows > m_liveCount;
+    const bool manyWeights = m_deadWeights >= COMPACT_MIN_DEAD && m_deadWeights > m_weights.size() / 2;
+    if (!manyRows && !manyWeights) {
+        return;
+    }
+
+    QVector<qint64> ids, createdAt, updatedAt;
+    QVector<int> flightCodes, itemOffsets;
+    QVector<QString> passengerNames;
+    QVector<quint8> itemCounts;
+    QVector<double> weights;
+    ids.reserve(m_liveCount);
+    weights.reserve(m_weights.size() - m_deadWeights);
+
+    m_rowsByFlight.clear();
+    m_rowsByPassenger.clear();
+    for (int row = 0; row < m_ids.size(); ++row) {
+        if (m_deleted[row]) {
+            continue;
+        }
+        const int newRow = ids.size();
+        ids.append(m_ids[row]);
+        flightCodes.append(m_flightCodes[row]);
+        passengerNames.append(m_passengerNames[row]);
+        createdAt.append(m_createdAt[row]);
+        updatedAt.append(m_updatedAt[row]);
+        itemOffsets.append(weights.size());
+        itemCounts.append(m_itemCounts[row]);
+        for (int i = 0; i < m_itemCounts[row]; ++i) {
+            weights.append(m_weights[m_itemOffsets[row] + i]);
+        }
+        m_rowsByFlight[m_flightCodes[row]].append(newRow);
+        m_rowsByPassenger[m_passengerNames[row]].append(newRow);
+    }
+
+    m_ids = ids;
+    m_flightCodes = flightCodes;
+    m_passengerNames = passengerNames;
+    m_createdAt = createdAt;
+    m_updatedAt = updatedAt;
+    m_itemOffsets = itemOffsets;
+    m_itemCounts = itemCounts;
+    m_weights = weights;
+    m_deleted = QVector<bool>(m_ids.size(), false);
+    m_deadWeights = 0;
+}
+
+BaggageRecord MemoryStorage::recordAt(int row) const {
+    const int offset = m_itemOffsets[row];
+    return BaggageRecord(m_flightNames[m_flightCodes[row]], m_passengerNames[row],
+                         m_weights.mid(offset, m_itemCounts[row]));
+}
+
+// Строки с created_at в [from, to]: created_at не убывает с номером строки
+QVector<int> MemoryStorage::rowsInRange(const QDateTime& from, const QDateTime& to) const {
+    auto first = std::lower_bound(m_createdAt.cbegin(), m_createdAt.cend(), toMicros(from));
+    auto last = std::upper_bound(first, m_createdAt.cend(), toMicros(to));
+
+    QVector<int> rows;
+    for (int row = static_cast<int>(first - m_createdAt.cbegin());
+         row < static_cast<int>(last - m_createdAt.cbegin()); ++row) {
+        if (!m_deleted[row]) {
+            rows.append(row);
+        }
+    }
+    return rows;
+}
+
+// Строки рейсов в порядке (номер рейса, id), как ORDER BY в DatabaseManager
+QVector<int> MemoryStorage::rowsOfFlights(const QStringList& flightNumbers) const {
+    QStringList names = flightNumbers;
+    if (names.isEmpty()) {
+        for (auto it = m_rowsByFlight.cbegin(); it != m_rowsByFlight.cend(); ++it) {
+            names.append(m_flightNames[it.key()]);
+        }
+    }
+    names.sort();
+    names.removeDuplicates();
+
+    QVector<int> rows;
+    for (const QString& name : names) {
+        auto code = m_flightCodeByName.constFind(name);
+        if (code == m_flightCodeByName.constEnd()) {
+            continue;
+        }
+        for (int row : m_rowsByFlight.value(code.value())) {
+            if (!m_deleted[row]) {
+                rows.append(row);
+            }
+        }
+    }
+    return rows;
+}
+
+// Функция 2: Получить все записи (в порядке id)
+QVector<BaggageRecord> MemoryStorage::getAllRecords(qint64* dataVersion) {
+    QReadLocker locker(&m_lock);
+    QVector<BaggageRecord> records;
+    records.reserve(m_liveCount);
+    qint64 version = 0;
+    for (int row = 0; row < m_ids.size(); ++row) {
+        if (!m_deleted[row]) {
+            records.append(recordAt(row));
+            version = qMax(version, m_updatedAt[row]);
+        }
+    }
+    if (dataVersion) {
+        *dataVersion = version;
+    }
+    return records;
+}
+
+// Функция 6: Добавить запись
+bool MemoryStorage::addRecord(const BaggageRecord& record) {
+    if (!record.isValid()) {
+        m_lastError.localData() = "Попытка добавить невалидную запись";
+        qWarning() << m_lastError.localData();
+        return false;
+    }
+    return addRecordsBatch({record});
+}
+
+// Пачка проверяется целиком до изменения данных - добавляется вся или ничего
+bool MemoryStorage::addRecordsBatch(const QVector<BaggageRecord>& records) {
+    for (int i = 0; i < records.size(); ++i) {
+        const QString error = constraintError(records[i]);
+        if (!error.isEmpty()) {
+            m_lastError.localData() = QString("Ошибка пакетной вставки записей: запись %1 - %2")
+                                          .arg(i + 1).arg(error);
+            qWarning() << m_lastError.localData();
+            return false;
+        }
+    }
+    if (records.isEmpty()) {
+        return true;
+    }
+
+    QWriteLocker locker(&m_lock);
+    const qint64 version = nextVersion();
+    for (const BaggageRecord& record : records) {
+        appendRow(record, version);
+    }
+    return true;
+}
+
+// Функция 7: Удалить записи по номерам рейсов (вместе с вещами)
+int MemoryStorage::deleteRecordsByFlightNumbers(const QStringList& flightNumbers) {
+    QWriteLocker locker(&m_lock);
+    int affectedRows = 0;
+
+    for (const QString& flightNumber : flightNumbers) {
+        auto code = m_flightCodeByName.constFind(flightNumber);
+        if (code == m_flightCodeByName.constEnd()) {
+            continue;
+        }
+        const QVector<int> rows = m_rowsByFlight.take(code.value());
+        for (int row : rows) {
+            if (m_deleted[row]) {
+                continue;
+            }
+            m_deleted[row] = true;
+            m_deadWeights += m_itemCounts[row];
+            --m_liveCount;
+            ++affectedRows;
+
+            auto byName = m_rowsByPassenger.find(m_passengerNames[row]);
+            if (byName != m_rowsByPassenger.end()) {
+                byName.value().removeOne(row);
+                if (byName.value().isEmpty()) {
+                    m_rowsByPassenger.erase(byName);
+                }
+            }
+        }
+    }
+
+    compactIfNeeded();
+    return affectedRows;
+}
+
+// Функция 8: Изменить количество вещей для указанных ФИО (первая запись пассажира)
+bool MemoryStorage::changeItemCountByName(const QString& passengerName,
+                                          const QVector<double>& newWeights) {
+    if (passengerName.trimmed().isEmpty()) {
+        m_lastError.localData() = "ФИО пассажира не может быть пустым";
+        return false;
+    }
+    if (!BaggageRecord::isValidItemCount(newWeights.size())) {
+        m_lastError.localData() = "Неверное количество вещей (должно быть от 1 до 5)";
+        return false;
+    }
+    for (double weight : newWeights) {
+        if (!BaggageRecord::isValidWeight(weight)) {
+            m_lastError.localData() = "Неверный вес вещи (должен быть от 0 до 100 кг)";
+            return false;
+        }
+    }
+
+    QWriteLocker locker(&m_lock);
+    const QVector<int> rows = m_rowsByPassenger.value(passengerName);
+    if (rows.isEmpty()) {
+        m_lastError.localData() = "Пассажир с указанным ФИО не найден";
+        return false;
+    }
+
+    const int row = rows.first();
+    m_deadWeights += m_itemCounts[row];
+    m_itemOffsets[row] = m_weights.size();
+    m_itemCounts[row] = static_cast<quint8>(newWeights.size());
+    for (double weight : newWeights) {
+        m_weights.append(roundWeight(weight));
+    }
+    m_updatedAt[row] = nextVersion();
+
+    compactIfNeeded();
+    return true;
+}
+
+void MemoryStorage::clearAllRecords() {
+    QWriteLocker locker(&m_lock);
+    m_ids.clear();
+    m_flightCodes.clear();
+    m_passengerNames.clear();
+    m_createdAt.clear();
+    m_updatedAt.clear();
+    m_itemOffsets.clear();
+    m_itemCounts.clear();
+    m_deleted.clear();
+    m_weights.clear();
+    m_deadWeights = 0;
+    m_flightNames.clear();
+    m_flightCodeByName.clear();
+    m_rowsByFlight.clear();
+    m_rowsByPassenger.clear();
+    m_liveCount = 0;
+}
+
+int MemoryStorage::getRecordCount() {
+    QReadLocker locker(&m_lock);
+    return m_liveCount;
+}
+
+QVector<BaggageRecord> MemoryStorage::findRecordsByFlightNumber(const QString& flightNumber) {
+    QReadLocker locker(&m_lock);
+    QVector<BaggageRecord> records;
+    for (int row : rowsOfFlights({flightNumber})) {
+        records.append(recordAt(row));
+    }
+    return records;
+}
+
+QVector<BaggageRecord> MemoryStorage::findRecordsByPassengerName(const QString& passengerName) {
+    QReadLocker locker(&m_lock);
+    QVector<BaggageRecord> records;
+    for (int row : m_rowsByPassenger.value(passengerName)) {
+        records.append(recordAt(row));
+    }
+    return records;
+}
+
+QVector<FlightStats> MemoryStorage::getFlightStatsByDateRange(const QDateTime& from, const QDateTime& to) {
+    m_lastError.localData().clear();
+    QReadLocker locker(&m_lock);
+
+    // По коду рейса, затем по номеру рейса - как ORDER BY flight_number
+    QHash<int, FlightStats> byCode;
+    for (int row : rowsInRange(from, to)) {
+        FlightStats& flight = byCode[m_flightCodes[row]];
+        ++flight.passengerCount;
+        flight.itemCount += m_itemCounts[row];
+        const int offset = m_itemOffsets[row];
+        for (int i = 0; i < m_itemCounts[row]; ++i) {
+            flight.totalWeight += m_weights[offset + i];
+        }
+    }
+
+    QMap<QString, FlightStats> byName;
+    for (auto it = byCode.begin(); it != byCode.end(); ++it) {
+        it.value().flightNumber = m_flightNames[it.key()];
+        byName.insert(it.value().flightNumber, it.value());
+    }
+    return byName.values().toVector();
+}
+
+bool MemoryStorage::streamRecordsByDateRange(const QDateTime& from, const QDateTime& to,
+                                             const RecordHandler& recordHandler) {
+    QVector<BaggageRecord> records;
+    {
+        QReadLocker locker(&m_lock);
+        for (int row : rowsInRange(from, to)) {
+            records.append(recordAt(row));
+        }
+    }
+    for (const BaggageRecord& record : records) {
+        if (!recordHandler(record)) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool MemoryStorage::streamRecords(const QStringList& flightNumbers, const RecordHandler& recordHandler) {
+    QVector<BaggageRecord> records;
+    {
+        QReadLocker locker(&m_lock);
+        for (int row : rowsOfFlights(flightNumbers)) {
+            records.append(recordAt(row));
+        }
+    }
+    for (const BaggageRecord& record : records) {
+        if (!recordHandler(record)) {
+            break;
+        }
+    }
+    return true;
+}
+
+qint64 MemoryStorage::getDataVersion(int* recordCount) {
+    QReadLocker locker(&m_lock);
+    qint64 version = 0;
+    for (int row = 0; row < m_updatedAt.size(); ++row) {
+        if (!m_deleted[row]) {
+            version = qMax(version, m_updatedAt[row]);
+        }
+    }
+    if (recordCount) {
+        *recordCount = m_liveCount;
+    }
+    return version;
+}
+
+int MemoryStorage::countPassengerChangesSince(const QString& passengerName, qint64 version) {
+    QReadLocker locker(&m_lock);
+    int changed = 0;
+    for (int row : m_rowsByPassenger.value(passengerName)) {
+        if (m_updatedAt[row] > version) {
+            ++changed;
+        }
+    }
+    return changed;
+}
+
+int MemoryStorage::countFlightChangesSince(const QStringList& flightNumbers, qint64 version) {
+    if (flightNumbers.isEmpty()) {
+        return 0;
+    }
+    QReadLocker locker(&m_lock);
+    int changed = 0;
+    for (int row : rowsOfFlights(flightNumbers)) {
+        if (m_updatedAt[row] > version) {
+            ++changed;
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,456 @@
+#include "MutationJournal.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QStandardPaths>
+#include <QFileInfo>
+#include <QDir>
+#include <QtEndian>
+#include <QMutexLocker>
+#include <QDebug>
+#include <array>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char MAGIC[4] = {'B', 'G', 'J', 'L'};
+constexpr int HEADER_SIZE = 16;
+constexpr int FRAME_HEADER_SIZE = 8;                  // длина + crc32
+constexpr quint32 MAX_ENTRY_SIZE = 16 * 1024 * 1024;
+constexpr qint64 COMPACT_THRESHOLD = 64 * 1024;       // сжимать файл, когда всё применено
+
+// CRC-32 (IEEE 802.3), табличный вариант
+quint32 crc32(const QByteArray& data) {
+    static const std::array<quint32, 256> table = []() {
+        std::array<quint32, 256> result{};
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            result[i] = c;
+        }
+        return result;
+    }();
+
+    quint32 crc = 0xFFFFFFFFu;
+    const uchar* bytes = reinterpret_cast<const uchar*>(data.constData());
+    for (int i = 0; i < data.size(); ++i) {
+        crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+bool fsyncFile(QFile& file) {
+    if (!file.flush()) {
+        return false;
+    }
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+} // namespace
+
+MutationJournal::MutationJournal()
+    : m_lastSequence(0), m_unsyncedEntries(0), m_syncEveryEntries(32), m_syncIntervalMs(50) {
+}
+
+MutationJournal::~MutationJournal() {
+    close();
+}
+
+bool MutationJournal::open(const QString& filename) {
+    QMutexLocker locker(&m_mutex);
+    close();
+    m_errorString.clear();
+    m_pending.clear();
+    m_lastSequence = 0;
+
+    QDir().mkpath(QFileInfo(filename).absolutePath());
+    m_file.setFileName(filename);
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        m_errorString = "Не удалось открыть журнал изменений: " + m_file.errorString();
+        return false;
+    }
+
+    if (m_file.size() == 0) {
+        if (!writeHeader(0) || !sync()) {
+            close();
+            return false;
+        }
+        m_sinceSync.start();
+        return true;
+    }
+
+    QVector<Entry> entries;
+    qint64 validEnd = 0;
+    quint64 baseSequence = 0;
+    if (!scan(m_file, entries, validEnd, baseSequence, &m_errorString)) {
+        m_file.close();
+        return false;
+    }
+
+    // Недописанная запись в конце (сбой при записи) - отбрасываем
+    if (validEnd < m_file.size()) {
+        qWarning() << "Журнал изменений: отброшен повреждённый хвост"
+                   << (m_file.size() - validEnd) << "байт";
+        if (!m_file.resize(validEnd)) {
+            m_errorString = "Не удалось восстановить журнал: " + m_file.errorString();
+            m_file.close();
+            return false;
+        }
+    }
+
+    m_lastSequence = baseSequence;
+    for (const Entry& entry : entries) {
+        if (entry.type == Applied) {
+            while (!m_pending.isEmpty() && m_pending.first().sequence <= entry.sequence) {
+                m_pending.removeFirst();
+            }
+        } else {
+            m_pending.append(entry);
+            m_lastSequence = qMax(m_lastSequence, entry.sequence);
+        }
+    }
+
+    m_file.seek(validEnd);
+    m_sinceSync.start();
+    qDebug() << "Журнал изменений открыт:" << filename << "неприменённых записей:" << m_pending.size();
+    return true;
+}
+
+void MutationJournal::close() {
+    QMutexLocker locker(&m_mutex);
+    if (m_file.isOpen()) {
+        sync();
+        m_file.close();
+    }
+}
+
+bool MutationJournal::isOpen() const {
+    QMutexLocker locker(&m_mutex);
+    return m_file.isOpen();
+}
+
+QVector<MutationJournal::Entry> MutationJournal::pendingEntries() const {
+    QMutexLocker locker(&m_mutex);
+    return m_pending;
+}
+
+int MutationJournal::pendingCount() const {
+    QMutexLocker locker(&m_mutex);
+    return m_pending.size();
+}
+
+quint64 MutationJournal::lastSequence() const {
+    QMutexLocker locker(&m_mutex);
+    return m_lastSequence;
+}
+
+QString MutationJournal::errorString() const {
+    QMutexLocker locker(&m_mutex);
+    return m_errorString;
+}
+
+QString MutationJournal::fileName() const {
+    QMutexLocker locker(&m_mutex);
+    return m_file.fileName();
+}
+
+void MutationJournal::setSyncPolicy(int everyEntries, int intervalMs) {
+    QMutexLocker locker(&m_mutex);
+    m_syncEveryEntries = qMax(1, everyEntries);
+    m_syncIntervalMs = qMax(0, intervalMs);
+}
+
+MutationJournal::Entry MutationJournal::appendAdd(const BaggageRecord& record) {
+    Entry entry;
+    entry.type = AddRecord;
+    entry.record = record;
+    return append(entry);
+}
+
+MutationJournal::Entry MutationJournal::appendDelete(const QStringList& flightNumbers,
+                                                     qint64 baseVersion) {
+    Entry entry;
+    entry.type = DeleteFlights;
+    entry.flightNumbers = flightNumbers;
+    entry.baseVersion = baseVersion;
+    return append(entry);
+}
+
+MutationJournal::Entry MutationJournal::appendChangeItems(const QString& passengerName,
+                                                          const QVector<double>& weights,
+                                                          qint64 baseVersion) {
+    Entry entry;
+    entry.type = ChangeItems;
+    entry.passengerName = passengerName;
+    entry.weights = weights;
+    entry.baseVersion = baseVersion;
+    return append(entry);
+}
+
+MutationJournal::Entry MutationJournal::append(Entry entry) {
+    QMutexLocker locker(&m_mutex);
+    entry.sequence = m_lastSequence + 1;
+    entry.timestampMsecs = QDateTime::currentMSecsSinceEpoch();
+
+    if (!m_file.isOpen() || !writeEntry(entry)) {
+        entry.sequence = 0;
+        return entry;
+    }
+
+    m_lastSequence = entry.sequence;
+    m_pending.append(entry);
+
+    ++m_unsyncedEntries;
+    if (m_unsyncedEntries >= m_syncEveryEntries || m_sinceSync.elapsed() >= m_syncIntervalMs) {
+        sync();
+    }
+    return entry;
+}
+
+bool MutationJournal::markApplied(quint64 sequence) {
+    QMutexLocker locker(&m_mutex);
+    if (m_pending.isEmpty() || m_pending.first().sequence > sequence) {
+        return true;
+    }
+
+    Entry marker;
+    marker.type = Applied;
+    marker.sequence = sequence;
+    marker.timestampMsecs = QDateTime::currentMSecsSinceEpoch();
+    // Маркер - сразу на диск: иначе после сбоя уже применённые к БД
+    // записи перенеслись бы повторно (повторное добавление - дубликат записи)
+    if (!writeEntry(marker) || !sync()) {
+        return false;
+    }
+
+    while (!m_pending.isEmpty() && m_pending.first().sequence <= sequence) {
+        m_pending.removeFirst();
+    }
+
+    // Всё применено - файл можно начать заново
+    if (m_pending.isEmpty() && m_file.size() > COMPACT_THRESHOLD) {
+        return compact();
+    }
+    return true;
+}
+
+bool MutationJournal::sync() {
+    QMutexLocker locker(&m_mutex);
+    if (!m_file.isOpen()) {
+        return false;
+    }
+    m_unsyncedEntries = 0;
+    m_sinceSync.restart();
+    if (!fsyncFile(m_file)) {
+        m_errorString = "Ошибка сброса журнала на диск: " + m_file.errorString();
+        qWarning() << m_errorString;
+        return false;
+    }
+    return true;
+}
+
+bool MutationJournal::compact() {
+    if (!m_file.resize(0) || !m_file.seek(0)) {
+        m_errorString = "Не удалось сжать журнал: " + m_file.errorString();
+        qWarning() << m_errorString;
+        return false;
+    }
+    return writeHeader(m_lastSequence) && sync();
+}
+
+bool MutationJournal::writeHeader(quint64 baseSequence) {
+    QByteArray header(HEADER_SIZE, '\0');
+    memcpy(header.data(), MAGIC, sizeof(MAGIC));
+    qToLittleEndian<quint16>(FORMAT_VERSION, header.data() + 4);
+    qToLittleEndian<quint64>(baseSequence, header.data() + 8);
+
+    if (m_file.write(header) != header.size()) {
+        m_errorString = "Ошибка записи заголовка журнала: " + m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool MutationJournal::writeEntry(const Entry& entry) {
+    QByteArray payload = encodePayload(entry);
+    QByteArray frame(FRAME_HEADER_SIZE, '\0');
+    qToLittleEndian<quint32>(static_cast<quint32>(payload.size()), frame.data());
+    qToLittleEndian<quint32>(crc32(payload), frame.data() + 4);
+    frame += payload;
+
+    if (m_file.write(frame) != frame.size()) {
+        m_errorString = "Ошибка записи в журнал изменений: " + m_file.errorString();
+        qWarning() << m_errorString;
+        return false;
+    }
+    return true;
+}
+
+// Последовательное чтение записей; validEnd - конец последней целой записи
+bool MutationJournal::scan(QFile& file, QVector<Entry>& entries, qint64& validEnd,
+                           quint64& baseSequence, QString* errorString) {
+    file.seek(0);
+    QByteArray header = file.read(HEADER_SIZE);
+    if (header.size() != HEADER_SIZE || memcmp(header.constData(), MAGIC, sizeof(MAGIC)) != 0) {
+        if (errorString) {
+            *errorString = "Файл не является журналом изменений: " + file.fileName();
+        }
+        return false;
+    }
+    quint16 version = qFromLittleEndian<quint16>(header.constData() + 4);
+    if (version > FORMAT_VERSION) {
+        if (errorString) {
+            *errorString = QString("Неподдерживаемая версия журнала: %1").arg(version);
+        }
+        return false;
+    }
+    baseSequence = qFromLittleEndian<quint64>(header.constData() + 8);
+
+    validEnd = HEADER_SIZE;
+    const qint64 fileSize = file.size();
+    while (validEnd + FRAME_HEADER_SIZE <= fileSize) {
+        QByteArray frameHeader = file.read(FRAME_HEADER_SIZE);
+        if (frameHeader.size() != FRAME_HEADER_SIZE) {
+            break;
+        }
+        quint32 length = qFromLittleEndian<quint32>(frameHeader.constData());
+        quint32 checksum = qFromLittleEndian<quint32>(frameHeader.constData() + 4);
+        if (length == 0 || length > MAX_ENTRY_SIZE
+            || validEnd + FRAME_HEADER_SIZE + length > fileSize) {
+            break;
+        }
+
+        QByteArray payload = file.read(length);
+        Entry entry;
+        if (payload.size() != static_cast<int>(length) || crc32(payload) != checksum
+            || !decodePayload(payload, entry)) {
+            break;
+        }
+
+        entries.append(entry);
+        validEnd += FRAME_HEADER_SIZE + length;
+    }
+    return true;
+}
+
+bool MutationJournal::readEntries(const QString& filename, QVector<Entry>& entries,
+                                  QString* errorString) {
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorString) {
+            *errorString = "Не удалось открыть журнал изменений: " + file.errorString();
+        }
+        return false;
+    }
+
+    qint64 validEnd = 0;
+    quint64 baseSequence = 0;
+    return scan(file, entries, validEnd, baseSequence, errorString);
+}
+
+QByteArray MutationJournal::encodePayload(const Entry& entry) {
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << static_cast<quint8>(entry.type) << entry.sequence << entry.timestampMsecs;
+
+    switch (entry.type) {
+    case AddRecord:
+        out << entry.record;
+        break;
+    case DeleteFlights:
+        out << entry.flightNumbers << entry.baseVersion;
+        break;
+    case ChangeItems:
+        out << entry.passengerName << entry.weights << entry.baseVersion;
+        break;
+    case Applied:
+        break;
+    }
+    return payload;
+}
+
+bool MutationJournal::decodePayload(const QByteArray& payload, Entry& entry) {
+    QDataStream in(payload);
+    in.setVersion(QDataStream::Qt_5_15);
+
+    quint8 type = 0;
+    in >> type >> entry.sequence >> entry.timestampMsecs;
+    entry.type = static_cast<EntryType>(type);
+
+    switch (entry.type) {
+    case AddRecord:
+        in >> entry.record;
+        break;
+    case DeleteFlights:
+        in >> entry.flightNumbers;
+        if (!in.atEnd()) {
+            in >> entry.baseVersion;
+        }
+        break;
+    case ChangeItems:
+        in >> entry.passengerName >> entry.weights;
+        if (!in.atEnd()) {
+            in >> entry.baseVersion;
+        }
+        break;
+    case Applied:
+        break;
+    default:
+        return false;
+    }
+    return in.status() == QDataStream::Ok;
+}
+
+void MutationJournal::applyToRecords(const Entry& entry, QVector<BaggageRecord>& records) {
+    switch (entry.type) {
+    case AddRecord:
+        records.append(entry.record);
+        break;
+    case DeleteFlights:
+        for (int i = records.size() - 1; i >= 0; --i) {
+            if (entry.flightNumbers.contains(records[i].getFlightNumber())) {
+                records.remove(i);
+            }
+        }
+        break;
+    case ChangeItems:
+        // Как и в БД, меняется первая найденная запись с этим ФИО
+        for (BaggageRecord& record : records) {
+            if (record.getPassengerName() == entry.passengerName) {
+                record.setItemWeights(entry.weights);
+                break;
+            }
+        }
+        break;
+    case Applied:
+        break;
+    }
+}
+
+QString MutationJournal::entryTypeName(EntryType type) {
+    switch (type) {
+    case AddRecord:     return "add";
+    case DeleteFlights: return "delete";
+    case ChangeItems:   return "change_items";
+    case Applied:       return "applied";
+    }
+    return "unknown";
+}
+
+QString MutationJournal::defaultPath() {
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    QDir().mkpath(dir);
+    return dir + "/mutations.journal";
+}
@@ -0,0 +1,135 @@
+#include "PurgeEngine.h"
+#include "DatabaseManager.h"
+#include "ShardedStorage.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QDebug>
+
+PurgeEngine::PurgeEngine(DatabaseManager& db) : m_db(db), m_cancelled(false) {
+}
+
+bool PurgeEngine::purgeFlights(const QStringList& flightNumbers, const PurgeOptions& options) {
+    return run("flight_number = ANY(?::text[])", DatabaseManager::pgTextArray(flightNumbers), options);
+}
+
+bool PurgeEngine::purgeOlderThan(const QDateTime& cutoff, const PurgeOptions& options) {
+    return run("created_at < ?", cutoff, options);
+}
+
+int PurgeEngine::retentionDaysFromEnvironment() {
+    return qMax(0, qEnvironmentVariable("BAGGAGE_RETENTION_DAYS", "0").toInt());
+}
+
+QVector<DatabaseManager*> PurgeEngine::databasesOf(StorageEngine& engine) {
+    QVector<DatabaseManager*> databases;
+    if (auto* sharded = dynamic_cast<ShardedStorage*>(&engine)) {
+        for (int i = 0; i < sharded->shardCount(); ++i) {
+            databases.append(&sharded->shard(i));
+        }
+    } else if (auto* database = dynamic_cast<DatabaseManager*>(&engine)) {
+        databases.append(database);
+    }
+    return databases;
+}
+
+bool PurgeEngine::run(const QString& condition, const QVariant& value, const PurgeOptions& options) {
+    m_stats = PurgeStats();
+    m_errorString.clear();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QSqlDatabase db = m_db.connection();
+    if (!db.isOpen()) {
+        m_errorString = "База данных не подключена";
+        qWarning() << m_errorString;
+        return false;
+    }
+
+    static const QStringList tables = {"baggage_records", "baggage_archive"};
+    for (const QString& table : tables) {
+        QSqlQuery countQuery(db);
+        countQuery.prepare(QString("SELECT COUNT(*) FROM %1 WHERE %2").arg(table, condition));
+        countQuery.addBindValue(value);
+        if (!countQuery.exec() || !countQuery.next()) {
+            m_errorString = "Ошибка подсчёта записей для очистки: " + countQuery.lastError().text();
+            qWarning() << m_errorString;
+            return false;
+        }
+        m_stats.recordsMatched += countQuery.value(0).toLongLong();
+    }
+
+    bool ok = true;
+    for (const QString& table : tables) {
+        if (m_cancelled || !ok) {
+            break;
+        }
+        ok = purgeTable(db, table, condition, value, options, timer);
+    }
+
+    if (m_stats.recordsDeleted > 0) {
+        m_db.noteWrite(db);
+    }
+    m_stats.elapsedMs = timer.elapsed();
+    qDebug() << "Очистка: удалено записей" << m_stats.recordsDeleted << "порций" << m_stats.chunksCommitted
+             << (m_cancelled ? "(отменена)" : "");
+    return ok && !m_cancelled;
+}
+
+bool PurgeEngine::purgeTable(QSqlDatabase& db, const QString& table, const QString& condition,
+                             const QVariant& value, const PurgeOptions& options, QElapsedTimer& timer) {
+    // Порция - следующие chunkSize подходящих записей после последнего
+    // отобранного id; каждый запрос - отдельная короткая транзакция.
+    // Удалено может быть меньше отобранного (часть записей успели удалить
+    // другие), поэтому конец - только порция, в которой ничего не отобрано
+    QSqlQuery deleteQuery(db);
+    deleteQuery.prepare(QString(R"(
+        WITH chunk AS (
+            SELECT id FROM %1
+            WHERE %2 AND id > ?
+            ORDER BY id
+            LIMIT ?
+        ), deleted AS (
+            DELETE FROM %1 t USING chunk
+            WHERE t.id = chunk.id
+            RETURNING t.id
+        )
+        SELECT (SELECT COUNT(*) FROM chunk), (SELECT COALESCE(MAX(id), 0) FROM chunk),
+               (SELECT COUNT(*) FROM deleted)
+    )").arg(table, condition));
+
+    const int chunkSize = qMax(1, options.chunkSize);
+    qint64 lastId = 0;
+    while (!m_cancelled) {
+        deleteQuery.bindValue(0, value);
+        deleteQuery.bindValue(1, lastId);
+        deleteQuery.bindValue(2, chunkSize);
+        if (!deleteQuery.exec() || !deleteQuery.next()) {
+            m_errorString = "Ошибка удаления порции записей: " + deleteQuery.lastError().text();
+            qWarning() << m_errorString;
+            return false;
+        }
+        const qint64 selected = deleteQuery.value(0).toLongLong();
+        lastId = qMax(lastId, deleteQuery.value(1).toLongLong());
+        const qint64 deleted = deleteQuery.value(2).toLongLong();
+        deleteQuery.finish();
+
+        if (deleted > 0) {
+            m_stats.recordsDeleted += deleted;
+            ++m_stats.chunksCommitted;
+            m_stats.elapsedMs = timer.elapsed();
+            if (options.progress) {
+                options.progress(m_stats);
+            }
+        }
+        if (selected == 0) {
+            break;
+        }
+        if (options.pauseMs > 0) {
+            QThread::msleep(options.pauseMs);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,61 @@
+#include "RefreshScheduler.h"
+#include <QEvent>
+
+RefreshScheduler::RefreshScheduler(QWidget* window, int frameIntervalMs, QObject* parent)
+    : QObject(parent),
+      m_window(window),
+      m_pending(0) {
+    m_frameTimer.setSingleShot(true);
+    m_frameTimer.setInterval(qMax(1, frameIntervalMs));
+    connect(&m_frameTimer, &QTimer::timeout, this, &RefreshScheduler::onFrame);
+    if (m_window) {
+        m_window->installEventFilter(this);
+    }
+}
+
+void RefreshScheduler::request(Part part) {
+    ++m_stats.requests;
+    if (m_pending != 0) {
+        ++m_stats.merged;
+    }
+    m_pending |= part;
+    if (!isWindowShown()) {
+        ++m_stats.dropped;
+    } else if (!m_frameTimer.isActive()) {
+        m_frameTimer.start();
+    }
+}
+
+void RefreshScheduler::flush() {
+    m_frameTimer.stop();
+    if (m_pending == 0) {
+        return;
+    }
+    const int parts = m_pending;
+    m_pending = 0;
+    ++m_stats.frames;
+    emit refreshDue(parts);
+}
+
+void RefreshScheduler::onFrame() {
+    // Свернули между запросом и кадром - ждём показа окна
+    if (!isWindowShown()) {
+        ++m_stats.dropped;
+        return;
+    }
+    flush();
+}
+
+// Показ или разворачивание окна - применить отложенное
+bool RefreshScheduler::eventFilter(QObject* watched, QEvent* event) {
+    if (watched == m_window && m_pending != 0
+        && (event->type() == QEvent::Show || event->type() == QEvent::WindowStateChange)
+        && isWindowShown() && !m_frameTimer.isActive()) {
+        m_frameTimer.start();
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+bool RefreshScheduler::isWindowShown() const {
+    return !m_window || (m_window->isVisible() && !m_window->isMinimized());
+}
@@ -0,0 +1,152 @@
+#include "ReportWriter.h"
+#include "StorageEngine.h"
+#include <QDebug>
+
+// ==================== PreviewReportSink ====================
+
+PreviewReportSink::PreviewReportSink(int maxLines)
+    : m_maxLines(qMax(1, maxLines)), m_truncated(false) {
+}
+
+bool PreviewReportSink::writeLine(const QString& line) {
+    if (m_lines.size() >= m_maxLines) {
+        m_truncated = true;
+        return false;
+    }
+    m_lines.append(line);
+    return true;
+}
+
+// ==================== FileReportSink ====================
+
+FileReportSink::FileReportSink() {
+}
+
+bool FileReportSink::open(const QString& filename, bool gzip) {
+    return m_writer.open(filename, gzip);
+}
+
+bool FileReportSink::writeLine(const QString& line) {
+    m_writer.write(line.toUtf8());
+    m_writer.write('\n');
+    return !m_writer.hasError();
+}
+
+bool FileReportSink::close() {
+    return m_writer.close();
+}
+
+void FileReportSink::discard() {
+    m_writer.discard();
+}
+
+// ==================== DateRangeReportWriter ====================
+
+DateRangeReportWriter::DateRangeReportWriter(const QDateTime& from, const QDateTime& to)
+    : m_from(from), m_to(to), m_recordCount(0) {
+}
+
+bool DateRangeReportWriter::write(ReportSink& sink) {
+    m_recordCount = 0;
+    m_errorString.clear();
+
+    bool sinkOpen = true;
+    auto line = [&sink, &sinkOpen](const QString& text) {
+        if (sinkOpen) {
+            sinkOpen = sink.writeLine(text);
+        }
+    };
+
+    StorageEngine& dbManager = StorageEngine::current();
+    QVector<FlightStats> flights = dbManager.getFlightStatsByDateRange(m_from, m_to);
+    // Пустой результат при ошибке запроса - не "записей не найдено"
+    if (flights.isEmpty() && !dbManager.getLastError().isEmpty()) {
+        m_errorString = dbManager.getLastError();
+        return false;
+    }
+
+    // Заголовок отчёта
+    line("========================================");
+    line("   ОТЧЁТ ЗА ПЕРИОД ВРЕМЕНИ");
+    line("========================================");
+    line("");
+    line("Период: с " + m_from.toString("dd.MM.yyyy HH:mm") +
+         " по " + m_to.toString("dd.MM.yyyy HH:mm"));
+    line("Дата формирования: " + QDateTime::currentDateTime().toString("dd.MM.yyyy HH:mm:ss"));
+    line("");
+
+    if (flights.isEmpty()) {
+        line("----------------------------------------");
+        line("ЗА УКАЗАННЫЙ ПЕРИОД ЗАПИСЕЙ НЕ НАЙДЕНО");
+        line("----------------------------------------");
+        return true;
+    }
+
+    // Общая статистика (из агрегатов по рейсам)
+    double totalWeight = 0.0;
+    int totalItems = 0;
+    for (const FlightStats& flight : flights) {
+        m_recordCount += flight.passengerCount;
+        totalItems += flight.itemCount;
+        totalWeight += flight.totalWeight;
+    }
+
+    line("----------------------------------------");
+    line("ОБЩАЯ СТАТИСТИКА:");
+    line("----------------------------------------");
+    line(QString("Количество записей: %1").arg(m_recordCount));
+    line("Общий вес багажа: " + QString::number(totalWeight, 'f', 2) + " кг");
+    line(QString("Общее количество вещей: %1").arg(totalItems));
+    line(QString("Количество уникальных рейсов: %1").arg(flights.size()));
+    line("");
+
+    // Список рейсов
+    line("----------------------------------------");
+    line("СПИСОК РЕЙСОВ:");
+    line("----------------------------------------");
+    for (const FlightStats& flight : flights) {
+        line(QString("  %1 - пассажиров: %2, вес: %3 кг")
+                 .arg(flight.flightNumber, -10)
+                 .arg(flight.passengerCount, 3)
+                 .arg(flight.totalWeight, 0, 'f', 2));
+    }
+    line("");
+
+    // Детальный список записей - потоком из курсора
+    line("----------------------------------------");
+    line("ДЕТАЛЬНЫЙ СПИСОК ЗАПИСЕЙ:");
+    line("----------------------------------------");
+    line(QString("%1 | %2 | %3 | %4 | %5")
+             .arg("№", -5)
+             .arg("Рейс", -10)
+             .arg("Пассажир", -30)
+             .arg("Вещей", -7)
+             .arg("Общий вес", -12));
+    line(QString("-").repeated(80));
+
+    if (sinkOpen) {
+        int index = 0;
+        bool ok = dbManager.streamRecordsByDateRange(m_from, m_to,
+            [&line, &sinkOpen, &index](const BaggageRecord& record) {
+                line(QString("%1 | %2 | %3 | %4 | %5 кг")
+                         .arg(++index, -5)
+                         .arg(record.getFlightNumber(), -10)
+                         .arg(record.getPassengerName(), -30)
+                         .arg(record.getItemCount(), -7)
+                         .arg(record.getTotalWeight(), -10, 'f', 2));
+                return sinkOpen;
+            });
+
+        if (!ok) {
+            m_errorString = dbManager.getLastError();
+            return false;
+        }
+    }
+
+    line("");
+    line("========================================");
+    line("   КОНЕЦ ОТЧЁТА");
+    line("========================================");
+
+    return true;
+}
@@ -0,0 +1,401 @@
+#include "ScanEventIngestor.h"
+#include "DatabaseManager.h"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QIODevice>
+#include <QThread>
+#include <QDateTime>
+#include <QDeadlineTimer>
+#include <QMutexLocker>
+#include <QDebug>
+
+namespace {
+
+constexpr qint64 MSECS_PER_DAY = 24 * 60 * 60 * 1000LL;
+constexpr int MAX_LOCATION_LENGTH = 100;
+// Пауза потока записи, когда буфер пуст, и потока приёма, когда он заполнен
+constexpr unsigned long IDLE_WAIT_US = 200;
+
+// Пачка - три параметра-массива, одна подготовка на любой размер пачки
+const char INSERT_EVENTS_SQL[] = R"(
+    INSERT INTO baggage_events (bag_tag, location, scanned_at)
+    SELECT e.tag, e.location, to_timestamp(e.ms / 1000.0)
+    FROM unnest(?::bigint[], ?::text[], ?::bigint[]) AS e(tag, location, ms)
+)";
+
+QString partitionName(qint64 day) {
+    return "baggage_events_" + QDateTime::fromMSecsSinceEpoch(day * MSECS_PER_DAY, Qt::UTC)
+                                   .toString("yyyyMMdd");
+}
+
+QString utcBound(qint64 day) {
+    return QDateTime::fromMSecsSinceEpoch(day * MSECS_PER_DAY, Qt::UTC).toString("yyyy-MM-dd") + " 00:00:00+00";
+}
+
+} // namespace
+
+ScanEventIngestor::ScanEventIngestor(const ScanIngestOptions& options)
+    : m_options(options),
+      m_ring(static_cast<size_t>(qMax(2, options.ringCapacity))),
+      m_thread(nullptr),
+      m_stopping(true),
+      m_accepted(0),
+      m_rejected(0),
+      m_stalls(0),
+      m_written(0),
+      m_failed(0),
+      m_batches(0),
+      m_retries(0) {
+    m_options.maxBatchSize = qMax(1, m_options.maxBatchSize);
+    m_options.maxTrackedTags = qMax(2, m_options.maxTrackedTags);
+    m_options.maxDelayMs = qMax(0, m_options.maxDelayMs);
+}
+
+ScanEventIngestor::~ScanEventIngestor() {
+    stop();
+}
+
+bool ScanEventIngestor::createTable(QSqlDatabase& db, QString* error) {
+    QSqlQuery query(db);
+    const bool ok = query.exec(R"(
+            CREATE TABLE IF NOT EXISTS baggage_events (
+                bag_tag BIGINT NOT NULL,
+                location VARCHAR(100) NOT NULL,
+                scanned_at TIMESTAMPTZ NOT NULL
+            ) PARTITION BY RANGE (scanned_at)
+        )")
+        && query.exec("CREATE INDEX IF NOT EXISTS idx_baggage_events_tag ON baggage_events(bag_tag, scanned_at)");
+    if (!ok) {
+        const QString message = "Ошибка создания таблицы baggage_events: " + query.lastError().text();
+        qWarning() << message;
+        if (error) {
+            *error = message;
+        }
+    }
+    return ok;
+}
+
+bool ScanEventIngestor::start() {
+    if (m_thread) {
+        return true;
+    }
+    m_stopping = false;
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->start();
+    return true;
+}
+
+void ScanEventIngestor::stop() {
+    if (!m_thread) {
+        return;
+    }
+    m_stopping = true;
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+}
+
+bool ScanEventIngestor::hasRoom() {
+    // Читатель только освобождает место, поэтому для потока приёма ответ точен
+    // или занижен, но не завышен
+    if (m_ring.size() < m_ring.capacity()) {
+        return true;
+    }
+    ++m_stalls;
+    return false;
+}
+
+bool ScanEventIngestor::submit(const ScanEvent& event) {
+    if (m_stopping) {
+        return false;
+    }
+    if (!m_ring.tryPush(event)) {
+        // Буфер заполнен: ждём поток записи, а не теряем события
+        ++m_stalls;
+        while (!m_ring.tryPush(event)) {
+            if (m_stopping) {
+                return false;
+            }
+            QThread::usleep(IDLE_WAIT_US);
+        }
+    }
+    ++m_accepted;
+    return true;
+}
+
+bool ScanEventIngestor::submitLine(const QByteArray& line) {
+    ScanEvent event;
+    if (!parseLine(line, &event)) {
+        ++m_rejected;
+        return false;
+    }
+    return submit(event);
+}
+
+qint64 ScanEventIngestor::ingestDevice(QIODevice* device, bool follow) {
+    qint64 lines = 0;
+    QByteArray pending;
+    while (!m_stopping) {
+        const QByteArray chunk = device->readLine();
+        if (chunk.isEmpty()) {
+            // Конец данных: без follow - последняя строка без перевода строки тоже событие
+            if (!follow) {
+                break;
+            }
+            QThread::msleep(100);
+            continue;
+        }
+        pending += chunk;
+        if (!pending.endsWith('\n')) {
+            continue;
+        }
+        const QByteArray line = pending.trimmed();
+        pending.clear();
+        if (!line.isEmpty() && !line.startsWith('#')) {
+            submitLine(line);
+            ++lines;
+        }
+    }
+
+    const QByteArray line = pending.trimmed();
+    if (!line.isEmpty() && !line.startsWith('#')) {
+        submitLine(line);
+        ++lines;
+    }
+    return lines;
+}
+
+bool ScanEventIngestor::parseLine(const QByteArray& line, ScanEvent* event) {
+    const QList<QByteArray> fields = line.split('\t');
+    if (fields.size() < 2 || fields.size() > 3) {
+        return false;
+    }
+
+    bool ok = false;
+    event->tag = fields[0].trimmed().toLongLong(&ok);
+    if (!ok || event->tag <= 0) {
+        return false;
+    }
+    event->location = QString::fromUtf8(fields[1].trimmed());
+    if (event->location.isEmpty() || event->location.size() > MAX_LOCATION_LENGTH) {
+        return false;
+    }
+
+    if (fields.size() < 3 || fields[2].trimmed().isEmpty()) {
+        event->scannedAtMs = QDateTime::currentMSecsSinceEpoch();
+        return true;
+    }
+    const QByteArray time = fields[2].trimmed();
+    event->scannedAtMs = time.toLongLong(&ok);
+    if (!ok) {
+        const QDateTime parsed = QDateTime::fromString(QString::fromLatin1(time), Qt::ISODateWithMs);
+        if (!parsed.isValid()) {
+            return false;
+        }
+        event->scannedAtMs = parsed.toMSecsSinceEpoch();
+    }
+    return event->scannedAtMs > 0;
+}
+
+bool ScanEventIngestor::lastScan(qint64 tag, ScanEvent* event) const {
+    QReadLocker locker(&m_latestLock);
+    auto it = m_latest.constFind(tag);
+    if (it == m_latest.constEnd()) {
+        it = m_previousLatest.constFind(tag);
+        if (it == m_previousLatest.constEnd()) {
+            return false;
+        }
+    }
+    if (event) {
+        *event = it.value();
+    }
+    return true;
+}
+
+// Бирка есть только в одном из поколений
+int ScanEventIngestor::trackedTags() const {
+    QReadLocker locker(&m_latestLock);
+    return m_latest.size() + m_previousLatest.size();
+}
+
+ScanIngestStats ScanEventIngestor::stats() const {
+    ScanIngestStats stats;
+    stats.accepted = m_accepted.load();
+    stats.rejected = m_rejected.load();
+    stats.stalls = m_stalls.load();
+    stats.written = m_written.load();
+    stats.failed = m_failed.load();
+    stats.batches = m_batches.load();
+    stats.retries = m_retries.load();
+    return stats;
+}
+
+QString ScanEventIngestor::errorString() const {
+    QMutexLocker locker(&m_errorMutex);
+    return m_errorString;
+}
+
+void ScanEventIngestor::setError(const QString& error) {
+    qWarning() << error;
+    QMutexLocker locker(&m_errorMutex);
+    m_errorString = error;
+}
+
+void ScanEventIngestor::run() {
+    const QString connectionName = QString("baggage_scan_events_%1")
+                                       .arg(reinterpret_cast<quintptr>(this), 0, 16);
+    {
+        // Не открылось - откроется при записи первой пачки
+        QSqlDatabase db = DatabaseManager::instance().openWorkerConnection(connectionName);
+
+        QVector<ScanEvent> batch;
+        batch.reserve(m_options.maxBatchSize);
+        ScanEvent event;
+        forever {
+            if (!m_ring.tryPop(event)) {
+                // Поток приёма уже не пишет в буфер после stop() - пустой буфер окончателен
+                if (m_stopping && m_ring.size() == 0) {
+                    break;
+                }
+                QThread::usleep(IDLE_WAIT_US);
+                continue;
+            }
+            batch.append(std::move(event));
+
+            // Первое событие пришло - добираем пачку не дольше maxDelayMs
+            QDeadlineTimer deadline(m_options.maxDelayMs);
+            while (batch.size() < m_options.maxBatchSize) {
+                if (m_ring.tryPop(event)) {
+                    batch.append(std::move(event));
+                } else if (m_stopping || deadline.hasExpired()) {
+                    break;
+                } else {
+                    QThread::usleep(IDLE_WAIT_US);
+                }
+            }
+
+            if (writeWithRetry(db, batch)) {
+                m_written += batch.size();
+                ++m_batches;
+                rememberLatest(batch);
+            } else {
+                m_failed += batch.size();
+            }
+            batch.clear();
+        }
+    }
+    DatabaseManager::closeWorkerConnection(connectionName);
+}
+
+bool ScanEventIngestor::writeWithRetry(QSqlDatabase& db, const QVector<ScanEvent>& batch) {
+    int delayMs = RETRY_DELAY_MS;
+    for (int attempt = 1;; ++attempt) {
+        if (!db.isOpen() && !db.open()) {
+            setError("Приём событий: нет подключения к БД: " + db.lastError().text());
+        } else if (writeBatch(db, batch)) {
+            return true;
+        } else {
+            // Ошибка из-за обрыва - переподключиться перед повтором
+            QSqlQuery ping(db);
+            if (!ping.exec("SELECT 1")) {
+                db.close();
+            }
+        }
+
+        if (m_stopping && attempt >= STOP_RETRY_ATTEMPTS) {
+            return false;
+        }
+        ++m_retries;
+        QThread::msleep(static_cast<unsigned long>(m_stopping ? RETRY_DELAY_MS : delayMs));
+        delayMs = qMin(delayMs * 2, RETRY_MAX_DELAY_MS);
+    }
+}
+
+// Более раннее сканирование (пришло с опозданием) не заменяет позднее
+void ScanEventIngestor::rememberLatest(const QVector<ScanEvent>& batch) {
+    QWriteLocker locker(&m_latestLock);
+    for (const ScanEvent& scan : batch) {
+        auto it = m_latest.find(scan.tag);
+        if (it != m_latest.end()) {
+            if (it->scannedAtMs <= scan.scannedAtMs) {
+                *it = scan;
+            }
+            continue;
+        }
+
+        ScanEvent latest = scan;
+        const auto previous = m_previousLatest.constFind(scan.tag);
+        if (previous != m_previousLatest.constEnd()) {
+            if (previous->scannedAtMs > scan.scannedAtMs) {
+                latest = previous.value();
+            }
+            m_previousLatest.erase(previous);
+        }
+        // Поколение заполнено - прежнее (не сканированные с тех пор бирки) вытесняется
+        if (m_latest.size() >= m_options.maxTrackedTags / 2) {
+            m_previousLatest.swap(m_latest);
+            m_latest.clear();
+        }
+        m_latest.insert(scan.tag, latest);
+    }
+}
+
+bool ScanEventIngestor::writeBatch(QSqlDatabase& db, const QVector<ScanEvent>& batch) {
+    if (!ensurePartitions(db, batch)) {
+        return false;
+    }
+
+    QVector<qint64> tags;
+    QStringList locations;
+    QVector<qint64> times;
+    tags.reserve(batch.size());
+    locations.reserve(batch.size());
+    times.reserve(batch.size());
+    for (const ScanEvent& event : batch) {
+        tags.append(event.tag);
+        locations.append(event.location);
+        times.append(event.scannedAtMs);
+    }
+
+    QSqlQuery query(db);
+    query.prepare(INSERT_EVENTS_SQL);
+    query.addBindValue(DatabaseManager::pgNumberArray(tags));
+    query.addBindValue(DatabaseManager::pgTextArray(locations));
+    query.addBindValue(DatabaseManager::pgNumberArray(times));
+    if (!query.exec()) {
+        setError("Ошибка записи событий сканирования: " + query.lastError().text());
+        return false;
+    }
+    return true;
+}
+
+// Секция на каждые сутки (UTC), в которые попали события пачки
+bool ScanEventIngestor::ensurePartitions(QSqlDatabase& db, const QVector<ScanEvent>& batch) {
+    QSet<qint64> days;
+    for (const ScanEvent& event : batch) {
+        const qint64 day = event.scannedAtMs / MSECS_PER_DAY;
+        if (!m_partitionDays.contains(day)) {
+            days.insert(day);
+        }
+    }
+
+    QSqlQuery query(db);
+    for (qint64 day : days) {
+        const QString sql = QString("CREATE TABLE IF NOT EXISTS %1 PARTITION OF baggage_events "
+                                    "FOR VALUES FROM ('%2') TO ('%3')")
+                                .arg(partitionName(day), utcBound(day), utcBound(day + 1));
+        if (!query.exec(sql)) {
+            // Ту же секцию мог одновременно создать другой приёмник
+            QSqlQuery check(db);
+            check.prepare("SELECT to_regclass(?) IS NOT NULL");
+            check.addBindValue(partitionName(day));
+            if (!check.exec() || !check.next() || !check.value(0).toBool()) {
+                setError("Ошибка создания секции " + partitionName(day) + ": " + query.lastError().text());
+                return false;
+            }
+        }
+        m_partitionDays.insert(day);
+    }
+    return true;
+}
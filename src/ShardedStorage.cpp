@@ -0,0 +1,752 @@
+#include "ShardedStorage.h"
+#include "DatabaseManager.h"
+#include "BoundedQueue.h"
+#include <QSemaphore>
+#include <QThread>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QMap>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+// Записи рейса удаляются и возвращаются одной командой: основная выборка
+// видит вещи до каскадного удаления, а записи, добавленные после начала
+// команды, не удаляются и остаются на сегменте до следующего переноса
+const char TAKE_FLIGHT_SQL[] = R"(
+    WITH taken AS (
+        DELETE FROM baggage_records WHERE flight_number = ?
+        RETURNING id, flight_number, passenger_name
+    )
+    SELECT t.flight_number, t.passenger_name,
+           COALESCE(array_agg(bi.weight ORDER BY bi.item_number) FILTER (WHERE bi.id IS NOT NULL), '{}')::text
+    FROM taken t
+    LEFT JOIN baggage_items bi ON bi.baggage_record_id = t.id
+    GROUP BY t.id, t.flight_number, t.passenger_name
+    ORDER BY t.id
+)";
+
+} // namespace
+
+ShardedStorage& ShardedStorage::instance() {
+    static ShardedStorage instance;
+    return instance;
+}
+
+ShardedStorage::ShardedStorage() {
+    m_pool.setExpiryTimeout(-1);
+}
+
+ShardedStorage::~ShardedStorage() {
+    m_pool.waitForDone();
+    disconnectFromDatabase();
+}
+
+// FNV-1a (32 бита): не зависит от платформы и запуска, в отличие от qHash
+int ShardedStorage::shardFor(const QString& flightNumber, int shardCount) {
+    if (shardCount <= 1) {
+        return 0;
+    }
+    quint32 hash = 2166136261u;
+    for (char byte : flightNumber.toUtf8()) {
+        hash ^= static_cast<quint8>(byte);
+        hash *= 16777619u;
+    }
+    return static_cast<int>(hash % static_cast<quint32>(shardCount));
+}
+
+bool ShardedStorage::connectFromEnvironment(QString* connectionInfo) {
+    const QString dbName = qEnvironmentVariable("DB_NAME", "baggage_db");
+    const QString dbUser = qEnvironmentVariable("DB_USER", "postgres");
+    const QString dbPassword = qEnvironmentVariable("DB_PASSWORD", "postgres");
+
+    QStringList addresses = qEnvironmentVariable("DB_SHARDS").split(',', Qt::SkipEmptyParts);
+    if (addresses.isEmpty()) {
+        addresses.append(qEnvironmentVariable("DB_HOST", "postgres") + ":" +
+                         qEnvironmentVariable("DB_PORT", "5432"));
+    }
+
+    m_pool.waitForDone();
+    m_shards.clear();
+    m_pool.setMaxThreadCount(qMax(1, addresses.size() - 1));
+
+    QStringList info;
+    bool ok = true;
+    for (int i = 0; i < addresses.size(); ++i) {
+        const QString address = addresses[i].trimmed();
+        const int colon = address.lastIndexOf(':');
+        const QString host = colon > 0 ? address.left(colon) : address;
+        const int port = colon > 0 ? address.mid(colon + 1).toInt() : 5432;
+        info.append(QString("Shard %1: %2:%3").arg(i).arg(host).arg(port));
+
+        m_shards.emplace_back(new DatabaseManager(QString("baggage_shard_%1").arg(i)));
+        if (!m_shards.back()->connectToDatabase(host, port, dbName, dbUser, dbPassword)) {
+            m_lastError.localData() = QString("Сегмент %1 (%2): %3")
+                                          .arg(i).arg(address, m_shards.back()->getLastError());
+            ok = false;
+        }
+    }
+
+    if (connectionInfo) {
+        *connectionInfo = info.join("\n") + "\nDatabase: " + dbName + "\nUser: " + dbUser;
+    }
+    return ok;
+}
+
+void ShardedStorage::disconnectFromDatabase() {
+    for (auto& shard : m_shards) {
+        shard->disconnectFromDatabase();
+    }
+}
+
+bool ShardedStorage::isConnected() const {
+    if (m_shards.empty()) {
+        return false;
+    }
+    for (const auto& shard : m_shards) {
+        if (!shard->isConnected()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Проверяются подключения текущего потока - последовательно
+bool ShardedStorage::checkConnection() {
+    if (m_shards.empty()) {
+        m_lastError.localData() = "Сегменты БД не настроены";
+        return false;
+    }
+    for (int i = 0; i < shardCount(); ++i) {
+        if (!m_shards[i]->checkConnection()) {
+            m_lastError.localData() = QString("Сегмент %1: %2").arg(i).arg(m_shards[i]->getLastError());
+            return false;
+        }
+    }
+    return true;
+}
+
+void ShardedStorage::releaseThreadConnection() {
+    for (auto& shard : m_shards) {
+        shard->releaseThreadConnection();
+    }
+}
+
+QSqlDatabase& ShardedStorage::getDatabase() {
+    static QSqlDatabase notConnected;
+    return m_shards.empty() ? notConnected : m_shards.front()->getDatabase();
+}
+
+DatabaseManager& ShardedStorage::shardOf(const QString& flightNumber) {
+    return *m_shards[shardFor(flightNumber, shardCount())];
+}
+
+QHash<int, QStringList> ShardedStorage::groupByShard(const QStringList& flightNumbers) const {
+    QHash<int, QStringList> groups;
+    for (const QString& flightNumber : flightNumbers) {
+        groups[shardFor(flightNumber, shardCount())].append(flightNumber);
+    }
+    return groups;
+}
+
+void ShardedStorage::forEachShard(const std::function<void(int)>& task) {
+    const int count = shardCount();
+    QSemaphore done;
+    for (int i = 1; i < count; ++i) {
+        m_pool.start([&task, &done, i]() {
+            task(i);
+            done.release();
+        });
+    }
+    if (count > 0) {
+        task(0);
+    }
+    done.acquire(qMax(0, count - 1));
+}
+
+void ShardedStorage::setShardErrors(const QVector<QString>& errors) {
+    QStringList messages;
+    for (int i = 0; i < errors.size(); ++i) {
+        if (!errors[i].isEmpty()) {
+            messages.append(QString("Сегмент %1: %2").arg(i).arg(errors[i]));
+        }
+    }
+    if (!messages.isEmpty()) {
+        m_lastError.localData() = messages.join("; ");
+    }
+}
+
+bool ShardedStorage::createTable() {
+    for (int i = 0; i < shardCount(); ++i) {
+        if (!m_shards[i]->createTable()) {
+            m_lastError.localData() = QString("Сегмент %1: %2").arg(i).arg(m_shards[i]->getLastError());
+            return false;
+        }
+        if (i > 0 && !m_shards[i]->reserveBagTags(i * BAG_TAG_RANGE)) {
+            m_lastError.localData() = QString("Сегмент %1: %2").arg(i).arg(m_shards[i]->getLastError());
+            return false;
+        }
+    }
+    return !m_shards.empty();
+}
+
+// Версия - наибольшая по сегментам; каждый сегмент читается своим снимком
+QVector<BaggageRecord> ShardedStorage::getAllRecords(qint64* dataVersion) {
+    QVector<QVector<BaggageRecord>> parts(shardCount());
+    QVector<qint64> versions(shardCount(), -1);
+    QVector<QString> errors(shardCount());
+
+    forEachShard([&](int i) {
+        parts[i] = m_shards[i]->getAllRecords(dataVersion ? &versions[i] : nullptr);
+        if (dataVersion && versions[i] < 0) {
+            errors[i] = m_shards[i]->getLastError();
+        }
+    });
+    setShardErrors(errors);
+
+    QVector<BaggageRecord> records;
+    for (const QVector<BaggageRecord>& part : parts) {
+        records += part;
+    }
+    if (dataVersion) {
+        *dataVersion = versions.isEmpty() ? -1 : *std::max_element(versions.cbegin(), versions.cend());
+        if (std::find(versions.cbegin(), versions.cend(), -1) != versions.cend()) {
+            *dataVersion = -1;
+        }
+    }
+    return records;
+}
+
+bool ShardedStorage::addRecord(const BaggageRecord& record) {
+    DatabaseManager& shard = shardOf(record.getFlightNumber());
+    if (!shard.addRecord(record)) {
+        m_lastError.localData() = shard.getLastError();
+        return false;
+    }
+    return true;
+}
+
+// Части пачки вставляются в открытые транзакции сегментов и фиксируются вместе
+bool ShardedStorage::addRecordsBatch(const QVector<BaggageRecord>& records) {
+    QMap<int, QVector<BaggageRecord>> parts;
+    for (const BaggageRecord& record : records) {
+        parts[shardFor(record.getFlightNumber(), shardCount())].append(record);
+    }
+    if (parts.size() <= 1) {
+        if (parts.isEmpty()) {
+            return true;
+        }
+        DatabaseManager& shard = *m_shards[parts.firstKey()];
+        if (!shard.addRecordsBatch(parts.first())) {
+            m_lastError.localData() = shard.getLastError();
+            return false;
+        }
+        return true;
+    }
+
+    QVector<QSqlDatabase> begun;
+    auto rollbackAll = [&begun](int from) {
+        for (int i = from; i < begun.size(); ++i) {
+            begun[i].rollback();
+        }
+    };
+
+    for (auto it = parts.cbegin(); it != parts.cend(); ++it) {
+        QSqlDatabase db = m_shards[it.key()]->connection();
+        QString error;
+        if (!db.transaction()) {
+            error = "Не удалось начать транзакцию: " + db.lastError().text();
+        } else {
+            begun.append(db);
+            DatabaseManager::insertRecordsBatch(db, it.value(), &error, false);
+        }
+        if (!error.isEmpty()) {
+            m_lastError.localData() = QString("Сегмент %1: %2").arg(it.key()).arg(error);
+            rollbackAll(0);
+            return false;
+        }
+    }
+
+    for (int i = 0; i < begun.size(); ++i) {
+        if (!begun[i].commit()) {
+            m_lastError.localData() = "Не удалось зафиксировать транзакцию сегмента: " + begun[i].lastError().text();
+            if (i > 0) {
+                qCritical() << "Пачка зафиксирована частично:" << i << "из" << begun.size()
+                            << "сегментов -" << m_lastError.localData();
+            }
+            rollbackAll(i);
+            return false;
+        }
+    }
+    return true;
+}
+
+int ShardedStorage::deleteRecordsByFlightNumbers(const QStringList& flightNumbers) {
+    return deleteFlightsBatch(flightNumbers);
+}
+
+int ShardedStorage::deleteFlightsBatch(const QStringList& flightNumbers, QVector<int>* outcomes) {
+    // Номера рейсов в исходном списке по сегментам
+    QHash<int, QVector<int>> indexes;
+    for (int i = 0; i < flightNumbers.size(); ++i) {
+        indexes[shardFor(flightNumbers[i], shardCount())].append(i);
+    }
+
+    QVector<int> result(flightNumbers.size(), 0);
+    QVector<int> deleted(shardCount(), 0);
+    QVector<QString> errors(shardCount());
+    forEachShard([&](int shard) {
+        if (!indexes.contains(shard)) {
+            return;
+        }
+        const QVector<int>& positions = indexes[shard];
+        QStringList part;
+        for (int index : positions) {
+            part.append(flightNumbers[index]);
+        }
+        QVector<int> partOutcomes;
+        deleted[shard] = m_shards[shard]->deleteFlightsBatch(part, &partOutcomes);
+        // Транзакция сегмента не выполнена - у всех его рейсов -1
+        if (partOutcomes.contains(-1)) {
+            errors[shard] = m_shards[shard]->getLastError();
+        }
+        for (int k = 0; k < positions.size(); ++k) {
+            result[positions[k]] = partOutcomes[k];
+        }
+    });
+    setShardErrors(errors);
+
+    if (outcomes) {
+        *outcomes = result;
+    }
+    int total = 0;
+    for (int count : deleted) {
+        total += count;
+    }
+    return total;
+}
+
+// Архив рейса - на сегменте рейса; сегменты закрывают свои рейсы
+// отдельными транзакциями
+int ShardedStorage::closeFlights(const QStringList& flightNumbers, QVector<int>* outcomes) {
+    QHash<int, QVector<int>> indexes;
+    for (int i = 0; i < flightNumbers.size(); ++i) {
+        indexes[shardFor(flightNumbers[i], shardCount())].append(i);
+    }
+
+    QVector<int> result(flightNumbers.size(), 0);
+    QVector<int> archived(shardCount(), 0);
+    QVector<QString> errors(shardCount());
+    forEachShard([&](int shard) {
+        if (!indexes.contains(shard)) {
+            return;
+        }
+        const QVector<int>& positions = indexes[shard];
+        QStringList part;
+        for (int index : positions) {
+            part.append(flightNumbers[index]);
+        }
+        QVector<int> partOutcomes;
+        archived[shard] = m_shards[shard]->closeFlights(part, &partOutcomes);
+        if (archived[shard] < 0) {
+            errors[shard] = m_shards[shard]->getLastError();
+        }
+        for (int k = 0; k < positions.size(); ++k) {
+            result[positions[k]] = partOutcomes[k];
+        }
+    });
+    setShardErrors(errors);
+
+    if (outcomes) {
+        *outcomes = result;
+    }
+    int total = 0;
+    for (int count : archived) {
+        if (count < 0) {
+            return -1;
+        }
+        total += count;
+    }
+    return total;
+}
+
+// Удаление на источнике фиксируется только после фиксации вставки на
+// сегменте рейса: при ошибке записи остаются на источнике. Сбой между
+// фиксациями оставляет рейс на обоих сегментах (повтор переноса удалит
+// копию с источника вместе с новыми записями), но не теряет записи.
+int ShardedStorage::moveFlight(int sourceShard, const QString& flightNumber) {
+    const int targetShard = shardFor(flightNumber, shardCount());
+    if (targetShard == sourceShard) {
+        return 0;
+    }
+    DatabaseManager& source = *m_shards[sourceShard];
+    DatabaseManager& target = *m_shards[targetShard];
+    QSqlDatabase sourceDb = source.connection();
+    QSqlDatabase targetDb = target.connection();
+
+    auto fail = [&](int shard, const QString& message) {
+        m_lastError.localData() = QString("Сегмент %1: %2").arg(shard).arg(message);
+        qWarning() << "Перенос рейса" << flightNumber << "-" << m_lastError.localData();
+        sourceDb.rollback();
+        return -1;
+    };
+
+    if (!sourceDb.transaction()) {
+        m_lastError.localData() = QString("Сегмент %1: не удалось начать транзакцию: %2")
+                                      .arg(sourceShard).arg(sourceDb.lastError().text());
+        return -1;
+    }
+    QSqlQuery query(sourceDb);
+    query.setForwardOnly(true);
+    query.prepare(TAKE_FLIGHT_SQL);
+    query.addBindValue(flightNumber);
+    if (!query.exec()) {
+        return fail(sourceShard, "Ошибка чтения рейса: " + query.lastError().text());
+    }
+    QVector<BaggageRecord> records;
+    while (query.next()) {
+        QVector<double> weights;
+        const QString array = query.value(2).toString().mid(1).chopped(1);  // "{1.5,2}" -> "1.5,2"
+        for (const QString& weight : array.split(',', Qt::SkipEmptyParts)) {
+            weights.append(weight.toDouble());
+        }
+        records.append(BaggageRecord(query.value(0).toString(), query.value(1).toString(), weights));
+    }
+    query.finish();
+
+    QString error;
+    if (!DatabaseManager::insertRecordsBatch(targetDb, records, &error)) {
+        return fail(targetShard, error);
+    }
+    target.noteWrite(targetDb);
+    if (!sourceDb.commit()) {
+        qCritical() << "Рейс" << flightNumber << "записан на сегмент" << targetShard
+                    << "и остался на сегменте" << sourceShard;
+        return fail(sourceShard, "Не удалось зафиксировать удаление: " + sourceDb.lastError().text());
+    }
+    source.noteWrite(sourceDb);
+    return records.size();
+}
+
+QVector<FlightStats> ShardedStorage::getClosedFlightStats() {
+    QVector<QVector<FlightStats>> parts(shardCount());
+    forEachShard([&](int i) { parts[i] = m_shards[i]->getClosedFlightStats(); });
+
+    QVector<FlightStats> stats;
+    for (const QVector<FlightStats>& part : parts) {
+        stats += part;
+    }
+    std::sort(stats.begin(), stats.end(), [](const FlightStats& a, const FlightStats& b) {
+        return a.flightNumber < b.flightNumber;
+    });
+    return stats;
+}
+
+// Изменяется первая запись пассажира на сегменте с наименьшим номером
+bool ShardedStorage::changeItemCountByName(const QString& passengerName,
+                                           const QVector<double>& newWeights) {
+    // Версия -1 - все записи пассажира
+    QVector<int> found(shardCount(), 0);
+    forEachShard([&](int i) {
+        found[i] = m_shards[i]->countPassengerChangesSince(passengerName, -1);
+    });
+
+    for (int i = 0; i < shardCount(); ++i) {
+        if (found[i] < 0) {
+            m_lastError.localData() = QString("Сегмент %1: ошибка поиска записи").arg(i);
+            return false;
+        }
+        if (found[i] > 0) {
+            if (!m_shards[i]->changeItemCountByName(passengerName, newWeights)) {
+                m_lastError.localData() = m_shards[i]->getLastError();
+                return false;
+            }
+            return true;
+        }
+    }
+    m_lastError.localData() = "Пассажир с указанным ФИО не найден";
+    return false;
+}
+
+// Как changeItemCountByName: ФИО, не найденные на сегменте, ищутся на следующем
+int ShardedStorage::changeItemsBatch(const QVector<ItemChange>& changes, QVector<int>* outcomes) {
+    QVector<int> result(changes.size(), 0);
+    QVector<int> pending;
+    for (int i = 0; i < changes.size(); ++i) {
+        pending.append(i);
+    }
+
+    int changed = 0;
+    for (int shard = 0; shard < shardCount() && !pending.isEmpty(); ++shard) {
+        QVector<ItemChange> part;
+        for (int index : pending) {
+            part.append(changes[index]);
+        }
+
+        QVector<int> partOutcomes;
+        const int count = m_shards[shard]->changeItemsBatch(part, &partOutcomes);
+        if (count < 0) {
+            // Изменения на предыдущих сегментах уже зафиксированы
+            m_lastError.localData() = QString("Сегмент %1: %2").arg(shard).arg(m_shards[shard]->getLastError());
+            for (int index : pending) {
+                result[index] = -1;
+            }
+            changed = -1;
+            break;
+        }
+        changed += count;
+
+        QVector<int> notFound;
+        for (int k = 0; k < pending.size(); ++k) {
+            if (partOutcomes[k] == 0) {
+                notFound.append(pending[k]);
+            } else {
+                result[pending[k]] = partOutcomes[k];
+            }
+        }
+        pending = notFound;
+    }
+
+    if (outcomes) {
+        *outcomes = result;
+    }
+    return changed;
+}
+
+void ShardedStorage::clearAllRecords() {
+    forEachShard([this](int i) { m_shards[i]->clearAllRecords(); });
+}
+
+int ShardedStorage::getRecordCount() {
+    QVector<int> counts(shardCount(), 0);
+    forEachShard([&](int i) { counts[i] = m_shards[i]->getRecordCount(); });
+
+    int total = 0;
+    for (int count : counts) {
+        total += count;
+    }
+    return total;
+}
+
+QVector<BaggageRecord> ShardedStorage::findRecordsByFlightNumber(const QString& flightNumber) {
+    return shardOf(flightNumber).findRecordsByFlightNumber(flightNumber);
+}
+
+QVector<BaggageRecord> ShardedStorage::findRecordsByPassengerName(const QString& passengerName) {
+    QVector<QVector<BaggageRecord>> parts(shardCount());
+    forEachShard([&](int i) { parts[i] = m_shards[i]->findRecordsByPassengerName(passengerName); });
+
+    QVector<BaggageRecord> records;
+    for (const QVector<BaggageRecord>& part : parts) {
+        records += part;
+    }
+    return records;
+}
+
+int ShardedStorage::resolveBagTag(qint64 tag, BagTagInfo* info) {
+    const qint64 shard = tag / BAG_TAG_RANGE;
+    if (tag <= 0 || shard >= shardCount()) {
+        return 0;
+    }
+    const int found = m_shards[shard]->resolveBagTag(tag, info);
+    if (found < 0) {
+        m_lastError.localData() = QString("Сегмент %1: %2").arg(shard).arg(m_shards[shard]->getLastError());
+    }
+    return found;
+}
+
+// Сегменты по очереди в текущем потоке
+bool ShardedStorage::streamBagTags(const BagTagHandler& handler) {
+    bool stopped = false;
+    for (int i = 0; i < shardCount() && !stopped; ++i) {
+        const bool ok = m_shards[i]->streamBagTags([&handler, &stopped](const BagTagInfo& info) {
+            stopped = !handler(info);
+            return !stopped;
+        });
+        if (!ok && !stopped) {
+            m_lastError.localData() = QString("Сегмент %1: %2").arg(i).arg(m_shards[i]->getLastError());
+            return false;
+        }
+    }
+    return !m_shards.empty();
+}
+
+// Рейс целиком на одном сегменте - агрегаты сегментов не пересекаются
+QVector<FlightStats> ShardedStorage::getFlightStatsByDateRange(const QDateTime& from, const QDateTime& to) {
+    QVector<QVector<FlightStats>> parts(shardCount());
+    QVector<QString> errors(shardCount());
+    forEachShard([&](int i) {
+        parts[i] = m_shards[i]->getFlightStatsByDateRange(from, to);
+        errors[i] = m_shards[i]->getLastError();
+    });
+    m_lastError.localData().clear();
+    setShardErrors(errors);
+    if (!m_lastError.localData().isEmpty()) {
+        return QVector<FlightStats>();
+    }
+
+    QVector<FlightStats> stats;
+    for (const QVector<FlightStats>& part : parts) {
+        stats += part;
+    }
+    std::sort(stats.begin(), stats.end(), [](const FlightStats& a, const FlightStats& b) {
+        return a.flightNumber < b.flightNumber;
+    });
+    return stats;
+}
+
+// Порядок по времени сохраняется внутри сегмента, сегменты чередуются
+bool ShardedStorage::streamRecordsByDateRange(const QDateTime& from, const QDateTime& to,
+                                              const RecordHandler& recordHandler) {
+    return streamShards([this, &from, &to](int i, const RecordHandler& handler) {
+        return m_shards[i]->streamRecordsByDateRange(from, to, handler);
+    }, false, recordHandler);
+}
+
+bool ShardedStorage::streamRecords(const QStringList& flightNumbers, const RecordHandler& recordHandler) {
+    const QHash<int, QStringList> groups = groupByShard(flightNumbers);
+    return streamShards([this, &flightNumbers, &groups](int i, const RecordHandler& handler) {
+        if (flightNumbers.isEmpty()) {
+            return m_shards[i]->streamRecords(QStringList(), handler);
+        }
+        // Пустой список у сегмента означал бы "все рейсы"
+        return !groups.contains(i) || m_shards[i]->streamRecords(groups.value(i), handler);
+    }, true, recordHandler);
+}
+
+bool ShardedStorage::streamShards(const ShardStream& stream, bool byFlight,
+                                  const RecordHandler& recordHandler) {
+    const int count = shardCount();
+    if (count == 0) {
+        m_lastError.localData() = "Сегменты БД не настроены";
+        return false;
+    }
+    if (count == 1) {
+        if (!stream(0, recordHandler)) {
+            m_lastError.localData() = m_shards.front()->getLastError();
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<std::unique_ptr<BoundedQueue<BaggageRecord>>> queues;
+    std::vector<std::unique_ptr<QThread>> threads;
+    QVector<QString> errors(count);
+
+    for (int i = 0; i < count; ++i) {
+        queues.emplace_back(new BoundedQueue<BaggageRecord>(STREAM_QUEUE_CAPACITY));
+    }
+    for (int i = 0; i < count; ++i) {
+        threads.emplace_back(QThread::create([this, &stream, &queues, &errors, i]() {
+            BoundedQueue<BaggageRecord>& queue = *queues[i];
+            if (!stream(i, [&queue](const BaggageRecord& record) { return queue.push(record); })) {
+                errors[i] = m_shards[i]->getLastError();
+            }
+            queue.close();
+            m_shards[i]->releaseThreadConnection();
+        }));
+        threads.back()->start();
+    }
+
+    // Слияние: сегменты отдают записи по возрастанию номера рейса
+    // (порядок сравнения строк может отличаться от сортировки сервера -
+    // тогда нарушается только порядок, записи не теряются)
+    QVector<BaggageRecord> heads(count);
+    QVector<bool> hasHead(count, false);
+    for (int i = 0; i < count; ++i) {
+        hasHead[i] = queues[i]->pop(heads[i]);
+    }
+
+    bool stopped = false;
+    int next = 0;
+    while (!stopped) {
+        int pick = -1;
+        for (int k = 0; k < count; ++k) {
+            const int i = byFlight ? k : (next + k) % count;
+            if (!hasHead[i]) {
+                continue;
+            }
+            if (pick < 0 || (byFlight && heads[i].getFlightNumber() < heads[pick].getFlightNumber())) {
+                pick = i;
+            }
+            if (!byFlight) {
+                break;
+            }
+        }
+        if (pick < 0) {
+            break;
+        }
+        next = pick + 1;
+
+        if (!recordHandler(heads[pick])) {
+            stopped = true;
+        } else {
+            hasHead[pick] = queues[pick]->pop(heads[pick]);
+        }
+    }
+
+    // Остановка обработчиком: закрытые очереди останавливают чтение сегментов
+    for (auto& queue : queues) {
+        queue->close();
+    }
+    for (auto& thread : threads) {
+        thread->wait();
+    }
+
+    if (stopped) {
+        return true;
+    }
+    setShardErrors(errors);
+    return std::all_of(errors.cbegin(), errors.cend(), [](const QString& e) { return e.isEmpty(); });
+}
+
+qint64 ShardedStorage::getDataVersion(int* recordCount) {
+    QVector<qint64> versions(shardCount(), -1);
+    QVector<int> counts(shardCount(), 0);
+    forEachShard([&](int i) { versions[i] = m_shards[i]->getDataVersion(&counts[i]); });
+
+    qint64 version = 0;
+    int total = 0;
+    for (int i = 0; i < shardCount(); ++i) {
+        if (versions[i] < 0) {
+            m_lastError.localData() = QString("Сегмент %1: ошибка чтения версии данных").arg(i);
+            return -1;
+        }
+        version = qMax(version, versions[i]);
+        total += counts[i];
+    }
+    if (recordCount) {
+        *recordCount = total;
+    }
+    return m_shards.empty() ? -1 : version;
+}
+
+int ShardedStorage::countPassengerChangesSince(const QString& passengerName, qint64 version) {
+    QVector<int> counts(shardCount(), 0);
+    forEachShard([&](int i) { counts[i] = m_shards[i]->countPassengerChangesSince(passengerName, version); });
+
+    int total = 0;
+    for (int count : counts) {
+        if (count < 0) {
+            return -1;
+        }
+        total += count;
+    }
+    return total;
+}
+
+int ShardedStorage::countFlightChangesSince(const QStringList& flightNumbers, qint64 version) {
+    int total = 0;
+    const QHash<int, QStringList> groups = groupByShard(flightNumbers);
+    for (auto it = groups.cbegin(); it != groups.cend(); ++it) {
+        const int count = m_shards[it.key()]->countFlightChangesSince(it.value(), version);
+        if (count < 0) {
+            m_lastError.localData() = m_shards[it.key()]->getLastError();
+            return -1;
+        }
+        total += count;
+    }
+    return total;
+}
@@ -0,0 +1,651 @@
+#include "SqliteStorage.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QStandardPaths>
+#include <QDir>
+#include <QFileInfo>
+#include <QThread>
+#include <QDebug>
+
+namespace {
+
+const char MAIN_CONNECTION[] = "baggage_sqlite";
+
+// Выборка записей с вещами; %1 - условие WHERE, %2 - порядок записей
+const char JOINED_SELECT[] =
+    "SELECT br.id, br.flight_number, br.passenger_name, bi.item_number, bi.weight "
+    "FROM baggage_records br "
+    "LEFT JOIN baggage_items bi ON bi.baggage_record_id = br.id "
+    "%1 ORDER BY %2, bi.item_number";
+
+QString placeholders(int count) {
+    QStringList marks;
+    for (int i = 0; i < count; ++i) {
+        marks.append("?");
+    }
+    return marks.join(", ");
+}
+
+qint64 toMicros(const QDateTime& value) {
+    return value.toMSecsSinceEpoch() * 1000;
+}
+
+} // namespace
+
+SqliteStorage& SqliteStorage::instance() {
+    static SqliteStorage instance;
+    return instance;
+}
+
+SqliteStorage::SqliteStorage() : m_ownerThread(QThread::currentThread()) {
+    m_db = QSqlDatabase::addDatabase("QSQLITE", MAIN_CONNECTION);
+}
+
+SqliteStorage::~SqliteStorage() {
+    disconnectFromDatabase();
+}
+
+QString SqliteStorage::defaultPath() {
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/baggage.sqlite";
+}
+
+bool SqliteStorage::open(const QString& path) {
+    disconnectFromDatabase();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    m_path = path;
+    m_db.setDatabaseName(path);
+    if (!openConnection(m_db)) {
+        m_lastError.localData() = "Ошибка открытия базы SQLite: " + m_db.lastError().text();
+        qWarning() << m_lastError.localData();
+        return false;
+    }
+
+    qDebug() << "Открыта база SQLite:" << path;
+    return true;
+}
+
+bool SqliteStorage::connectFromEnvironment(QString* connectionInfo) {
+    QString path = qEnvironmentVariable("BAGGAGE_SQLITE_PATH");
+    if (path.isEmpty()) {
+        path = defaultPath();
+    }
+    if (connectionInfo) {
+        *connectionInfo = "SQLite: " + path;
+    }
+    return open(path);
+}
+
+// Параметры задаются для каждого подключения: WAL и foreign_keys в SQLite
+// действуют на уровне подключения, а не файла
+bool SqliteStorage::openConnection(QSqlDatabase& db) {
+    db.setConnectOptions(QString("QSQLITE_BUSY_TIMEOUT=%1").arg(BUSY_TIMEOUT_MS));
+    if (!db.open()) {
+        return false;
+    }
+
+    QSqlQuery pragma(db);
+    pragma.exec("PRAGMA journal_mode=WAL");
+    pragma.exec("PRAGMA synchronous=NORMAL");
+    pragma.exec("PRAGMA foreign_keys=ON");
+    return true;
+}
+
+void SqliteStorage::disconnectFromDatabase() {
+    if (m_db.isOpen()) {
+        m_db.close();
+        qDebug() << "Закрыта база SQLite";
+    }
+}
+
+bool SqliteStorage::isConnected() const {
+    return m_db.isOpen();
+}
+
+bool SqliteStorage::checkConnection() {
+    QSqlDatabase db = connection();
+    if (db.isOpen() || openConnection(db)) {
+        return true;
+    }
+    m_lastError.localData() = "База SQLite не открыта: " + db.lastError().text();
+    return false;
+}
+
+QSqlDatabase SqliteStorage::connection() {
+    if (QThread::currentThread() == m_ownerThread) {
+        return m_db;
+    }
+
+    if (m_threadConnection.hasLocalData() && !m_threadConnection.localData().isEmpty()) {
+        return QSqlDatabase::database(m_threadConnection.localData(), false);
+    }
+
+    QString name = QString("%1_thread_%2")
+                       .arg(MAIN_CONNECTION)
+                       .arg(reinterpret_cast<quintptr>(QThread::currentThreadId()), 0, 16);
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", name);
+    db.setDatabaseName(m_path);
+    if (!openConnection(db)) {
+        m_lastError.localData() = "Ошибка открытия базы SQLite в потоке: " + db.lastError().text();
+    }
+    m_threadConnection.setLocalData(name);
+    return db;
+}
+
+void SqliteStorage::releaseThreadConnection() {
+    if (QThread::currentThread() == m_ownerThread || !m_threadConnection.hasLocalData()
+        || m_threadConnection.localData().isEmpty()) {
+        return;
+    }
+    const QString name = m_threadConnection.localData();
+    {
+        QSqlDatabase db = QSqlDatabase::database(name, false);
+        if (db.isOpen()) {
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(name);
+    m_threadConnection.setLocalData(QString());
+}
+
+// Функция 1: Создать таблицы
+bool SqliteStorage::createTable() {
+    QSqlQuery query(connection());
+
+    const QStringList statements = {
+        R"(CREATE TABLE IF NOT EXISTS baggage_records (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            flight_number TEXT NOT NULL,
+            passenger_name TEXT NOT NULL,
+            created_at INTEGER NOT NULL,
+            updated_at INTEGER NOT NULL,
+            created_by INTEGER
+        ))",
+        R"(CREATE TABLE IF NOT EXISTS baggage_items (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            baggage_record_id INTEGER NOT NULL
+                REFERENCES baggage_records(id) ON DELETE CASCADE,
+            item_number INTEGER NOT NULL,
+            weight REAL NOT NULL CHECK (weight > 0 AND weight <= 100),
+            UNIQUE (baggage_record_id, item_number)
+        ))",
+        R"(CREATE TABLE IF NOT EXISTS users (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            username TEXT UNIQUE NOT NULL,
+            password_hash TEXT NOT NULL,
+            role TEXT DEFAULT 'user',
+            created_at INTEGER
+        ))",
+        "CREATE INDEX IF NOT EXISTS idx_flight_number ON baggage_records(flight_number)",
+        "CREATE INDEX IF NOT EXISTS idx_passenger_name ON baggage_records(passenger_name)",
+        "CREATE INDEX IF NOT EXISTS idx_created_at ON baggage_records(created_at)",
+        "CREATE INDEX IF NOT EXISTS idx_updated_at ON baggage_records(updated_at)",
+        "CREATE INDEX IF NOT EXISTS idx_baggage_items_record ON baggage_items(baggage_record_id)",
+        // Администратор по умолчанию, как в init-db.sql
+        "INSERT OR IGNORE INTO users (username, password_hash, role) VALUES "
+        "('admin', '286057e1642b4a482258fa71c57d7c700ba55fa8b6b15f5593648c800a1dad02', 'admin')"
+    };
+
+    for (const QString& sql : statements) {
+        if (!query.exec(sql)) {
+            m_lastError.localData() = "Ошибка создания схемы SQLite: " + query.lastError().text();
+            qWarning() << m_lastError.localData();
+            return false;
+        }
+    }
+
+    qDebug() << "Таблицы SQLite созданы успешно";
+    return true;
+}
+
+qint64 SqliteStorage::nextVersion(QSqlDatabase& db) {
+    const qint64 now = QDateTime::currentMSecsSinceEpoch() * 1000;
+    QSqlQuery query(db);
+    if (query.exec("SELECT COALESCE(MAX(updated_at), 0) FROM baggage_records") && query.next()) {
+        return qMax(now, query.value(0).toLongLong() + 1);
+    }
+    return now;
+}
+
+bool SqliteStorage::failTransaction(QSqlDatabase& db, const QString& message) {
+    m_lastError.localData() = message;
+    qWarning() << message;
+    db.rollback();
+    return false;
+}
+
+bool SqliteStorage::insertRecord(QSqlQuery& recordQuery, QSqlQuery& itemQuery,
+                                 const BaggageRecord& record, qint64 version) {
+    recordQuery.bindValue(0, record.getFlightNumber());
+    recordQuery.bindValue(1, record.getPassengerName());
+    recordQuery.bindValue(2, version);
+    recordQuery.bindValue(3, version);
+    if (!recordQuery.exec()) {
+        m_lastError.localData() = "Ошибка добавления записи: " + recordQuery.lastError().text();
+        return false;
+    }
+
+    const qint64 recordId = recordQuery.lastInsertId().toLongLong();
+    const QVector<double> weights = record.getItemWeights();
+    for (int i = 0; i < weights.size(); ++i) {
+        itemQuery.bindValue(0, recordId);
+        itemQuery.bindValue(1, i + 1);
+        itemQuery.bindValue(2, weights[i]);
+        if (!itemQuery.exec()) {
+            m_lastError.localData() = "Ошибка добавления вещи: " + itemQuery.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+// Функция 6: Добавить запись
+bool SqliteStorage::addRecord(const BaggageRecord& record) {
+    if (!record.isValid()) {
+        m_lastError.localData() = "Попытка добавить невалидную запись";
+        qWarning() << m_lastError.localData();
+        return false;
+    }
+    return addRecordsBatch({record});
+}
+
+// Все записи пачки - одной транзакцией с подготовленными запросами
+bool SqliteStorage::addRecordsBatch(const QVector<BaggageRecord>& records) {
+    if (records.isEmpty()) {
+        return true;
+    }
+
+    QSqlDatabase db = connection();
+    if (!db.transaction()) {
+        m_lastError.localData() = "Не удалось начать транзакцию: " + db.lastError().text();
+        qWarning() << m_lastError.localData();
+        return false;
+    }
+
+    const qint64 version = nextVersion(db);
+    QSqlQuery recordQuery(db);
+    QSqlQuery itemQuery(db);
+    recordQuery.prepare("INSERT INTO baggage_records (flight_number, passenger_name, created_at, updated_at) "
+                        "VALUES (?, ?, ?, ?)");
+    itemQuery.prepare("INSERT INTO baggage_items (baggage_record_id, item_number, weight) VALUES (?, ?, ?)");
+
+    for (const BaggageRecord& record : records) {
+        if (!insertRecord(recordQuery, itemQuery, record, version)) {
+            return failTransaction(db, m_lastError.localData());
+        }
+    }
+
+    if (!db.commit()) {
+        return failTransaction(db, "Не удалось зафиксировать транзакцию: " + db.lastError().text());
+    }
+    return true;
+}
+
+// Функция 7: Удалить записи по номерам рейсов (вещи удаляются каскадно)
+int SqliteStorage::deleteRecordsByFlightNumbers(const QStringList& flightNumbers) {
+    if (flightNumbers.isEmpty()) {
+        return 0;
+    }
+
+    QSqlDatabase db = connection();
+    if (!db.transaction()) {
+        m_lastError.localData() = "Не удалось начать транзакцию: " + db.lastError().text();
+        qWarning() << m_lastError.localData();
+        return 0;
+    }
+
+    int affectedRows = 0;
+    QSqlQuery query(db);
+    for (int start = 0; start < flightNumbers.size(); start += IN_LIST_CHUNK_SIZE) {
+        const QStringList chunk = flightNumbers.mid(start, IN_LIST_CHUNK_SIZE);
+        query.prepare(QString("DELETE FROM baggage_records WHERE flight_number IN (%1)")
+                          .arg(placeholders(chunk.size())));
+        for (const QString& flightNumber : chunk) {
+            query.addBindValue(flightNumber);
+        }
+        if (!query.exec()) {
+            failTransaction(db, "Ошибка удаления записей: " + query.lastError().text());
+            return 0;
+        }
+        affectedRows += query.numRowsAffected();
+    }
+
+    if (!db.commit()) {
+        failTransaction(db, "Не удалось зафиксировать транзакцию: " + db.lastError().text());
+        return 0;
+    }
+
+    qDebug() << "Удалено записей SQLite:" << affectedRows;
+    return affectedRows;
+}
+
+// Функция 8: Изменить количество вещей для указанных ФИО
+bool SqliteStorage::changeItemCountByName(const QString& passengerName,
+                                          const QVector<double>& newWeights) {
+    if (passengerName.trimmed().isEmpty()) {
+        m_lastError.localData() = "ФИО пассажира не может быть пустым";
+        return false;
+    }
+    if (!BaggageRecord::isValidItemCount(newWeights.size())) {
+        m_lastError.localData() = "Неверное количество вещей (должно быть от 1 до 5)";
+        return false;
+    }
+    for (double weight : newWeights) {
+        if (!BaggageRecord::isValidWeight(weight)) {
+            m_lastError.localData() = "Неверный вес вещи (должен быть от 0 до 100 кг)";
+            return false;
+        }
+    }
+
+    QSqlDatabase db = connection();
+    if (!db.transaction()) {
+        m_lastError.localData() = "Не удалось начать транзакцию: " + db.lastError().text();
+        qWarning() << m_lastError.localData();
+        return false;
+    }
+
+    // Как в PostgreSQL-версии: изменяется первая запись пассажира
+    QSqlQuery findQuery(db);
+    findQuery.prepare("SELECT id FROM baggage_records WHERE passenger_name = ? ORDER BY id LIMIT 1");
+    findQuery.addBindValue(passengerName);
+    if (!findQuery.exec()) {
+        return failTransaction(db, "Ошибка поиска записи: " + findQuery.lastError().text());
+    }
+    if (!findQuery.next()) {
+        m_lastError.localData() = "Пассажир с указанным ФИО не найден";
+        db.rollback();
+        return false;
+    }
+    const qint64 recordId = findQuery.value(0).toLongLong();
+
+    QSqlQuery query(db);
+    query.prepare("DELETE FROM baggage_items WHERE baggage_record_id = ?");
+    query.addBindValue(recordId);
+    if (!query.exec()) {
+        return failTransaction(db, "Ошибка удаления старых вещей: " + query.lastError().text());
+    }
+
+    query.prepare("INSERT INTO baggage_items (baggage_record_id, item_number, weight) VALUES (?, ?, ?)");
+    for (int i = 0; i < newWeights.size(); ++i) {
+        query.bindValue(0, recordId);
+        query.bindValue(1, i + 1);
+        query.bindValue(2, newWeights[i]);
+        if (!query.exec()) {
+            return failTransaction(db, "Ошибка вставки новой вещи: " + query.lastError().text());
+        }
+    }
+
+    query.prepare("UPDATE baggage_records SET updated_at = ? WHERE id = ?");
+    query.addBindValue(nextVersion(db));
+    query.addBindValue(recordId);
+    if (!query.exec()) {
+        return failTransaction(db, "Ошибка обновления записи: " + query.lastError().text());
+    }
+
+    if (!db.commit()) {
+        return failTransaction(db, "Не удалось зафиксировать транзакцию: " + db.lastError().text());
+    }
+
+    qDebug() << "Обновлены веса в SQLite для:" << passengerName;
+    return true;
+}
+
+void SqliteStorage::clearAllRecords() {
+    QSqlQuery query(connection());
+    if (!query.exec("DELETE FROM baggage_records")) {
+        m_lastError.localData() = "Ошибка очистки таблицы: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+    }
+}
+
+int SqliteStorage::getRecordCount() {
+    QSqlQuery query(connection());
+    if (!query.exec("SELECT COUNT(*) FROM baggage_records") || !query.next()) {
+        m_lastError.localData() = "Ошибка подсчета записей: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        return 0;
+    }
+    return query.value(0).toInt();
+}
+
+// Строки отсортированы по записи; вещи одной записи идут подряд
+bool SqliteStorage::streamJoined(QSqlQuery& query, const RecordHandler& recordHandler) {
+    qint64 lastRecordId = -1;
+    QString flightNumber;
+    QString passengerName;
+    QVector<double> weights;
+
+    while (query.next()) {
+        const qint64 recordId = query.value(0).toLongLong();
+        if (recordId != lastRecordId) {
+            if (lastRecordId != -1
+                && !recordHandler(BaggageRecord(flightNumber, passengerName, weights))) {
+                return true;
+            }
+            lastRecordId = recordId;
+            flightNumber = query.value(1).toString();
+            passengerName = query.value(2).toString();
+            weights.clear();
+        }
+        if (!query.value(4).isNull()) {
+            weights.append(query.value(4).toDouble());
+        }
+    }
+
+    if (lastRecordId != -1) {
+        recordHandler(BaggageRecord(flightNumber, passengerName, weights));
+    }
+    return true;
+}
+
+QVector<BaggageRecord> SqliteStorage::collectJoined(QSqlQuery& query) {
+    QVector<BaggageRecord> records;
+    streamJoined(query, [&records](const BaggageRecord& record) {
+        records.append(record);
+        return true;
+    });
+    return records;
+}
+
+// Функция 2: Получить все записи
+QVector<BaggageRecord> SqliteStorage::getAllRecords(qint64* dataVersion) {
+    QSqlDatabase db = connection();
+
+    // В режиме WAL транзакция чтения видит один снимок файла
+    const bool consistent = dataVersion && db.transaction();
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+
+    if (consistent) {
+        if (!query.exec("SELECT COALESCE(MAX(updated_at), 0) FROM baggage_records") || !query.next()) {
+            m_lastError.localData() = "Ошибка чтения версии данных: " + query.lastError().text();
+            qWarning() << m_lastError.localData();
+            db.rollback();
+            return {};
+        }
+        *dataVersion = query.value(0).toLongLong();
+    }
+
+    if (!query.exec(QString(JOINED_SELECT).arg(QString(), "br.id"))) {
+        m_lastError.localData() = "Ошибка получения записей: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        if (consistent) {
+            db.rollback();
+        }
+        return {};
+    }
+
+    QVector<BaggageRecord> records = collectJoined(query);
+    query.finish();
+    if (consistent) {
+        db.commit();
+    }
+
+    qDebug() << "Загружено записей из SQLite:" << records.size();
+    return records;
+}
+
+QVector<BaggageRecord> SqliteStorage::findRecordsByFlightNumber(const QString& flightNumber) {
+    QSqlQuery query(connection());
+    query.setForwardOnly(true);
+    query.prepare(QString(JOINED_SELECT).arg("WHERE br.flight_number = ?", "br.id"));
+    query.addBindValue(flightNumber);
+    if (!query.exec()) {
+        m_lastError.localData() = "Ошибка поиска по номеру рейса: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        return {};
+    }
+    return collectJoined(query);
+}
+
+QVector<BaggageRecord> SqliteStorage::findRecordsByPassengerName(const QString& passengerName) {
+    QSqlQuery query(connection());
+    query.setForwardOnly(true);
+    query.prepare(QString(JOINED_SELECT).arg("WHERE br.passenger_name = ?", "br.id"));
+    query.addBindValue(passengerName);
+    if (!query.exec()) {
+        m_lastError.localData() = "Ошибка поиска по ФИО: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        return {};
+    }
+    return collectJoined(query);
+}
+
+QVector<FlightStats> SqliteStorage::getFlightStatsByDateRange(const QDateTime& from, const QDateTime& to) {
+    QVector<FlightStats> stats;
+    m_lastError.localData().clear();
+    QSqlQuery query(connection());
+    query.setForwardOnly(true);
+
+    query.prepare("SELECT br.flight_number, COUNT(DISTINCT br.id), COUNT(bi.id), "
+                  "COALESCE(SUM(bi.weight), 0) "
+                  "FROM baggage_records br "
+                  "LEFT JOIN baggage_items bi ON bi.baggage_record_id = br.id "
+                  "WHERE br.created_at BETWEEN ? AND ? "
+                  "GROUP BY br.flight_number "
+                  "ORDER BY br.flight_number");
+    query.addBindValue(toMicros(from));
+    query.addBindValue(toMicros(to));
+
+    if (!query.exec()) {
+        m_lastError.localData() = "Ошибка получения статистики за период: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        return stats;
+    }
+
+    while (query.next()) {
+        FlightStats flight;
+        flight.flightNumber = query.value(0).toString();
+        flight.passengerCount = query.value(1).toInt();
+        flight.itemCount = query.value(2).toInt();
+        flight.totalWeight = query.value(3).toDouble();
+        stats.append(flight);
+    }
+    return stats;
+}
+
+bool SqliteStorage::streamRecordsByDateRange(const QDateTime& from, const QDateTime& to,
+                                             const RecordHandler& recordHandler) {
+    QSqlQuery query(connection());
+    query.setForwardOnly(true);
+    query.prepare(QString(JOINED_SELECT).arg("WHERE br.created_at BETWEEN ? AND ?",
+                                             "br.created_at, br.id"));
+    query.addBindValue(toMicros(from));
+    query.addBindValue(toMicros(to));
+    if (!query.exec()) {
+        m_lastError.localData() = "Ошибка получения записей за период: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        return false;
+    }
+    return streamJoined(query, recordHandler);
+}
+
+bool SqliteStorage::streamRecords(const QStringList& flightNumbers, const RecordHandler& recordHandler) {
+    QSqlQuery query(connection());
+    query.setForwardOnly(true);
+
+    if (flightNumbers.isEmpty()) {
+        if (!query.exec(QString(JOINED_SELECT).arg(QString(), "br.flight_number, br.id"))) {
+            m_lastError.localData() = "Ошибка чтения записей: " + query.lastError().text();
+            qWarning() << m_lastError.localData();
+            return false;
+        }
+        return streamJoined(query, recordHandler);
+    }
+
+    // Порции по отсортированному списку - общий порядок по рейсам сохраняется
+    QStringList sorted = flightNumbers;
+    sorted.sort();
+    sorted.removeDuplicates();
+
+    bool stopped = false;
+    const RecordHandler handler = [&](const BaggageRecord& record) {
+        stopped = !recordHandler(record);
+        return !stopped;
+    };
+
+    for (int start = 0; start < sorted.size() && !stopped; start += IN_LIST_CHUNK_SIZE) {
+        const QStringList chunk = sorted.mid(start, IN_LIST_CHUNK_SIZE);
+        query.prepare(QString(JOINED_SELECT)
+                          .arg(QString("WHERE br.flight_number IN (%1)").arg(placeholders(chunk.size())),
+                               "br.flight_number, br.id"));
+        for (const QString& flightNumber : chunk) {
+            query.addBindValue(flightNumber);
+        }
+        if (!query.exec()) {
+            m_lastError.localData() = "Ошибка чтения записей: " + query.lastError().text();
+            qWarning() << m_lastError.localData();
+            return false;
+        }
+        streamJoined(query, handler);
+    }
+    return true;
+}
+
+qint64 SqliteStorage::getDataVersion(int* recordCount) {
+    QSqlQuery query(connection());
+    if (!query.exec("SELECT COALESCE(MAX(updated_at), 0), COUNT(*) FROM baggage_records") || !query.next()) {
+        m_lastError.localData() = "Ошибка чтения версии данных: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        return -1;
+    }
+    if (recordCount) {
+        *recordCount = query.value(1).toInt();
+    }
+    return query.value(0).toLongLong();
+}
+
+int SqliteStorage::countPassengerChangesSince(const QString& passengerName, qint64 version) {
+    QSqlQuery query(connection());
+    query.prepare("SELECT COUNT(*) FROM baggage_records WHERE passenger_name = ? AND updated_at > ?");
+    query.addBindValue(passengerName);
+    query.addBindValue(version);
+    if (!query.exec() || !query.next()) {
+        m_lastError.localData() = "Ошибка проверки изменений пассажира: " + query.lastError().text();
+        qWarning() << m_lastError.localData();
+        return -1;
+    }
+    return query.value(0).toInt();
+}
+
+int SqliteStorage::countFlightChangesSince(const QStringList& flightNumbers, qint64 version) {
+    int changed = 0;
+    QSqlQuery query(connection());
+    for (int start = 0; start < flightNumbers.size(); start += IN_LIST_CHUNK_SIZE) {
+        const QStringList chunk = flightNumbers.mid(start, IN_LIST_CHUNK_SIZE);
+        query.prepare(QString("SELECT COUNT(*) FROM baggage_records "
+                              "WHERE flight_number IN (%1) AND updated_at > ?")
+                          .arg(placeholders(chunk.size())));
+        for (const QString& flightNumber : chunk) {
+            query.addBindValue(flightNumber);
+        }
+        query.addBindValue(version);
+        if (!query.exec() || !query.next()) {
+            m_lastError.localData() = "Ошибка проверки изменений рейсов: " + query.lastError().text();
+            qWarning() << m_lastError.localData();
+            return -1;
+        }
+        changed += query.value(0).toInt();
+    }
+    return changed;
+}
@@ -0,0 +1,252 @@
+#include "StorageEngine.h"
+#include "DatabaseManager.h"
+#include "SqliteStorage.h"
+#include "MemoryStorage.h"
+#include "ShardedStorage.h"
+#include "BufferedFileWriter.h"
+#include <QMap>
+#include <QHash>
+#include <QDebug>
+
+namespace {
+
+StorageEngine* g_currentEngine = nullptr;
+
+// Шаг вызова прогресса при выгрузке сводки (строк)
+constexpr qint64 SUMMARY_PROGRESS_STEP = 10000;
+
+} // namespace
+
+StorageEngine& StorageEngine::current() {
+    return g_currentEngine ? *g_currentEngine : DatabaseManager::instance();
+}
+
+void StorageEngine::setCurrent(StorageEngine* engine) {
+    g_currentEngine = engine;
+}
+
+StorageEngine& StorageEngine::selectFromEnvironment() {
+    const QString kind = qEnvironmentVariable("BAGGAGE_STORAGE", "postgres").toLower();
+    if (kind == "sqlite") {
+        setCurrent(&SqliteStorage::instance());
+    } else if (kind == "memory") {
+        setCurrent(&MemoryStorage::instance());
+    } else if (kind == "sharded") {
+        setCurrent(&ShardedStorage::instance());
+    } else {
+        if (kind != "postgres") {
+            qWarning() << "Неизвестное хранилище BAGGAGE_STORAGE =" << kind << "- используется PostgreSQL";
+        }
+        setCurrent(&DatabaseManager::instance());
+    }
+    return current();
+}
+
+// Функция 3: Фильтр пассажиров с 1 вещью весом 20-30 кг
+QVector<BaggageRecord> StorageEngine::filterPassengersWithSingleItem20_30kg() {
+    QVector<BaggageRecord> result;
+    streamRecords(QStringList(), [&result](const BaggageRecord& record) {
+        if (record.getItemCount() == 1) {
+            double weight = record.getItemWeights()[0];
+            if (weight >= 20.0 && weight <= 30.0) {
+                result.append(record);
+            }
+        }
+        return true;
+    });
+    return result;
+}
+
+// Функция 4: Сформировать файл сводки потоковым чтением записей
+bool StorageEngine::createSummaryFile(const QString& filename, const SummaryExportOptions& options) {
+    BufferedFileWriter writer;
+    if (!writer.open(filename, options.gzip)) {
+        m_lastError.localData() = "Не удалось создать файл сводки: " + writer.errorString();
+        qWarning() << m_lastError.localData();
+        return false;
+    }
+
+    // Заголовок
+    writer.write(QString("№ рейса\tФ.И.О. пассажира\tОбщий вес багажа (кг)\n"));
+    writer.write(QString("=======================================================\n"));
+
+    const qint64 totalRows = options.progress ? getRecordCount() : 0;
+    qint64 rowsWritten = 0;
+    bool cancelled = false;
+
+    bool ok = streamRecords(QStringList(), [&](const BaggageRecord& record) {
+        writer.write(record.getFlightNumber().toUtf8());
+        writer.write('\t');
+        writer.write(record.getPassengerName().toUtf8());
+        writer.write('\t');
+        writer.write(QByteArray::number(record.getTotalWeight(), 'f', 2));
+        writer.write('\n');
+
+        ++rowsWritten;
+        if (options.progress && rowsWritten % SUMMARY_PROGRESS_STEP == 0 &&
+            !options.progress(rowsWritten, totalRows)) {
+            cancelled = true;
+        }
+        return !cancelled && !writer.hasError();
+    });
+
+    if (cancelled) {
+        writer.discard();
+        m_lastError.localData() = "Создание файла сводки отменено";
+        qDebug() << m_lastError.localData();
+        return false;
+    }
+
+    if (!ok) {
+        writer.discard();
+        return false;
+    }
+
+    if (!writer.close()) {
+        m_lastError.localData() = "Ошибка записи в файл сводки: " + writer.errorString();
+        qWarning() << m_lastError.localData();
+        return false;
+    }
+
+    if (options.progress) {
+        options.progress(rowsWritten, totalRows);
+    }
+    return true;
+}
+
+QString StorageEngine::itemChangeError(const QString& passengerName, const QVector<double>& weights) {
+    if (passengerName.trimmed().isEmpty()) {
+        return "ФИО пассажира не может быть пустым";
+    }
+    if (!BaggageRecord::isValidItemCount(weights.size())) {
+        return "Неверное количество вещей (должно быть от 1 до 5)";
+    }
+    for (double weight : weights) {
+        if (!BaggageRecord::isValidWeight(weight)) {
+            return "Неверный вес вещи (должен быть от 0 до 100 кг)";
+        }
+    }
+    return QString();
+}
+
+// Функция 7 по одному рейсу. deleteRecordsByFlightNumbers при ошибке
+// возвращает 0 - ошибку рейса отличает установленная ею последняя ошибка
+int StorageEngine::deleteFlightsBatch(const QStringList& flightNumbers, QVector<int>* outcomes) {
+    if (outcomes) {
+        outcomes->fill(0, flightNumbers.size());
+    }
+    int total = 0;
+    QString firstError;
+    for (int i = 0; i < flightNumbers.size(); ++i) {
+        m_lastError.localData().clear();
+        int deleted = deleteRecordsByFlightNumbers({flightNumbers[i]});
+        if (deleted == 0 && !m_lastError.localData().isEmpty()) {
+            deleted = -1;
+            if (firstError.isEmpty()) {
+                firstError = m_lastError.localData();
+            }
+        } else {
+            total += deleted;
+        }
+        if (outcomes) {
+            (*outcomes)[i] = deleted;
+        }
+    }
+    m_lastError.localData() = firstError;
+    return total;
+}
+
+// Функция 8 по одному пассажиру
+int StorageEngine::changeItemsBatch(const QVector<ItemChange>& changes, QVector<int>* outcomes) {
+    QHash<QString, int> lastIndex;
+    for (int i = 0; i < changes.size(); ++i) {
+        lastIndex.insert(changes[i].first, i);
+    }
+
+    QVector<int> result(changes.size(), 0);
+    int changed = 0;
+    for (int i = 0; i < changes.size(); ++i) {
+        if (lastIndex.value(changes[i].first) != i) {
+            continue;
+        }
+        if (!itemChangeError(changes[i].first, changes[i].second).isEmpty()) {
+            result[i] = -1;
+        } else if (changeItemCountByName(changes[i].first, changes[i].second)) {
+            result[i] = 1;
+            ++changed;
+        }
+    }
+
+    if (outcomes) {
+        for (int i = 0; i < changes.size(); ++i) {
+            result[i] = result[lastIndex.value(changes[i].first)];
+        }
+        *outcomes = result;
+    }
+    return changed;
+}
+
+int StorageEngine::closeFlights(const QStringList& flightNumbers, QVector<int>* outcomes) {
+    if (outcomes) {
+        outcomes->fill(-1, flightNumbers.size());
+    }
+    m_lastError.localData() = "Архив закрытых рейсов недоступен для хранилища " + engineName();
+    qWarning() << m_lastError.localData();
+    return -1;
+}
+
+QVector<FlightStats> StorageEngine::getClosedFlightStats() {
+    return QVector<FlightStats>();
+}
+
+bool StorageEngine::getRecordsChangedSince(qint64 version, QVector<BaggageRecord>* records,
+                                           qint64* dataVersion, int* recordCount) {
+    Q_UNUSED(version);
+    Q_UNUSED(records);
+    Q_UNUSED(dataVersion);
+    Q_UNUSED(recordCount);
+    m_lastError.localData() = "Догоняющее чтение недоступно для хранилища " + engineName();
+    return false;
+}
+
+int StorageEngine::resolveBagTag(qint64 tag, BagTagInfo* info) {
+    Q_UNUSED(tag);
+    Q_UNUSED(info);
+    m_lastError.localData() = "Бирки вещей недоступны для хранилища " + engineName();
+    qWarning() << m_lastError.localData();
+    return -1;
+}
+
+bool StorageEngine::streamBagTags(const BagTagHandler& handler) {
+    Q_UNUSED(handler);
+    m_lastError.localData() = "Бирки вещей недоступны для хранилища " + engineName();
+    qWarning() << m_lastError.localData();
+    return false;
+}
+
+QVector<BaggageRecord> StorageEngine::getRecordsByDateRange(const QDateTime& from, const QDateTime& to) {
+    QVector<BaggageRecord> records;
+    streamRecordsByDateRange(from, to, [&records](const BaggageRecord& record) {
+        records.append(record);
+        return true;
+    });
+    return records;
+}
+
+QVector<FlightStats> StorageEngine::getFlightStatsByDateRange(const QDateTime& from, const QDateTime& to) {
+    // QMap - результат упорядочен по номеру рейса, как ORDER BY в PostgreSQL
+    QMap<QString, FlightStats> byFlight;
+    m_lastError.localData().clear();
+    const bool ok = streamRecordsByDateRange(from, to, [&byFlight](const BaggageRecord& record) {
+        FlightStats& flight = byFlight[record.getFlightNumber()];
+        flight.flightNumber = record.getFlightNumber();
+        ++flight.passengerCount;
+        flight.itemCount += record.getItemCount();
+        flight.totalWeight += record.getTotalWeight();
+        return true;
+    });
+    if (!ok) {
+        return QVector<FlightStats>();
+    }
+    return byFlight.values().toVector();
+}
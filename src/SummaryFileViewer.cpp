@@ -0,0 +1,160 @@
+#include "SummaryFileViewer.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QPushButton>
+#include <QFileInfo>
+#include <QFont>
+#include <QDebug>
+
+// ==================== SummaryFileModel ====================
+
+SummaryFileModel::SummaryFileModel(MappedTextFile* file, QObject* parent)
+    : QAbstractListModel(parent), m_file(file), m_rowCount(0) {
+    connect(m_file, &MappedTextFile::linesIndexed, this, &SummaryFileModel::onLinesIndexed);
+}
+
+int SummaryFileModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : m_rowCount;
+}
+
+QVariant SummaryFileModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    return m_file->line(index.row());
+}
+
+void SummaryFileModel::onLinesIndexed(int lineCount) {
+    if (lineCount <= m_rowCount) {
+        return;
+    }
+    beginInsertRows(QModelIndex(), m_rowCount, lineCount - 1);
+    m_rowCount = lineCount;
+    endInsertRows();
+}
+
+// ==================== SummaryFileViewer ====================
+
+SummaryFileViewer::SummaryFileViewer(QWidget* parent)
+    : QDialog(parent), m_file(new MappedTextFile(this)) {
+    setWindowTitle("Просмотр файла сводки");
+    resize(700, 500);
+    m_model = new SummaryFileModel(m_file, this);
+    createUI();
+
+    connect(m_file, &MappedTextFile::linesIndexed, this, &SummaryFileViewer::onLinesIndexed);
+    connect(m_file, &MappedTextFile::indexingFinished, this, &SummaryFileViewer::onIndexingFinished);
+}
+
+SummaryFileViewer::~SummaryFileViewer() {
+    // Останавливаем фоновую индексацию до удаления модели
+    m_file->close();
+}
+
+void SummaryFileViewer::createUI() {
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
+
+    // Панель перехода и поиска
+    QHBoxLayout* toolsLayout = new QHBoxLayout();
+
+    m_lineSpinBox = new QSpinBox(this);
+    m_lineSpinBox->setRange(1, 1);
+    toolsLayout->addWidget(new QLabel("Строка:", this));
+    toolsLayout->addWidget(m_lineSpinBox);
+
+    QPushButton* goButton = new QPushButton("Перейти", this);
+    toolsLayout->addWidget(goButton);
+
+    toolsLayout->addSpacing(20);
+
+    m_searchEdit = new QLineEdit(this);
+    m_searchEdit->setPlaceholderText("Поиск (рейс, ФИО)...");
+    toolsLayout->addWidget(m_searchEdit);
+
+    QPushButton* findButton = new QPushButton("Найти далее", this);
+    toolsLayout->addWidget(findButton);
+
+    mainLayout->addLayout(toolsLayout);
+
+    // Виртуальный список: отрисовываются только видимые строки
+    m_listView = new QListView(this);
+    m_listView->setModel(m_model);
+    m_listView->setUniformItemSizes(true);
+    m_listView->setLayoutMode(QListView::Batched);
+    m_listView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_listView->setFont(QFont("Monospace", 10));
+    mainLayout->addWidget(m_listView);
+
+    m_statusLabel = new QLabel(this);
+    mainLayout->addWidget(m_statusLabel);
+
+    // Кнопка "Закрыть"
+    QPushButton* closeButton = new QPushButton("Закрыть", this);
+    mainLayout->addWidget(closeButton);
+
+    connect(goButton, &QPushButton::clicked, this, &SummaryFileViewer::onGoToLine);
+    connect(m_lineSpinBox, &QSpinBox::editingFinished, this, &SummaryFileViewer::onGoToLine);
+    connect(findButton, &QPushButton::clicked, this, &SummaryFileViewer::onFindNext);
+    connect(m_searchEdit, &QLineEdit::returnPressed, this, &SummaryFileViewer::onFindNext);
+    connect(closeButton, &QPushButton::clicked, this, &QDialog::accept);
+}
+
+bool SummaryFileViewer::openFile(const QString& filename) {
+    if (!m_file->open(filename)) {
+        return false;
+    }
+
+    setWindowTitle("Просмотр файла сводки - " + QFileInfo(filename).fileName());
+    m_statusLabel->setText("Индексация строк...");
+    return true;
+}
+
+void SummaryFileViewer::onGoToLine() {
+    int row = m_lineSpinBox->value() - 1;
+    if (row < 0 || row >= m_model->rowCount()) {
+        return;
+    }
+
+    QModelIndex index = m_model->index(row);
+    m_listView->setCurrentIndex(index);
+    m_listView->scrollTo(index, QAbstractItemView::PositionAtCenter);
+}
+
+void SummaryFileViewer::onFindNext() {
+    QString text = m_searchEdit->text();
+    if (text.isEmpty()) {
+        return;
+    }
+
+    // Поиск начинается со строки после текущей
+    int fromLine = m_listView->currentIndex().isValid() ? m_listView->currentIndex().row() + 1 : 0;
+    int found = m_file->findNext(text, fromLine);
+    if (found < 0 && fromLine > 0) {
+        found = m_file->findNext(text, 0);   // продолжаем с начала файла
+    }
+
+    if (found < 0) {
+        m_statusLabel->setText(m_file->isIndexComplete()
+                                   ? "Не найдено: " + text
+                                   : "Не найдено в проиндексированной части: " + text);
+        return;
+    }
+
+    QModelIndex index = m_model->index(found);
+    m_listView->setCurrentIndex(index);
+    m_listView->scrollTo(index, QAbstractItemView::PositionAtCenter);
+    m_statusLabel->setText(QString("Найдено в строке %1").arg(found + 1));
+}
+
+void SummaryFileViewer::onLinesIndexed(int lineCount) {
+    m_lineSpinBox->setRange(1, qMax(1, lineCount));
+    m_statusLabel->setText(QString("Индексация строк... %1").arg(lineCount));
+}
+
+void SummaryFileViewer::onIndexingFinished(int lineCount) {
+    m_lineSpinBox->setRange(1, qMax(1, lineCount));
+    m_statusLabel->setText(QString("Строк: %1 | Размер: %2 КБ")
+                               .arg(lineCount)
+                               .arg(m_file->fileSize() / 1024));
+    qDebug() << "Индексация файла сводки завершена, строк:" << lineCount;
+}
@@ -0,0 +1,205 @@
+#include "WriteBehindQueue.h"
+#include "DatabaseManager.h"
+#include <QThread>
+#include <QDeadlineTimer>
+#include <QMutexLocker>
+#include <QDebug>
+
+WriteBehindQueue::WriteBehindQueue(const WriteBehindOptions& options)
+    : m_options(options), m_thread(nullptr), m_stopping(true) {
+    m_options.maxBatchSize = qMax(1, m_options.maxBatchSize);
+    m_options.maxDelayMs = qMax(0, m_options.maxDelayMs);
+    m_options.maxPending = qMax(m_options.maxBatchSize, m_options.maxPending);
+}
+
+WriteBehindQueue::~WriteBehindQueue() {
+    stop();
+}
+
+bool WriteBehindQueue::start() {
+    if (m_thread) {
+        return true;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = false;
+    }
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->start();
+    return true;
+}
+
+void WriteBehindQueue::stop() {
+    if (!m_thread) {
+        return;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_notEmpty.wakeAll();
+        m_notFull.wakeAll();
+    }
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+}
+
+QFuture<WriteResult> WriteBehindQueue::enqueue(const BaggageRecord& record) {
+    PendingWrite write;
+    write.record = record;
+    write.promise.reportStarted();
+    QFuture<WriteResult> future = write.promise.future();
+    push(std::move(write));
+    return future;
+}
+
+void WriteBehindQueue::enqueue(const BaggageRecord& record, const Callback& callback) {
+    PendingWrite write;
+    write.record = record;
+    write.promise.reportStarted();
+    write.callback = callback;
+    push(std::move(write));
+}
+
+// Невалидные записи и записи после stop() завершаются сразу, без очереди
+bool WriteBehindQueue::push(PendingWrite&& write) {
+    BaggageRecord::ValidationError validation = write.record.validate();
+    if (validation != BaggageRecord::NoError) {
+        resolve(write, {false, BaggageRecord::validationErrorText(validation)});
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    while (m_pending.size() >= m_options.maxPending && !m_stopping) {
+        m_notFull.wait(&m_mutex);
+    }
+    if (m_stopping) {
+        locker.unlock();
+        resolve(write, {false, "Очередь отложенной записи остановлена"});
+        return false;
+    }
+
+    m_pending.enqueue(std::move(write));
+    m_notEmpty.wakeOne();
+    return true;
+}
+
+WriteBehindStats WriteBehindQueue::stats() const {
+    QMutexLocker locker(&m_mutex);
+    return m_stats;
+}
+
+void WriteBehindQueue::run() {
+    const QString connectionName = QString("baggage_write_behind_%1")
+                                       .arg(reinterpret_cast<quintptr>(this), 0, 16);
+    {
+        QSqlDatabase db = DatabaseManager::instance().openWorkerConnection(connectionName);
+
+        QVector<PendingWrite> group;
+        group.reserve(m_options.maxBatchSize);
+        forever {
+            {
+                QMutexLocker locker(&m_mutex);
+                while (m_pending.isEmpty() && !m_stopping) {
+                    m_notEmpty.wait(&m_mutex);
+                }
+                if (m_pending.isEmpty()) {
+                    break;   // остановка и очередь пуста
+                }
+
+                // Первая запись пришла - ждём добора группы не дольше maxDelayMs
+                QDeadlineTimer deadline(m_options.maxDelayMs);
+                while (m_pending.size() < m_options.maxBatchSize && !m_stopping
+                       && !deadline.hasExpired()) {
+                    m_notEmpty.wait(&m_mutex, deadline);
+                }
+
+                while (!m_pending.isEmpty() && group.size() < m_options.maxBatchSize) {
+                    group.append(m_pending.dequeue());
+                }
+                m_notFull.wakeAll();
+            }
+
+            commitGroup(db, group);
+            group.clear();
+        }
+    }
+    DatabaseManager::closeWorkerConnection(connectionName);
+}
+
+void WriteBehindQueue::commitGroup(QSqlDatabase& db, QVector<PendingWrite>& group) {
+    QVector<BaggageRecord> records;
+    records.reserve(group.size());
+    for (const PendingWrite& write : group) {
+        records.append(write.record);
+    }
+
+    QString error;
+    bool ok;
+    {
+        QMutexLocker commitLocker(m_options.commitLock);
+        ok = DatabaseManager::insertRecordsBatch(db, records, &error);
+        if (ok && m_options.onCommitted) {
+            m_options.onCommitted(records);
+        }
+    }
+
+    if (ok) {
+        // До ответа клиентам: их следующие чтения не должны уйти на отстающую реплику
+        DatabaseManager::instance().noteWrite(db);
+        {
+            QMutexLocker locker(&m_mutex);
+            m_stats.recordsWritten += group.size();
+            ++m_stats.groupsCommitted;
+        }
+        for (PendingWrite& write : group) {
+            resolve(write, {true, QString()});
+        }
+        return;
+    }
+
+    if (group.size() == 1) {
+        {
+            QMutexLocker locker(&m_mutex);
+            ++m_stats.recordsFailed;
+        }
+        resolve(group.first(), {false, error});
+        return;
+    }
+
+    // Группа откатилась целиком - повторяем по одной записи
+    qWarning() << "Групповой коммит не удался, повтор по одной записи:" << error;
+    for (PendingWrite& write : group) {
+        QVector<BaggageRecord> single(1, write.record);
+        QString singleError;
+        bool singleOk;
+        {
+            QMutexLocker commitLocker(m_options.commitLock);
+            singleOk = DatabaseManager::insertRecordsBatch(db, single, &singleError);
+            if (singleOk && m_options.onCommitted) {
+                m_options.onCommitted(single);
+            }
+        }
+        if (singleOk) {
+            DatabaseManager::instance().noteWrite(db);
+        }
+        {
+            QMutexLocker locker(&m_mutex);
+            if (singleOk) {
+                ++m_stats.recordsWritten;
+                ++m_stats.groupsCommitted;
+            } else {
+                ++m_stats.recordsFailed;
+            }
+        }
+        resolve(write, {singleOk, singleError});
+    }
+}
+
+void WriteBehindQueue::resolve(PendingWrite& write, const WriteResult& result) {
+    write.promise.reportResult(result);
+    write.promise.reportFinished();
+    if (write.callback) {
+        write.callback(result);
+    }
+}
@@ -0,0 +1,674 @@
+#include "DatabaseManager.h"
+#include "FlightArchive.h"
+#include "ReportWriter.h"
+#include "WriteBehindQueue.h"
+#include "BenchFixture.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QBuffer>
+#include <QThread>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QSqlRecord>
+#include <QHash>
+#include <QRegularExpression>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Замеры и проверки для разработки; в поставку для cron не входит (см. baggage-cli).
+// Замеры с БД пишут только на тестовые рейсы BenchFixture и удаляют их после себя:
+//   baggage-bench archive-verify [--records <n>] (архив: запись и чтение без БД, сравнение записей)
+//   baggage-bench bench-insert [--records <n>] [--clients <n>] [--group-delay <мс>]
+//   baggage-bench bench-storage [--records <n>]  (BAGGAGE_STORAGE=memory - базовый замер)
+//   baggage-bench bench-read [--records <n>]     (разбор строк getAllRecords)
+//   baggage-bench bench-tags [--records <n>]     (поиск по бирке: БД и индекс в памяти)
+//   baggage-bench bench-validate [--records <n>] (проверка рейса и ФИО: регулярные выражения и сканер)
+//   baggage-bench scan-load [--records <n>] [--rate <n/с>]  (поток событий для baggage-cli scan-ingest в stdout)
+// Итоги печатаются в stdout в виде key=value, ошибки - в stderr.
+
+namespace {
+
+constexpr int EXIT_OK = 0;
+constexpr int EXIT_FAILED = 1;
+constexpr int EXIT_USAGE = 2;
+
+QTextStream& out() {
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+QTextStream& err() {
+    static QTextStream stream(stderr);
+    return stream;
+}
+
+// Проверка архива без БД: записи с общими префиксами ФИО, повторами рейсов
+// и весами от 0,01 до 100 кг пишутся в архив в памяти и читаются обратно.
+// Внутри блока архив упорядочивает записи, поэтому сравнение - после
+// сортировки по (рейс, ФИО); веса сравниваются в сотых долях кг.
+int runArchiveVerify(int records) {
+    QVector<BaggageRecord> source = BenchFixture::archiveRecords(records);
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QElapsedTimer timer;
+    timer.start();
+    FlightArchiveWriter writer;
+    writer.open(&buffer);
+    for (const BaggageRecord& record : source) {
+        writer.write(record);
+    }
+    if (!writer.close()) {
+        err() << writer.errorString() << "\n";
+        return EXIT_FAILED;
+    }
+    const qint64 writeMs = timer.restart();
+    buffer.close();
+
+    buffer.open(QIODevice::ReadOnly);
+    FlightArchiveReader reader;
+    QVector<BaggageRecord> loaded;
+    if (reader.open(&buffer)) {
+        loaded = reader.readAll();
+    }
+    const qint64 readMs = timer.elapsed();
+    if (reader.hasError()) {
+        err() << reader.errorString() << "\n";
+        return EXIT_FAILED;
+    }
+
+    auto byFlightAndName = [](const BaggageRecord& a, const BaggageRecord& b) {
+        return a.getFlightNumber() != b.getFlightNumber() ? a.getFlightNumber() < b.getFlightNumber()
+                                                          : a.getPassengerName() < b.getPassengerName();
+    };
+    std::sort(source.begin(), source.end(), byFlightAndName);
+    std::sort(loaded.begin(), loaded.end(), byFlightAndName);
+
+    int mismatched = qAbs(source.size() - loaded.size());
+    for (int i = 0; i < qMin(source.size(), loaded.size()); ++i) {
+        const BaggageRecord& a = source[i];
+        const BaggageRecord& b = loaded[i];
+        bool same = a.getFlightNumber() == b.getFlightNumber() && a.getPassengerName() == b.getPassengerName()
+                    && a.getItemCount() == b.getItemCount();
+        const QVector<double> expected = a.getItemWeights();
+        const QVector<double> actual = b.getItemWeights();
+        for (int k = 0; same && k < expected.size(); ++k) {
+            same = qRound64(expected[k] * 100.0) == qRound64(actual[k] * 100.0);
+        }
+        if (!same) {
+            if (mismatched == 0) {
+                err() << "Расхождение: " << a.getFlightNumber() << " \"" << a.getPassengerName() << "\"\n";
+            }
+            ++mismatched;
+        }
+    }
+
+    out() << "records=" << source.size()
+          << " loaded=" << loaded.size()
+          << " mismatched=" << mismatched
+          << " archive_bytes=" << buffer.size()
+          << " bytes_per_record=" << QString::number(double(buffer.size()) / qMax(1, records), 'f', 2)
+          << " write_ms=" << writeMs
+          << " read_ms=" << readMs << "\n";
+    return mismatched == 0 ? EXIT_OK : EXIT_FAILED;
+}
+
+// clients потоков, каждый синхронно добавляет свою долю записей (как стойки регистрации)
+struct BenchResult {
+    qint64 elapsedMs = 0;
+    qint64 failed = 0;
+    qint64 commits = 0;
+};
+
+BenchResult runBenchClients(int records, int clients, WriteBehindQueue* queue) {
+    std::atomic<qint64> failed(0);
+    std::vector<std::unique_ptr<QThread>> threads;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int c = 0; c < clients; ++c) {
+        threads.emplace_back(QThread::create([c, clients, records, queue, &failed]() {
+            for (int i = c; i < records; i += clients) {
+                bool ok;
+                if (queue) {
+                    ok = queue->enqueue(BenchFixture::record(i)).result().ok;
+                } else {
+                    ok = DatabaseManager::instance().addRecord(BenchFixture::record(i));
+                }
+                if (!ok) {
+                    ++failed;
+                }
+            }
+            DatabaseManager::instance().releaseThreadConnection();
+        }));
+        threads.back()->start();
+    }
+    for (auto& thread : threads) {
+        thread->wait();
+    }
+
+    BenchResult result;
+    result.elapsedMs = qMax<qint64>(1, timer.elapsed());
+    result.failed = failed.load();
+    result.commits = queue ? queue->stats().groupsCommitted : records - result.failed;
+    return result;
+}
+
+void printBench(const QString& mode, int records, int clients, const BenchResult& result) {
+    out() << "mode=" << mode
+          << " records=" << records
+          << " clients=" << clients
+          << " failed=" << result.failed
+          << " commits=" << result.commits
+          << " elapsed_ms=" << result.elapsedMs
+          << " records_per_sec=" << QString::number((records - result.failed) * 1000.0 / result.elapsedMs, 'f', 0)
+          << " commits_per_sec=" << QString::number(result.commits * 1000.0 / result.elapsedMs, 'f', 0)
+          << "\n";
+    out().flush();
+}
+
+// Сравнение addRecord (транзакция на запись) и группового коммита
+int runBenchInsert(int records, int clients, int groupDelayMs) {
+    const QStringList flights = BenchFixture::flightNumbers();
+
+    // Не трогаем рейсы, если на них уже есть реальные данные
+    QString error;
+    if (!BenchFixture::flightsAreFree(DatabaseManager::instance(), &error)) {
+        err() << error << "\n";
+        return EXIT_FAILED;
+    }
+
+    BenchResult direct = runBenchClients(records, clients, nullptr);
+    printBench("direct", records, clients, direct);
+    DatabaseManager::instance().deleteRecordsByFlightNumbers(flights);
+
+    WriteBehindOptions options;
+    options.maxDelayMs = groupDelayMs;
+    WriteBehindQueue queue(options);
+    queue.start();
+    BenchResult grouped = runBenchClients(records, clients, &queue);
+    queue.stop();
+    printBench("write_behind", records, clients, grouped);
+    DatabaseManager::instance().deleteRecordsByFlightNumbers(flights);
+
+    return direct.failed == 0 && grouped.failed == 0 ? EXIT_OK : EXIT_FAILED;
+}
+
+/**
+ * @brief Приёмник отчёта для замеров: только считает строки
+ */
+class CountingReportSink : public ReportSink {
+public:
+    bool writeLine(const QString&) override {
+        ++lines;
+        return true;
+    }
+
+    qint64 lines = 0;
+};
+
+void printStorageBench(const QString& op, qint64 count, qint64 elapsedMs) {
+    elapsedMs = qMax<qint64>(1, elapsedMs);
+    out() << "engine=" << StorageEngine::current().engineName()
+          << " op=" << op
+          << " count=" << count
+          << " elapsed_ms=" << elapsedMs
+          << " ops_per_sec=" << QString::number(count * 1000.0 / elapsedMs, 'f', 0)
+          << "\n";
+    out().flush();
+}
+
+// Замер операций хранилища, отчёта и сводки на тестовых рейсах.
+// С BAGGAGE_STORAGE=memory - базовая линия без сети и сервера БД.
+int runBenchStorage(int records) {
+    StorageEngine& storage = StorageEngine::current();
+    const QStringList flights = BenchFixture::flightNumbers();
+    const int lookups = qMin(records, 1000);
+
+    QString error;
+    if (!BenchFixture::flightsAreFree(storage, &error)) {
+        err() << error << "\n";
+        return EXIT_FAILED;
+    }
+
+    const QDateTime from = QDateTime::currentDateTime().addSecs(-1);
+    QElapsedTimer timer;
+    bool ok = true;
+
+    timer.start();
+    QVector<BaggageRecord> batch;
+    for (int i = 0; i < records && ok; ++i) {
+        batch.append(BenchFixture::record(i));
+        if (batch.size() == BenchFixture::BATCH_SIZE || i == records - 1) {
+            ok = storage.addRecordsBatch(batch);
+            batch.clear();
+        }
+    }
+    printStorageBench("insert_batch", records, timer.elapsed());
+
+    timer.restart();
+    const int loaded = storage.getAllRecords().size();
+    printStorageBench("get_all", loaded, timer.elapsed());
+
+    timer.restart();
+    for (const QString& flight : flights) {
+        storage.findRecordsByFlightNumber(flight);
+    }
+    printStorageBench("find_flight", flights.size(), timer.elapsed());
+
+    timer.restart();
+    for (int i = 0; i < lookups; ++i) {
+        storage.findRecordsByPassengerName(BenchFixture::record(i).getPassengerName());
+    }
+    printStorageBench("find_passenger", lookups, timer.elapsed());
+
+    timer.restart();
+    for (int i = 0; i < lookups && ok; ++i) {
+        ok = storage.changeItemCountByName(BenchFixture::record(i).getPassengerName(), {12.5, 7.0, 3.25});
+    }
+    printStorageBench("change_items", lookups, timer.elapsed());
+
+    timer.restart();
+    const int filtered = storage.filterPassengersWithSingleItem20_30kg().size();
+    printStorageBench("filter", filtered, timer.elapsed());
+
+    timer.restart();
+    DateRangeReportWriter report(from, QDateTime::currentDateTime().addSecs(1));
+    CountingReportSink sink;
+    ok = report.write(sink) && ok;
+    printStorageBench("report", report.recordCount(), timer.elapsed());
+
+    const QString summaryPath = QDir::temp().filePath("baggage-bench-summary.txt");
+    timer.restart();
+    ok = storage.createSummaryFile(summaryPath) && ok;
+    printStorageBench("summary", storage.getRecordCount(), timer.elapsed());
+    QFile::remove(summaryPath);
+
+    timer.restart();
+    const int deleted = storage.deleteRecordsByFlightNumbers(flights);
+    printStorageBench("delete", deleted, timer.elapsed());
+
+    if (!ok) {
+        err() << storage.getLastError() << "\n";
+    }
+    return ok && deleted == records ? EXIT_OK : EXIT_FAILED;
+}
+
+// Поиск по бирке: запрос к БД на каждую бирку против индекса в памяти
+// (QHash, как в BaggageManager). Замеряются бирки, уже записанные в БД.
+int runBenchTags(int lookups) {
+    StorageEngine& storage = StorageEngine::current();
+
+    QHash<qint64, BagTagInfo> index;
+    QElapsedTimer timer;
+    timer.start();
+    if (!storage.streamBagTags([&index](const BagTagInfo& info) {
+            index.insert(info.tag, info);
+            return true;
+        })) {
+        err() << storage.getLastError() << "\n";
+        return EXIT_FAILED;
+    }
+    const qint64 buildNs = timer.nsecsElapsed();
+    if (index.isEmpty()) {
+        err() << "В БД нет вещей с бирками, замер отменён\n";
+        return EXIT_FAILED;
+    }
+    out() << "op=build_index tags=" << index.size() << " elapsed_ms=" << buildNs / 1000000 << "\n";
+
+    QVector<qint64> tags;
+    tags.reserve(lookups);
+    for (auto it = index.cbegin(); tags.size() < lookups; ++it) {
+        if (it == index.cend()) {
+            it = index.cbegin();
+        }
+        tags.append(it.key());
+    }
+
+    // Первый запрос готовит его на подключении
+    storage.resolveBagTag(tags.first(), nullptr);
+    QVector<qint64> latencies;
+    latencies.reserve(tags.size());
+    int missed = 0;
+    timer.restart();
+    for (qint64 tag : tags) {
+        const qint64 start = timer.nsecsElapsed();
+        if (storage.resolveBagTag(tag, nullptr) != 1) {
+            ++missed;
+        }
+        latencies.append(timer.nsecsElapsed() - start);
+    }
+    const qint64 serverNs = qMax<qint64>(1, timer.nsecsElapsed());
+    std::sort(latencies.begin(), latencies.end());
+    out() << "op=resolve_storage lookups=" << tags.size()
+          << " missed=" << missed
+          << " elapsed_ms=" << serverNs / 1000000
+          << " us_avg=" << serverNs / tags.size() / 1000
+          << " us_p99=" << latencies[qMin(latencies.size() - 1, latencies.size() * 99 / 100)] / 1000
+          << " lookups_per_sec=" << qint64(tags.size() * 1e9 / serverNs) << "\n";
+
+    qint64 checksum = 0;
+    timer.restart();
+    for (qint64 tag : tags) {
+        checksum += index.value(tag).itemNumber;
+    }
+    const qint64 indexNs = qMax<qint64>(1, timer.nsecsElapsed());
+    out() << "op=resolve_index lookups=" << tags.size()
+          << " elapsed_ms=" << indexNs / 1000000
+          << " ns_avg=" << indexNs / tags.size()
+          << " lookups_per_sec=" << qint64(tags.size() * 1e9 / indexNs)
+          << " checksum=" << checksum << "\n";
+    return missed == 0 ? EXIT_OK : EXIT_FAILED;
+}
+
+// Генератор нагрузки для scan-ingest: события по records / 4 биркам и точкам
+// маршрута багажа; rate - событий в секунду (0 - без ограничения)
+int runScanLoad(int records, int rate) {
+    static const char* const locations[] = {"CHECKIN", "SORT-1", "SORT-2", "SCREENING",
+                                            "MAKEUP", "LOADING", "CLAIM"};
+    const int locationCount = sizeof(locations) / sizeof(locations[0]);
+    const int tagCount = qMax(1, records / 4);
+
+    QFile file;
+    if (!file.open(stdout, QIODevice::WriteOnly)) {
+        err() << "Не удалось открыть stdout: " << file.errorString() << "\n";
+        return EXIT_FAILED;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    QByteArray buffer;
+    for (int i = 0; i < records; ++i) {
+        const qint64 tag = 1 + i % tagCount;
+        buffer += QByteArray::number(tag) + '\t' + locations[(i / tagCount) % locationCount] + '\t'
+                  + QByteArray::number(QDateTime::currentMSecsSinceEpoch()) + '\n';
+
+        // Опережаем заданную скорость - отдаём накопленное и ждём
+        const qint64 aheadMs = rate > 0 ? qint64(i + 1) * 1000 / rate - timer.elapsed() : 0;
+        if (buffer.size() >= 64 * 1024 || aheadMs > 0 || i + 1 == records) {
+            if (file.write(buffer) != buffer.size() || !file.flush()) {
+                return EXIT_FAILED;   // читатель закрыл канал
+            }
+            buffer.clear();
+        }
+        if (aheadMs > 0) {
+            QThread::msleep(static_cast<unsigned long>(aheadMs));
+        }
+    }
+    return EXIT_OK;
+}
+
+void printReadBench(const QString& op, qint64 rows, qint64 elapsedNs) {
+    elapsedNs = qMax<qint64>(1, elapsedNs);
+    out() << "op=" << op
+          << " rows=" << rows
+          << " elapsed_ms=" << elapsedNs / 1000000
+          << " ns_per_row=" << (rows > 0 ? elapsedNs / rows : 0)
+          << "\n";
+    out().flush();
+}
+
+// Обход уже полученной выборки: замеряется только разбор строк
+template <typename Decode>
+qint64 timeDecode(QSqlQuery& query, qint64* rows, Decode decode) {
+    QElapsedTimer timer;
+    timer.start();
+    *rows = 0;
+    if (query.first()) {
+        do {
+            decode(query);
+            ++*rows;
+        } while (query.next());
+    }
+    return timer.nsecsElapsed();
+}
+
+// Чтение всех записей: getAllRecords целиком, затем отдельно разбор строк
+// той же выборки по именам столбцов и по номерам, найденным один раз
+int runBenchRead(int records) {
+    if (StorageEngine::current().engineName() != "postgres") {
+        err() << "Команда bench-read доступна только для PostgreSQL (BAGGAGE_STORAGE=postgres)\n";
+        return EXIT_USAGE;
+    }
+    DatabaseManager& db = DatabaseManager::instance();
+    const QStringList flights = BenchFixture::flightNumbers();
+
+    QString error;
+    if (!BenchFixture::flightsAreFree(db, &error)) {
+        err() << error << "\n";
+        return EXIT_FAILED;
+    }
+
+    QVector<BaggageRecord> batch;
+    batch.reserve(records);
+    for (int i = 0; i < records; ++i) {
+        batch.append(BenchFixture::record(i));
+    }
+    if (!db.addRecordsBatch(batch)) {
+        err() << "Ошибка подготовки данных: " << db.getLastError() << "\n";
+        return EXIT_FAILED;
+    }
+
+    // Первый вызов готовит запрос на подключении, замеряются повторные
+    const int repeats = 5;
+    db.getAllRecords();
+    QElapsedTimer timer;
+    timer.start();
+    qint64 loaded = 0;
+    for (int r = 0; r < repeats; ++r) {
+        loaded += db.getAllRecords().size();
+    }
+    printReadBench("get_all_records", loaded, timer.nsecsElapsed());
+
+    QSqlQuery query(db.connection());
+    bool ok = query.exec(R"(
+        SELECT br.id, br.flight_number, br.passenger_name,
+               bi.item_number, bi.weight
+        FROM baggage_records br
+        LEFT JOIN baggage_items bi ON bi.baggage_record_id = br.id
+        ORDER BY br.id, bi.item_number
+    )");
+    if (ok) {
+        // Сумма по полям - чтобы разбор не был выброшен оптимизатором
+        double checksum = 0;
+        qint64 rows = 0;
+        qint64 elapsed = timeDecode(query, &rows, [&checksum](const QSqlQuery& row) {
+            checksum += row.value("id").toInt() + row.value("flight_number").toString().size()
+                        + row.value("passenger_name").toString().size() + row.value("weight").toDouble();
+        });
+        printReadBench("decode_by_name", rows, elapsed);
+
+        const QSqlRecord columns = query.record();
+        const int id = columns.indexOf("id");
+        const int flightNumber = columns.indexOf("flight_number");
+        const int passengerName = columns.indexOf("passenger_name");
+        const int weight = columns.indexOf("weight");
+        elapsed = timeDecode(query, &rows, [&](const QSqlQuery& row) {
+            checksum -= row.value(id).toInt() + row.value(flightNumber).toString().size()
+                        + row.value(passengerName).toString().size() + row.value(weight).toDouble();
+        });
+        printReadBench("decode_by_index", rows, elapsed);
+        out() << "checksum=" << QString::number(checksum, 'f', 2) << "\n";
+    } else {
+        err() << "Ошибка выборки: " << query.lastError().text() << "\n";
+    }
+    query.finish();
+
+    db.deleteRecordsByFlightNumbers(flights);
+    return ok ? EXIT_OK : EXIT_FAILED;
+}
+
+// Прежние валидаторы на QRegularExpression - базовая линия для bench-validate
+bool regexValidFlightNumber(const QString& flightNumber) {
+    QString trimmed = flightNumber.trimmed();
+    if (trimmed.isEmpty() || trimmed.length() < 4 || trimmed.length() > 10) {
+        return false;
+    }
+    if (trimmed.contains(QRegularExpression("[<>{}\\[\\]$;'\"`\\\\]"))) {
+        return false;
+    }
+    QRegularExpression regex("^[A-Z]{2}\\d{3,4}$");
+    return regex.match(trimmed).hasMatch();
+}
+
+bool regexValidPassengerName(const QString& name) {
+    QString trimmed = name.trimmed();
+    if (trimmed.length() < 3 || trimmed.length() > 255) {
+        return false;
+    }
+    if (trimmed.contains(QRegularExpression("[<>{}\\[\\]$;'\"`\\\\]"))) {
+        return false;
+    }
+    return trimmed.contains(QRegularExpression("[А-Яа-яA-Za-z]"));
+}
+
+// Проверка номеров рейсов и ФИО: прежние регулярные выражения против
+// однопроходных проверок BaggageRecord. Среди значений есть недопустимые;
+// расхождение итогов двух реализаций - ошибка. БД не нужна.
+int runBenchValidate(int records) {
+    static const QStringList invalidFlights = {"SU12", "su123", "SU12345", "S1234", "SU<12", " BA45 "};
+    static const QStringList invalidNames = {"Ив", "Иванов; DROP", "12345", "Петров <b>", "   "};
+    QStringList flights;
+    QStringList names;
+    flights.reserve(records);
+    names.reserve(records);
+    for (int i = 0; i < records; ++i) {
+        if (i % 10 == 0) {
+            flights.append(invalidFlights[i / 10 % invalidFlights.size()]);
+            names.append(invalidNames[i / 10 % invalidNames.size()]);
+        } else {
+            const BaggageRecord record = BenchFixture::record(i);
+            flights.append(i % 3 == 0 ? " " + record.getFlightNumber() + " " : record.getFlightNumber());
+            names.append(record.getPassengerName());
+        }
+    }
+
+    QVector<bool> before(records);
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < records; ++i) {
+        before[i] = regexValidFlightNumber(flights[i]) && regexValidPassengerName(names[i]);
+    }
+    printReadBench("validate_regex", records, timer.nsecsElapsed());
+
+    QVector<bool> after(records);
+    timer.restart();
+    for (int i = 0; i < records; ++i) {
+        after[i] = BaggageRecord::isValidFlightNumber(flights[i]) && BaggageRecord::isValidPassengerName(names[i]);
+    }
+    printReadBench("validate_scan", records, timer.nsecsElapsed());
+
+    int valid = 0;
+    int mismatched = 0;
+    for (int i = 0; i < records; ++i) {
+        valid += after[i] ? 1 : 0;
+        if (before[i] != after[i]) {
+            if (mismatched == 0) {
+                err() << "Расхождение: \"" << flights[i] << "\" \"" << names[i] << "\"\n";
+            }
+            ++mismatched;
+        }
+    }
+    out() << "valid=" << valid << " invalid=" << records - valid << " mismatched=" << mismatched << "\n";
+    return mismatched == 0 ? EXIT_OK : EXIT_FAILED;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("baggage-bench");
+    QCoreApplication::setApplicationVersion("2.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Замеры производительности и проверки системы управления багажом.\n"
+        "Команды: archive-verify, bench-insert, bench-storage, bench-read, bench-tags,\n"
+        "bench-validate, scan-load (archive-verify, bench-validate и scan-load - без БД).\n"
+        "Подключение к БД - те же переменные DB_* и BAGGAGE_STORAGE, что у baggage-cli\n"
+        "(bench-insert и bench-read - только PostgreSQL).");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("command", "archive-verify | bench-insert | bench-storage | bench-read | "
+                                            "bench-tags | bench-validate | scan-load");
+
+    QCommandLineOption recordsOption("records", "Записей в замере.", "n", "2000");
+    QCommandLineOption clientsOption("clients", "Параллельных клиентов в bench-insert.", "n", "16");
+    QCommandLineOption groupDelayOption("group-delay", "Ожидание добора группы, мс.", "ms", "5");
+    QCommandLineOption rateOption("rate", "scan-load: событий в секунду (0 - без ограничения).", "n", "0");
+    parser.addOption(recordsOption);
+    parser.addOption(clientsOption);
+    parser.addOption(groupDelayOption);
+    parser.addOption(rateOption);
+    parser.process(app);
+
+    const QStringList positional = parser.positionalArguments();
+    if (positional.size() != 1) {
+        parser.showHelp(EXIT_USAGE);
+    }
+    const QString command = positional.first();
+    const int records = qMax(1, parser.value(recordsOption).toInt());
+
+    static const QStringList commands = {"archive-verify", "bench-insert", "bench-storage", "bench-read",
+                                         "bench-tags", "bench-validate", "scan-load"};
+    if (!commands.contains(command)) {
+        err() << "Неизвестная команда: " << command << "\n";
+        return EXIT_USAGE;
+    }
+
+    // Команды, которым не нужна БД
+    if (command == "archive-verify") {
+        int result = runArchiveVerify(records);
+        out().flush();
+        return result;
+    }
+    if (command == "bench-validate") {
+        int result = runBenchValidate(records);
+        out().flush();
+        return result;
+    }
+    if (command == "scan-load") {
+        return runScanLoad(records, parser.value(rateOption).toInt());
+    }
+
+    StorageEngine& dbManager = StorageEngine::selectFromEnvironment();
+    // Групповой коммит и разбор строк PostgreSQL - только на PostgreSQL
+    if (dbManager.isEmbedded() && (command == "bench-insert" || command == "bench-read")) {
+        err() << "Команда " << command << " доступна только для PostgreSQL (BAGGAGE_STORAGE=postgres)\n";
+        return EXIT_USAGE;
+    }
+
+    QString connectionInfo;
+    if (!dbManager.connectFromEnvironment(&connectionInfo)) {
+        err() << "Не удалось подключиться к БД: " << dbManager.getLastError() << "\n"
+              << connectionInfo << "\n";
+        return EXIT_FAILED;
+    }
+    if (dbManager.isEmbedded() && !dbManager.createTable()) {
+        err() << "Не удалось создать таблицы: " << dbManager.getLastError() << "\n";
+        return EXIT_FAILED;
+    }
+
+    int result = EXIT_USAGE;
+    if (command == "bench-insert") {
+        result = runBenchInsert(records, qMax(1, parser.value(clientsOption).toInt()),
+                                parser.value(groupDelayOption).toInt());
+    } else if (command == "bench-storage") {
+        result = runBenchStorage(records);
+    } else if (command == "bench-read") {
+        result = runBenchRead(records);
+    } else if (command == "bench-tags") {
+        result = runBenchTags(records);
+    }
+
+    out().flush();
+    err().flush();
+    dbManager.disconnectFromDatabase();
+    return result;
+}
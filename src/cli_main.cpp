@@ -0,0 +1,882 @@
+#include "DatabaseManager.h"
+#include "BulkImporter.h"
+#include "FlightArchive.h"
+#include "ReportWriter.h"
+#include "MutationJournal.h"
+#include "JournalReplayer.h"
+#include "BaggageSnapshot.h"
+#include "ShardedStorage.h"
+#include "PurgeEngine.h"
+#include "ScanEventIngestor.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QFile>
+#include <atomic>
+#include <csignal>
+#include <QDebug>
+
+// Пакетная утилита без GUI для ночных заданий (cron):
+//   baggage-cli summary <файл> [--gzip]
+//   baggage-cli report --from <дата> --to <дата> [--output <файл>] [--gzip]
+//   baggage-cli delete [рейс...]            (без рейсов - список со stdin)
+//   baggage-cli import <файл> [--errors <файл>] [--threads <n>] [--batch <n>]
+//   baggage-cli export <файл.bga> [рейс...]
+//   baggage-cli change-items [файл]          (строки "ФИО<TAB>вес,вес,..."; без файла - stdin)
+//   baggage-cli close-flight [рейс...]      (перенести в архив; без рейсов - список со stdin)
+//   baggage-cli closed-flights                (итоги закрытых рейсов)
+//   baggage-cli bag-tag <бирка...>            (вещь, пассажир и рейс по бирке)
+//   baggage-cli purge [рейс...] [--days <n>] [--batch <n>] [--pause <мс>]
+//   baggage-cli scan-ingest [файл|-] [--follow] (события сканирования "бирка<TAB>место[<TAB>время]")
+//   baggage-cli shard-rebalance              (BAGGAGE_STORAGE=sharded: перенести рейсы на свои сегменты)
+//   baggage-cli journal-dump <журнал>
+//   baggage-cli journal-replay <журнал>       (перенести отложенные изменения в БД)
+//   baggage-cli journal-rebuild <журнал> [--base <снимок.dat>] -o <снимок.dat>
+// Итоги печатаются в stdout в виде key=value, ошибки - в stderr.
+// Замеры и проверки - отдельная утилита baggage-bench (bench_main.cpp).
+
+namespace {
+
+constexpr int EXIT_OK = 0;
+constexpr int EXIT_FAILED = 1;
+constexpr int EXIT_USAGE = 2;
+constexpr int ARCHIVE_IMPORT_BATCH = 5000;
+
+QTextStream& out() {
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+QTextStream& err() {
+    static QTextStream stream(stderr);
+    return stream;
+}
+
+/**
+ * @brief Вывод отчёта в stdout
+ */
+class StdoutReportSink : public ReportSink {
+public:
+    bool writeLine(const QString& line) override {
+        out() << line << '\n';
+        return out().status() == QTextStream::Ok;
+    }
+};
+
+// Дата без времени: начало дня для from, конец дня для to
+QDateTime parseDateTime(const QString& text, bool endOfDay) {
+    QDateTime dateTime = QDateTime::fromString(text, Qt::ISODate);
+    if (dateTime.isValid()) {
+        return dateTime;
+    }
+    QDate date = QDate::fromString(text, Qt::ISODate);
+    if (!date.isValid()) {
+        return QDateTime();
+    }
+    return endOfDay ? date.endOfDay() : date.startOfDay();
+}
+
+int runSummary(const QStringList& args, bool gzip) {
+    if (args.isEmpty()) {
+        err() << "Не указан файл сводки\n";
+        return EXIT_USAGE;
+    }
+
+    SummaryExportOptions options;
+    options.gzip = gzip;
+
+    if (!StorageEngine::current().createSummaryFile(args.first(), options)) {
+        err() << StorageEngine::current().getLastError() << "\n";
+        return EXIT_FAILED;
+    }
+    out() << "summary=" << args.first() << "\n";
+    return EXIT_OK;
+}
+
+int runReport(const QString& fromText, const QString& toText, const QString& output, bool gzip) {
+    QDateTime from = parseDateTime(fromText, false);
+    QDateTime to = parseDateTime(toText, true);
+    if (!from.isValid() || !to.isValid() || from > to) {
+        err() << "Укажите корректный период: --from и --to (ГГГГ-ММ-ДД или ISO 8601)\n";
+        return EXIT_USAGE;
+    }
+
+    DateRangeReportWriter writer(from, to);
+
+    if (output.isEmpty()) {
+        StdoutReportSink sink;
+        bool ok = writer.write(sink);
+        out().flush();
+        if (!ok) {
+            err() << writer.errorString() << "\n";
+            return EXIT_FAILED;
+        }
+        return EXIT_OK;
+    }
+
+    FileReportSink sink;
+    if (!sink.open(output, gzip)) {
+        err() << sink.errorString() << "\n";
+        return EXIT_FAILED;
+    }
+    if (!writer.write(sink)) {
+        sink.discard();
+        err() << writer.errorString() << "\n";
+        return EXIT_FAILED;
+    }
+    if (!sink.close()) {
+        err() << sink.errorString() << "\n";
+        return EXIT_FAILED;
+    }
+    out() << "report=" << output << " records=" << writer.recordCount() << "\n";
+    return EXIT_OK;
+}
+
+// Номера рейсов из аргументов, без аргументов - со stdin по одному в строке
+QStringList readFlightNumbers(const QStringList& args) {
+    QStringList flightNumbers;
+    for (const QString& arg : args) {
+        flightNumbers.append(arg.trimmed());
+    }
+
+    // Без аргументов - номера рейсов со stdin, по одному в строке
+    if (flightNumbers.isEmpty()) {
+        QTextStream in(stdin);
+        QString line;
+        while (in.readLineInto(&line)) {
+            line = line.trimmed();
+            if (!line.isEmpty() && !line.startsWith('#')) {
+                flightNumbers.append(line);
+            }
+        }
+    }
+
+    flightNumbers.removeAll(QString());
+    flightNumbers.removeDuplicates();
+    return flightNumbers;
+}
+
+int runDelete(const QStringList& args) {
+    const QStringList flightNumbers = readFlightNumbers(args);
+    if (flightNumbers.isEmpty()) {
+        err() << "Список рейсов пуст\n";
+        return EXIT_USAGE;
+    }
+
+    // Ошибка рейса - outcomes -1 (у PostgreSQL - у всех рейсов, транзакция одна)
+    QVector<int> outcomes;
+    int deleted = StorageEngine::current().deleteFlightsBatch(flightNumbers, &outcomes);
+    bool failed = outcomes.size() != flightNumbers.size();
+    for (int i = 0; i < outcomes.size(); ++i) {
+        out() << "flight=" << flightNumbers[i] << " deleted=" << outcomes[i] << "\n";
+        failed = failed || outcomes[i] < 0;
+    }
+    out() << "flights=" << flightNumbers.size() << " deleted=" << deleted << "\n";
+    if (failed) {
+        err() << StorageEngine::current().getLastError() << "\n";
+    }
+    return failed ? EXIT_FAILED : EXIT_OK;
+}
+
+// Закрытие рейсов: записи переносятся в архив, остаются итоги рейса
+int runCloseFlight(const QStringList& args) {
+    const QStringList flightNumbers = readFlightNumbers(args);
+    if (flightNumbers.isEmpty()) {
+        err() << "Список рейсов пуст\n";
+        return EXIT_USAGE;
+    }
+
+    QVector<int> outcomes;
+    const int archived = StorageEngine::current().closeFlights(flightNumbers, &outcomes);
+    for (int i = 0; i < flightNumbers.size(); ++i) {
+        out() << "flight=" << flightNumbers[i] << " archived=" << outcomes[i] << "\n";
+    }
+    out() << "flights=" << flightNumbers.size() << " archived=" << archived << "\n";
+    if (archived < 0) {
+        err() << StorageEngine::current().getLastError() << "\n";
+        return EXIT_FAILED;
+    }
+    return EXIT_OK;
+}
+
+int runClosedFlights() {
+    const QVector<FlightStats> flights = StorageEngine::current().getClosedFlightStats();
+    for (const FlightStats& flight : flights) {
+        out() << "flight=" << flight.flightNumber
+              << " passengers=" << flight.passengerCount
+              << " items=" << flight.itemCount
+              << " weight=" << QString::number(flight.totalWeight, 'f', 2) << "\n";
+    }
+    out() << "closed_flights=" << flights.size() << "\n";
+    return EXIT_OK;
+}
+
+// Строки "ФИО<TAB>вес,вес,..." из файла или stdin - одним пакетом
+int runChangeItems(const QStringList& args) {
+    QFile file;
+    if (args.isEmpty()) {
+        file.open(stdin, QIODevice::ReadOnly);
+    } else {
+        file.setFileName(args.first());
+        if (!file.open(QIODevice::ReadOnly)) {
+            err() << "Не удалось открыть " << args.first() << ": " << file.errorString() << "\n";
+            return EXIT_FAILED;
+        }
+    }
+
+    QVector<StorageEngine::ItemChange> changes;
+    QTextStream in(&file);
+    QString line;
+    int lineNumber = 0;
+    while (in.readLineInto(&line)) {
+        ++lineNumber;
+        if (line.trimmed().isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+        const QStringList fields = line.split('\t');
+        QVector<double> weights;
+        bool ok = fields.size() == 2;
+        for (const QString& part : ok ? fields[1].split(',', Qt::SkipEmptyParts) : QStringList()) {
+            weights.append(part.trimmed().toDouble(&ok));
+            if (!ok) {
+                break;
+            }
+        }
+        if (!ok) {
+            err() << "Строка " << lineNumber << ": ожидается \"ФИО<TAB>вес,вес,...\"\n";
+            return EXIT_USAGE;
+        }
+        changes.append({fields[0].trimmed(), weights});
+    }
+    if (changes.isEmpty()) {
+        err() << "Список изменений пуст\n";
+        return EXIT_USAGE;
+    }
+
+    QVector<int> outcomes;
+    const int changed = StorageEngine::current().changeItemsBatch(changes, &outcomes);
+    for (int i = 0; i < changes.size(); ++i) {
+        out() << "passenger=" << changes[i].first << " result="
+              << (outcomes[i] > 0 ? "changed" : outcomes[i] == 0 ? "not_found" : "error") << "\n";
+    }
+    out() << "changes=" << changes.size() << " changed=" << qMax(0, changed) << "\n";
+    if (changed < 0) {
+        err() << StorageEngine::current().getLastError() << "\n";
+        return EXIT_FAILED;
+    }
+    return EXIT_OK;
+}
+
+// Очистка короткими транзакциями: рейсы из аргументов или записи старше
+// --days (по умолчанию BAGGAGE_RETENTION_DAYS) дней
+// Ctrl+C / SIGTERM во время purge: текущая порция завершается, следующая не
+// начинается. В обработчике - только атомарные операции; повторный сигнал
+// завершает процесс как обычно.
+std::atomic<PurgeEngine*> g_runningPurge(nullptr);
+std::atomic<bool> g_purgeInterrupted(false);
+
+extern "C" void onPurgeSignal(int signal) {
+    g_purgeInterrupted = true;
+    if (PurgeEngine* engine = g_runningPurge.load()) {
+        engine->cancel();
+    }
+    std::signal(signal, SIG_DFL);
+}
+
+int runPurge(const QStringList& flightNumbers, int days, int chunkSize, int pauseMs) {
+    const QVector<DatabaseManager*> databases = PurgeEngine::databasesOf(StorageEngine::current());
+    if (databases.isEmpty()) {
+        err() << "Команда purge доступна только для PostgreSQL\n";
+        return EXIT_USAGE;
+    }
+    if (days <= 0) {
+        days = PurgeEngine::retentionDaysFromEnvironment();
+    }
+    if (flightNumbers.isEmpty() && days <= 0) {
+        err() << "Укажите рейсы или срок хранения (--days или BAGGAGE_RETENTION_DAYS)\n";
+        return EXIT_USAGE;
+    }
+
+    PurgeOptions options;
+    if (chunkSize > 0) {
+        options.chunkSize = chunkSize;
+    }
+    if (pauseMs >= 0) {
+        options.pauseMs = pauseMs;
+    }
+    options.progress = [](const PurgeStats& stats) {
+        err() << "\rУдалено " << stats.recordsDeleted << " из " << stats.recordsMatched;
+        err().flush();
+    };
+
+    const QDateTime cutoff = QDateTime::currentDateTime().addDays(-days);
+    PurgeStats total;
+    bool ok = true;
+    g_purgeInterrupted = false;
+    std::signal(SIGINT, onPurgeSignal);
+    std::signal(SIGTERM, onPurgeSignal);
+    for (DatabaseManager* database : databases) {
+        if (g_purgeInterrupted) {
+            ok = false;
+            break;
+        }
+        PurgeEngine engine(*database);
+        g_runningPurge = &engine;
+        // Сигнал мог прийти до регистрации engine
+        if (g_purgeInterrupted) {
+            engine.cancel();
+        }
+        ok = flightNumbers.isEmpty() ? engine.purgeOlderThan(cutoff, options)
+                                     : engine.purgeFlights(flightNumbers, options);
+        g_runningPurge = nullptr;
+        const PurgeStats stats = engine.stats();
+        total.recordsMatched += stats.recordsMatched;
+        total.recordsDeleted += stats.recordsDeleted;
+        total.chunksCommitted += stats.chunksCommitted;
+        total.elapsedMs += stats.elapsedMs;
+        if (!ok) {
+            if (!engine.isCancelled()) {
+                err() << "\n" << engine.errorString() << "\n";
+            }
+            break;
+        }
+    }
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    if (total.chunksCommitted > 0) {
+        err() << "\n";
+    }
+    if (g_purgeInterrupted) {
+        err() << "Очистка прервана; повторный запуск продолжит с оставшихся записей\n";
+    }
+
+    if (flightNumbers.isEmpty()) {
+        out() << "cutoff=" << cutoff.toString(Qt::ISODate) << " ";
+    } else {
+        out() << "flights=" << flightNumbers.size() << " ";
+    }
+    out() << "matched=" << total.recordsMatched
+          << " deleted=" << total.recordsDeleted
+          << " chunks=" << total.chunksCommitted
+          << " elapsed_ms=" << total.elapsedMs
+          << " records_per_sec=" << QString::number(total.recordsPerSecond(), 'f', 0) << "\n";
+    return ok ? EXIT_OK : EXIT_FAILED;
+}
+
+// Архив .bga загружается пачками через insertRecordsBatch
+int runArchiveImport(const QString& filename) {
+    FlightArchiveReader reader;
+    if (!reader.open(filename)) {
+        err() << reader.errorString() << "\n";
+        return EXIT_FAILED;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QSqlDatabase& db = DatabaseManager::instance().getDatabase();
+    QVector<BaggageRecord> batch;
+    batch.reserve(ARCHIVE_IMPORT_BATCH);
+    qint64 imported = 0;
+    QString error;
+
+    BaggageRecord record;
+    while (reader.readNext(record)) {
+        batch.append(record);
+        if (batch.size() >= ARCHIVE_IMPORT_BATCH) {
+            if (!DatabaseManager::insertRecordsBatch(db, batch, &error)) {
+                break;
+            }
+            imported += batch.size();
+            batch.clear();
+        }
+    }
+    if (error.isEmpty() && !batch.isEmpty()) {
+        if (DatabaseManager::insertRecordsBatch(db, batch, &error)) {
+            imported += batch.size();
+        }
+    }
+    if (imported > 0) {
+        DatabaseManager::instance().noteWrite(db);
+    }
+
+    out() << "imported=" << imported << " elapsed_ms=" << timer.elapsed() << "\n";
+    if (!error.isEmpty()) {
+        err() << error << "\n";
+        return EXIT_FAILED;
+    }
+    if (reader.hasError()) {
+        err() << reader.errorString() << "\n";
+        return EXIT_FAILED;
+    }
+    return EXIT_OK;
+}
+
+int runImport(const QStringList& args, const QString& errorsPath, int threads, int batchSize) {
+    if (args.isEmpty()) {
+        err() << "Не указан файл для импорта\n";
+        return EXIT_USAGE;
+    }
+    if (!DatabaseManager::instance().createTable()) {
+        err() << "Не удалось создать таблицу: " << DatabaseManager::instance().getLastError() << "\n";
+        return EXIT_FAILED;
+    }
+
+    const QString filename = args.first();
+    if (QFileInfo(filename).suffix().compare("bga", Qt::CaseInsensitive) == 0) {
+        return runArchiveImport(filename);
+    }
+
+    ImportOptions options;
+    options.errorReportPath = errorsPath;
+    if (threads > 0) {
+        options.parserThreads = threads;
+    }
+    if (batchSize > 0) {
+        options.batchSize = batchSize;
+    }
+
+    BulkImporter importer;
+    bool success = importer.run(filename, options);
+    ImportStats stats = importer.stats();
+
+    out() << "rows_read=" << stats.rowsRead
+          << " imported=" << stats.rowsImported
+          << " rejected=" << stats.rowsRejected
+          << " batches=" << stats.batchesWritten
+          << " elapsed_ms=" << stats.elapsedMs
+          << " rows_per_sec=" << QString::number(stats.rowsPerSecond(), 'f', 0) << "\n";
+    if (!importer.errorReportPath().isEmpty()) {
+        out() << "errors_report=" << importer.errorReportPath() << "\n";
+    }
+    if (!success) {
+        err() << importer.errorString() << "\n";
+        return EXIT_FAILED;
+    }
+    return EXIT_OK;
+}
+
+int runExport(const QStringList& args) {
+    if (args.isEmpty()) {
+        err() << "Не указан файл архива\n";
+        return EXIT_USAGE;
+    }
+
+    FlightArchiveWriter writer;
+    if (!writer.open(args.first())) {
+        err() << writer.errorString() << "\n";
+        return EXIT_FAILED;
+    }
+
+    qint64 exported = 0;
+    bool ok = StorageEngine::current().streamRecords(args.mid(1),
+        [&writer, &exported](const BaggageRecord& record) {
+            ++exported;
+            return writer.write(record);
+        });
+
+    if (!writer.close() || !ok) {
+        err() << (ok ? writer.errorString() : StorageEngine::current().getLastError()) << "\n";
+        return EXIT_FAILED;
+    }
+    out() << "archive=" << args.first() << " records=" << exported << "\n";
+    return EXIT_OK;
+}
+
+// Бирки из аргументов: вещь, пассажир и рейс
+int runBagTag(const QStringList& args) {
+    if (args.isEmpty()) {
+        err() << "Укажите номера бирок\n";
+        return EXIT_USAGE;
+    }
+    bool failed = false;
+    for (const QString& arg : args) {
+        bool isNumber = false;
+        const qint64 tag = arg.toLongLong(&isNumber);
+        if (!isNumber) {
+            err() << "Неверный номер бирки: " << arg << "\n";
+            failed = true;
+            continue;
+        }
+        BagTagInfo info;
+        const int found = StorageEngine::current().resolveBagTag(tag, &info);
+        if (found < 0) {
+            err() << StorageEngine::current().getLastError() << "\n";
+            failed = true;
+        } else if (found == 0) {
+            out() << "tag=" << tag << " found=0\n";
+        } else {
+            out() << "tag=" << tag << " found=1"
+                  << " flight=" << info.flightNumber
+                  << " passenger=\"" << info.passengerName << "\""
+                  << " item=" << info.itemNumber
+                  << " weight=" << QString::number(info.weight, 'f', 2)
+                  << " archived=" << (info.archived ? 1 : 0) << "\n";
+        }
+    }
+    return failed ? EXIT_FAILED : EXIT_OK;
+}
+
+// События сканирования из файла или stdin ("-"); --follow - ждать новых строк
+// (хвост файла) до прерывания, события ещё не записанной пачки при этом теряются
+int runScanIngest(const QStringList& args, bool follow) {
+    const QString path = args.value(0, "-");
+    QFile file(path);
+    const bool opened = path == "-" ? file.open(stdin, QIODevice::ReadOnly) : file.open(QIODevice::ReadOnly);
+    if (!opened) {
+        err() << "Не удалось открыть " << path << ": " << file.errorString() << "\n";
+        return EXIT_FAILED;
+    }
+
+    QSqlDatabase db = DatabaseManager::instance().connection();
+    QString error;
+    if (!ScanEventIngestor::createTable(db, &error)) {
+        err() << error << "\n";
+        return EXIT_FAILED;
+    }
+
+    ScanEventIngestor ingestor;
+    QElapsedTimer timer;
+    timer.start();
+    ingestor.start();
+    const qint64 lines = ingestor.ingestDevice(&file, follow);
+    ingestor.stop();
+    const qint64 elapsedMs = qMax<qint64>(1, timer.elapsed());
+
+    const ScanIngestStats stats = ingestor.stats();
+    out() << "events=" << lines
+          << " written=" << stats.written
+          << " failed=" << stats.failed
+          << " rejected=" << stats.rejected
+          << " stalls=" << stats.stalls
+          << " retries=" << stats.retries
+          << " batches=" << stats.batches
+          << " elapsed_ms=" << elapsedMs
+          << " events_per_sec=" << qint64(stats.written * 1000.0 / elapsedMs)
+          << " tracked_tags=" << ingestor.trackedTags() << "\n";
+    if (stats.failed > 0) {
+        err() << ingestor.errorString() << "\n";
+    }
+    return stats.failed == 0 && stats.rejected == 0 ? EXIT_OK : EXIT_FAILED;
+}
+
+// Рейсы, лежащие не на своём сегменте (после изменения DB_SHARDS или перехода
+// с одного сервера), переносятся целиком: вставка на новом сегменте, затем
+// удаление на старом. Время создания записей становится временем переноса.
+int runShardRebalance() {
+    if (StorageEngine::current().engineName() != "sharded") {
+        err() << "Команда shard-rebalance требует BAGGAGE_STORAGE=sharded\n";
+        return EXIT_USAGE;
+    }
+
+    ShardedStorage& storage = ShardedStorage::instance();
+    // Новый сегмент может быть ещё пустым
+    if (!storage.createTable()) {
+        err() << "Ошибка создания таблиц: " << storage.getLastError() << "\n";
+        return EXIT_FAILED;
+    }
+    qint64 movedFlights = 0;
+    qint64 movedRecords = 0;
+    bool ok = true;
+
+    for (int i = 0; i < storage.shardCount() && ok; ++i) {
+        DatabaseManager& source = storage.shard(i);
+        QStringList misplaced;
+        QString lastFlight;
+        ok = source.streamRecords(QStringList(), [&](const BaggageRecord& record) {
+            const QString& flight = record.getFlightNumber();
+            if (flight != lastFlight && ShardedStorage::shardFor(flight, storage.shardCount()) != i) {
+                misplaced.append(flight);
+            }
+            lastFlight = flight;
+            return true;
+        });
+        if (!ok) {
+            err() << "Сегмент " << i << ": " << source.getLastError() << "\n";
+            break;
+        }
+        misplaced.removeDuplicates();
+
+        for (const QString& flight : misplaced) {
+            const int moved = storage.moveFlight(i, flight);
+            if (moved < 0) {
+                err() << "Рейс " << flight << ": " << storage.getLastError() << "\n";
+                ok = false;
+                break;
+            }
+            ++movedFlights;
+            movedRecords += moved;
+        }
+    }
+
+    out() << "shards=" << storage.shardCount() << " moved_flights=" << movedFlights
+          << " moved_records=" << movedRecords << "\n";
+    return ok ? EXIT_OK : EXIT_FAILED;
+}
+
+int runJournalDump(const QStringList& args) {
+    if (args.isEmpty()) {
+        err() << "Не указан файл журнала\n";
+        return EXIT_USAGE;
+    }
+
+    QVector<MutationJournal::Entry> entries;
+    QString error;
+    if (!MutationJournal::readEntries(args.first(), entries, &error)) {
+        err() << error << "\n";
+        return EXIT_FAILED;
+    }
+
+    for (const MutationJournal::Entry& entry : entries) {
+        out() << entry.sequence << '\t'
+              << QDateTime::fromMSecsSinceEpoch(entry.timestampMsecs).toString(Qt::ISODateWithMs) << '\t'
+              << MutationJournal::entryTypeName(entry.type);
+        switch (entry.type) {
+        case MutationJournal::AddRecord:
+            out() << '\t' << entry.record.getFlightNumber() << '\t' << entry.record.getPassengerName()
+                  << '\t' << entry.record.getItemCount();
+            break;
+        case MutationJournal::DeleteFlights:
+            out() << '\t' << entry.flightNumbers.join(',') << "\tbase=" << entry.baseVersion;
+            break;
+        case MutationJournal::ChangeItems:
+            out() << '\t' << entry.passengerName << '\t' << entry.weights.size()
+                  << "\tbase=" << entry.baseVersion;
+            break;
+        case MutationJournal::Applied:
+            break;
+        }
+        out() << '\n';
+    }
+    return EXIT_OK;
+}
+
+// Журнал не должен быть открыт приложением на стойке во время переноса
+int runJournalReplay(const QStringList& args) {
+    if (args.isEmpty()) {
+        err() << "Не указан файл журнала\n";
+        return EXIT_USAGE;
+    }
+
+    MutationJournal journal;
+    if (!journal.open(args.first())) {
+        err() << journal.errorString() << "\n";
+        return EXIT_FAILED;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const int before = journal.pendingCount();
+    QVector<JournalReplayer::Skipped> skipped;
+    int applied = JournalReplayer::drain(journal, &skipped);
+
+    int conflicts = 0;
+    for (const JournalReplayer::Skipped& item : skipped) {
+        const MutationJournal::Entry& entry = item.entry;
+        const bool conflict = item.result == JournalReplayer::Conflict;
+        conflicts += conflict ? 1 : 0;
+        err() << (conflict ? "conflict" : "rejected") << '\t' << entry.sequence << '\t'
+              << MutationJournal::entryTypeName(entry.type) << '\t'
+              << (entry.type == MutationJournal::DeleteFlights ? entry.flightNumbers.join(',')
+                  : entry.type == MutationJournal::AddRecord ? entry.record.getPassengerName()
+                                                             : entry.passengerName);
+        if (!conflict) {
+            err() << '\t' << item.error;
+        }
+        err() << "\n";
+    }
+    out() << "pending_before=" << before
+          << " applied=" << applied - skipped.size()
+          << " rejected=" << skipped.size() - conflicts
+          << " conflicts=" << conflicts
+          << " pending_after=" << journal.pendingCount()
+          << " elapsed_ms=" << timer.elapsed() << "\n";
+    return journal.pendingCount() == 0 ? EXIT_OK : EXIT_FAILED;
+}
+
+// Состояние = базовый снимок + все изменения журнала по порядку
+int runJournalRebuild(const QStringList& args, const QString& basePath, const QString& output) {
+    if (args.isEmpty() || output.isEmpty()) {
+        err() << "Укажите файл журнала и -o <снимок.dat>\n";
+        return EXIT_USAGE;
+    }
+
+    QVector<BaggageRecord> records;
+    if (!basePath.isEmpty()) {
+        BaggageSnapshot base;
+        if (!base.open(basePath)) {
+            err() << base.errorString() << "\n";
+            return EXIT_FAILED;
+        }
+        records = base.readAll();
+    }
+
+    QVector<MutationJournal::Entry> entries;
+    QString error;
+    if (!MutationJournal::readEntries(args.first(), entries, &error)) {
+        err() << error << "\n";
+        return EXIT_FAILED;
+    }
+    for (const MutationJournal::Entry& entry : entries) {
+        MutationJournal::applyToRecords(entry, records);
+    }
+
+    if (!BaggageSnapshot::write(output, records, &error)) {
+        err() << error << "\n";
+        return EXIT_FAILED;
+    }
+    out() << "entries=" << entries.size() << " records=" << records.size()
+          << " snapshot=" << output << "\n";
+    return EXIT_OK;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("baggage-cli");
+    QCoreApplication::setApplicationVersion("2.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Пакетные операции системы управления багажом без GUI.\n"
+        "Команды: summary, report, delete, change-items, close-flight, closed-flights, bag-tag,\n"
+        "purge, import, export, shard-rebalance, scan-ingest, journal-dump, journal-replay, journal-rebuild.\n"
+        "Подключение к БД - переменные DB_HOST, DB_PORT, DB_NAME, DB_USER, DB_PASSWORD;\n"
+        "BAGGAGE_STORAGE=sqlite - встроенная БД в файле BAGGAGE_SQLITE_PATH,\n"
+        "BAGGAGE_STORAGE=memory - хранилище в памяти процесса,\n"
+        "BAGGAGE_STORAGE=sharded - рейсы по серверам DB_SHARDS=host:port,host:port\n"
+        "DB_REPLICA_HOST, DB_REPLICA_PORT, DB_REPLICA_MAX_LAG_MS - реплика для отчётов и поиска\n"
+        "(import и scan-ingest - только PostgreSQL).");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("command", "summary | report | delete | change-items | close-flight | closed-flights | "
+                                            "bag-tag | purge | import | export | shard-rebalance | scan-ingest | "
+                                            "journal-dump | journal-replay | journal-rebuild");
+    parser.addPositionalArgument("args", "Аргументы команды (файл, номера рейсов).", "[args...]");
+
+    QCommandLineOption gzipOption("gzip", "Сжать выходной файл (gzip).");
+    QCommandLineOption fromOption("from", "Начало периода отчёта.", "date");
+    QCommandLineOption toOption("to", "Конец периода отчёта.", "date");
+    QCommandLineOption outputOption({"o", "output"}, "Файл отчёта (по умолчанию stdout).", "file");
+    QCommandLineOption errorsOption("errors", "Файл отчёта об ошибках импорта.", "file");
+    QCommandLineOption threadsOption("threads", "Число потоков разбора.", "n");
+    QCommandLineOption batchOption("batch", "Записей в одной транзакции.", "n");
+    QCommandLineOption baseOption("base", "Базовый снимок для journal-rebuild.", "file");
+    QCommandLineOption daysOption("days", "Срок хранения для purge, дней.", "n");
+    QCommandLineOption pauseOption("pause", "Пауза между порциями purge, мс.", "ms");
+    QCommandLineOption followOption("follow", "scan-ingest: ждать новых строк файла.");
+    parser.addOption(gzipOption);
+    parser.addOption(fromOption);
+    parser.addOption(toOption);
+    parser.addOption(outputOption);
+    parser.addOption(errorsOption);
+    parser.addOption(threadsOption);
+    parser.addOption(batchOption);
+    parser.addOption(baseOption);
+    parser.addOption(daysOption);
+    parser.addOption(pauseOption);
+    parser.addOption(followOption);
+    parser.process(app);
+
+    QStringList positional = parser.positionalArguments();
+    if (positional.isEmpty()) {
+        parser.showHelp(EXIT_USAGE);
+    }
+    const QString command = positional.takeFirst();
+
+    static const QStringList commands = {"summary", "report", "delete", "change-items", "close-flight",
+                                         "closed-flights", "bag-tag", "purge", "import", "export",
+                                         "shard-rebalance", "scan-ingest",
+                                         "journal-dump", "journal-replay", "journal-rebuild"};
+    if (!commands.contains(command)) {
+        err() << "Неизвестная команда: " << command << "\n";
+        return EXIT_USAGE;
+    }
+
+    // Команды, которым не нужна БД
+    if (command == "journal-dump") {
+        int result = runJournalDump(positional);
+        out().flush();
+        return result;
+    }
+    if (command == "journal-rebuild") {
+        int result = runJournalRebuild(positional, parser.value(baseOption), parser.value(outputOption));
+        out().flush();
+        return result;
+    }
+
+    StorageEngine& dbManager = StorageEngine::selectFromEnvironment();
+    // Пакетная вставка через unnest() есть только у PostgreSQL
+    if (dbManager.isEmbedded() && command == "import") {
+        err() << "Команда " << command << " доступна только для PostgreSQL (BAGGAGE_STORAGE=postgres)\n";
+        return EXIT_USAGE;
+    }
+    // События пишутся в baggage_events одного сервера (DB_HOST)
+    if (command == "scan-ingest" && dbManager.engineName() != "postgres") {
+        err() << "Команда scan-ingest доступна только для BAGGAGE_STORAGE=postgres\n";
+        return EXIT_USAGE;
+    }
+
+    QString connectionInfo;
+    if (!dbManager.connectFromEnvironment(&connectionInfo)) {
+        err() << "Не удалось подключиться к БД: " << dbManager.getLastError() << "\n"
+              << connectionInfo << "\n";
+        return EXIT_FAILED;
+    }
+    if (dbManager.isEmbedded() && !dbManager.createTable()) {
+        err() << "Не удалось создать таблицы: " << dbManager.getLastError() << "\n";
+        return EXIT_FAILED;
+    }
+
+    int result = EXIT_USAGE;
+    if (command == "summary") {
+        result = runSummary(positional, parser.isSet(gzipOption));
+    } else if (command == "report") {
+        result = runReport(parser.value(fromOption), parser.value(toOption),
+                           parser.value(outputOption), parser.isSet(gzipOption));
+    } else if (command == "delete") {
+        result = runDelete(positional);
+    } else if (command == "change-items") {
+        result = runChangeItems(positional);
+    } else if (command == "close-flight") {
+        result = runCloseFlight(positional);
+    } else if (command == "closed-flights") {
+        result = runClosedFlights();
+    } else if (command == "bag-tag") {
+        result = runBagTag(positional);
+    } else if (command == "purge") {
+        result = runPurge(positional, parser.value(daysOption).toInt(), parser.value(batchOption).toInt(),
+                          parser.isSet(pauseOption) ? parser.value(pauseOption).toInt() : -1);
+    } else if (command == "import") {
+        result = runImport(positional, parser.value(errorsOption),
+                           parser.value(threadsOption).toInt(), parser.value(batchOption).toInt());
+    } else if (command == "export") {
+        result = runExport(positional);
+    } else if (command == "shard-rebalance") {
+        result = runShardRebalance();
+    } else if (command == "scan-ingest") {
+        result = runScanIngest(positional, parser.isSet(followOption));
+    } else if (command == "journal-replay") {
+        result = runJournalReplay(positional);
+    }
+
+    // Где выполнялись чтения (при DB_REPLICA_HOST)
+    if (dbManager.engineName() == "postgres" && DatabaseManager::instance().hasReplica()) {
+        const ReadRoutingStats reads = DatabaseManager::instance().readRoutingStats();
+        out() << "reads_primary=" << reads.primaryReads
+              << " reads_replica=" << reads.replicaReads
+              << " replica_fallbacks=" << reads.replicaFallbacks
+              << " replica_lagged=" << reads.laggedSkips
+              << " replica_stale=" << reads.staleSkips
+              << " replica_lag_ms=" << reads.replicaLagMs << "\n";
+    }
+
+    out().flush();
+    err().flush();
+    dbManager.disconnectFromDatabase();
+    return result;
+}
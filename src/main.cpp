@@ -1,5 +1,5 @@
 #include "MainWindow.h"
-#include "DatabaseManager.h"
+#include "StorageEngine.h"
 #include "LoginDialog.h"
 #include <QApplication>
 #include <QLocale>
@@ -19,36 +19,25 @@ int main(int argc, char *argv[]) {
     // Установка русской локали
     QLocale::setDefault(QLocale(QLocale::Russian, QLocale::Russia));
 
-    // Подключение к PostgreSQL
-    QString dbHost = qEnvironmentVariable("DB_HOST", "postgres");
-    int dbPort = qEnvironmentVariable("DB_PORT", "5432").toInt();
-    QString dbName = qEnvironmentVariable("DB_NAME", "baggage_db");
-    QString dbUser = qEnvironmentVariable("DB_USER", "postgres");
-    QString dbPassword = qEnvironmentVariable("DB_PASSWORD", "postgres");
-
-    DatabaseManager& dbManager = DatabaseManager::instance();
-
-    if (!dbManager.connectToDatabase(dbHost, dbPort, dbName, dbUser, dbPassword)) {
-        QMessageBox::critical(nullptr, "Ошибка подключения к БД",
-                             "Не удалось подключиться к PostgreSQL:\n" +
-                             dbManager.getLastError() + "\n\n" +
-                             "Параметры подключения:\n" +
-                             "Host: " + dbHost + ":" + QString::number(dbPort) + "\n" +
-                             "Database: " + dbName + "\n" +
-                             "User: " + dbUser);
-        return 1;
-    }
-
-    // Создаем таблицу, если её нет
-    if (!dbManager.createTable()) {
+    // Подключение к хранилищу: PostgreSQL или встроенная SQLite (BAGGAGE_STORAGE)
+    StorageEngine& dbManager = StorageEngine::selectFromEnvironment();
+    QString connectionInfo;
+
+    // Без связи с БД стойка запускается автономно: данные из последнего снимка,
+    // изменения копятся в журнале и переносятся в БД фоновой сверкой
+    if (!dbManager.connectFromEnvironment(&connectionInfo)) {
+        qWarning() << "⚠ Нет подключения к БД" << dbManager.engineName() << ", запуск в автономном режиме:"
+                   << dbManager.getLastError() << connectionInfo;
+    } else if (!dbManager.createTable()) {
+        // Создаем таблицу, если её нет
         QMessageBox::critical(nullptr, "Ошибка инициализации БД",
                              "Не удалось создать таблицу:\n" +
                              dbManager.getLastError());
         return 1;
+    } else {
+        qDebug() << "✓ Подключение к БД успешно:" << dbManager.engineName();
     }
 
-    qDebug() << "✓ Подключение к PostgreSQL успешно";
-
     // Загрузка и применение стилей
     QFile styleFile(":/styles.qss");
     if (styleFile.open(QFile::ReadOnly | QFile::Text)) {
@@ -0,0 +1,77 @@
+#include "BaggageService.h"
+#include "DatabaseManager.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QDebug>
+
+// Сервис без GUI: baggage-service [--socket <имя>] [--port <n>] [--listen <адрес>] [--threads <n>]
+//                                  [--write-behind [--group-delay <мс>]] [--scan-socket <имя>]
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    // Имя как у GUI - общий каталог данных и снимок кеша
+    QCoreApplication::setApplicationName("Система управления багажом");
+    QCoreApplication::setApplicationVersion("2.0");
+    QCoreApplication::setOrganizationName("Курсовая работа");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Сервис системы управления багажом (JSON по локальному сокету / TCP)");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption socketOption("socket", "Имя локального сокета (пусто - отключить).", "name",
+                                    "baggage-service");
+    QCommandLineOption portOption("port", "TCP-порт (0 - отключить).", "n", "0");
+    QCommandLineOption listenOption("listen", "Адрес для TCP (не локальный - только с BAGGAGE_SERVICE_TOKEN).",
+                                    "address", "127.0.0.1");
+    QCommandLineOption threadsOption("threads", "Число рабочих потоков.", "n", "0");
+    QCommandLineOption refreshOption("refresh", "Период сверки кеша с БД, секунд.", "n", "60");
+    QCommandLineOption writeBehindOption("write-behind", "Добавления - групповым коммитом.");
+    QCommandLineOption groupDelayOption("group-delay", "Ожидание добора группы, мс.", "ms", "5");
+    QCommandLineOption scanSocketOption("scan-socket", "Локальный сокет событий сканирования бирок.",
+                                        "name");
+    parser.addOption(socketOption);
+    parser.addOption(portOption);
+    parser.addOption(listenOption);
+    parser.addOption(threadsOption);
+    parser.addOption(refreshOption);
+    parser.addOption(writeBehindOption);
+    parser.addOption(groupDelayOption);
+    parser.addOption(scanSocketOption);
+    parser.process(app);
+
+    QTextStream err(stderr);
+    DatabaseManager& dbManager = DatabaseManager::instance();
+    QString connectionInfo;
+    if (!dbManager.connectFromEnvironment(&connectionInfo)) {
+        err << "Не удалось подключиться к PostgreSQL: " << dbManager.getLastError() << "\n"
+            << connectionInfo << "\n";
+        return 1;
+    }
+    if (!dbManager.createTable()) {
+        err << "Не удалось создать таблицу: " << dbManager.getLastError() << "\n";
+        return 1;
+    }
+
+    ServiceOptions options;
+    options.socketName = parser.value(socketOption);
+    options.tcpPort = static_cast<quint16>(parser.value(portOption).toUInt());
+    options.listenAddress = parser.value(listenOption);
+    options.workerThreads = parser.value(threadsOption).toInt();
+    options.cacheRefreshSeconds = parser.value(refreshOption).toInt();
+    options.writeBehind = parser.isSet(writeBehindOption);
+    options.groupDelayMs = parser.value(groupDelayOption).toInt();
+    options.scanSocketName = parser.value(scanSocketOption);
+    options.authToken = qEnvironmentVariable("BAGGAGE_SERVICE_TOKEN");
+
+    BaggageService service;
+    if (!service.start(options)) {
+        err << service.errorString() << "\n";
+        return 1;
+    }
+
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, &service, &BaggageService::stop);
+    int result = app.exec();
+
+    dbManager.disconnectFromDatabase();
+    return result;
+}